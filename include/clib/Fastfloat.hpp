@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+
+#include "Flexfloat.hpp"
+#include "common.hpp"
+
+namespace clib
+{
+
+/*!
+ * \brief Быстрая приближенная эмуляция Flexfloat поверх float
+ *
+ * \details Число хранится как float, уже лежащий на сетке формата (E, M, B). Каждая операция вычисляется в float
+ * и квантуется в формат результата несколькими битовыми операциями:
+ *  - мантисса обрезается (как в Flexfloat::normalise) или округляется к ближайшему четному до M бит;
+ *  - модуль больше max_norm насыщается до max_norm (в Flexfloat нет inf и NaN);
+ *  - в денормализованной области значения обрезаются до кратных min_denorm, меньшие min_denorm - до нуля.
+ *
+ * Формат должен помещаться в нормализованные float: M <= 23, 2^E - 1 - B <= 128, 1 - B >= -126 (см. fits). Тогда
+ * квантование float -> (E, M, B) точное. Нормализованные значения квантуются битовыми операциями, насыщение - min
+ * по битам без ветвления. В quantize остаются два ветвления: по режиму rnd_ (одинаков для всех чисел формата) и по
+ * денормализованной области, где значение делится на min_denorm и округляется trunc или nearbyint. Оба хорошо
+ * предсказываются, пока денормализованные значения редки, но автоматическая векторизация циклов не гарантируется.
+ *
+ * Отличия от Flexfloat (значения (E, M, B) = (5, 10, 15) для примера):
+ *  - sum/sub: Flexfloat выравнивает меньший операнд сдвигом без защитных битов, поэтому при разных знаках
+ *    результат может быть на 1 ulp больше по модулю (1000 - 0.3: Flexfloat 1000, Fastfloat 999.5);
+ *  - точное сокращение x + (-x): Flexfloat возвращает 2^(e - B - M - 1) старшего операнда (1 - 1 = 2^-11) из-за
+ *    ветки cur_mant == 0 в normalise, Fastfloat возвращает +0;
+ *  - mult: произведение сначала округляется float до 24 бит, поэтому при M = 23 результат может отличаться на 1 ulp;
+ *  - inv: Flexfloat использует полиномиальную аппроксимацию (polyfit), Fastfloat - 1 / x с квантованием;
+ *  - to_float нуля: Flexfloat возвращает min_denorm, Fastfloat - 0;
+ *  - from_arithmetic_t(int): |n| > 2^24 сначала округляется до float;
+ *  - при 2^E - 1 - B = 128 (формат (8, 23, 127)) значения от 2^128 недоступны, насыщение - до FLT_MAX.
+ * Сравнения повторяют семантику Flexfloat: operator< это !(lhs > rhs), +0 > -0, == сравнивает знак и значение,
+ * поэтому ветвления в коде конвейеров совпадают при совпадающих значениях
+ */
+class Fastfloat
+{
+  public:
+    using Etype = Flexfloat::Etype;
+    using Mtype = Flexfloat::Mtype;
+    using Btype = Flexfloat::Btype;
+    using hyper_params = Flexfloat::hyper_params;
+
+    /// Способ квантования мантиссы
+    enum class rounding : uint8_t
+    {
+        truncate, ///< обрезание, как в Flexfloat
+        nearest   ///< к ближайшему, половина - к четному
+    };
+
+  private:
+    float v_ = 0.0f;
+    Etype E_ = 0;
+    Mtype M_ = 0;
+    rounding rnd_ = rounding::truncate;
+    Btype B_ = 0;
+
+  public:
+    /// @brief Создает не валидный Fastfloat (формат (0, 0, 0))
+    Fastfloat() = default;
+
+    /*! @brief Создает Fastfloat, квантуя значение в формат
+     *
+     * \param[in] E_n Количество бит в экспоненте
+     * \param[in] M_n Количество бит в мантиссе
+     * \param[in] B_n Bias
+     * \param[in] value Значение
+     * \param[in] rnd Способ квантования
+     */
+    Fastfloat(Etype E_n, Mtype M_n, Btype B_n, float value, rounding rnd = rounding::truncate);
+
+    /*! @brief Помещается ли формат в float
+     */
+    static bool fits(Etype E, Mtype M, Btype B) noexcept;
+
+    /*! @brief Переводит число в формат req_hyperparams (способ квантования сохраняется)
+     */
+    static Fastfloat pack(const Fastfloat &in, hyper_params req_hyperparams);
+
+    Etype get_E() const noexcept
+    {
+        return E_;
+    }
+    Mtype get_M() const noexcept
+    {
+        return M_;
+    }
+    Btype get_B() const noexcept
+    {
+        return B_;
+    }
+    rounding get_rounding() const noexcept
+    {
+        return rnd_;
+    }
+
+    //! Maximal normalized value = 2^(Emax - B) * (2 - 2^(-M))
+    Fastfloat max_norm() const;
+    //! Minimal normalized value = 2^(1-B)
+    Fastfloat min_norm() const;
+    //! Minimal denormalized value = 2^(1-B-M)
+    Fastfloat min_denorm() const;
+
+    /*! @brief Квантует x в формат this
+     *
+     * \return Ближайшее вниз по модулю (или ближайшее для rounding::nearest) значение формата
+     */
+    float quantize(float x) const noexcept
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &x, sizeof(bits));
+        const uint32_t sign = bits & 0x80000000u;
+        bits &= 0x7fffffffu;
+
+        float a = 0.0f;
+        if (bits < pow2_bits(1 - B_))
+        {
+            // Денормализованная область: сетка с шагом min_denorm, нули ниже min_denorm
+            const float q = pow2(1 - B_ - M_);
+            float mag = 0.0f;
+            std::memcpy(&mag, &bits, sizeof(mag));
+            a = (rnd_ == rounding::truncate ? std::trunc(mag / q) : std::nearbyint(mag / q)) * q;
+            std::memcpy(&bits, &a, sizeof(bits));
+        }
+        else
+        {
+            // Нормализованная область: остается M старших бит мантиссы float
+            const unsigned drop = 23u - M_;
+            if (rnd_ == rounding::nearest && drop != 0)
+                bits += ((1u << (drop - 1)) - 1u) + ((bits >> drop) & 1u);
+            bits &= ~((1u << drop) - 1u);
+        }
+
+        // Насыщение. Включает inf, которую может дать float
+        bits = std::min(bits, max_norm_bits());
+        bits |= sign;
+
+        std::memcpy(&a, &bits, sizeof(a));
+        return a;
+    }
+
+    float to_float() const noexcept
+    {
+        return v_;
+    }
+
+    /*! @brief Округление до ближайшего целого, половина - от нуля (как Flexfloat::to_int)
+     */
+    int to_int() const;
+
+    /*! @brief Точное преобразование из Flexfloat того же формата
+     */
+    static Fastfloat from_flexfloat(const Flexfloat &val);
+
+    /*! @brief Преобразование в Flexfloat того же формата
+     */
+    Flexfloat to_flexfloat() const;
+
+    static Fastfloat from_arithmetic_t(Etype E, Mtype M, Btype B, float flt);
+    static Fastfloat from_arithmetic_t(const Fastfloat &hyperparams, float flt);
+    static void from_arithmetic_t(float flt, const Fastfloat &in, Fastfloat &out);
+
+    static Fastfloat from_arithmetic_t(Etype E, Mtype M, Btype B, int n);
+    static Fastfloat from_arithmetic_t(const Fastfloat &hyperparams, int n);
+    static void from_arithmetic_t(int n, const Fastfloat &in, Fastfloat &out);
+
+    static Fastfloat from_arithmetic_t(Etype E, Mtype M, Btype B, long unsigned n);
+    static Fastfloat from_arithmetic_t(const Fastfloat &hyperparams, long unsigned n);
+    static void from_arithmetic_t(long unsigned n, const Fastfloat &in, Fastfloat &out);
+
+    static Fastfloat from_arithmetic_t(Etype E, Mtype M, Btype B, int64_t n);
+    static Fastfloat from_arithmetic_t(const Fastfloat &hyperparams, int64_t n);
+    static void from_arithmetic_t(int64_t n, const Fastfloat &in, Fastfloat &out);
+
+    /*! @brief Умножение. Формат результата - формат res
+     */
+    static void mult(const Fastfloat &left, const Fastfloat &right, Fastfloat &res) noexcept
+    {
+        res.v_ = res.quantize(left.v_ * right.v_);
+    }
+
+    /*! @brief Сложение. Формат результата - формат res
+     */
+    static void sum(const Fastfloat &left, const Fastfloat &right, Fastfloat &res) noexcept
+    {
+        res.v_ = res.quantize(left.v_ + right.v_);
+    }
+
+    /*! @brief Вычитание. Формат результата - формат res
+     */
+    static void sub(const Fastfloat &left, const Fastfloat &right, Fastfloat &res) noexcept
+    {
+        res.v_ = res.quantize(left.v_ - right.v_);
+    }
+
+    /*! @brief Получение 1/x. Формат результата - формат res
+     */
+    static void inv(const Fastfloat &x, Fastfloat &res) noexcept
+    {
+        res.v_ = res.quantize(1.0f / x.v_);
+    }
+
+    static void negative(const Fastfloat &val, Fastfloat &res) noexcept
+    {
+        res.v_ = -val.v_;
+    }
+
+    static void abs(const Fastfloat &val, Fastfloat &res) noexcept
+    {
+        res.v_ = std::fabs(val.v_);
+    }
+
+    static void min(const Fastfloat &first, const Fastfloat &second, Fastfloat &res) noexcept;
+    static void max(const Fastfloat &first, const Fastfloat &second, Fastfloat &res) noexcept;
+
+    /*! @brief Обрезает x до промежутка [a;b]
+     */
+    static void clip(const Fastfloat &a, const Fastfloat &x, const Fastfloat &b, Fastfloat &out) noexcept;
+
+    /// Выводит Fastfloat в информативном виде
+    friend std::ostream &operator<<(std::ostream &oss, const Fastfloat &num);
+
+    friend bool operator>(const Fastfloat &lhs, const Fastfloat &rhs) noexcept;
+    friend bool operator==(const Fastfloat &lhs, const Fastfloat &rhs) noexcept;
+
+  private:
+    // Битовое представление float 2^k, -149 <= k <= 127
+    static uint32_t pow2_bits(int k) noexcept
+    {
+        return k >= -126 ? static_cast<uint32_t>(k + 127) << 23 : 1u << (k + 149);
+    }
+
+    static float pow2(int k) noexcept
+    {
+        const uint32_t bits = pow2_bits(k);
+        float res = 0.0f;
+        std::memcpy(&res, &bits, sizeof(res));
+        return res;
+    }
+
+    // Битовое представление float. Значения формата квантованы и насыщены, поэтому равенство отсчетов - равенство бит
+    static uint32_t float_bits(float x) noexcept
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return bits;
+    }
+
+    // Битовое представление max_norm: экспонента 2^E - 1 - B, M старших бит мантиссы - единицы. Старший порядок
+    // форматов с 2^E - 1 - B = 128 (например, (8, 23, 127)) в float не помещается и насыщается до FLT_MAX
+    uint32_t max_norm_bits() const noexcept
+    {
+        const int exp = std::min((1 << E_) - 1 - B_, 127);
+        return (static_cast<uint32_t>(exp + 127) << 23) | (((1u << M_) - 1u) << (23u - M_));
+    }
+};
+
+bool operator>(const Fastfloat &lhs, const Fastfloat &rhs) noexcept;
+bool operator<(const Fastfloat &lhs, const Fastfloat &rhs) noexcept;
+bool operator>=(const Fastfloat &lhs, const Fastfloat &rhs) noexcept;
+bool operator<=(const Fastfloat &lhs, const Fastfloat &rhs) noexcept;
+bool operator==(const Fastfloat &lhs, const Fastfloat &rhs) noexcept;
+bool operator!=(const Fastfloat &lhs, const Fastfloat &rhs) noexcept;
+
+} // namespace clib
@@ -78,6 +78,22 @@ class Flexfixed
      */
     static void mult(const Flexfixed &lhs, const Flexfixed &rhs, Flexfixed &res);
 
+    //! \return true, если val равно нулю или ±2^k
+    static bool is_pow2(const Flexfixed &val)
+    {
+        return (val.n & (val.n - 1)) == 0;
+    }
+
+    /*! @brief Умножение на ноль или ±2^k (см. is_pow2)
+     *
+     * \details Побитово совпадает с mult(coef, x, res): произведение числителей заменяется сдвигом
+     *
+     * \param[in] coef Множитель, is_pow2(coef)
+     * \param[in] x Второй множитель
+     * \param[out] res Результат. Может совпадать с x
+     */
+    static void mult_pow2(const Flexfixed &coef, const Flexfixed &x, Flexfixed &res);
+
     /// @brief Взятие обратного элемента (1/x)
     /// @param val Операнд
     /// @param res Результат
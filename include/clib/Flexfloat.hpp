@@ -171,6 +171,21 @@ class Flexfloat
      */
     static void mult(const Flexfloat &left, const Flexfloat &right, Flexfloat &res);
 
+    //! \return true, если val равно нулю или ±2^k
+    static bool is_pow2(const Flexfloat &val);
+
+    /*! @brief Умножение на ноль или ±2^k (см. is_pow2)
+     *
+     * \details Побитово совпадает с mult(coef, x, res). Если x нормализовано, имеет формат res и результат не выходит
+     * за нормализованные числа, умножение сводится к сдвигу экспоненты и смене знака. Иначе (денормализованные
+     * числа, насыщение до max_norm) выполняется mult
+     *
+     * \param[in] coef Множитель, is_pow2(coef)
+     * \param[in] x Второй множитель
+     * \param[out] res Результат. Может совпадать с x
+     */
+    static void mult_pow2(const Flexfloat &coef, const Flexfloat &x, Flexfloat &res);
+
     /*! @brief Сложение Flexfloat
      *
      * \param[in] left Левый операнд
@@ -233,6 +248,17 @@ class Flexfloat
      */
     static void sin(const Flexfloat &x, Flexfloat &res, uint8_t F = 16);
 
+    /*! @brief Получение cos(2pi * k / n) и sin(2pi * k / n)
+     *
+     * \details Вычисляется по тем же таблицам, что cos и sin, но доля оборота k / n не округляется до формата
+     * аргумента: четверть оборота и положение внутри нее берутся из k и n точно (для n = 2^p, p <= F + 2).
+     * На границах четвертей результат точный: 0 или ±1. Используется для таблиц поворотных множителей FFT
+     *
+     * \param[out] cos_res, sin_res Результаты в своих форматах
+     * \param[in] F Битовая ширина дробной части
+     */
+    static void cos_sin_turn(uint64_t k, uint64_t n, Flexfloat &cos_res, Flexfloat &sin_res, uint8_t F = 16);
+
     /*! @brief Получение ctan(x)
      *
      * \param[out] res Результат
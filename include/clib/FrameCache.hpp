@@ -0,0 +1,292 @@
+#pragma once
+
+#include "ImgView.hpp"
+#include "VideoView.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace clib
+{
+
+/*! @brief Геометрия и отсчеты файла сырых кадров, отображенного в память
+ *
+ * \details Отсчеты хранятся по плоскостям: кадр, цвет, строка, столбец (столбец меняется быстрее всего). Плоскость
+ * цвета clr кадра frame начинается с отсчета (frame * clrs + clr) * rows * cols
+ */
+struct raw_frames
+{
+    using idx_t = ImgView::idx_t;
+    using pixel_t = ImgView::pixel_t;
+
+    const unsigned char *base = nullptr; ///< первый отсчет
+    idx_t rows = 0;
+    idx_t cols = 0;
+    idx_t clrs = 0;
+    idx_t frames = 0;
+    sample_t sample = sample_t::u8;
+
+    idx_t sample_size() const
+    {
+        return sample == sample_t::u8 ? 1 : sample == sample_t::u16 ? 2 : 4;
+    }
+
+    /// Плоскость цвета clr кадра frame
+    const void *plane(idx_t clr, idx_t frame) const
+    {
+        assert(clr < clrs);
+        assert(frame < frames);
+        return base + (frame * clrs + clr) * rows * cols * sample_size();
+    }
+
+    pixel_t get(idx_t i, idx_t j, idx_t clr, idx_t frame) const;
+
+    /// Строка i плоскости (clr, frame) в dst с расширением до pixel_t
+    void read_row(idx_t i, idx_t clr, idx_t frame, pixel_t *dst) const;
+};
+
+/*!
+ * \brief Кадр файла сырых кадров как Представление изображения, только для чтения
+ *
+ * \details Не владеет отображением: действителен, пока существует RawVideoView, из которого получен
+ */
+class RawImgView : public ImgView
+{
+    raw_frames raw_;
+    idx_t frame_;
+
+  public:
+    RawImgView(const raw_frames &raw, idx_t frame) : raw_(raw), frame_(frame)
+    {
+        assert(frame < raw.frames);
+    }
+
+    void init(idx_t, idx_t, idx_t) override
+    {
+        throw std::logic_error("Raw frame is read-only");
+    }
+
+    idx_t rows() const override
+    {
+        return raw_.rows;
+    }
+    idx_t cols() const override
+    {
+        return raw_.cols;
+    }
+    idx_t clrs() const override
+    {
+        return raw_.clrs;
+    }
+
+    pixel_t get(idx_t i, idx_t j, idx_t clr) const override
+    {
+        return raw_.get(i, j, clr, frame_);
+    }
+    void set(pixel_t, idx_t, idx_t, idx_t) override
+    {
+        throw std::logic_error("Raw frame is read-only");
+    }
+
+    void read_row(idx_t i, idx_t clr, pixel_t *dst) const override
+    {
+        raw_.read_row(i, clr, frame_, dst);
+    }
+    void read_plane(idx_t clr, pixel_t *dst, idx_t stride) const override;
+
+    pixel_t *data(idx_t) override
+    {
+        return nullptr;
+    }
+    const pixel_t *data(idx_t clr) const override
+    {
+        return raw_.sample == sample_t::i32 ? static_cast<const pixel_t *>(raw_.plane(clr, frame_)) : nullptr;
+    }
+
+    sample_t sample_type() const override
+    {
+        return raw_.sample;
+    }
+    const void *samples(idx_t clr) const override
+    {
+        return raw_.plane(clr, frame_);
+    }
+
+    void read_img(const std::string &) override
+    {
+        throw std::logic_error("Raw frame is read-only");
+    }
+    void write_img(const std::string &) override
+    {
+        throw std::logic_error("Raw frame is read-only");
+    }
+};
+
+/*!
+ * \brief Файл сырых кадров, отображенный в память (mmap) только для чтения
+ *
+ * \details Формат файла: заголовок (размеры, количество цветов и кадров, разрядность 8/16/32, fps, размер и время
+ * изменения исходного файла, путь исходного файла), затем отсчеты по плоскостям (raw_frames). Порядок байт -
+ * порядок машины, записавшей файл. Отсчеты не копируются: samples() указывает прямо в отображение, кадры доступны в
+ * любом порядке, страницы подгружаются ОС по мере обращения
+ *
+ * Пример:
+ *
+ *     RawVideoView raw("frames.raw");
+ *     img<T> frame(prototype, raw.frame(10));
+ */
+class RawVideoView : public VideoView
+{
+    raw_frames raw_;
+    void *map_ = nullptr;
+    idx_t bytes_ = 0;
+    uint64_t source_size_ = 0;
+    int64_t source_mtime_ = 0;
+    std::string source_;
+
+  public:
+    RawVideoView();
+
+    /// Отображает файл path
+    explicit RawVideoView(const std::string &path);
+
+    RawVideoView(RawVideoView &&other) noexcept;
+    RawVideoView &operator=(RawVideoView &&other) noexcept;
+    RawVideoView(const RawVideoView &) = delete;
+    RawVideoView &operator=(const RawVideoView &) = delete;
+    ~RawVideoView() override;
+
+    void init(idx_t, idx_t, idx_t, idx_t, size_t) override
+    {
+        throw std::logic_error("Raw video is read-only");
+    }
+
+    idx_t rows() const override
+    {
+        return raw_.rows;
+    }
+    idx_t cols() const override
+    {
+        return raw_.cols;
+    }
+    idx_t clrs() const override
+    {
+        return raw_.clrs;
+    }
+    idx_t frames() const override
+    {
+        return raw_.frames;
+    }
+
+    pixel_t get(idx_t i, idx_t j, idx_t clr, idx_t frame) const override
+    {
+        return raw_.get(i, j, clr, frame);
+    }
+    void set(pixel_t, idx_t, idx_t, idx_t, idx_t) override
+    {
+        throw std::logic_error("Raw video is read-only");
+    }
+
+    void read_row(idx_t i, idx_t clr, idx_t frame, pixel_t *dst) const override
+    {
+        raw_.read_row(i, clr, frame, dst);
+    }
+    void read_plane(idx_t clr, idx_t frame, pixel_t *dst, idx_t stride) const override;
+
+    pixel_t *data(idx_t, idx_t) override
+    {
+        return nullptr;
+    }
+    const pixel_t *data(idx_t clr, idx_t frame) const override
+    {
+        return raw_.sample == sample_t::i32 ? static_cast<const pixel_t *>(raw_.plane(clr, frame)) : nullptr;
+    }
+
+    sample_t sample_type() const override
+    {
+        return raw_.sample;
+    }
+    const void *samples(idx_t clr, idx_t frame) const override
+    {
+        return raw_.plane(clr, frame);
+    }
+
+    /// Кадр frame как Представление изображения без копирования
+    RawImgView frame(idx_t frame) const
+    {
+        return RawImgView(raw_, frame);
+    }
+
+    /// Размер и время изменения (нс) исходного файла, из которого записан кэш. 0, если не известны
+    uint64_t source_size() const noexcept
+    {
+        return source_size_;
+    }
+    int64_t source_mtime() const noexcept
+    {
+        return source_mtime_;
+    }
+    const std::string &source() const noexcept
+    {
+        return source_;
+    }
+
+    /// Отображает файл сырых кадров path вместо текущего
+    void read_video(const std::string &path) override;
+
+    /// Записывает копию в файл сырых кадров path
+    void write_video(const std::string &path) override;
+
+  private:
+    void release() noexcept;
+};
+
+/*! @brief Записывает Представление в файл сырых кадров
+ *
+ * \details Отсчеты хранятся в типе sample_type() Представления. Файл пишется во временный и переименовывается, поэтому
+ * читатели никогда не видят его частично записанным
+ */
+void save_raw(const std::string &path, const VideoView &video);
+void save_raw(const std::string &path, const ImgView &image);
+
+/*!
+ * \brief Кэш декодированных изображений и видео в виде файлов сырых кадров
+ *
+ * \details При первом обращении к исходному файлу (JPEG, PNG, MP4, ...) он декодируется и записывается в каталог кэша;
+ * дальше open() отображает готовый файл в память без декодирования. Кэш недействителен, если у исходного файла
+ * изменился размер или время изменения. Изображения хранятся как один кадр: 8-битные в uint8_t, 16-битные PNG в
+ * uint16_t; видео - в uint8_t, кадры декодируются по одному, поэтому память не зависит от длины ролика
+ *
+ * Пример:
+ *
+ *     FrameCache cache("/tmp/clib-frames");
+ *     RawVideoView video = cache.open("input.mp4");
+ *     for (idx_t f = 0; f < video.frames(); ++f)
+ *         process(img_rgb<T>(prototype, video.frame(f)));
+ */
+class FrameCache
+{
+    std::string dir_;
+
+  public:
+    /// Каталог dir создается, если его нет
+    explicit FrameCache(const std::string &dir);
+
+    const std::string &dir() const noexcept
+    {
+        return dir_;
+    }
+
+    /// Путь файла сырых кадров для исходного файла source
+    std::string raw_path(const std::string &source) const;
+
+    /// Есть ли действительный кэш исходного файла source
+    bool valid(const std::string &source) const;
+
+    /// Отображает кэш исходного файла source, декодируя его, если кэш отсутствует или устарел
+    RawVideoView open(const std::string &source) const;
+};
+
+} // namespace clib
@@ -6,7 +6,10 @@
 #include "CImg.h"
 #include "X11/Xlib.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -16,6 +19,56 @@ namespace clib
 
 const std::vector<std::string> image_extensions = {"jpg","jpeg","png"};
 
+/// Тип отсчетов, в котором Представление хранит изображение
+enum class sample_t
+{
+    u8,
+    u16,
+    i32
+};
+
+template <typename S> struct sample_of;
+template <> struct sample_of<uint8_t>
+{
+    static constexpr sample_t value = sample_t::u8;
+};
+template <> struct sample_of<uint16_t>
+{
+    static constexpr sample_t value = sample_t::u16;
+};
+template <> struct sample_of<int>
+{
+    static constexpr sample_t value = sample_t::i32;
+};
+
+
+namespace detail
+{
+/// Насыщение значения до диапазона типа отсчетов S
+template <typename S> S to_sample(int val)
+{
+    using limits = std::numeric_limits<S>;
+    return static_cast<S>(std::min<long long>(std::max<long long>(val, limits::lowest()), limits::max()));
+}
+
+/// Прямой доступ к плоскости как к int возможен, только если отсчеты хранятся в int
+template <typename S> int *int_plane(S *)
+{
+    return nullptr;
+}
+inline int *int_plane(int *plane)
+{
+    return plane;
+}
+template <typename S> const int *int_plane(const S *)
+{
+    return nullptr;
+}
+inline const int *int_plane(const int *plane)
+{
+    return plane;
+}
+} // namespace detail
 
 /*!
  * \brief Обёртка над классом для работы с изображениями
@@ -45,6 +98,38 @@ struct ImgView
     virtual pixel_t get(idx_t i, idx_t j, idx_t clr) const = 0;
     virtual void set(pixel_t val, idx_t i, idx_t j, idx_t clr) = 0;
 
+    /*! @brief Массовый доступ к отсчетам
+     *
+     * \details Один виртуальный вызов на строку или плоскость вместо вызова на отсчет. Реализации по умолчанию
+     * выражены через get/set (строка) и строки (плоскость); Представления с плоским хранением их переопределяют
+     */
+
+    /// Строка i цвета clr в dst (cols() отсчетов)
+    virtual void read_row(idx_t i, idx_t clr, pixel_t *dst) const;
+    /// Строка i цвета clr из src (cols() отсчетов)
+    virtual void write_row(idx_t i, idx_t clr, const pixel_t *src);
+
+    /// Плоскость цвета clr в dst: строка i записывается с адреса dst + i * stride, stride >= cols()
+    virtual void read_plane(idx_t clr, pixel_t *dst, idx_t stride) const;
+    /// Плоскость цвета clr из src: строка i читается с адреса src + i * stride, stride >= cols()
+    virtual void write_plane(idx_t clr, const pixel_t *src, idx_t stride);
+
+    /// Плоскость цвета clr, хранящаяся по строкам подряд с шагом cols(), или nullptr, если прямой доступ невозможен
+    virtual pixel_t *data(idx_t clr);
+    virtual const pixel_t *data(idx_t clr) const;
+
+    /// Тип хранимых отсчетов
+    virtual sample_t sample_type() const
+    {
+        return sample_t::i32;
+    }
+
+    /// Плоскость цвета clr в типе sample_type() по строкам подряд с шагом cols(), или nullptr
+    virtual const void *samples(idx_t clr) const
+    {
+        return data(clr);
+    }
+
     virtual void read_img(const std::string &path) = 0;
     virtual void write_img(const std::string &path) = 0;
 
@@ -53,11 +138,18 @@ struct ImgView
     }
 };
 
-struct CImgView : ImgView
+/*!
+ * \brief Представление на CImg с отсчетами типа S
+ *
+ * \details S = uint8_t хранит 8-битные JPEG/PNG в 4 раза компактнее, чем int; отсчеты переводятся в pixel_t только
+ * при обращении через get/read_plane, а img<T> читает их напрямую (samples). Значения set/write_plane вне диапазона
+ * S насыщаются
+ */
+template <typename S> struct CImgViewT : ImgView
 {
 
 private:
-    cimg_library::CImg<pixel_t> image_;
+    cimg_library::CImg<S> image_;
     bool img_created_ = false;
 
 public:
@@ -74,6 +166,26 @@ public:
     // CImg stores data as [width,height]. Therefore, the data in cimg are transposed
     void set(pixel_t val, idx_t i, idx_t j, idx_t clr) override;
 
+    void read_row(idx_t i, idx_t clr, pixel_t *dst) const override;
+
+    void write_row(idx_t i, idx_t clr, const pixel_t *src) override;
+
+    void read_plane(idx_t clr, pixel_t *dst, idx_t stride) const override;
+
+    void write_plane(idx_t clr, const pixel_t *src, idx_t stride) override;
+
+    // Плоскость CImg хранится по строкам: x = j меняется быстрее всего. Прямой доступ только при S = pixel_t
+    pixel_t *data(idx_t clr) override;
+
+    const pixel_t *data(idx_t clr) const override;
+
+    sample_t sample_type() const override
+    {
+        return sample_of<S>::value;
+    }
+
+    const void *samples(idx_t clr) const override;
+
     void read_img(const std::string &path) override;
 
     void write_img(const std::string &path) override;
@@ -83,5 +195,16 @@ public:
 private:
 
     void check_created() const;
+
+    const S *plane(idx_t clr) const;
+    S *plane(idx_t clr);
 };
+
+extern template struct CImgViewT<uint8_t>;
+extern template struct CImgViewT<uint16_t>;
+extern template struct CImgViewT<int>;
+
+using CImgView = CImgViewT<int>;
+using CImgView8 = CImgViewT<uint8_t>;
+using CImgView16 = CImgViewT<uint16_t>;
 } // namespace clib
@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vsim
+{
+
+using idx_t = std::size_t;
+using pixel_t = int;
+
+/*! @brief Геометрия видео, передаваемого через ShmRing
+ */
+struct shm_media
+{
+    uint64_t frames = 0;
+    uint64_t rows = 0;
+    uint64_t cols = 0;
+    uint64_t clrs = 0;
+    uint64_t fps = 0;
+
+    /// Количество отсчетов в кадре
+    idx_t frame_size() const
+    {
+        return static_cast<idx_t>(rows * cols * clrs);
+    }
+
+    /// Количество отсчетов видео
+    idx_t size() const
+    {
+        return static_cast<idx_t>(frames) * frame_size();
+    }
+};
+
+/*!
+ * \brief Кольцо отсчетов в разделяемой памяти POSIX для одного писателя и одного читателя из разных процессов
+ *
+ * \details Сегмент содержит заголовок (геометрия видео, счетчики записанных и прочитанных отсчетов) и кольцо из
+ * capacity отсчетов. Писатель и читатель копируют отсчеты пачками и публикуют счетчики один раз на пачку. Если кольцо
+ * заполнено, писатель ждет читателя (обратное давление); если пусто - читатель ждет писателя. Ожидание - futex в
+ * разделяемой памяти; системный вызов пробуждения делается, только если другая сторона действительно ждет.
+ *
+ * close() с любой стороны завершает передачу: читатель дочитывает оставшиеся отсчеты и получает конец данных,
+ * писатель перестает ждать. Сегмент удаляется (shm_unlink) объектом, который его создал
+ *
+ * Пример:
+ *
+ *     // процесс проверки
+ *     auto ring = ShmRing::create("/clib_video", 1 << 16, media);
+ *     feed(serializer, ring);
+ *
+ *     // процесс симулятора
+ *     auto ring = ShmRing::open("/clib_video");
+ *     ShmSerializer source(ring);
+ *     pixel_t pixel = source.pop();
+ */
+class ShmRing
+{
+  public:
+    /*! @brief Создает сегмент
+     *
+     * \param[in] name Имя сегмента, как для shm_open: "/name"
+     * \param[in] capacity Количество отсчетов в кольце
+     * \param[in] media Геометрия передаваемого видео
+     */
+    static ShmRing create(const std::string &name, idx_t capacity, const shm_media &media);
+
+    /// Открывает сегмент, созданный другим процессом
+    static ShmRing open(const std::string &name);
+
+    ShmRing(ShmRing &&other) noexcept;
+    ShmRing &operator=(ShmRing &&other) noexcept;
+    ShmRing(const ShmRing &) = delete;
+    ShmRing &operator=(const ShmRing &) = delete;
+    ~ShmRing();
+
+    idx_t capacity() const;
+    shm_media media() const;
+
+    /*! @brief Записывает n отсчетов, ожидая свободного места
+     *
+     * \return Количество записанных отсчетов. Меньше n, только если кольцо закрыто
+     */
+    idx_t write(const pixel_t *src, idx_t n);
+
+    /*! @brief Читает от 1 до n отсчетов, ожидая, пока появится хотя бы один
+     *
+     * \return Количество прочитанных отсчетов. 0 - кольцо закрыто и все отсчеты прочитаны
+     */
+    idx_t read_some(pixel_t *dst, idx_t n);
+
+    /*! @brief Читает n отсчетов
+     *
+     * \return Количество прочитанных отсчетов. Меньше n, только если кольцо закрыто
+     */
+    idx_t read(pixel_t *dst, idx_t n);
+
+    /// Завершает передачу и будит другую сторону
+    void close();
+
+    bool closed() const;
+
+  private:
+    struct header;
+
+    header *hdr_ = nullptr;
+    pixel_t *data_ = nullptr;
+    idx_t bytes_ = 0;
+    std::string name_{};
+    bool owner_ = false;
+
+    ShmRing() = default;
+    void map(int fd, idx_t bytes);
+    void release() noexcept;
+};
+
+/*!
+ * \brief Читающая сторона кольца с интерфейсом Serializer
+ *
+ * \details Отсчеты читаются из кольца пачками по batch во внутренний буфер, поэтому pop() обращается к разделяемой
+ * памяти один раз на пачку. Курсор frame()/row()/col()/clr() указывает на отсчет, который будет выдан следующим
+ */
+class ShmSerializer
+{
+    ShmRing &ring_;
+    shm_media media_;
+    std::vector<pixel_t> buf_;
+    idx_t buf_pos_ = 0;
+    idx_t buf_end_ = 0;
+    idx_t count_ = 0; ///< количество выданных отсчетов
+
+  public:
+    explicit ShmSerializer(ShmRing &ring, idx_t batch = 4096) : ring_(ring), media_(ring.media()), buf_(batch)
+    {
+        assert(batch > 0);
+    }
+
+    idx_t frames() const
+    {
+        return static_cast<idx_t>(media_.frames);
+    }
+    idx_t rows() const
+    {
+        return static_cast<idx_t>(media_.rows);
+    }
+    idx_t cols() const
+    {
+        return static_cast<idx_t>(media_.cols);
+    }
+    idx_t clrs() const
+    {
+        return static_cast<idx_t>(media_.clrs);
+    }
+    size_t fps() const
+    {
+        return static_cast<size_t>(media_.fps);
+    }
+
+    idx_t frame() const
+    {
+        return count_ / media_.frame_size();
+    }
+    idx_t row() const
+    {
+        return count_ % media_.frame_size() / (cols() * clrs());
+    }
+    idx_t col() const
+    {
+        return count_ / clrs() % cols();
+    }
+    idx_t clr() const
+    {
+        return count_ % clrs();
+    }
+
+    /// Следующий отсчет. 0, если все отсчеты выданы или передача прервана
+    pixel_t pop()
+    {
+        if (buf_pos_ == buf_end_ && !fill())
+            return 0;
+
+        ++count_;
+        return buf_[buf_pos_++];
+    }
+
+    /*! @brief Копирует до n следующих отсчетов в dst
+     *
+     * \return Количество скопированных отсчетов. Меньше n, если все отсчеты выданы или передача прервана
+     */
+    idx_t pop_n(pixel_t *dst, idx_t n);
+
+    /// cols() * clrs() отсчетов: целая строка, если курсор в начале строки
+    idx_t pop_line(pixel_t *dst)
+    {
+        return pop_n(dst, cols() * clrs());
+    }
+
+    /// Кадр целиком, если курсор в начале кадра
+    idx_t pop_frame(pixel_t *dst)
+    {
+        return pop_n(dst, media_.frame_size());
+    }
+
+  private:
+    bool fill();
+};
+
+/*!
+ * \brief Пишущая сторона кольца с интерфейсом Deserializer
+ *
+ * \details Отсчеты собираются во внутреннем буфере и передаются в кольцо пачками по batch, а также в конце каждого
+ * кадра и при flush(). close() передает остаток и закрывает кольцо
+ */
+class ShmDeserializer
+{
+    ShmRing &ring_;
+    shm_media media_;
+    std::vector<pixel_t> buf_;
+    idx_t buf_end_ = 0;
+    idx_t count_ = 0;      ///< количество принятых отсчетов
+    bool stopped_ = false; ///< кольцо закрыто читателем, отсчеты больше не принимаются
+
+  public:
+    explicit ShmDeserializer(ShmRing &ring, idx_t batch = 4096) : ring_(ring), media_(ring.media()), buf_(batch)
+    {
+        assert(batch > 0);
+    }
+
+    ~ShmDeserializer();
+
+    ShmDeserializer(const ShmDeserializer &) = delete;
+    ShmDeserializer &operator=(const ShmDeserializer &) = delete;
+
+    idx_t frames() const
+    {
+        return static_cast<idx_t>(media_.frames);
+    }
+    idx_t rows() const
+    {
+        return static_cast<idx_t>(media_.rows);
+    }
+    idx_t cols() const
+    {
+        return static_cast<idx_t>(media_.cols);
+    }
+    idx_t clrs() const
+    {
+        return static_cast<idx_t>(media_.clrs);
+    }
+    size_t fps() const
+    {
+        return static_cast<size_t>(media_.fps);
+    }
+
+    idx_t frame() const
+    {
+        return count_ / media_.frame_size();
+    }
+    idx_t row() const
+    {
+        return count_ % media_.frame_size() / (cols() * clrs());
+    }
+    idx_t col() const
+    {
+        return count_ / clrs() % cols();
+    }
+    idx_t clr() const
+    {
+        return count_ % clrs();
+    }
+
+    /// Принимает отсчет. Ничего не делает, если все отсчеты приняты или кольцо закрыто читателем
+    void push(pixel_t pixel)
+    {
+        if (count_ >= media_.size() || stopped_)
+            return;
+
+        buf_[buf_end_++] = pixel;
+        ++count_;
+        if (buf_end_ == buf_.size() || count_ % media_.frame_size() == 0)
+            flush();
+    }
+
+    /*! @brief Принимает до n отсчетов из src
+     *
+     * \return Количество принятых отсчетов. Меньше n, если все отсчеты приняты или передача прервана
+     */
+    idx_t push_n(const pixel_t *src, idx_t n);
+
+    /// cols() * clrs() отсчетов: целая строка, если курсор в начале строки
+    idx_t push_line(const pixel_t *src)
+    {
+        return push_n(src, cols() * clrs());
+    }
+
+    /// Кадр целиком, если курсор в начале кадра
+    idx_t push_frame(const pixel_t *src)
+    {
+        return push_n(src, media_.frame_size());
+    }
+
+    /*! @brief Передает накопленные отсчеты в кольцо
+     *
+     * \return Количество переданных отсчетов. Если кольцо закрыто читателем, непереданные отсчеты не считаются
+     * принятыми (курсор возвращается к последнему переданному), а новые отсчеты больше не принимаются
+     */
+    idx_t flush();
+
+    /// Кольцо закрыто читателем: отсчеты больше не принимаются
+    bool stopped() const noexcept
+    {
+        return stopped_;
+    }
+
+    /// Передает накопленные отсчеты и закрывает кольцо
+    void close();
+};
+
+/*! @brief Передает все отсчеты source в кольцо пачками по batch и закрывает кольцо
+ *
+ * \param[in] source Объект с pop_n(pixel_t *, idx_t), например Serializer
+ *
+ * \return Количество переданных отсчетов
+ */
+template <typename Source> idx_t feed(Source &source, ShmRing &ring, idx_t batch = 4096)
+{
+    std::vector<pixel_t> buf(batch);
+    idx_t total = 0;
+    while (true)
+    {
+        const idx_t n = source.pop_n(buf.data(), batch);
+        if (n == 0)
+            break;
+        const idx_t written = ring.write(buf.data(), n);
+        total += written;
+        if (written < n)
+            break;
+    }
+    ring.close();
+    return total;
+}
+
+/*! @brief Читает отсчеты из кольца до его закрытия и передает их в target
+ *
+ * \param[in] target Объект с push_n(const pixel_t *, idx_t), например Deserializer
+ *
+ * \return Количество прочитанных отсчетов
+ */
+template <typename Target> idx_t drain(ShmRing &ring, Target &target, idx_t batch = 4096)
+{
+    std::vector<pixel_t> buf(batch);
+    idx_t total = 0;
+    while (true)
+    {
+        const idx_t n = ring.read_some(buf.data(), batch);
+        if (n == 0)
+            break;
+        target.push_n(buf.data(), n);
+        total += n;
+    }
+    return total;
+}
+
+} // namespace vsim
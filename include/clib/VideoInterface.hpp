@@ -1,13 +1,18 @@
 #pragma once
 
+#include "FrameCache.hpp"
 #include "ImgView.hpp"
+#include "VideoReader.hpp"
 #include "VideoView.hpp"
+#include "VideoWriter.hpp"
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace vsim
@@ -24,131 +29,187 @@ using pixel_t = clib::VideoView::pixel_t;
 /*!
  * \brief General media class. Can contain video and image
  *
- * \details If number of frames = 2, the video_ array contains two copies of the image. If number of frames > 2, the
- *          video_ array contains the video. Number of frames can not be less than 2
+ * \details If number of frames = 2, the media is an image and frame 1 is a copy of frame 0. A single-frame video is
+ *          loaded the same way. If number of frames > 2, the media is a video. Number of frames can not be less than 2
+ *
+ *          Samples are kept in one flat frame-major buffer of 8-, 16- or 32-bit values: frame, row, column, color,
+ *          with the color changing fastest (the order of Serializer::pop). Frame f starts at frame_offset_[f]. Frames
+ *          of a still image share storage; writing to a shared frame gives it its own copy first
  */
 class Video
 {
+    vector<uint8_t> data8_{};   ///< samples if sample_ == u8
+    vector<uint16_t> data16_{}; ///< samples if sample_ == u16
+    vector<int> data32_{};      ///< samples if sample_ == i32
+    vector<idx_t> frame_offset_{};
+    vector<char> shared_{}; ///< frame storage is shared with another frame
+
+    idx_t rows_ = 0;
+    idx_t cols_ = 0;
+    idx_t clrs_ = 0;
+    clib::sample_t sample_ = clib::sample_t::i32;
+    // /Equal to 0 for image
+    size_t fps_ = 0;
 
+    // Calls func with the buffer of sample_
+    template <typename V, typename F> static decltype(auto) visit(V &self, F &func)
+    {
+        switch (self.sample_)
+        {
+        case clib::sample_t::u8:
+            return func(self.data8_);
+        case clib::sample_t::u16:
+            return func(self.data16_);
+        case clib::sample_t::i32:
+        default:
+            return func(self.data32_);
+        }
+    }
+    template <typename F> decltype(auto) visit(F &&func)
+    {
+        return visit(*this, func);
+    }
+    template <typename F> decltype(auto) visit(F &&func) const
+    {
+        return visit(*this, func);
+    }
 
-    /// video_[i][j][k][l]
-    /// i - frame number
-    /// j - column number
-    /// k - row number
-    /// l - color number
-    vector<vector<vector<vector<pixel_t>>>> video_;
-    // /Equal to 0 for image
-    size_t fps_;
+    // Value saturated to the range of the samples in data
+    template <typename D, typename S> static typename D::value_type saturate(const D &, S val)
+    {
+        return clib::detail::to_sample<typename D::value_type>(static_cast<pixel_t>(val));
+    }
 
   public:
     Video() = default;
 
-    /*! @brief Automatically detects the file type and fills the video_ array
+    /*! @brief Automatically detects the file type and loads samples plane by plane
      *
      * \param[in] path Path to the file
      */
     Video(const std::string &path)
     {
-        idx_t frames = 0;
-        idx_t rows = 0;
-        idx_t cols = 0;
-        idx_t clrs = 0;
-
-        auto vid_view = clib::CVideoView{};
-        auto img_view = clib::CImgView{};
-        bool is_video = false;
-
         if (clib::check_ext(path, clib::video_extensions))
         {
-            vid_view.read_video(path);
-            frames = vid_view.frames();
-            rows = vid_view.rows();
-            cols = vid_view.cols();
-            clrs = vid_view.clrs();
+            // Frames are decoded one at a time straight into the buffer: rows of the reader are already in pop order
+            clib::VideoReader reader(path);
+            fps_ = reader.info().fps;
+            rows_ = reader.rows();
+            cols_ = reader.cols();
+            clrs_ = reader.clrs();
+            sample_ = clib::sample_t::u8;
+
+            // The header frame count is only an estimate: the buffer grows by a fixed chunk and is cut once at the end
+            const idx_t estimate = std::max<idx_t>(reader.info().frames, 1);
+            const idx_t chunk = std::max<idx_t>(estimate / 8, 1) * frame_size();
+            data8_.reserve(estimate * frame_size());
+            while (reader.next())
+            {
+                if (data8_.capacity() - data8_.size() < frame_size())
+                    data8_.reserve(data8_.size() + chunk);
 
-            is_video = true;
-            fps_ = clib::get_fps(path);
+                frame_offset_.push_back(data8_.size());
+                for (idx_t i = 0; i < rows_; ++i)
+                    data8_.insert(data8_.end(), reader.row(i), reader.row(i) + cols_ * clrs_);
+            }
+            if (frames() == 0)
+                throw std::runtime_error("No frames decoded: " + path);
+            if (data8_.size() != data8_.capacity())
+                data8_.shrink_to_fit();
+            shared_.assign(frames(), 0);
+
+            // A single-frame video is kept as an image: the second frame shares the first frame's storage
+            if (frames() == 1)
+            {
+                frame_offset_.push_back(0);
+                shared_.assign(2, 1);
+            }
         }
         else if (clib::check_ext(path, clib::image_extensions))
         {
+            auto img_view = clib::CImgView16{};
             img_view.read_img(path);
-            frames = 2;
-            rows = img_view.rows();
-            cols = img_view.cols();
-            clrs = img_view.clrs();
 
-            is_video = false;
+            vector<vector<pixel_t>> planes(img_view.clrs(), vector<pixel_t>(img_view.rows() * img_view.cols()));
+            pixel_t max_val = 0;
+            for (idx_t c = 0; c < planes.size(); ++c)
+            {
+                img_view.read_plane(c, planes[c].data(), img_view.cols());
+                max_val = std::max(max_val, *std::max_element(planes[c].begin(), planes[c].end()));
+            }
+
+            // 16-bit storage only for 16-bit images. The second frame shares the first frame's storage
             fps_ = 0;
+            allocate(1, img_view.rows(), img_view.cols(), img_view.clrs(),
+                     max_val > 255 ? clib::sample_t::u16 : clib::sample_t::u8);
+            for (idx_t c = 0; c < clrs_; ++c)
+                store_plane(0, c, planes[c].data());
+            frame_offset_.push_back(0);
+            shared_.assign(2, 1);
         }
         else
             assert(0);
 
-        assert(rows > 0);
-        assert(cols > 0);
-        assert(clrs > 0);
-        assert(frames > 1);
+        assert(rows_ > 0);
+        assert(cols_ > 0);
+        assert(clrs_ > 0);
+    }
 
-        video_.reserve(frames);
-        video_.resize(frames);
-        for (idx_t i = 0; i < frames; ++i)
-        {
-            video_[i].reserve(rows);
-            video_[i].resize(rows);
-            for (idx_t j = 0; j < rows; ++j)
-            {
-                video_[i][j].reserve(cols);
-                video_[i][j].resize(cols);
-                for (idx_t k = 0; k < cols; ++k)
+    /*! @brief Loads samples from the raw frame cache. The file is decoded only if it is not cached yet
+     *
+     * \param[in] path Path to the file
+     * \param[in] cache Cache of decoded files
+     */
+    Video(const std::string &path, const clib::FrameCache &cache)
+    {
+        const clib::RawVideoView raw = cache.open(path);
+        const bool image = clib::check_ext(path, clib::image_extensions);
+        assert(raw.frames() >= 1);
+        assert(!image || raw.frames() == 1);
+
+        fps_ = image ? 0 : raw.fps();
+        allocate(raw.frames(), raw.rows(), raw.cols(), raw.clrs(), raw.sample_type());
+        for (idx_t f = 0; f < raw.frames(); ++f)
+            for (idx_t c = 0; c < clrs_; ++c)
+                switch (sample_)
                 {
-                    video_[i][j][k].reserve(clrs);
-                    video_[i][j][k].resize(clrs);
-
-                    for (idx_t l = 0; l < clrs; ++l)
-                    {
-                        if (is_video)
-                            video_[i][j][k][l] = vid_view.get(j, k, l, i);
-                        else
-                            // The second frame must contain a copy of the first frame
-                            if (i == 1)
-                                video_[i][j][k][l] = video_[0][j][k][l];
-                            else
-                                video_[i][j][k][l] = img_view.get(j, k, l);
-                    }
+                case clib::sample_t::u8:
+                    store_plane(f, c, static_cast<const uint8_t *>(raw.samples(c, f)));
+                    break;
+                case clib::sample_t::u16:
+                    store_plane(f, c, static_cast<const uint16_t *>(raw.samples(c, f)));
+                    break;
+                case clib::sample_t::i32:
+                default:
+                    store_plane(f, c, static_cast<const int *>(raw.samples(c, f)));
+                    break;
                 }
-            }
+
+        // The second frame of an image or a single-frame video shares the first frame's storage
+        if (raw.frames() == 1)
+        {
+            frame_offset_.push_back(0);
+            shared_.assign(2, 1);
         }
     }
 
-    /*! @brief Creates video_ array with the specified dimensions
+    /*! @brief Creates video with the specified dimensions
      *
      * \param[in] frames - number of frames
      * \param[in] rows - number of rows
      * \param[in] cols - number of columns
      * \param[in] clrs - number of colors
      * \param[in] fps - fps of the video. For image can be omitted
+     * \param[in] sample - sample type. i32 keeps any pixel_t; u8 and u16 save memory, values out of their range
+     *                     saturate
      */
-    Video(idx_t frames, idx_t rows, idx_t cols, idx_t clrs, size_t fps = 0)
+    Video(idx_t frames, idx_t rows, idx_t cols, idx_t clrs, size_t fps = 0,
+          clib::sample_t sample = clib::sample_t::i32)
     {
         assert(frames > 1);
 
         fps_ = fps;
-        video_.reserve(frames);
-        video_.resize(frames);
-        for (idx_t i = 0; i < frames; ++i)
-        {
-            video_[i].reserve(rows);
-            video_[i].resize(rows);
-            for (idx_t j = 0; j < rows; ++j)
-            {
-                video_[i][j].reserve(cols);
-                video_[i][j].resize(cols);
-                for (idx_t k = 0; k < cols; ++k)
-                {
-                    video_[i][j][k].reserve(clrs);
-                    video_[i][j][k].resize(clrs);
-                }
-            }
-        }
+        allocate(frames, rows, cols, clrs, sample);
     }
 
     /*! @brief Writes image to the file
@@ -179,16 +240,17 @@ class Video
         if (!is_video)
             i = 1;
 
+        // One plane per view call
+        vector<pixel_t> plane(rows() * cols());
         for (; i < frames(); ++i)
-            for (idx_t j = 0; j < rows(); ++j)
-                for (idx_t k = 0; k < cols(); ++k)
-                    for (idx_t l = 0; l < clrs(); ++l)
-                    {
-                        if (is_video)
-                            vid_view.set(video_[i][j][k][l], j, k, l, i);
-                        else
-                            img_view.set(video_[i][j][k][l], j, k, l);
-                    }
+            for (idx_t c = 0; c < clrs(); ++c)
+            {
+                load_plane(i, c, plane.data());
+                if (is_video)
+                    vid_view.write_plane(c, i, plane.data(), cols());
+                else
+                    img_view.write_plane(c, plane.data(), cols());
+            }
 
         if (is_video)
             vid_view.write_video(path);
@@ -199,40 +261,28 @@ class Video
     /// Number of frames
     idx_t frames() const
     {
-        // static_cast due to different
-        // Cimg library index size = unsigned
-        //         and vector size = long unsigned
-        return static_cast<unsigned>(video_.size());
+        return frame_offset_.size();
     }
 
     /// Height
     idx_t rows() const
     {
-        // static_cast due to different
-        // Cimg library index size = unsigned
-        //         and vector size = long unsigned
-        assert(video_.size() > 0);
-        return static_cast<unsigned>(video_[0].size());
+        assert(frames() > 0);
+        return rows_;
     }
 
     /// Width
     idx_t cols() const
     {
-        // static_cast due to different
-        // Cimg library index size = unsigned
-        //         and vector size = long unsigned
-        assert(video_.size() > 0);
-        return static_cast<unsigned>(video_[0][0].size());
+        assert(frames() > 0);
+        return cols_;
     }
 
     /// Number of colors
     idx_t clrs() const
     {
-        // static_cast due to different
-        // Cimg library index size = unsigned
-        //         and vector size = long unsigned
-        assert(video_.size() > 0);
-        return static_cast<unsigned>(video_[0][0][0].size());
+        assert(frames() > 0);
+        return clrs_;
     }
 
     /// Number of fps
@@ -241,21 +291,252 @@ class Video
         return fps_;
     }
 
+    /// Type of stored samples
+    clib::sample_t sample_type() const
+    {
+        return sample_;
+    }
+
     /// Get pixel
     pixel_t get(idx_t frame, idx_t i, idx_t j, idx_t clr) const
     {
-        return video_[frame][i][j][clr];
+        const idx_t k = index(frame, i, j, clr);
+        return visit([&](const auto &data) { return static_cast<pixel_t>(data[k]); });
     }
 
-    /// Set pixel
+    /// Set pixel. Values out of the sample range saturate
     void set(pixel_t val, idx_t frame, idx_t i, idx_t j, idx_t clr)
     {
-        video_[frame][i][j][clr] = val;
+        if (shared_[frame])
+            detach(frame);
+
+        const idx_t k = index(frame, i, j, clr);
+        visit([&](auto &data) { data[k] = saturate(data, val); });
+    }
+
+    /// Number of samples in a frame
+    idx_t frame_size() const
+    {
+        return rows_ * cols_ * clrs_;
+    }
+
+    /// Copies n samples of the frame starting at position pos (in pop order) to dst
+    void get_run(idx_t frame, idx_t pos, pixel_t *dst, idx_t n) const
+    {
+        assert(frame < frames());
+        assert(pos + n <= frame_size());
+
+        const idx_t k = frame_offset_[frame] + pos;
+        visit([&](const auto &data) { std::copy_n(data.data() + k, n, dst); });
+    }
+
+    /// Copies n samples from src to the frame starting at position pos (in pop order). Values saturate
+    template <typename S> void set_run(idx_t frame, idx_t pos, const S *src, idx_t n)
+    {
+        assert(frame < frames());
+        assert(pos + n <= frame_size());
+
+        if (shared_[frame])
+            detach(frame);
+
+        const idx_t k = frame_offset_[frame] + pos;
+        visit([&](auto &data) {
+            std::transform(src, src + n, data.begin() + static_cast<long>(k),
+                           [&](S val) { return saturate(data, val); });
+        });
+    }
+
+    /// Fills the frame with zeros
+    void clear_frame(idx_t frame)
+    {
+        assert(frame < frames());
+
+        if (shared_[frame])
+            detach(frame);
+
+        const idx_t k = frame_offset_[frame];
+        visit([&](auto &data) { std::fill_n(data.begin() + static_cast<long>(k), frame_size(), 0); });
+    }
+
+  private:
+    idx_t index(idx_t frame, idx_t i, idx_t j, idx_t clr) const
+    {
+        assert(frame < frames());
+        assert(i < rows_);
+        assert(j < cols_);
+        assert(clr < clrs_);
+
+        return frame_offset_[frame] + (i * cols_ + j) * clrs_ + clr;
+    }
+
+    void allocate(idx_t frames, idx_t rows, idx_t cols, idx_t clrs, clib::sample_t sample)
+    {
+        rows_ = rows;
+        cols_ = cols;
+        clrs_ = clrs;
+        sample_ = sample;
+
+        data8_.clear();
+        data16_.clear();
+        data32_.clear();
+        visit([&](auto &data) { data.assign(frames * frame_size(), 0); });
+
+        frame_offset_.resize(frames);
+        for (idx_t f = 0; f < frames; ++f)
+            frame_offset_[f] = f * frame_size();
+        shared_.assign(frames, 0);
+    }
+
+    // Gives the frame its own copy of the shared storage
+    void detach(idx_t frame)
+    {
+        const idx_t old_offset = frame_offset_[frame];
+        const idx_t new_offset = visit([](const auto &data) { return data.size(); });
+        visit([&](auto &data) {
+            data.resize(new_offset + frame_size());
+            std::copy_n(data.begin() + static_cast<long>(old_offset), frame_size(),
+                        data.begin() + static_cast<long>(new_offset));
+        });
+
+        frame_offset_[frame] = new_offset;
+        shared_[frame] = 0;
+
+        // The last frame left on the old storage is not shared any more
+        idx_t left = 0, last = 0;
+        for (idx_t f = 0; f < frames(); ++f)
+            if (frame_offset_[f] == old_offset)
+                ++left, last = f;
+        if (left == 1)
+            shared_[last] = 0;
+    }
+
+    // Stores plane [rows x cols] of color clr
+    template <typename P> void store_plane(idx_t frame, idx_t clr, const P *plane)
+    {
+        const idx_t base = frame_offset_[frame] + clr, count = rows_ * cols_;
+        visit([&](auto &data) {
+            for (idx_t k = 0; k < count; ++k)
+                data[base + k * clrs_] = saturate(data, plane[k]);
+        });
+    }
+
+    // Loads plane [rows x cols] of color clr
+    void load_plane(idx_t frame, idx_t clr, pixel_t *plane) const
+    {
+        const idx_t base = frame_offset_[frame] + clr, count = rows_ * cols_;
+        visit([&](const auto &data) {
+            for (idx_t k = 0; k < count; ++k)
+                plane[k] = data[base + k * clrs_];
+        });
+    }
+};
+
+/// @brief Frames for the streaming mode of Serializer: 8-bit frames decoded one at a time
+class FrameSource
+{
+  public:
+    virtual ~FrameSource() = default;
+
+    virtual idx_t rows() const = 0;
+    virtual idx_t cols() const = 0;
+    virtual idx_t clrs() const = 0;
+    virtual size_t fps() const = 0;
+
+    /// Number of frames from the header. 0 if unknown
+    virtual idx_t frames() const = 0;
+
+    /// @brief Makes the next frame current
+    /// @return false if all frames were read
+    virtual bool next() = 0;
+
+    /// Row i of the current frame: cols() * clrs() samples, the color changing fastest
+    virtual const uint8_t *row(idx_t i) const = 0;
+};
+
+/// @brief Frames for the streaming mode of Deserializer: 8-bit frames encoded one at a time
+class FrameSink
+{
+  public:
+    virtual ~FrameSink() = default;
+
+    /// Row i of the frame being filled: cols * clrs samples, the color changing fastest
+    virtual uint8_t *row(idx_t i) = 0;
+
+    /// Writes the filled frame. The buffer can be refilled for the next frame
+    virtual void write_frame() = 0;
+
+    /// Finishes the output after the last frame
+    virtual void finish() = 0;
+};
+
+/// FrameSource of a video file, decoded by clib::VideoReader
+class VideoFileSource final : public FrameSource
+{
+    clib::VideoReader reader_;
+
+  public:
+    explicit VideoFileSource(const std::string &path) : reader_(path)
+    {
+    }
+
+    idx_t rows() const override
+    {
+        return reader_.rows();
+    }
+    idx_t cols() const override
+    {
+        return reader_.cols();
+    }
+    idx_t clrs() const override
+    {
+        return reader_.clrs();
+    }
+    size_t fps() const override
+    {
+        return reader_.info().fps;
+    }
+    idx_t frames() const override
+    {
+        return reader_.info().frames;
+    }
+    bool next() override
+    {
+        return reader_.next();
+    }
+    const uint8_t *row(idx_t i) const override
+    {
+        return reader_.row(i);
+    }
+};
+
+/// FrameSink of a video file, encoded by clib::VideoWriter
+class VideoFileSink final : public FrameSink
+{
+    clib::VideoWriter writer_;
+
+  public:
+    VideoFileSink(const std::string &path, idx_t rows, idx_t cols, size_t fps)
+        : writer_(path, rows, cols, static_cast<double>(fps))
+    {
+    }
+
+    uint8_t *row(idx_t i) override
+    {
+        return writer_.row(i);
+    }
+    void write_frame() override
+    {
+        writer_.write_frame();
+    }
+    void finish() override
+    {
+        writer_.finish();
     }
 };
 
 class Serializer
 {
+    /// Whole media, or in streaming mode a ring of the frames around the cursor
     Video video_;
 
     /// Points to the pixel that will be popped out
@@ -267,6 +548,11 @@ class Serializer
 
     bool is_inited_;
 
+    /// Streaming mode: frame f is decoded into slot f % video_.frames() of the ring
+    std::unique_ptr<FrameSource> reader_{};
+    idx_t loaded_ = 0; ///< number of decoded frames
+    bool eof_ = false;
+
   public:
     Serializer()
     {
@@ -277,13 +563,9 @@ class Serializer
     /// @param[in] path - file path
     void init(const std::string &path)
     {
+        reader_.reset();
         video_ = Video(path);
-        cur_frame_ = 0;
-        cur_row_ = 0;
-        cur_col_ = 0;
-        cur_clr_ = 0;
-
-        is_inited_ = true;
+        reset_cursor();
     }
 
     /// @brief Creates a Video with the specified dimensions
@@ -292,21 +574,62 @@ class Serializer
     /// @param[in] cols - number of columns
     /// @param[in] clrs - number of colors
     /// @param[in] fps - fps of the video. For image can be omitted
-    void init(idx_t frames, idx_t rows, idx_t cols, idx_t clrs, size_t fps = 0)
+    /// @param[in] sample - sample type. i32 keeps any pixel; u8 and u16 save memory and saturate
+    void init(idx_t frames, idx_t rows, idx_t cols, idx_t clrs, size_t fps = 0,
+              clib::sample_t sample = clib::sample_t::i32)
     {
-        video_ = Video(frames, rows, cols, clrs, fps);
-        cur_frame_ = 0;
-        cur_row_ = 0;
-        cur_col_ = 0;
-        cur_clr_ = 0;
+        reader_.reset();
+        video_ = Video(frames, rows, cols, clrs, fps, sample);
+        reset_cursor();
+    }
 
-        is_inited_ = true;
+    /// @brief Pops the pixels of a ready Video
+    /// @param[in] video - frames to pop
+    void init(Video video)
+    {
+        reader_.reset();
+        video_ = std::move(video);
+        reset_cursor();
     }
 
-    /// Number of frames
+    /// @brief Streaming mode: frames are decoded just ahead of the cursor, only ring frames are kept in memory.
+    ///        Images are loaded whole
+    /// @param[in] path - file path
+    /// @param[in] ring - number of frames in memory. At least 2
+    void init_stream(const std::string &path, idx_t ring = 2)
+    {
+        assert(ring > 1);
+
+        if (!clib::check_ext(path, clib::video_extensions))
+        {
+            init(path);
+            return;
+        }
+
+        init_stream(std::unique_ptr<FrameSource>(new VideoFileSource(path)), ring);
+    }
+
+    /// @brief Streaming mode over any source of frames
+    /// @param[in] source - source of frames
+    /// @param[in] ring - number of frames in memory. At least 2
+    void init_stream(std::unique_ptr<FrameSource> source, idx_t ring = 2)
+    {
+        assert(ring > 1);
+
+        reader_ = std::move(source);
+        video_ = Video(ring, reader_->rows(), reader_->cols(), reader_->clrs(), reader_->fps(), clib::sample_t::u8);
+        loaded_ = 0;
+        eof_ = false;
+        reset_cursor();
+        fetch();
+    }
+
+    /// Number of frames. In streaming mode the number from the file header until the end of the file is reached
     idx_t frames() const
     {
-        return video_.frames();
+        if (!reader_)
+            return video_.frames();
+        return eof_ ? loaded_ : std::max(loaded_, reader_->frames());
     }
 
     /// Height
@@ -334,6 +657,12 @@ class Serializer
         return video_.fps();
     }
 
+    /// Stored frames. In streaming mode the ring, frame f is in slot f % video().frames()
+    const Video &video() const
+    {
+        return video_;
+    }
+
     idx_t frame() const
     {
         return cur_frame_;
@@ -357,7 +686,7 @@ class Serializer
     {
         assert(is_inited_);
 
-        if (cur_frame_ >= video_.frames())
+        if (cur_frame_ >= available())
         {
             std::cerr << "frames() = " << frames() << "; cur_frame = " << cur_frame_ << std::endl;
             std::cerr << "rows() =   " << rows() << "; cur_row   = " << cur_row_ << std::endl;
@@ -366,7 +695,7 @@ class Serializer
 
             return 0;
         }
-        pixel_t pix = video_.get(cur_frame_, cur_row_, cur_col_, cur_clr_);
+        pixel_t pix = video_.get(slot(cur_frame_), cur_row_, cur_col_, cur_clr_);
 
         cur_clr_++;
         if (cur_clr_ >= video_.clrs())
@@ -383,14 +712,111 @@ class Serializer
         {
             cur_row_ = 0;
             cur_frame_ += 1;
+            fetch();
         }
 
         return pix;
     }
+
+    /// @brief Copies up to n next pixels to dst in pop order, frame by frame
+    /// @param[out] dst - buffer of n pixels
+    /// @param[in] n - number of pixels
+    /// @return number of copied pixels. Less than n if all pixels are popped out
+    idx_t pop_n(pixel_t *dst, idx_t n)
+    {
+        assert(is_inited_);
+
+        idx_t done = 0;
+        while (done < n && cur_frame_ < available())
+        {
+            const idx_t pos = position();
+            const idx_t run = std::min(n - done, video_.frame_size() - pos);
+            video_.get_run(slot(cur_frame_), pos, dst + done, run);
+            done += run;
+            seek(pos + run);
+        }
+        return done;
+    }
+
+    /// @brief Pops cols() * clrs() pixels: a whole line if the current pixel starts a line
+    idx_t pop_line(pixel_t *dst)
+    {
+        return pop_n(dst, cols() * clrs());
+    }
+
+    /// @brief Pops rows() * cols() * clrs() pixels: a whole frame if the current pixel starts a frame
+    idx_t pop_frame(pixel_t *dst)
+    {
+        return pop_n(dst, video_.frame_size());
+    }
+
+  private:
+    void reset_cursor()
+    {
+        cur_frame_ = 0;
+        cur_row_ = 0;
+        cur_col_ = 0;
+        cur_clr_ = 0;
+
+        is_inited_ = true;
+    }
+
+    /// Number of frames that can be popped: all of them, or in streaming mode the decoded ones
+    idx_t available() const
+    {
+        return reader_ ? loaded_ : video_.frames();
+    }
+
+    /// Index of the frame in video_
+    idx_t slot(idx_t frame) const
+    {
+        return reader_ ? frame % video_.frames() : frame;
+    }
+
+    /// Streaming mode: decodes frames up to cur_frame_ + ring - 1 into the slots of the popped frames
+    void fetch()
+    {
+        if (!reader_)
+            return;
+
+        const idx_t line = video_.cols() * video_.clrs();
+        while (!eof_ && loaded_ < cur_frame_ + video_.frames())
+        {
+            if (!reader_->next())
+            {
+                eof_ = true;
+                break;
+            }
+            for (idx_t i = 0; i < video_.rows(); ++i)
+                video_.set_run(slot(loaded_), i * line, reader_->row(i), line);
+            ++loaded_;
+        }
+    }
+
+    /// Position of the current pixel in the current frame
+    idx_t position() const
+    {
+        return (cur_row_ * video_.cols() + cur_col_) * video_.clrs() + cur_clr_;
+    }
+
+    /// Moves the current pixel to position pos of the current frame. pos == frame_size() is the next frame
+    void seek(idx_t pos)
+    {
+        if (pos == video_.frame_size())
+        {
+            pos = 0;
+            cur_frame_ += 1;
+            fetch();
+        }
+        cur_clr_ = pos % video_.clrs();
+        cur_col_ = pos / video_.clrs() % video_.cols();
+        cur_row_ = pos / video_.clrs() / video_.cols();
+    }
 };
 
 class Deserializer
 {
+    /// Whole media, or in streaming mode a ring of the frames around the cursor
     Video video_;
 
     /// Points to the pixel that will be pushed in
@@ -402,6 +828,11 @@ class Deserializer
 
     bool is_inited_;
 
+    /// Streaming mode: frame f is collected in slot f % video_.frames() of the ring and encoded once completed
+    std::unique_ptr<FrameSink> writer_{};
+    idx_t frames_ = 0;  ///< number of frames in streaming mode
+    idx_t encoded_ = 0; ///< number of encoded frames
+
   public:
     Deserializer()
     {
@@ -414,42 +845,80 @@ class Deserializer
     /// @param[in] cols - number of columns
     /// @param[in] clrs - number of colors
     /// @param[in] fps - fps of the video. For image can be omitted
-    void init(idx_t frames, idx_t rows, idx_t cols, idx_t clrs, size_t fps = 0)
+    /// @param[in] sample - sample type. i32 keeps any pixel; u8 and u16 save memory and saturate
+    void init(idx_t frames, idx_t rows, idx_t cols, idx_t clrs, size_t fps = 0,
+              clib::sample_t sample = clib::sample_t::i32)
     {
-        video_ = Video(frames, rows, cols, clrs, fps);
-        cur_frame_ = 0;
-        cur_row_ = 0;
-        cur_col_ = 0;
-        cur_clr_ = 0;
-
-        is_inited_ = true;
+        writer_.reset();
+        video_ = Video(frames, rows, cols, clrs, fps, sample);
+        reset_cursor();
     }
 
     /// @brief Automatically detects the file type and creates the Video
     /// @param[in] path - file path
     void init(const std::string &path)
     {
+        writer_.reset();
         video_ = Video(path);
-        cur_frame_ = 0;
-        cur_row_ = 0;
-        cur_col_ = 0;
-        cur_clr_ = 0;
+        reset_cursor();
+    }
 
-        is_inited_ = true;
+    /// @brief Streaming mode: each frame is encoded to the video file as soon as it is completed, only ring frames
+    ///        are kept in memory
+    /// @param[in] path - video file path
+    /// @param[in] frames - number of frames
+    /// @param[in] rows - number of rows. Even
+    /// @param[in] cols - number of columns. Even
+    /// @param[in] clrs - number of colors. 3
+    /// @param[in] fps - fps of the video
+    /// @param[in] ring - number of frames in memory. At least 2
+    /// @param[in] sample - sample type of the ring. Pixels are saturated to 8 bits only when a frame is encoded
+    void init_stream(const std::string &path, idx_t frames, idx_t rows, idx_t cols, idx_t clrs, size_t fps,
+                     idx_t ring = 2, clib::sample_t sample = clib::sample_t::i32)
+    {
+        assert(clrs == 3);
+
+        init_stream(std::unique_ptr<FrameSink>(new VideoFileSink(path, rows, cols, fps)), frames, rows, cols, clrs,
+                    fps, ring, sample);
+    }
+
+    /// @brief Streaming mode over any sink of frames. Parameters as in init_stream with a path
+    /// @param[in] sink - sink of frames of rows x cols x clrs samples
+    void init_stream(std::unique_ptr<FrameSink> sink, idx_t frames, idx_t rows, idx_t cols, idx_t clrs, size_t fps,
+                     idx_t ring = 2, clib::sample_t sample = clib::sample_t::i32)
+    {
+        assert(ring > 1);
+
+        writer_ = std::move(sink);
+        video_ = Video(ring, rows, cols, clrs, fps, sample);
+        frames_ = frames;
+        encoded_ = 0;
+        reset_cursor();
     }
 
-    /// @brief Writes Video to the  file
+    /// @brief Writes Video to the file. In streaming mode encodes the remaining frames and finishes the file given
+    ///        to init_stream; path is ignored
     /// @param[in] path - file path
     void write(const std::string &path)
     {
         assert(is_inited_);
-        video_.write(path);
+
+        if (!writer_)
+        {
+            video_.write(path);
+            return;
+        }
+
+        // Frames that were not pushed completely are encoded as in the batch mode
+        for (idx_t f = encoded_; f < frames_; ++f)
+            encode(f);
+        writer_->finish();
     }
 
     /// Number of frames
     idx_t frames() const
     {
-        return video_.frames();
+        return writer_ ? frames_ : video_.frames();
     }
 
     /// Height
@@ -477,6 +946,12 @@ class Deserializer
         return video_.fps();
     }
 
+    /// Stored frames. In streaming mode the ring, frame f is in slot f % video().frames()
+    const Video &video() const
+    {
+        return video_;
+    }
+
     idx_t frame() const
     {
         return cur_frame_;
@@ -501,7 +976,7 @@ class Deserializer
     {
         assert(is_inited_);
 
-        if (cur_frame_ >= video_.frames())
+        if (cur_frame_ >= frames())
         {
             std::cerr << "frames() = " << frames() << "; cur_frame = " << cur_frame_ << std::endl;
             std::cerr << "rows() =   " << rows() << "; cur_row   = " << cur_row_ << std::endl;
@@ -510,7 +985,7 @@ class Deserializer
 
             return;
         }
-        video_.set(pixel, cur_frame_, cur_row_, cur_col_, cur_clr_);
+        video_.set(pixel, slot(cur_frame_), cur_row_, cur_col_, cur_clr_);
 
         cur_clr_++;
         if (cur_clr_ >= video_.clrs())
@@ -527,7 +1002,105 @@ class Deserializer
         {
             cur_row_ = 0;
             cur_frame_ += 1;
+            flush();
+        }
+    }
+
+    /// @brief Copies up to n pixels from src to Video in push order, frame by frame
+    /// @param[in] src - buffer of n pixels
+    /// @param[in] n - number of pixels
+    /// @return number of copied pixels. Less than n if all pixels are pushed in
+    idx_t push_n(const pixel_t *src, idx_t n)
+    {
+        assert(is_inited_);
+
+        idx_t done = 0;
+        while (done < n && cur_frame_ < frames())
+        {
+            const idx_t pos = position();
+            const idx_t run = std::min(n - done, video_.frame_size() - pos);
+            video_.set_run(slot(cur_frame_), pos, src + done, run);
+            done += run;
+            seek(pos + run);
+        }
+        return done;
+    }
+
+    /// @brief Pushes cols() * clrs() pixels: a whole line if the current pixel starts a line
+    idx_t push_line(const pixel_t *src)
+    {
+        return push_n(src, cols() * clrs());
+    }
+
+    /// @brief Pushes rows() * cols() * clrs() pixels: a whole frame if the current pixel starts a frame
+    idx_t push_frame(const pixel_t *src)
+    {
+        return push_n(src, video_.frame_size());
+    }
+
+  private:
+    void reset_cursor()
+    {
+        cur_frame_ = 0;
+        cur_row_ = 0;
+        cur_col_ = 0;
+        cur_clr_ = 0;
+
+        is_inited_ = true;
+    }
+
+    /// Index of the frame in video_
+    idx_t slot(idx_t frame) const
+    {
+        return writer_ ? frame % video_.frames() : frame;
+    }
+
+    /// Streaming mode: encodes the frames completed by the cursor
+    void flush()
+    {
+        if (!writer_)
+            return;
+
+        while (encoded_ < cur_frame_)
+            encode(encoded_);
+    }
+
+    /// Streaming mode: encodes frame and frees its slot for frame + ring
+    void encode(idx_t frame)
+    {
+        assert(frame == encoded_);
+
+        const idx_t line = video_.cols() * video_.clrs();
+        vector<pixel_t> buf(line);
+        for (idx_t i = 0; i < video_.rows(); ++i)
+        {
+            video_.get_run(slot(frame), i * line, buf.data(), line);
+            std::transform(buf.begin(), buf.end(), writer_->row(i), clib::detail::to_sample<uint8_t>);
+        }
+        writer_->write_frame();
+
+        video_.clear_frame(slot(frame));
+        ++encoded_;
+    }
+
+    /// Position of the current pixel in the current frame
+    idx_t position() const
+    {
+        return (cur_row_ * video_.cols() + cur_col_) * video_.clrs() + cur_clr_;
+    }
+
+    /// Moves the current pixel to position pos of the current frame. pos == frame_size() is the next frame
+    void seek(idx_t pos)
+    {
+        if (pos == video_.frame_size())
+        {
+            pos = 0;
+            cur_frame_ += 1;
+            flush();
         }
+        cur_clr_ = pos % video_.clrs();
+        cur_col_ = pos / video_.clrs() % video_.cols();
+        cur_row_ = pos / video_.clrs() / video_.cols();
     }
 };
 
@@ -551,6 +1124,20 @@ struct VideoInterface
     {
         target.push(pixel);
     }
+
+    /// @brief Pop up to n pixels
+    /// @return number of popped pixels
+    idx_t pop_n(pixel_t *dst, idx_t n)
+    {
+        return source.pop_n(dst, n);
+    }
+
+    /// @brief Push up to n pixels
+    /// @return number of pushed pixels
+    idx_t push_n(const pixel_t *src, idx_t n)
+    {
+        return target.push_n(src, n);
+    }
 };
 
 } // namespace vsim
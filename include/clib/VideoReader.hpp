@@ -0,0 +1,208 @@
+#pragma once
+
+#include "ImgView.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+namespace clib
+{
+
+/*! @brief Параметры видеопотока
+ */
+struct video_info
+{
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t fps = 0;          ///< кадров в секунду с округлением вниз, как get_fps
+    double frame_rate = 0.0; ///< кадров в секунду
+    size_t frames = 0;       ///< количество кадров из заголовка контейнера. 0 - неизвестно
+    double duration = 0.0;   ///< длительность в секундах. 0 - неизвестна
+    std::string codec;       ///< название кодека
+};
+
+/*!
+ * \brief Потоковое чтение видео через libavformat/libavcodec
+ *
+ * \details Файл открывается один раз, параметры потока (info) известны сразу после открытия. Кадры декодируются по
+ * одному при вызове next() и переводятся в RGB в один и тот же буфер, поэтому память ограничена несколькими кадрами
+ * декодера независимо от длины ролика. Текущий кадр доступен как ImgView (view()), из которого строятся img<T> и
+ * img_rgb<T>
+ *
+ * Пример:
+ *
+ *     VideoReader reader(path);
+ *     while (reader.next())
+ *         process(img_rgb<T>(prototype, reader.view()));
+ */
+class VideoReader
+{
+  public:
+    using idx_t = ImgView::idx_t;
+    using pixel_t = ImgView::pixel_t;
+
+    /*! @brief Открывает файл и декодер первого видеопотока
+     *
+     * \param[in] path Путь до видео
+     */
+    explicit VideoReader(const std::string &path);
+    ~VideoReader();
+
+    VideoReader(const VideoReader &) = delete;
+    VideoReader &operator=(const VideoReader &) = delete;
+
+    const video_info &info() const noexcept
+    {
+        return info_;
+    }
+
+    idx_t rows() const noexcept
+    {
+        return info_.rows;
+    }
+    idx_t cols() const noexcept
+    {
+        return info_.cols;
+    }
+    idx_t clrs() const noexcept
+    {
+        return 3;
+    }
+
+    /*! @brief Декодирует следующий кадр в буфер
+     *
+     * \return false, если кадры закончились. Буфер при этом не меняется
+     */
+    bool next();
+
+    /// Номер текущего кадра, начиная с 0
+    idx_t frame() const
+    {
+        check_frame();
+        return decoded_ - 1;
+    }
+
+    /// Отсчет текущего кадра
+    pixel_t get(idx_t i, idx_t j, idx_t clr) const
+    {
+        assert(i < rows());
+        assert(j < cols());
+        assert(clr < clrs());
+
+        check_frame();
+        return rgb_[(i * info_.cols + j) * 3 + clr];
+    }
+
+    /// Строка i текущего кадра: cols() троек R, G, B
+    const uint8_t *row(idx_t i) const
+    {
+        assert(i < rows());
+
+        check_frame();
+        return rgb_.data() + i * info_.cols * 3;
+    }
+
+    /// Текущий кадр как Представление изображения (только для чтения)
+    const ImgView &view() const noexcept
+    {
+        return view_;
+    }
+
+  private:
+    // Представление текущего кадра для конструкторов img<T> и img_rgb<T>
+    class frame_view : public ImgView
+    {
+        const VideoReader &reader_;
+
+      public:
+        explicit frame_view(const VideoReader &reader) : reader_(reader)
+        {
+        }
+
+        void init(idx_t, idx_t, idx_t) override
+        {
+            throw std::logic_error("VideoReader frame is read-only");
+        }
+
+        idx_t rows() const override
+        {
+            return reader_.rows();
+        }
+        idx_t cols() const override
+        {
+            return reader_.cols();
+        }
+        idx_t clrs() const override
+        {
+            return reader_.clrs();
+        }
+
+        pixel_t get(idx_t i, idx_t j, idx_t clr) const override
+        {
+            return reader_.get(i, j, clr);
+        }
+        void set(pixel_t, idx_t, idx_t, idx_t) override
+        {
+            throw std::logic_error("VideoReader frame is read-only");
+        }
+
+        void read_row(idx_t i, idx_t clr, pixel_t *dst) const override
+        {
+            assert(clr < reader_.clrs());
+
+            const uint8_t *src = reader_.row(i) + clr;
+            for (idx_t j = 0, cols = reader_.cols(); j < cols; ++j)
+                dst[j] = src[j * 3];
+        }
+
+        void read_plane(idx_t clr, pixel_t *dst, idx_t stride) const override
+        {
+            assert(stride >= reader_.cols());
+
+            for (idx_t i = 0, rows = reader_.rows(); i < rows; ++i)
+                frame_view::read_row(i, clr, dst + i * stride);
+        }
+
+        void read_img(const std::string &) override
+        {
+            throw std::logic_error("VideoReader frame is read-only");
+        }
+        void write_img(const std::string &) override
+        {
+            throw std::logic_error("VideoReader frame is read-only");
+        }
+    };
+
+    AVFormatContext *format_ = nullptr;
+    AVCodecContext *codec_ = nullptr;
+    AVFrame *frame_ = nullptr;
+    AVPacket *packet_ = nullptr;
+    SwsContext *sws_ = nullptr;
+    int stream_ = -1;
+    bool draining_ = false;
+
+    video_info info_;
+    std::vector<uint8_t> rgb_;
+    idx_t decoded_ = 0;
+    frame_view view_;
+
+    void convert();
+    void close() noexcept;
+
+    void check_frame() const
+    {
+        if (decoded_ == 0)
+            throw std::runtime_error{"no frame was decoded"};
+    }
+};
+
+} // namespace clib
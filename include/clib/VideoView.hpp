@@ -4,6 +4,7 @@
 #define cimg_use_jpeg
 
 #include "CImg.h"
+#include "ImgView.hpp"
 #include "X11/Xlib.h"
 
 extern "C"
@@ -50,10 +51,47 @@ class VideoView
     virtual idx_t clrs() const = 0;   // количество цветов
     virtual idx_t frames() const = 0; // количество кадров
 
+    /// Кадров в секунду
+    size_t fps() const
+    {
+        return fps_;
+    }
+
     // Работа с пикселями
     virtual pixel_t get(idx_t i, idx_t j, idx_t clr, idx_t frame) const = 0;
     virtual void set(pixel_t val, idx_t i, idx_t j, idx_t clr, idx_t frame) = 0;
 
+    /*! @brief Массовый доступ к отсчетам кадра, как у ImgView
+     *
+     * \details Реализации по умолчанию выражены через get/set (строка) и строки (плоскость)
+     */
+
+    /// Строка i цвета clr кадра frame в dst (cols() отсчетов)
+    virtual void read_row(idx_t i, idx_t clr, idx_t frame, pixel_t *dst) const;
+    /// Строка i цвета clr кадра frame из src (cols() отсчетов)
+    virtual void write_row(idx_t i, idx_t clr, idx_t frame, const pixel_t *src);
+
+    /// Плоскость цвета clr кадра frame в dst: строка i записывается с адреса dst + i * stride, stride >= cols()
+    virtual void read_plane(idx_t clr, idx_t frame, pixel_t *dst, idx_t stride) const;
+    /// Плоскость цвета clr кадра frame из src: строка i читается с адреса src + i * stride, stride >= cols()
+    virtual void write_plane(idx_t clr, idx_t frame, const pixel_t *src, idx_t stride);
+
+    /// Плоскость цвета clr кадра frame по строкам подряд с шагом cols(), или nullptr, если прямой доступ невозможен
+    virtual pixel_t *data(idx_t clr, idx_t frame);
+    virtual const pixel_t *data(idx_t clr, idx_t frame) const;
+
+    /// Тип хранимых отсчетов
+    virtual sample_t sample_type() const
+    {
+        return sample_t::i32;
+    }
+
+    /// Плоскость цвета clr кадра frame в типе sample_type() по строкам подряд с шагом cols(), или nullptr
+    virtual const void *samples(idx_t clr, idx_t frame) const
+    {
+        return data(clr, frame);
+    }
+
     virtual void read_video(const std::string &path) = 0;
     virtual void write_video(const std::string &path) = 0;
 
@@ -62,9 +100,15 @@ class VideoView
     }
 };
 
-class CVideoView : public VideoView
+/*!
+ * \brief Представление на CImg с отсчетами типа S
+ *
+ * \details Декодированное видео 8-битное, поэтому CVideoView хранит uint8_t: в 4 раза меньше памяти, чем int.
+ * img<T> и video<T> читают отсчеты напрямую (samples); значения set/write_plane вне диапазона S насыщаются
+ */
+template <typename S> class CVideoViewT : public VideoView
 {
-    cimg_library::CImg<pixel_t> video_;
+    cimg_library::CImg<S> video_;
     bool video_created_ = false;
 
   public:
@@ -84,14 +128,47 @@ class CVideoView : public VideoView
     // CImg stores data as [width,height]. Therefore, the data in cimg are transposed
     void set(pixel_t val, idx_t i, idx_t j, idx_t clr, idx_t frame) override;
 
-    void read_video(const std::string &path);
+    void read_row(idx_t i, idx_t clr, idx_t frame, pixel_t *dst) const override;
+
+    void write_row(idx_t i, idx_t clr, idx_t frame, const pixel_t *src) override;
+
+    void read_plane(idx_t clr, idx_t frame, pixel_t *dst, idx_t stride) const override;
+
+    void write_plane(idx_t clr, idx_t frame, const pixel_t *src, idx_t stride) override;
 
-    void write_video(const std::string &path);
+    // Плоскость (z = frame, c = clr) CImg хранится по строкам: x = j меняется быстрее всего. Прямой доступ только
+    // при S = pixel_t
+    pixel_t *data(idx_t clr, idx_t frame) override;
+
+    const pixel_t *data(idx_t clr, idx_t frame) const override;
+
+    sample_t sample_type() const override
+    {
+        return sample_of<S>::value;
+    }
+
+    const void *samples(idx_t clr, idx_t frame) const override;
+
+    void read_video(const std::string &path) override;
+
+    void write_video(const std::string &path) override;
 
   private:
     void check_created() const;
+
+    const S *plane(idx_t clr, idx_t frame) const;
+    S *plane(idx_t clr, idx_t frame);
+
+    // Меняет количество кадров, сохраняя первые min(frames, frames()) кадров
+    void resize_frames(idx_t frames);
 };
 
+extern template class CVideoViewT<uint8_t>;
+extern template class CVideoViewT<uint16_t>;
+extern template class CVideoViewT<int>;
+
+using CVideoView = CVideoViewT<uint8_t>;
+
 size_t get_fps(const std::string &path);
 bool check_ext(const std::string &s, const std::vector<std::string> &exts);
 
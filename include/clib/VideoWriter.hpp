@@ -0,0 +1,190 @@
+#pragma once
+
+#include "ImgView.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVStream;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+namespace clib
+{
+
+/*!
+ * \brief Потоковая запись видео через libavformat/libavcodec
+ *
+ * \details Кадр заполняется в буфере RGB (через view() или row()) и кодируется вызовом write_frame(); закодированные
+ * пакеты сразу пишутся в файл. Память ограничена одним кадром и буферами кодера независимо от длины ролика. Кодек
+ * выбирается по расширению файла, формат пикселей кодера - YUV 4:2:0
+ *
+ * Пример:
+ *
+ *     VideoWriter writer(path, rows, cols, fps);
+ *     for (auto &frame : frames)
+ *     {
+ *         frame.write(writer.view());
+ *         writer.write_frame();
+ *     }
+ *     writer.finish();
+ */
+class VideoWriter
+{
+  public:
+    using idx_t = ImgView::idx_t;
+    using pixel_t = ImgView::pixel_t;
+
+    /*! @brief Создает файл и открывает кодер
+     *
+     * \param[in] path Путь до видео
+     * \param[in] rows, cols Размер кадра. Оба четные
+     * \param[in] fps Кадров в секунду
+     */
+    VideoWriter(const std::string &path, idx_t rows, idx_t cols, double fps);
+
+    /// Дописывает файл (finish), если это не сделано явно. Ошибки при этом не передаются
+    ~VideoWriter();
+
+    VideoWriter(const VideoWriter &) = delete;
+    VideoWriter &operator=(const VideoWriter &) = delete;
+
+    idx_t rows() const noexcept
+    {
+        return rows_;
+    }
+    idx_t cols() const noexcept
+    {
+        return cols_;
+    }
+    idx_t clrs() const noexcept
+    {
+        return 3;
+    }
+
+    /// Количество записанных кадров
+    idx_t frames() const noexcept
+    {
+        return written_;
+    }
+
+    void set(pixel_t val, idx_t i, idx_t j, idx_t clr)
+    {
+        assert(i < rows());
+        assert(j < cols());
+        assert(clr < clrs());
+
+        rgb_[(i * cols_ + j) * 3 + clr] = static_cast<uint8_t>(std::min(std::max(val, 0), 255));
+    }
+
+    /// Строка i кадра: cols() троек R, G, B
+    uint8_t *row(idx_t i)
+    {
+        assert(i < rows());
+        return rgb_.data() + i * cols_ * 3;
+    }
+
+    /// Кадр как Представление изображения (для img<T>::write и img_rgb<T>::write)
+    ImgView &view() noexcept
+    {
+        return view_;
+    }
+
+    /// Кодирует кадр из буфера. Буфер сохраняется и может быть изменен для следующего кадра
+    void write_frame();
+
+    /// Выталкивает кадры из кодера и дописывает файл. Повторный вызов ничего не делает
+    void finish();
+
+  private:
+    // Представление кадра для img<T>::write и img_rgb<T>::write
+    class frame_view : public ImgView
+    {
+        VideoWriter &writer_;
+
+      public:
+        explicit frame_view(VideoWriter &writer) : writer_(writer)
+        {
+        }
+
+        void init(idx_t rows, idx_t cols, idx_t colors) override
+        {
+            if (rows != writer_.rows() || cols != writer_.cols() || colors != writer_.clrs())
+                throw std::invalid_argument("VideoWriter frame size is fixed");
+        }
+
+        idx_t rows() const override
+        {
+            return writer_.rows();
+        }
+        idx_t cols() const override
+        {
+            return writer_.cols();
+        }
+        idx_t clrs() const override
+        {
+            return writer_.clrs();
+        }
+
+        pixel_t get(idx_t i, idx_t j, idx_t clr) const override
+        {
+            return writer_.rgb_[(i * writer_.cols_ + j) * 3 + clr];
+        }
+        void set(pixel_t val, idx_t i, idx_t j, idx_t clr) override
+        {
+            writer_.set(val, i, j, clr);
+        }
+
+        void write_row(idx_t i, idx_t clr, const pixel_t *src) override
+        {
+            assert(clr < writer_.clrs());
+
+            uint8_t *dst = writer_.row(i) + clr;
+            for (idx_t j = 0, cols = writer_.cols(); j < cols; ++j)
+                dst[j * 3] = static_cast<uint8_t>(std::min(std::max(src[j], 0), 255));
+        }
+
+        void write_plane(idx_t clr, const pixel_t *src, idx_t stride) override
+        {
+            assert(stride >= writer_.cols());
+
+            for (idx_t i = 0, rows = writer_.rows(); i < rows; ++i)
+                frame_view::write_row(i, clr, src + i * stride);
+        }
+
+        void read_img(const std::string &) override
+        {
+            throw std::logic_error("VideoWriter frame is write-only");
+        }
+        void write_img(const std::string &) override
+        {
+            throw std::logic_error("VideoWriter frame is write-only");
+        }
+    };
+
+    AVFormatContext *format_ = nullptr;
+    AVCodecContext *codec_ = nullptr;
+    AVStream *stream_ = nullptr;
+    AVFrame *frame_ = nullptr;
+    AVPacket *packet_ = nullptr;
+    SwsContext *sws_ = nullptr;
+    bool finished_ = false;
+
+    idx_t rows_;
+    idx_t cols_;
+    std::vector<uint8_t> rgb_;
+    idx_t written_ = 0;
+    frame_view view_;
+
+    void send(AVFrame *frame);
+    void close() noexcept;
+};
+
+} // namespace clib
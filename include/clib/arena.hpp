@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace clib
+{
+
+/*!
+ * \brief Арена для временных изображений одного кадра
+ *
+ * \details Память выделяется последовательно (bump) из блоков фиксированного размера и не освобождается по
+ * отдельности: deallocate ничего не делает, вся память арены возвращается вызовом reset за O(1). Блоки после reset
+ * не отдаются системе и переиспользуются следующими кадрами, поэтому в установившемся режиме арена не обращается
+ * к malloc. Запросы больше блока получают отдельный блок, который освобождается при reset.
+ *
+ * Выделение потокобезопасно: место в текущем блоке занимается атомарным сдвигом, блокировка берется только при
+ * переходе к следующему блоку и для больших запросов. reset не должен выполняться одновременно с выделением. Все
+ * изображения, созданные из арены, должны быть уничтожены или больше не использоваться до reset.
+ *
+ * Пример:
+ *
+ *     frame_arena arena;
+ *     for (...)
+ *     {
+ *         {
+ *             arena_scope scope(arena); // img и img_rgb, созданные в этом потоке, берут память из arena
+ *             img<T> res = img<T>::convolution(kernel, frame);
+ *             save(res);
+ *         }
+ *         arena.reset();
+ *     }
+ */
+class frame_arena
+{
+  public:
+    /// Счетчики арены
+    struct counters
+    {
+        size_t allocations = 0; ///< выделений с последнего reset
+        size_t bytes = 0;       ///< выделено байт с последнего reset (с выравниванием)
+        size_t blocks = 0;      ///< блоков, полученных от системы за все время
+    };
+
+    static constexpr size_t DEFAULT_BLOCK = size_t(1) << 20;
+
+    explicit frame_arena(size_t block_size = DEFAULT_BLOCK);
+
+    frame_arena(const frame_arena &) = delete;
+    frame_arena &operator=(const frame_arena &) = delete;
+
+    /*! @brief Выделяет bytes байт с выравниванием align
+     */
+    void *allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+
+    /*! @brief Возвращает всю память арены. Обычные блоки сохраняются для следующего кадра
+     */
+    void reset() noexcept;
+
+    counters stats() const;
+
+    size_t block_size() const noexcept
+    {
+        return block_size_;
+    }
+
+  private:
+    // Блок размера block_size_. used сдвигается атомарно, без блокировки
+    struct block
+    {
+        std::unique_ptr<char[]> data;
+        std::atomic<size_t> used;
+    };
+
+    size_t block_size_;
+
+    std::mutex mutex_;                           // только для смены блока и больших запросов
+    std::vector<std::unique_ptr<block>> blocks_; // блоки размера block_size_
+    std::vector<std::unique_ptr<char[]>> large_; // отдельные блоки для больших запросов
+    size_t current_index_;                       // индекс текущего блока в blocks_
+    std::atomic<block *> current_;               // текущий блок. nullptr - блоков еще нет
+
+    std::atomic<size_t> allocations_;
+    std::atomic<size_t> bytes_;
+    std::atomic<size_t> blocks_count_;
+
+    // Переходит к следующему блоку, если текущим все еще остается full
+    void next_block(block *full);
+};
+
+/*! @brief Текущая арена потока. nullptr - память берется из кучи
+ */
+frame_arena *current_arena() noexcept;
+
+/*! @brief Количество выделений frame_allocator из кучи (без арены) во всех потоках
+ */
+size_t heap_allocations() noexcept;
+
+/*! @brief Делает арену текущей для потока на время жизни объекта
+ */
+class arena_scope
+{
+    frame_arena *prev_;
+
+  public:
+    explicit arena_scope(frame_arena &arena);
+    /// nullptr - память из кучи. Используется для передачи арены рабочим потокам
+    explicit arena_scope(frame_arena *arena);
+    ~arena_scope();
+
+    arena_scope(const arena_scope &) = delete;
+    arena_scope &operator=(const arena_scope &) = delete;
+};
+
+namespace detail
+{
+void *heap_allocate(size_t bytes);
+} // namespace detail
+
+/*!
+ * \brief Аллокатор хранилища img
+ *
+ * \details Запоминает текущую арену потока в момент создания контейнера (или копирования, см.
+ * select_on_container_copy_construction) и выделяет память из нее. Поэтому строки изображения, созданного под
+ * arena_scope, берут память из арены даже тогда, когда заполняются рабочими потоками img. Без арены работает как
+ * std::allocator
+ */
+template <typename T> class frame_allocator
+{
+    template <typename U> friend class frame_allocator;
+
+    frame_arena *arena_;
+
+  public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    frame_allocator() noexcept : arena_(current_arena())
+    {
+    }
+    explicit frame_allocator(frame_arena *arena) noexcept : arena_(arena)
+    {
+    }
+    template <typename U> frame_allocator(const frame_allocator<U> &other) noexcept : arena_(other.arena_)
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        if (arena_ != nullptr)
+            return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T *>(detail::heap_allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, size_t) noexcept
+    {
+        if (arena_ == nullptr)
+            ::operator delete(ptr);
+    }
+
+    /// Копия контейнера берет память из текущей арены копирующего потока, а не из арены оригинала
+    frame_allocator select_on_container_copy_construction() const noexcept
+    {
+        return frame_allocator();
+    }
+
+    frame_arena *arena() const noexcept
+    {
+        return arena_;
+    }
+
+    template <typename U> bool operator==(const frame_allocator<U> &other) const noexcept
+    {
+        return arena_ == other.arena_;
+    }
+    template <typename U> bool operator!=(const frame_allocator<U> &other) const noexcept
+    {
+        return arena_ != other.arena_;
+    }
+};
+
+} // namespace clib
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Flexfixed.hpp"
+#include "Flexfloat.hpp"
+
+namespace clib
+{
+
+/*! @brief Умножение на ноль и ±2^k для типа элемента T
+ *
+ * \details По умолчанию быстрого пути нет: все множители умножаются через T::mult
+ */
+template <typename T> struct pow2_ops
+{
+    static bool is_pow2(const T &)
+    {
+        return false;
+    }
+    static bool is_zero(const T &)
+    {
+        return false;
+    }
+    static void mult(const T &coef, const T &x, T &res)
+    {
+        T::mult(coef, x, res);
+    }
+    static bool same_format(const T &, const T &)
+    {
+        return false;
+    }
+};
+
+template <> struct pow2_ops<Flexfloat>
+{
+    static bool is_pow2(const Flexfloat &val)
+    {
+        return Flexfloat::is_pow2(val);
+    }
+    static bool is_zero(const Flexfloat &val)
+    {
+        return Flexfloat::is_zero(val);
+    }
+    static void mult(const Flexfloat &coef, const Flexfloat &x, Flexfloat &res)
+    {
+        Flexfloat::mult_pow2(coef, x, res);
+    }
+    static bool same_format(const Flexfloat &lhs, const Flexfloat &rhs)
+    {
+        return lhs.get_E() == rhs.get_E() && lhs.get_M() == rhs.get_M() && lhs.get_B() == rhs.get_B();
+    }
+};
+
+template <> struct pow2_ops<Flexfixed>
+{
+    static bool is_pow2(const Flexfixed &val)
+    {
+        return Flexfixed::is_pow2(val);
+    }
+    static bool is_zero(const Flexfixed &val)
+    {
+        return val.get_n() == 0;
+    }
+    static void mult(const Flexfixed &coef, const Flexfixed &x, Flexfixed &res)
+    {
+        Flexfixed::mult_pow2(coef, x, res);
+    }
+    static bool same_format(const Flexfixed &lhs, const Flexfixed &rhs)
+    {
+        return lhs.get_params() == rhs.get_params();
+    }
+};
+
+/*!
+ * \brief Постоянный множитель ядра
+ *
+ * \details Вид множителя определяется один раз при создании. Умножение на ±2^k выполняется сдвигом (экспоненты для
+ * Flexfloat, числителя для Flexfixed), на ноль - без вычислений, а слагаемое свертки с нулевым множителем
+ * пропускается, если прибавление нуля не меняет сумму. Результаты побитово совпадают с T::mult и T::sum
+ *
+ * Пример:
+ *
+ *     const const_coef<T> half(T::from_arithmetic_t(proto, 0.5f));
+ *     half.mult(x, x);       // x = 0.5 * x
+ *     half.mult_add(y, acc); // acc = acc + 0.5 * y
+ */
+template <typename T> class const_coef
+{
+    T value_;
+    bool pow2_;
+    bool zero_;
+
+  public:
+    explicit const_coef(const T &value)
+        : value_(value), pow2_(pow2_ops<T>::is_pow2(value)), zero_(pow2_ops<T>::is_zero(value))
+    {
+    }
+
+    const T &value() const noexcept
+    {
+        return value_;
+    }
+
+    /// Множитель равен нулю или ±2^k и умножается без T::mult
+    bool is_pow2() const noexcept
+    {
+        return pow2_;
+    }
+
+    bool is_zero() const noexcept
+    {
+        return zero_;
+    }
+
+    /*! @brief res = value * x, как T::mult(value, x, res). res может совпадать с x
+     */
+    void mult(const T &x, T &res) const
+    {
+        if (pow2_)
+            pow2_ops<T>::mult(value_, x, res);
+        else
+            T::mult(value_, x, res);
+    }
+
+    /*! @brief acc = acc + value * x, как
+     *
+     *     T tap = x;
+     *     T::mult(value, tap, tap);
+     *     T::sum(acc, tap, acc);
+     *
+     * \details Ноль в формате acc не меняет acc при сложении, поэтому такое слагаемое пропускается
+     */
+    void mult_add(const T &x, T &acc) const
+    {
+        if (zero_ && pow2_ops<T>::same_format(acc, x))
+            return;
+
+        T tap = x;
+        mult(x, tap);
+        T::sum(acc, tap, acc);
+    }
+};
+
+} // namespace clib
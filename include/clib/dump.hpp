@@ -0,0 +1,360 @@
+#pragma once
+
+#include "Flexfixed.hpp"
+#include "Flexfloat.hpp"
+#include "image.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace clib
+{
+
+template <typename T> class video;
+
+/*! @brief Формат чисел записи дампа
+ */
+struct dump_format
+{
+    enum kind_t : uint8_t
+    {
+        flexfloat = 1, ///< слово s|e|m, params = E, M, bias = B
+        flexfixed = 2  ///< слово s|n, params = I, F
+    };
+
+    uint8_t kind = 0;
+    uint8_t word = 0;   ///< байт на слово: 1, 2, 4 или 8
+    uint8_t param0 = 0; ///< E или I
+    uint8_t param1 = 0; ///< M или F
+    int32_t bias = 0;   ///< B для flexfloat
+
+    bool operator==(const dump_format &other) const
+    {
+        return kind == other.kind && word == other.word && param0 == other.param0 && param1 == other.param1 &&
+               bias == other.bias;
+    }
+    bool operator!=(const dump_format &other) const
+    {
+        return !(*this == other);
+    }
+
+    /// Наименьший размер слова для bits бит
+    static uint8_t word_for(unsigned bits)
+    {
+        if (bits > 64)
+            throw std::invalid_argument("Number does not fit in a 64-bit dump word");
+        return bits <= 8 ? 1 : bits <= 16 ? 2 : bits <= 32 ? 4 : 8;
+    }
+};
+
+/*! @brief Упаковка чисел в слова дампа. Специализации для Flexfloat и Flexfixed
+ *
+ * \details format(x) - формат числа x; pack(x) - слово числа; unpack(format, word) - число из слова
+ */
+template <typename T> struct dump_traits;
+
+template <> struct dump_traits<Flexfloat>
+{
+    static constexpr uint8_t kind = dump_format::flexfloat;
+
+    static dump_format format(const Flexfloat &x)
+    {
+        dump_format res;
+        res.kind = kind;
+        res.word = dump_format::word_for(1u + x.get_E() + x.get_M());
+        res.param0 = x.get_E();
+        res.param1 = x.get_M();
+        res.bias = x.get_B();
+        return res;
+    }
+
+    static uint64_t pack(const Flexfloat &x)
+    {
+        return static_cast<uint64_t>(x.get_s()) << (x.get_E() + x.get_M()) |
+               static_cast<uint64_t>(x.get_e()) << x.get_M() | x.get_m();
+    }
+
+    static Flexfloat unpack(const dump_format &format, uint64_t word)
+    {
+        const unsigned E = format.param0, M = format.param1;
+        const uint64_t m_mask = M < 64 ? (uint64_t{1} << M) - 1 : ~uint64_t{0};
+        const uint64_t e_mask = (uint64_t{1} << E) - 1;
+        return Flexfloat(format.param0, format.param1, format.bias, static_cast<Flexfloat::stype>(word >> (E + M) & 1),
+                         static_cast<Flexfloat::etype>(word >> M & e_mask),
+                         static_cast<Flexfloat::mtype>(word & m_mask));
+    }
+};
+
+template <> struct dump_traits<Flexfixed>
+{
+    static constexpr uint8_t kind = dump_format::flexfixed;
+
+    static dump_format format(const Flexfixed &x)
+    {
+        dump_format res;
+        res.kind = kind;
+        res.word = dump_format::word_for(1u + x.get_I() + x.get_F());
+        res.param0 = x.get_I();
+        res.param1 = x.get_F();
+        return res;
+    }
+
+    static uint64_t pack(const Flexfixed &x)
+    {
+        return static_cast<uint64_t>(x.get_s()) << (x.get_I() + x.get_F()) | x.get_n();
+    }
+
+    static Flexfixed unpack(const dump_format &format, uint64_t word)
+    {
+        const unsigned W = format.param0 + format.param1;
+        const uint64_t n_mask = (uint64_t{1} << W) - 1;
+        return Flexfixed(format.param0, format.param1, static_cast<Flexfixed::stype>(word >> W & 1), word & n_mask);
+    }
+};
+
+/*!
+ * \brief Потоковая запись промежуточных img, img_rgb и video в двоичный дамп
+ *
+ * \details Дамп - последовательность записей. Запись: заголовок (имя, формат чисел dump_format, количество кадров,
+ * цветов, строк и столбцов), затем слова чисел по плоскостям (кадр, цвет, строка, столбец), выровненные на 64 байта.
+ * Слово хранит битовое представление числа (s|e|m для Flexfloat, s|n для Flexfixed) в младших битах; порядок байт -
+ * порядок машины, записавшей дамп. Запись дописывается в файл сразу, поэтому дамп, прерванный между записями, остается
+ * читаемым. Все числа одной записи должны иметь одинаковые гиперпараметры
+ *
+ * Пример:
+ *
+ *     dump_writer dump("stages.dump");
+ *     dump.write("input", frame);
+ *     dump.write("demosaic", img_rgb<Flexfloat>(r, g, b));
+ *
+ *     dump_reader stages("stages.dump");
+ *     auto r = stages.read_img<Flexfloat>("demosaic", 0, ImgView::R);
+ */
+class dump_writer
+{
+    std::ofstream file_;
+    std::string path_;
+    std::vector<char> buf_;
+    uint64_t left_ = 0; ///< байт, которые осталось записать в текущую запись
+
+  public:
+    /// Создает файл path (существующий перезаписывается)
+    explicit dump_writer(const std::string &path);
+
+    dump_writer(const dump_writer &) = delete;
+    dump_writer &operator=(const dump_writer &) = delete;
+
+    template <typename T> void write(const std::string &name, const img<T> &image)
+    {
+        const dump_format format = format_of(image);
+        check_plane(format, image);
+        begin(name, format, 1, 1, image.rows(), image.cols());
+        put_plane(format, image);
+        end();
+    }
+
+    template <typename T> void write(const std::string &name, const img_rgb<T> &image)
+    {
+        const dump_format format = format_of(image[0]);
+        for (idx_t clr = 0; clr < 3; ++clr)
+            check_plane(format, image[clr]);
+        begin(name, format, 1, 3, image.rows(), image.cols());
+        for (idx_t clr = 0; clr < 3; ++clr)
+            put_plane(format, image[clr]);
+        end();
+    }
+
+    template <typename T> void write(const std::string &name, const video<T> &vid)
+    {
+        const dump_format format = format_of(vid(0)[0]);
+        for (idx_t f = 0; f < vid.frames(); ++f)
+            for (idx_t clr = 0; clr < 3; ++clr)
+                check_plane(format, vid(f)[clr]);
+        begin(name, format, vid.frames(), 3, vid.rows(), vid.cols());
+        for (idx_t f = 0; f < vid.frames(); ++f)
+            for (idx_t clr = 0; clr < 3; ++clr)
+                put_plane(format, vid(f)[clr]);
+        end();
+    }
+
+    /// Передает записанное в файл
+    void flush();
+
+  private:
+    template <typename T> static dump_format format_of(const img<T> &image)
+    {
+        assert(image.rows() > 0 && image.cols() > 0);
+        return dump_traits<T>::format(image(0, 0));
+    }
+
+    // Форматы проверяются до заголовка записи, поэтому отклоненная запись ничего не оставляет в файле
+    template <typename T> static void check_plane(const dump_format &format, const img<T> &image)
+    {
+        for (idx_t i = 0; i < image.rows(); ++i)
+            for (idx_t j = 0; j < image.cols(); ++j)
+                if (dump_traits<T>::format(image(i, j)) != format)
+                    throw std::invalid_argument("All numbers of a dump record must have the same format");
+    }
+
+    template <typename T> void put_plane(const dump_format &format, const img<T> &image)
+    {
+        switch (format.word)
+        {
+        case 1:
+            put_words<uint8_t>(image);
+            break;
+        case 2:
+            put_words<uint16_t>(image);
+            break;
+        case 4:
+            put_words<uint32_t>(image);
+            break;
+        default:
+            put_words<uint64_t>(image);
+            break;
+        }
+    }
+
+    // Слова пишутся по строке: один вызов записи на строку
+    template <typename W, typename T> void put_words(const img<T> &image)
+    {
+        const idx_t cols = image.cols();
+        buf_.resize(cols * sizeof(W));
+        W *words = reinterpret_cast<W *>(buf_.data());
+
+        for (idx_t i = 0; i < image.rows(); ++i)
+        {
+            for (idx_t j = 0; j < cols; ++j)
+                words[j] = static_cast<W>(dump_traits<T>::pack(image(i, j)));
+            put(buf_.data(), cols * sizeof(W));
+        }
+    }
+
+    void begin(const std::string &name, const dump_format &format, idx_t frames, idx_t clrs, idx_t rows, idx_t cols);
+    void put(const char *data, uint64_t bytes);
+    void end();
+};
+
+/*!
+ * \brief Чтение дампа, записанного dump_writer, через отображение файла в память (mmap)
+ *
+ * \details При открытии читаются только заголовки записей; слова остаются в отображении и доступны без копирования
+ * (entry::words), а read_* распаковывает их в img, img_rgb и video
+ */
+class dump_reader
+{
+  public:
+    struct entry
+    {
+        std::string name{};
+        dump_format format{};
+        idx_t frames = 0;
+        idx_t clrs = 0;
+        idx_t rows = 0;
+        idx_t cols = 0;
+        const unsigned char *words = nullptr; ///< слова всех плоскостей записи
+
+        /// Слова плоскости цвета clr кадра frame
+        const unsigned char *plane(idx_t frame, idx_t clr) const
+        {
+            assert(frame < frames);
+            assert(clr < clrs);
+            return words + (frame * clrs + clr) * rows * cols * format.word;
+        }
+    };
+
+    /// Отображает файл path и читает заголовки записей
+    explicit dump_reader(const std::string &path);
+    ~dump_reader();
+
+    dump_reader(const dump_reader &) = delete;
+    dump_reader &operator=(const dump_reader &) = delete;
+
+    idx_t size() const noexcept
+    {
+        return entries_.size();
+    }
+
+    const entry &operator[](idx_t i) const
+    {
+        assert(i < entries_.size());
+        return entries_[i];
+    }
+
+    /// Первая запись с именем name. \throw std::out_of_range, если такой нет
+    const entry &find(const std::string &name) const;
+
+    /// Плоскость цвета clr кадра frame записи name
+    template <typename T> img<T> read_img(const std::string &name, idx_t frame = 0, idx_t clr = 0) const
+    {
+        return unpack<T>(find(name), frame, clr);
+    }
+
+    /// Кадр frame записи name из 3 цветов
+    template <typename T> img_rgb<T> read_rgb(const std::string &name, idx_t frame = 0) const
+    {
+        const entry &e = find(name);
+        if (e.clrs != 3)
+            throw std::invalid_argument("Dump record is not RGB: " + name);
+
+        img_rgb<T> res(dump_traits<T>::unpack(e.format, 0), e.rows, e.cols);
+        for (idx_t clr = 0; clr < 3; ++clr)
+            res[clr] = unpack<T>(e, frame, clr);
+        return res;
+    }
+
+    /// Все кадры записи name из 3 цветов
+    template <typename T> video<T> read_video(const std::string &name) const
+    {
+        const entry &e = find(name);
+        std::vector<img_rgb<T>> frames;
+        frames.reserve(e.frames);
+        for (idx_t f = 0; f < e.frames; ++f)
+            frames.push_back(read_rgb<T>(name, f));
+        return video<T>(frames);
+    }
+
+  private:
+    void *map_ = nullptr;
+    idx_t bytes_ = 0;
+    std::vector<entry> entries_{};
+
+    template <typename T> static img<T> unpack(const entry &e, idx_t frame, idx_t clr)
+    {
+        if (e.format.kind != dump_traits<T>::kind)
+            throw std::invalid_argument("Dump record holds numbers of another type: " + e.name);
+
+        switch (e.format.word)
+        {
+        case 1:
+            return unpack_words<uint8_t, T>(e, frame, clr);
+        case 2:
+            return unpack_words<uint16_t, T>(e, frame, clr);
+        case 4:
+            return unpack_words<uint32_t, T>(e, frame, clr);
+        default:
+            return unpack_words<uint64_t, T>(e, frame, clr);
+        }
+    }
+
+    template <typename W, typename T> static img<T> unpack_words(const entry &e, idx_t frame, idx_t clr)
+    {
+        const W *words = reinterpret_cast<const W *>(e.plane(frame, clr));
+
+        img<T> res(dump_traits<T>::unpack(e.format, 0), e.rows, e.cols);
+        for (idx_t i = 0; i < e.rows; ++i)
+        {
+            T *row = res.row(i);
+            for (idx_t j = 0; j < e.cols; ++j)
+                row[j] = dump_traits<T>::unpack(e.format, words[i * e.cols + j]);
+        }
+        return res;
+    }
+};
+
+} // namespace clib
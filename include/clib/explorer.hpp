@@ -0,0 +1,342 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <string>
+
+#include "image.hpp"
+#include "tasks.hpp"
+
+namespace clib
+{
+
+/*! @brief Результат одного набора форматов стадий
+ */
+struct explore_result
+{
+    vector<Flexfloat::hyper_params> formats; ///< формат выхода каждой стадии
+    idx_t bits = 0;                          ///< суммарная разрядность стадий, sum(1 + E + M)
+
+    float psnr = 0.0f;    ///< PSNR выхода последней стадии относительно эталона, дБ. inf - совпадение
+    float max_abs = 0.0f; ///< максимум модуля ошибки выхода последней стадии
+    idx_t overflow = 0;   ///< количество насыщенных (|x| = max_norm) значений на выходах всех стадий
+
+    vector<idx_t> stage_overflow; ///< overflow по стадиям
+};
+
+/*! @brief Метрика ошибки для построения фронта Парето
+ */
+enum class explore_metric
+{
+    psnr,   ///< больше - лучше
+    max_abs ///< меньше - лучше
+};
+
+/*! @brief Отчет исследования форматов
+ */
+struct explore_report
+{
+    vector<explore_result> results; ///< все наборы форматов, в лексикографическом порядке кандидатов стадий
+    idx_t stage_runs = 0;           ///< количество вызовов функций стадий (с учетом общих префиксов)
+
+    /*! @brief Фронт Парето "разрядность - ошибка"
+     *
+     * \return Индексы results, упорядоченные по возрастанию bits. Ни один набор форматов из results не лучше
+     * элемента фронта одновременно по разрядности и по ошибке
+     */
+    vector<idx_t> pareto(explore_metric metric = explore_metric::psnr) const
+    {
+        auto error = [metric](const explore_result &res) {
+            return metric == explore_metric::psnr ? -res.psnr : res.max_abs;
+        };
+
+        vector<idx_t> order(results.size());
+        for (idx_t k = 0; k < order.size(); ++k)
+            order[k] = k;
+        std::stable_sort(order.begin(), order.end(), [&](idx_t lhs, idx_t rhs) {
+            if (results[lhs].bits != results[rhs].bits)
+                return results[lhs].bits < results[rhs].bits;
+            return error(results[lhs]) < error(results[rhs]);
+        });
+
+        vector<idx_t> front;
+        float best = std::numeric_limits<float>::infinity();
+        for (idx_t k : order)
+            if (error(results[k]) < best)
+            {
+                best = error(results[k]);
+                front.push_back(k);
+            }
+
+        return front;
+    }
+};
+
+/*!
+ * \brief Перебор форматов Flexfloat по стадиям конвейера
+ *
+ * \details Конвейер - последовательность стадий img<T> -> img<T>, каждая стадия получает формат своего выхода.
+ * Для каждой стадии задается список форматов-кандидатов, перебирается их декартово произведение. Входные кадры
+ * декодируются пользователем один раз и передаются в run.
+ *
+ * Наборы форматов образуют дерево: узел уровня s - выбор форматов стадий 0..s-1 и изображения после стадии s - 1.
+ * Дерево обходится в глубину, поэтому общий префикс стадий вычисляется один раз для всех наборов, которые его
+ * содержат. Первые стадии выполняются по уровням, пока пар (префикс, кадр) не станет достаточно для всех потоков,
+ * от этих пар дерево обходится в глубину; пары распределяются по потокам динамически. Выход каждого листа сразу
+ * сравнивается с эталоном и освобождается: от листьев остаются только метрики, и память не растет с количеством
+ * наборов форматов.
+ *
+ * Эталон - тот же конвейер, выполненный в формате reference (по умолчанию (8, 23, 127), т.е. float) для всех
+ * стадий. Результат не зависит от количества потоков
+ *
+ * Пример:
+ *
+ *     explorer<Flexfloat> ex;
+ *     ex.stage("gain", gain, {{5, 10, 15}, {8, 7, 127}}).stage("blur", blur, {{5, 10, 15}, {4, 3, 7}});
+ *     explore_report report = ex.run(frames);
+ *     for (idx_t k : report.pareto()) ...
+ */
+template <typename T> class explorer
+{
+  public:
+    using format = Flexfloat::hyper_params;
+    using stage_func = std::function<img<T>(const img<T> &, const format &)>;
+
+  private:
+    struct stage_desc
+    {
+        std::string name;
+        stage_func func;
+        vector<format> candidates;
+    };
+
+    // Ошибка выхода одного набора форматов на одном кадре
+    struct frame_error
+    {
+        double sq_err = 0.0;
+        float max_abs = 0.0f;
+        idx_t count = 0;
+        vector<idx_t> overflow{}; // переполнения по стадиям
+    };
+
+    vector<stage_desc> stages_;
+    format reference_;
+
+  public:
+    explicit explorer(const format &reference = {8, 23, 127}) : reference_(reference)
+    {
+    }
+
+    /*! @brief Добавляет стадию в конец конвейера
+     *
+     * \param[in] name Имя стадии
+     * \param[in] func Стадия. Получает вход и формат, в котором должен быть ее выход
+     * \param[in] candidates Форматы-кандидаты выхода стадии
+     */
+    explorer &stage(const std::string &name, stage_func func, const vector<format> &candidates)
+    {
+        assert(!candidates.empty());
+        stages_.push_back({name, std::move(func), candidates});
+        return *this;
+    }
+
+    idx_t stages() const noexcept
+    {
+        return stages_.size();
+    }
+
+    const std::string &name(idx_t s) const
+    {
+        return stages_[s].name;
+    }
+
+    /*! @brief Выполняет все наборы форматов
+     *
+     * \param[in] inputs Декодированные входные кадры
+     * \param[in] peak Пиковое значение сигнала для PSNR. 0 - максимум модуля эталона
+     * \param[in] req_threads Количество потоков. 0 - определить автоматически
+     */
+    explore_report run(const vector<img<T>> &inputs, float peak = 0.0f, idx_t req_threads = 0) const
+    {
+        assert(!stages_.empty());
+        assert(!inputs.empty());
+
+        explore_report report;
+
+        // Эталон
+        vector<img<T>> reference = inputs;
+        for (const stage_desc &st : stages_)
+            for (img<T> &frame : reference)
+                frame = st.func(frame, reference_);
+        report.stage_runs += stages_.size() * inputs.size();
+
+        if (peak == 0.0f)
+            for (const img<T> &frame : reference)
+                for (idx_t i = 0; i < frame.rows(); ++i)
+                    for (idx_t j = 0; j < frame.cols(); ++j)
+                        peak = std::max(peak, std::fabs(frame(i, j).to_float()));
+
+        // Листья дерева в лексикографическом порядке кандидатов стадий
+        const idx_t nframes = inputs.size();
+        idx_t leaves = 1;
+        for (const stage_desc &st : stages_)
+        {
+            leaves *= st.candidates.size();
+            report.stage_runs += leaves * nframes;
+        }
+
+        // Первые стадии выполняются по уровням, пар (префикс, кадр) становится больше с каждым уровнем. Уровни
+        // добавляются, пока пар меньше 4 * nthreads: при одном кандидате первой стадии или одном кадре потоки все
+        // равно заняты. Задача - одна пара, префикс вычисляется один раз и хранится до следующего уровня
+        const idx_t nthreads = req_threads != 0 ? req_threads : thread_pool::instance().workers();
+        vector<frame_error> errors(leaves * nframes);
+        vector<img<T>> outs;              // выходы префиксов уровня depth, по парам (префикс, кадр)
+        vector<vector<idx_t>> overflows;  // переполнения стадий префиксов уровня depth
+        idx_t depth = 0, prefixes = 1;
+        while (depth < stages_.size() && prefixes * nframes < 4 * nthreads)
+        {
+            const idx_t next = stages_[depth].candidates.size();
+            const bool last = depth + 1 == stages_.size();
+            vector<img<T>> next_outs(last ? 0 : prefixes * next * nframes);
+            vector<vector<idx_t>> next_overflows(last ? 0 : prefixes * next * nframes);
+            run_tasks(prefixes * next * nframes, req_threads, [&](idx_t task) {
+                const idx_t p = task / nframes, f = task % nframes, parent = p / next * nframes + f;
+                const format &fmt = stages_[depth].candidates[p % next];
+
+                img<T> out = stages_[depth].func(depth == 0 ? inputs[f] : outs[parent], fmt);
+                vector<idx_t> overflow = depth == 0 ? vector<idx_t>() : overflows[parent];
+                overflow.push_back(saturated(out, fmt));
+
+                if (last)
+                {
+                    errors[task].overflow = std::move(overflow);
+                    measure(out, reference[f], errors[task]);
+                }
+                else
+                {
+                    next_outs[task] = std::move(out);
+                    next_overflows[task] = std::move(overflow);
+                }
+            });
+            outs = std::move(next_outs);
+            overflows = std::move(next_overflows);
+            prefixes *= next;
+            ++depth;
+        }
+
+        // Остальные стадии - обход в глубину из каждой пары
+        if (depth < stages_.size())
+            run_tasks(prefixes * nframes, req_threads, [&](idx_t task) {
+                const idx_t p = task / nframes, f = task % nframes, next = stages_[depth].candidates.size();
+                vector<idx_t> overflow = depth == 0 ? vector<idx_t>() : overflows[task];
+                for (idx_t k = 0; k < next; ++k)
+                    descend(depth, k, p * next + k, depth == 0 ? inputs[f] : outs[task], reference[f], overflow,
+                            &errors[f], nframes);
+            });
+
+        // Метрики. Кадры складываются по порядку, поэтому результат не зависит от количества потоков
+        report.results.resize(leaves);
+        for (idx_t n = 0; n < leaves; ++n)
+        {
+            explore_result &res = report.results[n];
+
+            res.formats.resize(stages_.size());
+            for (idx_t s = stages_.size(), rest = n; s-- > 0;)
+            {
+                const vector<format> &candidates = stages_[s].candidates;
+                res.formats[s] = candidates[rest % candidates.size()];
+                rest /= candidates.size();
+            }
+            for (const format &fmt : res.formats)
+                res.bits += 1u + fmt.E + fmt.M;
+
+            res.stage_overflow.assign(stages_.size(), 0);
+            double sq_err = 0.0;
+            idx_t count = 0;
+            for (idx_t f = 0; f < nframes; ++f)
+            {
+                const frame_error &err = errors[n * nframes + f];
+                for (idx_t s = 0; s < stages_.size(); ++s)
+                    res.stage_overflow[s] += err.overflow[s];
+                res.max_abs = std::max(res.max_abs, err.max_abs);
+                sq_err += err.sq_err;
+                count += err.count;
+            }
+            for (idx_t ovf : res.stage_overflow)
+                res.overflow += ovf;
+
+            const double mse = sq_err / static_cast<double>(count);
+            res.psnr = mse == 0.0 ? std::numeric_limits<float>::infinity()
+                                  : static_cast<float>(10.0 * std::log10(static_cast<double>(peak) * peak / mse));
+        }
+
+        return report;
+    }
+
+  private:
+    /*! @brief Выполняет стадию s с кандидатом c и все наборы форматов следующих стадий
+     *
+     * \details Выход листа сразу сравнивается с эталоном ref, в errors[leaf * nframes] остаются только метрики.
+     * Одновременно хранится по одному изображению на стадию
+     */
+    void descend(idx_t s, idx_t c, idx_t leaf, const img<T> &in, const img<T> &ref, vector<idx_t> &overflow,
+                 frame_error *errors, idx_t nframes) const
+    {
+        const format &fmt = stages_[s].candidates[c];
+        const img<T> out = stages_[s].func(in, fmt);
+        overflow.push_back(saturated(out, fmt));
+
+        if (s + 1 == stages_.size())
+        {
+            frame_error &err = errors[leaf * nframes];
+            err.overflow = overflow;
+            measure(out, ref, err);
+        }
+        else
+        {
+            const idx_t next = stages_[s + 1].candidates.size();
+            for (idx_t k = 0; k < next; ++k)
+                descend(s + 1, k, leaf * next + k, out, ref, overflow, errors, nframes);
+        }
+
+        overflow.pop_back();
+    }
+
+    // Ошибка выхода out относительно эталона ref
+    static void measure(const img<T> &out, const img<T> &ref, frame_error &err)
+    {
+        assert(out.rows() == ref.rows() && out.cols() == ref.cols());
+
+        for (idx_t i = 0; i < out.rows(); ++i)
+            for (idx_t j = 0; j < out.cols(); ++j)
+            {
+                const float diff = std::fabs(out(i, j).to_float() - ref(i, j).to_float());
+                err.max_abs = std::max(err.max_abs, diff);
+                err.sq_err += static_cast<double>(diff) * diff;
+            }
+        err.count = out.rows() * out.cols();
+    }
+
+    // Количество значений, насыщенных до max_norm формата
+    static idx_t saturated(const img<T> &image, const format &fmt)
+    {
+        const float max_norm = T::from_arithmetic_t(fmt.E, fmt.M, fmt.B, FLT_MAX).to_float();
+
+        if (image.is_broadcast())
+            return std::fabs(image.value().to_float()) >= max_norm ? image.rows() * image.cols() : 0;
+
+        idx_t res = 0;
+        for (idx_t i = 0; i < image.rows(); ++i)
+        {
+            const T *line = image.row(i);
+            for (idx_t j = 0; j < image.cols(); ++j)
+                res += std::fabs(line[j].to_float()) >= max_norm;
+        }
+        return res;
+    }
+};
+
+} // namespace clib
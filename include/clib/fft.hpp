@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Flexfloat.hpp"
+#include "coef.hpp"
+#include "pool.hpp"
+
+namespace clib
+{
+
+/*! @brief Комплексное число из двух значений T
+ *
+ * \details Каждая операция округляется в формате res так же, как T::mult и T::sum: произведение (a + bi)(c + di)
+ * считается как четыре округленных произведения и два округленных сложения, как в аппаратном умножителе
+ */
+template <typename T> struct complex_t
+{
+    T re;
+    T im;
+
+    static void sum(const complex_t &lhs, const complex_t &rhs, complex_t &res)
+    {
+        T::sum(lhs.re, rhs.re, res.re);
+        T::sum(lhs.im, rhs.im, res.im);
+    }
+
+    static void sub(const complex_t &lhs, const complex_t &rhs, complex_t &res)
+    {
+        T::sub(lhs.re, rhs.re, res.re);
+        T::sub(lhs.im, rhs.im, res.im);
+    }
+
+    /// res может совпадать с lhs или rhs
+    static void mult(const complex_t &lhs, const complex_t &rhs, complex_t &res)
+    {
+        T ac = res.re, bd = res.re, ad = res.im, bc = res.im;
+        T::mult(lhs.re, rhs.re, ac);
+        T::mult(lhs.im, rhs.im, bd);
+        T::mult(lhs.re, rhs.im, ad);
+        T::mult(lhs.im, rhs.re, bc);
+        T::sub(ac, bd, res.re);
+        T::sum(ad, bc, res.im);
+    }
+
+    /// Сопряжение: смена знака мнимой части, без округления
+    static void conj(complex_t &val)
+    {
+        T::negative(val.im, val.im);
+    }
+};
+
+/*! @brief Таблица поворотных множителей exp(-2pi * i * k / n), k = 0..n - 1, в формате proto
+ *
+ * \details По умолчанию значения вычисляются в double и переводятся в формат proto
+ */
+template <typename T> struct fft_twiddles
+{
+    using table_t = std::shared_ptr<const std::vector<complex_t<T>>>;
+
+    static table_t get(const T &proto, ImgView::idx_t n)
+    {
+        auto table = std::make_shared<std::vector<complex_t<T>>>();
+        table->reserve(n);
+        for (ImgView::idx_t k = 0; k < n; ++k)
+        {
+            const double angle = 2.0 * 3.141592653589793 * static_cast<double>(k) / static_cast<double>(n);
+            table->push_back({T::from_arithmetic_t(proto, static_cast<float>(std::cos(angle))),
+                              T::from_arithmetic_t(proto, static_cast<float>(-std::sin(angle)))});
+        }
+        return table;
+    }
+};
+
+/*! @brief Таблицы Flexfloat строятся по таблицам cos и sin (см. Flexfloat::cos_sin_turn) один раз для каждого
+ * формата и длины и переиспользуются
+ */
+template <> struct fft_twiddles<Flexfloat>
+{
+    using table_t = std::shared_ptr<const std::vector<complex_t<Flexfloat>>>;
+
+    static table_t get(const Flexfloat &proto, ImgView::idx_t n);
+};
+
+/*!
+ * \brief Быстрое преобразование Фурье длины n = 2^p над complex_t<T>
+ *
+ * \details Алгоритм Стокхэма (без перестановки битов): этапы по основанию 4, последний этап по основанию 2, если
+ * p нечетно. Результат каждого этапа округляется в рабочем формате, как в аппаратном конвейере FFT; поворотные
+ * множители берутся из таблицы (fft_twiddles), умножение на ±i и на единичный множитель выполняется без умножений.
+ * Обратное преобразование - прямое над сопряженными значениями с делением на n (сдвиг экспоненты для Flexfloat)
+ *
+ * Пример:
+ *
+ *     fft_plan<T> plan(proto, 64);
+ *     plan.transform(data, scratch);       // прямое
+ *     plan.transform(data, scratch, true); // обратное
+ */
+template <typename T> class fft_plan
+{
+  public:
+    using idx_t = ImgView::idx_t;
+    using value_t = complex_t<T>;
+
+    fft_plan(const T &proto, idx_t n)
+        : n_(n), twiddles_(fft_twiddles<T>::get(proto, n)),
+          inv_n_(T::from_arithmetic_t(proto, 1.0f / static_cast<float>(n)))
+    {
+        assert(n != 0 && (n & (n - 1)) == 0);
+    }
+
+    idx_t size() const noexcept
+    {
+        return n_;
+    }
+
+    /*! @brief Преобразование n значений data на месте
+     *
+     * \param[in,out] data Значения в рабочем формате
+     * \param[in] scratch Буфер из n значений в рабочем формате
+     * \param[in] inverse Обратное преобразование
+     */
+    void transform(value_t *data, value_t *scratch, bool inverse = false) const
+    {
+        if (inverse)
+            for (idx_t k = 0; k < n_; ++k)
+                value_t::conj(data[k]);
+
+        value_t *x = data, *y = scratch;
+        idx_t n = n_, s = 1;
+        while (n > 1)
+        {
+            if (n % 4 == 0)
+            {
+                radix4(n, s, x, y);
+                n /= 4;
+                s *= 4;
+            }
+            else
+            {
+                radix2(n, s, x, y);
+                n /= 2;
+                s *= 2;
+            }
+            std::swap(x, y);
+        }
+        if (x != data)
+            std::copy(x, x + n_, data);
+
+        if (inverse)
+            for (idx_t k = 0; k < n_; ++k)
+            {
+                value_t::conj(data[k]);
+                inv_n_.mult(data[k].re, data[k].re);
+                inv_n_.mult(data[k].im, data[k].im);
+            }
+    }
+
+  private:
+    idx_t n_;
+    typename fft_twiddles<T>::table_t twiddles_;
+    const_coef<T> inv_n_;
+
+    // Этап длины n с шагом s: x[q + s * (p + m * r)] -> y[q + s * (4p + r)]
+    void radix4(idx_t n, idx_t s, const value_t *x, value_t *y) const
+    {
+        const idx_t m = n / 4;
+        const auto &w = *twiddles_;
+
+        value_t apc = x[0], amc = x[0], bpd = x[0], bmd = x[0];
+        for (idx_t p = 0; p < m; ++p)
+            for (idx_t q = 0; q < s; ++q)
+            {
+                const value_t &a = x[q + s * p], &b = x[q + s * (p + m)];
+                const value_t &c = x[q + s * (p + 2 * m)], &d = x[q + s * (p + 3 * m)];
+                value_t *out = y + q + s * 4 * p;
+
+                value_t::sum(a, c, apc);
+                value_t::sub(a, c, amc);
+                value_t::sum(b, d, bpd);
+                value_t::sub(b, d, bmd);
+
+                value_t &y0 = out[0], &y1 = out[s], &y2 = out[2 * s], &y3 = out[3 * s];
+                value_t::sum(apc, bpd, y0);
+                value_t::sub(apc, bpd, y2);
+
+                // y1 = amc - i * bmd, y3 = amc + i * bmd
+                T::sum(amc.re, bmd.im, y1.re);
+                T::sub(amc.im, bmd.re, y1.im);
+                T::sub(amc.re, bmd.im, y3.re);
+                T::sum(amc.im, bmd.re, y3.im);
+
+                if (p != 0)
+                {
+                    value_t::mult(y1, w[p * s], y1);
+                    value_t::mult(y2, w[2 * p * s], y2);
+                    value_t::mult(y3, w[3 * p * s], y3);
+                }
+            }
+    }
+
+    void radix2(idx_t n, idx_t s, const value_t *x, value_t *y) const
+    {
+        const idx_t m = n / 2;
+        const auto &w = *twiddles_;
+
+        for (idx_t p = 0; p < m; ++p)
+            for (idx_t q = 0; q < s; ++q)
+            {
+                const value_t &a = x[q + s * p], &b = x[q + s * (p + m)];
+                value_t &y0 = y[q + s * 2 * p], &y1 = y[q + s * (2 * p + 1)];
+                value_t::sum(a, b, y0);
+                value_t::sub(a, b, y1);
+                if (p != 0)
+                    value_t::mult(y1, w[p * s], y1);
+            }
+    }
+};
+
+/*! @brief Двумерное преобразование сетки rows x cols (по строкам подряд) на месте
+ *
+ * \details Сначала преобразуются строки, затем столбцы; строки (и столбцы) делятся на полосы, которые выполняются
+ * рабочими потоками пула. Столбец копируется в буфер потока, преобразуется и записывается обратно
+ *
+ * \param[in] row_plan План длины cols
+ * \param[in] col_plan План длины rows
+ */
+template <typename T>
+void fft2d(std::vector<complex_t<T>> &grid, const fft_plan<T> &row_plan, const fft_plan<T> &col_plan, bool inverse,
+           ImgView::idx_t nthreads)
+{
+    using idx_t = ImgView::idx_t;
+
+    const idx_t rows = col_plan.size(), cols = row_plan.size();
+    assert(grid.size() == rows * cols);
+
+    auto bands = [nthreads](idx_t n, const thread_pool::band_func &func) {
+        if (nthreads <= 1)
+            func(0, n);
+        else
+            thread_pool::instance().bands(std::min(nthreads, n), n, func);
+    };
+
+    bands(rows, [&](idx_t st, idx_t en) {
+        std::vector<complex_t<T>> scratch(cols, grid[0]);
+        for (idx_t i = st; i < en; ++i)
+            row_plan.transform(grid.data() + i * cols, scratch.data(), inverse);
+    });
+
+    bands(cols, [&](idx_t st, idx_t en) {
+        std::vector<complex_t<T>> line(rows, grid[0]), scratch(rows, grid[0]);
+        for (idx_t j = st; j < en; ++j)
+        {
+            for (idx_t i = 0; i < rows; ++i)
+                line[i] = grid[i * cols + j];
+            col_plan.transform(line.data(), scratch.data(), inverse);
+            for (idx_t i = 0; i < rows; ++i)
+                grid[i * cols + j] = line[i];
+        }
+    });
+}
+
+} // namespace clib
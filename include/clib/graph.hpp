@@ -0,0 +1,418 @@
+#pragma once
+
+#include "Flexfixed.hpp"
+#include "Flexfloat.hpp"
+#include "image.hpp"
+#include "synth.hpp"
+#include "tasks.hpp"
+
+namespace clib
+{
+
+/*! @brief Операторы Synth для типа элемента T
+ */
+template <typename T> struct synth_ops;
+
+template <> struct synth_ops<Flexfloat>
+{
+    static void Const(float value, const img<Flexfloat> &in, img<Flexfloat> &out)
+    {
+        Synth::Flexfloat_Const(value, in, out);
+    }
+    static void sum(const img<Flexfloat> &in, img<Flexfloat> &out)
+    {
+        Synth::Flexfloat_sum(in, out);
+    }
+    static void mean(const img<Flexfloat> &in, img<Flexfloat> &out)
+    {
+        Synth::Flexfloat_mean(in, out);
+    }
+    static void Add(const img<Flexfloat> &lhs, const img<Flexfloat> &rhs, img<Flexfloat> &res)
+    {
+        Synth::Flexfloat_Add(lhs, rhs, res);
+    }
+    static void Mult(const img<Flexfloat> &lhs, const img<Flexfloat> &rhs, img<Flexfloat> &res)
+    {
+        Synth::Flexfloat_Mult(lhs, rhs, res);
+    }
+    static void Sub(const img<Flexfloat> &lhs, const img<Flexfloat> &rhs, img<Flexfloat> &res)
+    {
+        Synth::Flexfloat_Sub(lhs, rhs, res);
+    }
+    static void Inv(const img<Flexfloat> &x, img<Flexfloat> &res)
+    {
+        Synth::Flexfloat_Inv(x, res);
+    }
+    static bool same_format(const Flexfloat &lhs, const Flexfloat &rhs)
+    {
+        return lhs.get_E() == rhs.get_E() && lhs.get_M() == rhs.get_M() && lhs.get_B() == rhs.get_B();
+    }
+};
+
+template <> struct synth_ops<Flexfixed>
+{
+    static void Const(float value, const img<Flexfixed> &in, img<Flexfixed> &out)
+    {
+        Synth::Flexfixed_Const(value, in, out);
+    }
+    static void sum(const img<Flexfixed> &in, img<Flexfixed> &out)
+    {
+        Synth::Flexfixed_sum(in, out);
+    }
+    static void mean(const img<Flexfixed> &in, img<Flexfixed> &out)
+    {
+        Synth::Flexfixed_mean(in, out);
+    }
+    static void Add(const img<Flexfixed> &lhs, const img<Flexfixed> &rhs, img<Flexfixed> &res)
+    {
+        Synth::Flexfixed_Add(lhs, rhs, res);
+    }
+    static void Mult(const img<Flexfixed> &lhs, const img<Flexfixed> &rhs, img<Flexfixed> &res)
+    {
+        Synth::Flexfixed_Mult(lhs, rhs, res);
+    }
+    static void Sub(const img<Flexfixed> &lhs, const img<Flexfixed> &rhs, img<Flexfixed> &res)
+    {
+        Synth::Flexfixed_Sub(lhs, rhs, res);
+    }
+    static void Inv(const img<Flexfixed> &x, img<Flexfixed> &res)
+    {
+        Synth::Flexfixed_Inv(x, res);
+    }
+    static bool same_format(const Flexfixed &lhs, const Flexfixed &rhs)
+    {
+        return lhs.I == rhs.I && lhs.F == rhs.F;
+    }
+};
+
+/*!
+ * \brief Граф потока данных из операторов Synth
+ *
+ * \details Граф описывается один раз и выполняется для каждого кадра. При первом запуске после изменения графа
+ * строится расписание:
+ *  - уровень узла - длина самого длинного пути от входов. Узлы одного уровня независимы и выполняются параллельно;
+ *  - время жизни результата узла - до последнего уровня, на котором он читается (выходы живут до конца);
+ *  - результаты узлов размещаются в буферах (слотах). Слот освобождается после уровня последнего чтения и
+ *    переиспользуется узлом следующих уровней с тем же форматом элемента и тем же видом результата.
+ * Const, sum и mean по контракту Synth возвращают широковещательное изображение (см. img::broadcast), Add, Mult, Sub
+ * и Inv - широковещательное, если все их аргументы широковещательные, иначе обычное. Входы считаются обычными. Вид
+ * результата известен при построении расписания, поэтому обычный узел не получает слот широковещательного и не
+ * разворачивает его заново. Слоты хранятся в графе между запусками: начиная со второго кадра память под кадр не
+ * выделяется, широковещательные узлы выделяют только свое значение.
+ *
+ * Уровень, в котором узлов не меньше, чем потоков, выполняется параллельно по узлам; иначе узлы выполняются по
+ * очереди, и каждый делит свои строки между всеми потоками пула.
+ *
+ * Формат результата Add, Mult, Sub и Inv задается прототипом, Const, sum и mean - формат аргумента.
+ *
+ * Пример:
+ *
+ *     synth_graph<Flexfloat> g;
+ *     auto x = g.input(proto);
+ *     auto y = g.Sub(x, g.mean(x), proto);
+ *     g.output(g.Mult(y, y, proto));
+ *     for (...)
+ *     {
+ *         g.run({frame});
+ *         use(g.result(...));
+ *     }
+ */
+template <typename T> class synth_graph
+{
+  public:
+    using node_id = idx_t;
+
+  private:
+    enum class op_t
+    {
+        input,
+        Const,
+        sum,
+        mean,
+        Add,
+        Mult,
+        Sub,
+        Inv
+    };
+
+    struct node
+    {
+        op_t op;
+        vector<node_id> args;
+        T format;
+        float value = 0.0f; // для Const
+
+        idx_t level = 0;
+        idx_t last_use = 0;     // последний уровень, на котором читается результат
+        bool broadcast = false; // результат - широковещательное изображение
+        bool is_output = false;
+        idx_t slot = 0;
+    };
+
+    vector<node> nodes_;
+    vector<node_id> inputs_;
+
+    // Расписание
+    bool compiled_ = false;
+    vector<vector<node_id>> levels_; // узлы по уровням, начиная с 1
+    vector<img<T>> slots_;
+    vector<node_id> slot_owner_; // последний узел слота, определяет формат элементов
+
+    // Входы текущего запуска
+    const vector<img<T>> *frame_ = nullptr;
+
+  public:
+    /*! @brief Вход графа. Изображения входов передаются в run в порядке создания
+     *
+     * \param[in] format Формат элементов входа
+     */
+    node_id input(const T &format)
+    {
+        inputs_.push_back(nodes_.size());
+        return add_node(op_t::input, {}, format);
+    }
+
+    node_id Const(float value, node_id like)
+    {
+        node_id id = add_node(op_t::Const, {like}, nodes_.at(like).format);
+        nodes_[id].value = value;
+        return id;
+    }
+    node_id sum(node_id in)
+    {
+        return add_node(op_t::sum, {in}, nodes_.at(in).format);
+    }
+    node_id mean(node_id in)
+    {
+        return add_node(op_t::mean, {in}, nodes_.at(in).format);
+    }
+    node_id Add(node_id lhs, node_id rhs, const T &format)
+    {
+        return add_node(op_t::Add, {lhs, rhs}, format);
+    }
+    node_id Mult(node_id lhs, node_id rhs, const T &format)
+    {
+        return add_node(op_t::Mult, {lhs, rhs}, format);
+    }
+    node_id Sub(node_id lhs, node_id rhs, const T &format)
+    {
+        return add_node(op_t::Sub, {lhs, rhs}, format);
+    }
+    node_id Inv(node_id x, const T &format)
+    {
+        return add_node(op_t::Inv, {x}, format);
+    }
+
+    /*! @brief Отмечает узел как выход: его результат доступен через result после run
+     */
+    synth_graph &output(node_id id)
+    {
+        nodes_.at(id).is_output = true;
+        compiled_ = false;
+        return *this;
+    }
+
+    /*! @brief Выполняет граф для одного кадра
+     *
+     * \param[in] inputs Изображения входов одного размера, в порядке вызовов input
+     * \param[in] req_threads Количество потоков для узлов одного уровня. 0 - все потоки пула
+     */
+    void run(const vector<img<T>> &inputs, idx_t req_threads = 0)
+    {
+        assert(inputs.size() == inputs_.size());
+        assert(!inputs.empty());
+
+        if (!compiled_)
+            compile();
+
+        const idx_t rows = inputs[0].rows(), cols = inputs[0].cols();
+        for (idx_t s = 0; s < slots_.size(); ++s)
+            if (slots_[s].rows() != rows || slots_[s].cols() != cols)
+                slots_[s] = nodes_[slot_owner_[s]].broadcast ? img<T>::broadcast(slot_format(s), rows, cols)
+                                                              : img<T>(slot_format(s), rows, cols);
+
+        // Вложенная работа пула выполняется в вызвавшем потоке, поэтому узел, запущенный задачей, считается в
+        // одном потоке. Узлов меньше, чем потоков, выгоднее выполнить по очереди с полосами на весь пул
+        const idx_t nthreads = req_threads != 0 ? req_threads : thread_pool::instance().workers();
+
+        frame_ = &inputs;
+        for (const auto &level : levels_)
+            if (level.size() >= nthreads)
+                run_tasks(level.size(), req_threads, [&](idx_t k) { execute(level[k]); });
+            else
+                for (node_id id : level)
+                    execute(id);
+        frame_ = nullptr;
+    }
+
+    /*! @brief Результат узла-выхода последнего запуска
+     */
+    const img<T> &result(node_id id) const
+    {
+        assert(nodes_.at(id).is_output);
+        assert(compiled_);
+        return slots_[nodes_[id].slot];
+    }
+
+    /// Количество уровней расписания (без входов)
+    idx_t levels()
+    {
+        if (!compiled_)
+            compile();
+        return levels_.size();
+    }
+
+    /// Количество буферов для результатов
+    idx_t buffers()
+    {
+        if (!compiled_)
+            compile();
+        return slots_.size();
+    }
+
+  private:
+    node_id add_node(op_t op, vector<node_id> args, const T &format)
+    {
+        for (node_id arg : args)
+            assert(arg < nodes_.size());
+
+        node n;
+        n.op = op;
+        n.args = std::move(args);
+        n.format = format;
+        nodes_.push_back(n);
+
+        compiled_ = false;
+        return nodes_.size() - 1;
+    }
+
+    void compile()
+    {
+        // Узлы добавляются после своих аргументов, поэтому порядок создания топологический
+        idx_t max_level = 0;
+        for (node &n : nodes_)
+        {
+            n.level = 0;
+            n.broadcast = is_scalar(n.op);
+            if (n.op != op_t::input)
+            {
+                bool all_broadcast = true;
+                for (node_id arg : n.args)
+                {
+                    n.level = std::max(n.level, nodes_[arg].level + 1);
+                    all_broadcast = all_broadcast && nodes_[arg].broadcast;
+                }
+                n.broadcast = n.broadcast || all_broadcast;
+            }
+            n.last_use = n.level;
+            max_level = std::max(max_level, n.level);
+        }
+        for (node &n : nodes_)
+            for (node_id arg : n.args)
+                nodes_[arg].last_use = std::max(nodes_[arg].last_use, n.level);
+
+        levels_.assign(max_level, {});
+        for (node_id id = 0; id < nodes_.size(); ++id)
+            if (nodes_[id].level != 0)
+                levels_[nodes_[id].level - 1].push_back(id);
+
+        // Назначение слотов в порядке уровней. Узлы одного уровня выполняются одновременно, поэтому слот,
+        // освобожденный после уровня L, доступен только с уровня L + 1
+        vector<node_id> owner;
+        vector<bool> busy;
+        for (idx_t lvl = 1; lvl <= max_level; ++lvl)
+        {
+            for (idx_t s = 0; s < owner.size(); ++s)
+            {
+                const node &prev = nodes_[owner[s]];
+                busy[s] = prev.is_output || prev.last_use >= lvl;
+            }
+
+            for (node_id id : levels_[lvl - 1])
+            {
+                node &n = nodes_[id];
+                idx_t s = 0;
+                while (s < owner.size() && (busy[s] || !compatible(nodes_[owner[s]], n)))
+                    ++s;
+
+                if (s == owner.size())
+                {
+                    owner.push_back(id);
+                    busy.push_back(true);
+                }
+                owner[s] = id;
+                busy[s] = true;
+                n.slot = s;
+            }
+        }
+        slot_owner_ = owner;
+        slots_ = vector<img<T>>(owner.size()); // размер задается при первом запуске
+
+        compiled_ = true;
+    }
+
+    // Константы и свертки всегда дают широковещательные изображения
+    static bool is_scalar(op_t op)
+    {
+        return op == op_t::Const || op == op_t::sum || op == op_t::mean;
+    }
+
+    // Слот не переходит от одного вида результата к другому, иначе обычный узел разворачивал бы его заново на каждом
+    // кадре
+    static bool compatible(const node &prev, const node &next)
+    {
+        return prev.broadcast == next.broadcast && synth_ops<T>::same_format(prev.format, next.format);
+    }
+
+    const T &slot_format(idx_t s) const
+    {
+        return nodes_[slot_owner_[s]].format;
+    }
+
+    const img<T> &value(node_id id) const
+    {
+        const node &n = nodes_[id];
+        if (n.op == op_t::input)
+        {
+            const idx_t k = std::find(inputs_.begin(), inputs_.end(), id) - inputs_.begin();
+            return (*frame_)[k];
+        }
+        return slots_[n.slot];
+    }
+
+    void execute(node_id id)
+    {
+        const node &n = nodes_[id];
+        img<T> &out = slots_[n.slot];
+
+        switch (n.op)
+        {
+        case op_t::Const:
+            synth_ops<T>::Const(n.value, value(n.args[0]), out);
+            break;
+        case op_t::sum:
+            synth_ops<T>::sum(value(n.args[0]), out);
+            break;
+        case op_t::mean:
+            synth_ops<T>::mean(value(n.args[0]), out);
+            break;
+        case op_t::Add:
+            synth_ops<T>::Add(value(n.args[0]), value(n.args[1]), out);
+            break;
+        case op_t::Mult:
+            synth_ops<T>::Mult(value(n.args[0]), value(n.args[1]), out);
+            break;
+        case op_t::Sub:
+            synth_ops<T>::Sub(value(n.args[0]), value(n.args[1]), out);
+            break;
+        case op_t::Inv:
+            synth_ops<T>::Inv(value(n.args[0]), out);
+            break;
+        case op_t::input:
+            assert(false);
+            break;
+        }
+    }
+};
+
+} // namespace clib
@@ -3,10 +3,17 @@
 #include <iostream>
 #include <stdexcept>
 
+#include "Fastfloat.hpp"
+#include "arena.hpp"
+#include "coef.hpp"
+#include "fft.hpp"
+#include "pool.hpp"
 #include "Flexfloat.hpp"
 #include "ImgView.hpp"
 #include "common.hpp"
 #include "logs.hpp"
+#include "mask.hpp"
+#include "reduce.hpp"
 
 namespace clib
 {
@@ -18,18 +25,38 @@ namespace clib
 using std::vector;
 using pixel_t = ImgView::pixel_t;
 using idx_t = ImgView::idx_t;
+
+/*! @brief Способ доопределения изображения за его границами в трафаретных операциях
+ */
+enum class border_t
+{
+    mirror,  ///< отражение без повтора крайнего пикселя: -1 -> 1, rows -> rows - 2 (как в get_window)
+    clamp,   ///< повтор крайнего пикселя: -1 -> 0, rows -> rows - 1
+    constant ///< значение fill
+};
+
 template <typename T> class img final
 {
+  public:
+    /// Строка изображения. Память берется из текущей арены потока, если она есть (см. frame_arena)
+    using row_t = vector<T, frame_allocator<T>>;
+    using storage_t = vector<row_t, frame_allocator<row_t>>;
+
+  private:
     idx_t rows_ = 0; // height of image
     idx_t cols_ = 0; // width of image
 
-    vector<vector<T>> vv_;
+    // Широковещательное изображение: vv_ хранит одно значение 1x1, а rows_ и cols_ - логический размер
+    bool broadcast_ = false;
+
+    storage_t vv_{};
 
   public:
     img &operator=(const img &in)
     {
         rows_ = in.rows_;
         cols_ = in.cols_;
+        broadcast_ = in.broadcast_;
         vv_ = in.vv_;
 
         return *this;
@@ -38,12 +65,23 @@ template <typename T> class img final
     img() = default;
 
     /*! @brief Инициализации изображения из другого изображения
+     *
+     * \details Копия широковещательного изображения тоже широковещательная
      */
     img(const img<T> &base, idx_t req_threads = 0) : vv_()
     {
         // assert(base.rows() > 0);
         // assert(base.cols() > 0);
 
+        if (base.broadcast_)
+        {
+            rows_ = base.rows_;
+            cols_ = base.cols_;
+            broadcast_ = true;
+            vv_ = base.vv_;
+            return;
+        }
+
         auto get_val = [&base](idx_t i, idx_t j) { return base(i, j); };
         _ctor_implt(base.rows(), base.cols(), get_val, req_threads);
     }
@@ -68,10 +106,28 @@ template <typename T> class img final
      */
     img(const T &prototype, const ImgView &view, idx_t clr = 0, idx_t req_threads = 0) : vv_()
     {
-        auto get_val = [&prototype, &view, clr](idx_t i, idx_t j) {
-            return T::from_arithmetic_t(prototype, view.get(i, j, clr));
-        };
-        _ctor_implt(view.rows(), view.cols(), get_val, req_threads);
+        const idx_t rows = view.rows(), cols = view.cols();
+
+        // Отсчеты переводятся в T прямо из хранилища Представления в его типе; иначе плоскость читается одним вызовом
+        if (const void *samples = view.samples(clr))
+            switch (view.sample_type())
+            {
+            case sample_t::u8:
+                _ctor_plane(prototype, static_cast<const uint8_t *>(samples), rows, cols, req_threads);
+                return;
+            case sample_t::u16:
+                _ctor_plane(prototype, static_cast<const uint16_t *>(samples), rows, cols, req_threads);
+                return;
+            case sample_t::i32:
+                _ctor_plane(prototype, static_cast<const int *>(samples), rows, cols, req_threads);
+                return;
+            default: // неизвестный тип хранилища читается через read_plane
+                break;
+            }
+
+        vector<ImgView::pixel_t> buf(rows * cols);
+        view.read_plane(clr, buf.data(), cols);
+        _ctor_plane(prototype, buf.data(), rows, cols, req_threads);
     }
 
     /*! @brief Инициализации изображения массивом
@@ -98,41 +154,129 @@ template <typename T> class img final
         rows_ = base.size();
         cols_ = base[0].size();
 
-        vv_ = std::move(base);
+        vv_.reserve(rows_);
+        for (auto &line : base)
+            vv_.emplace_back(std::make_move_iterator(line.begin()), std::make_move_iterator(line.end()));
     }
 
     /*! @brief Инициализации изображения массивом
      *
      * TODO
      */
-    img(const img &base, const clib::Flexfloat::hyper_params &params, idx_t req_threads = 0) : vv_()
+    template <typename U = T>
+    img(const img &base, const typename U::hyper_params &params, idx_t req_threads = 0) : vv_()
     {
         assert(base.vv_.size() > 0);
 
+        if (base.broadcast_)
+        {
+            *this = broadcast(U::pack(base.vv_[0][0], params), base.rows_, base.cols_);
+            return;
+        }
+
         auto rows = base.vv_.size();
         auto cols = base.vv_[0].size();
-        auto get_val = [&base, &params](idx_t i, idx_t j) { return clib::Flexfloat::pack(base.vv_[i][j], params); };
+        auto get_val = [&base, &params](idx_t i, idx_t j) { return U::pack(base.vv_[i][j], params); };
 
         _ctor_implt(rows, cols, get_val, req_threads);
     }
 
+    /*! @brief Широковещательное изображение: все rows x cols элементов равны value
+     *
+     * \details Хранит одно значение, создается за O(1) без заполнения. Принимается везде, где ожидается img.
+     * Чтение элементов и поэлементные операции работают с ним без развертывания: бинарные операции с ним выполняются
+     * как операции изображения со скаляром, а результат операции двух широковещательных изображений тоже
+     * широковещательный. Запись элемента (неконстантные operator() и row) и трафаретные операции развертывают его в
+     * обычное изображение
+     *
+     * \param[in] value Значение всех элементов
+     * \param[in] rows Количество строк
+     * \param[in] cols Количество столбцов
+     */
+    static img broadcast(const T &value, idx_t rows, idx_t cols)
+    {
+        assert(rows > 0);
+        assert(cols > 0);
+
+        img res;
+        res.rows_ = rows;
+        res.cols_ = cols;
+        res.broadcast_ = true;
+        res.vv_.emplace_back(1, value);
+        return res;
+    }
+
+    bool is_broadcast() const noexcept
+    {
+        return broadcast_;
+    }
+
+    /// Значение широковещательного изображения
+    const T &value() const
+    {
+        assert(broadcast_);
+        return vv_[0][0];
+    }
+
+    /*! @brief Обычное изображение с теми же элементами. Для обычного изображения - копия
+     */
+    img dense(idx_t req_threads = 0) const
+    {
+        if (!broadcast_)
+            return *this;
+        return img(vv_[0][0], rows_, cols_, req_threads);
+    }
+
+    /*! @brief Развертывает широковещательное изображение на месте
+     */
+    void densify(idx_t req_threads = 0)
+    {
+        if (broadcast_)
+            *this = dense(req_threads);
+    }
+
     const vector<vector<T>> vv() const
     {
-        return vv_;
+        if (broadcast_)
+            return vector<vector<T>>(rows_, vector<T>(cols_, vv_[0][0]));
+
+        vector<vector<T>> res;
+        res.reserve(vv_.size());
+        for (const auto &line : vv_)
+            res.emplace_back(line.begin(), line.end());
+        return res;
     }
 
     vector<vector<T>> vv()
     {
-        return vv_;
+        return static_cast<const img &>(*this).vv();
     }
 
     idx_t rows() const
     {
-        return vv_.size();
+        return rows_;
     }
     idx_t cols() const
     {
-        return vv_.empty() ? 0 : vv_[0].size();
+        return cols_;
+    }
+
+    /*! @brief Указатель на начало строки i. Элементы строки лежат в памяти подряд
+     *
+     * \details Для широковещательного изображения строк в памяти нет, его нужно развернуть (dense). Неконстантная
+     * версия развертывает его сама
+     */
+    const T *row(idx_t i) const
+    {
+        assert(!broadcast_);
+        assert(i < vv_.size());
+        return vv_[i].data();
+    }
+    T *row(idx_t i)
+    {
+        densify();
+        assert(i < vv_.size());
+        return vv_[i].data();
     }
 
     /*! @brief Подсчет суммы двумерного массива
@@ -156,76 +300,43 @@ template <typename T> class img final
      *
      * sum = part_sums[0] + part_sums[1] + part_sums[2]
      *
+     * Это порядок order_t::modulus, другие порядки задаются через spec (см. reduce.hpp). Если строк или столбцов
+     * меньше modulus, элементы складываются последовательно, начиная с нуля
+     *
+     * \param[in] req_threads Количество потоков. 0 - определить автоматически. На результат не влияет
+     * \param[in] spec Порядок суммирования
      */
-    T sum(idx_t req_threads = 0) const
+    T sum(idx_t req_threads = 0, const order_spec &spec = order_spec()) const
     {
         assert(cols_ != 0);
         assert(rows_ != 0);
 
-        const idx_t modulus = 3;
-
 #ifndef SUM_FIX
         // brute calculating of sum
-        if (cols_ < modulus || rows_ < modulus)
+        if (spec.order == order_t::modulus && (cols_ < spec.modulus || rows_ < spec.modulus))
         {
             T sum = T::from_arithmetic_t(vv_[0][0], 0.0f);
             for (idx_t i = 0; i < rows_; ++i)
             {
                 for (idx_t j = 0; j < cols_; ++j)
                 {
-                    T::sum(sum, vv_[i][j], sum);
+                    T::sum(sum, (*this)(i, j), sum);
                 }
             }
             return sum;
         }
 #endif
 
-        auto modulus_sum = [modulus](const vector<T> &line) {
-            vector<T> part_sums(line.begin(), line.begin() + modulus);
-            // for (idx_t j = 0; j < modulus; ++j)
-            //     std::cout << "part_sums[" << j << "] " << part_sums[j] << " = " << part_sums[j].to_float() <<
-            //     std::endl;
-
-            for (idx_t j = modulus; j < line.size(); ++j)
-            {
-                T::sum(line[j], part_sums[j % modulus], part_sums[j % modulus]);
-                // std::cout << "part_sums[" << j % modulus << "] " << part_sums[j % modulus] << " = " << part_sums[j %
-                // modulus].to_float() << std::endl;
-            }
-
-            // std::cout << "part_sums done" << std::endl;
-
-            // Собираем промежуточные суммы для разных остатков по модулю
-            auto st_indx = (line.size() - modulus) % modulus;
-            T ans = part_sums[st_indx];
-            for (idx_t j = 1; j < modulus; ++j)
-                T::sum(part_sums[(st_indx + j) % modulus], ans, ans);
-
-            return ans;
-        };
-
-        // Вычислен c помощью функции determine_work_number;
-        const idx_t MIN_THREAD_WORK = 12000;
-        idx_t nthreads = req_threads;
-        if (req_threads == 0)
-            nthreads = determine_threads(MIN_THREAD_WORK);
-
-        vector<T> results(rows_, vv_[0][0]);
-        work(nthreads, rows_, [&](idx_t st_row, idx_t en_row) {
-            for (idx_t i = st_row; i < en_row; ++i)
-            {
-                results[i] = modulus_sum(vv_[i]);
-                // std::cout << "line[" << i << "]  " << results[i]  << " = " << results[i].to_float() << std::endl;
-            }
-        });
-        // Собираем промежуточные суммы с потоков
-        return modulus_sum(results);
+        return reduce([](const T &lhs, const T &rhs, T &res) { T::sum(lhs, rhs, res); }, spec, req_threads);
     }
 
-    /// @brief Подсчет среднего двумерного массива
-    T mean() const
+    /*! @brief Подсчет среднего двумерного массива
+     *
+     * \param[in] spec Порядок суммирования
+     */
+    T mean(const order_spec &spec = order_spec()) const
     {
-        T summ = sum();
+        T summ = sum(0, spec);
 
         // The code below only works with correct implemented INVERSION function
 
@@ -246,10 +357,136 @@ template <typename T> class img final
         return summ;
     }
 
+    /*! @brief Минимальный элемент массива
+     *
+     * \param[in] spec Порядок свертки. Влияет только на выбор среди равных по сравнению элементов (например, -0 и 0)
+     */
+    T minimum(const order_spec &spec = order_spec(), idx_t req_threads = 0) const
+    {
+        return reduce([](const T &lhs, const T &rhs, T &res) { T::min(lhs, rhs, res); }, spec, req_threads);
+    }
+
+    /*! @brief Максимальный элемент массива
+     *
+     * \param[in] spec Порядок свертки. Влияет только на выбор среди равных по сравнению элементов (например, -0 и 0)
+     */
+    T maximum(const order_spec &spec = order_spec(), idx_t req_threads = 0) const
+    {
+        return reduce([](const T &lhs, const T &rhs, T &res) { T::max(lhs, rhs, res); }, spec, req_threads);
+    }
+
+    /*! @brief Скалярное произведение sum(lhs(i, j) * rhs(i, j))
+     *
+     * \details Произведения вычисляются в формате lhs и складываются в порядке spec, как sum
+     */
+    static T dot(const img<T> &lhs, const img<T> &rhs, const order_spec &spec = order_spec(), idx_t req_threads = 0)
+    {
+        assert(lhs.rows() == rhs.rows());
+        assert(lhs.cols() == rhs.cols());
+
+        auto product = [&](idx_t i, idx_t j) {
+            T res = lhs(i, j);
+            T::mult(lhs(i, j), rhs(i, j), res);
+            return res;
+        };
+
+        return transform_reduce(lhs.rows(), lhs.cols(), product,
+                                [](const T &l, const T &r, T &res) { T::sum(l, r, res); }, spec, req_threads);
+    }
+
+    /*! @brief Свертка массива функцией combine в порядке spec
+     *
+     * \param[in] combine Функция void(const T &lhs, const T &rhs, T &res). res может совпадать с lhs или rhs
+     * \param[in] spec Порядок свертки
+     * \param[in] req_threads Количество потоков. 0 - определить автоматически. На результат не влияет
+     */
+    template <typename Combine> T reduce(Combine combine, const order_spec &spec = order_spec(), idx_t req_threads = 0) const
+    {
+        // Порядок свертки широковещательного изображения тот же, что и у развернутого
+        if (broadcast_)
+            return transform_reduce(
+                rows_, cols_, [this](idx_t, idx_t) -> const T & { return vv_[0][0]; }, combine, spec, req_threads);
+
+        return transform_reduce(
+            rows_, cols_, [this](idx_t i, idx_t j) -> const T & { return vv_[i][j]; }, combine, spec, req_threads);
+    }
+
+    /*! @brief Свертка значений elem(i, j), i < rows, j < cols, функцией combine в порядке spec
+     *
+     * \details Общая реализация для reduce, sum, dot и редукций по кадрам видео. Разбиение на потоки зависит только
+     * от структуры порядка (строки для modulus, поддеревья для pairwise), поэтому результат для данного spec
+     * побитово одинаков при любом количестве потоков
+     *
+     * \param[in] rows, cols Размер области
+     * \param[in] elem Функция T(idx_t i, idx_t j)
+     * \param[in] combine Функция void(const T &lhs, const T &rhs, T &res). res может совпадать с lhs или rhs
+     * \param[in] spec Порядок свертки
+     * \param[in] req_threads Количество потоков. 0 - определить автоматически
+     */
+    template <typename Elem, typename Combine>
+    static T transform_reduce(idx_t rows, idx_t cols, Elem elem, Combine combine, const order_spec &spec = order_spec(),
+                              idx_t req_threads = 0)
+    {
+        assert(rows != 0);
+        assert(cols != 0);
+
+        // Вычислен c помощью функции determine_work_number;
+        const idx_t MIN_THREAD_WORK = 12000;
+        idx_t nthreads = req_threads;
+        if (req_threads == 0)
+            nthreads = determine_threads(rows, cols, MIN_THREAD_WORK);
+
+        switch (spec.order)
+        {
+        case order_t::sequential:
+            return sequential_fold<T>([&](idx_t k) { return elem(k / cols, k % cols); }, combine, 0, rows * cols);
+
+        case order_t::pairwise: {
+            assert(spec.leaf > 0);
+            auto at = [&](idx_t k) { return elem(k / cols, k % cols); };
+
+            // Верхние уровни дерева режутся на поддеревья, которые считаются параллельно. Форма дерева от этого
+            // не меняется
+            idx_t depth = 0;
+            while ((1lu << depth) < 4 * nthreads)
+                ++depth;
+
+            vector<std::pair<idx_t, idx_t>> tasks;
+            tree_split(0, rows * cols, spec.leaf, depth, tasks);
+
+            vector<T> parts(tasks.size(), elem(0, 0));
+            work(std::min(nthreads, tasks.size()), tasks.size(), [&](idx_t st, idx_t en) {
+                for (idx_t t = st; t < en; ++t)
+                    parts[t] = tree_fold<T>(at, combine, tasks[t].first, tasks[t].second, spec.leaf);
+            });
+
+            idx_t next = 0;
+            return tree_join(combine, 0, rows * cols, spec.leaf, depth, parts, next);
+        }
+
+        case order_t::modulus:
+        default: {
+            const idx_t modulus = spec.modulus;
+            assert(modulus > 0);
+
+            if (cols < modulus || rows < modulus)
+                return sequential_fold<T>([&](idx_t k) { return elem(k / cols, k % cols); }, combine, 0, rows * cols);
+
+            vector<T> results(rows, elem(0, 0));
+            work(std::min(nthreads, rows), rows, [&](idx_t st_row, idx_t en_row) {
+                for (idx_t i = st_row; i < en_row; ++i)
+                    results[i] = modulus_fold<T>([&](idx_t j) { return elem(i, j); }, combine, cols, modulus);
+            });
+            // Собираем промежуточные суммы с потоков
+            return modulus_fold<T>([&](idx_t k) -> const T & { return results[k]; }, combine, rows, modulus);
+        }
+        }
+    }
+
     /// @brief Подсчет максимального элемента для каждой ячейки нескольких массивов
     template <typename... Imgs> static img max(const img &first, const Imgs &...imgs)
     {
-        img res(first);
+        img res = first.dense();
         for_each(first.rows(), first.cols(), [&](idx_t i, idx_t j) {
             res(i, j) = std::max({first(i, j), imgs(i, j)...});
         });
@@ -260,15 +497,19 @@ template <typename T> class img final
     /// @brief Обрезает все числа в двумерном массиве между minn и maxx
     img clip(pixel_t minn = 0, pixel_t maxx = 255) const
     {
+        auto clip_value = [minn, maxx](const T &x) {
+            if (x.to_int() < minn)
+                return T::from_arithmetic_t(x, minn);
+            if (x.to_int() > maxx)
+                return T::from_arithmetic_t(x, maxx);
+            return x;
+        };
+
+        if (broadcast_)
+            return broadcast(clip_value(vv_[0][0]), rows_, cols_);
+
         img res(*this);
-        for_each(rows_, cols_, [&](idx_t i, idx_t j) {
-            if (vv_[i][j].to_int() < minn)
-                res.vv_[i][j] = T::from_arithmetic_t(vv_[i][j], minn);
-            else if (vv_[i][j].to_int() > maxx)
-                res.vv_[i][j] = T::from_arithmetic_t(vv_[i][j], maxx);
-            else
-                res.vv_[i][j] = vv_[i][j];
-        });
+        for_each(rows_, cols_, [&](idx_t i, idx_t j) { res.vv_[i][j] = clip_value(vv_[i][j]); });
 
         return res;
     }
@@ -276,90 +517,62 @@ template <typename T> class img final
     img operator+(const T &rhs) const
     {
         img res(*this);
-        for_each(rows_, cols_, [&](idx_t i, idx_t j) { T::sum(res.vv_[i][j], rhs, res.vv_[i][j]); });
+        add(*this, rhs, res);
 
         return res;
     }
     static void add(const img<T> &lhs, const img<T> &rhs, img<T> &res)
     {
-        assert((rhs.rows_ == lhs.rows_) == res.rows_);
-        assert((rhs.cols_ == lhs.cols_) == res.cols_);
-
-        for_each(res.rows(), res.cols(),
-                 [&](idx_t i, idx_t j) { T::sum(lhs.vv_[i][j], rhs.vv_[i][j], res.vv_[i][j]); });
+        binary(lhs, rhs, res, [](const T &l, const T &r, T &out) { T::sum(l, r, out); });
     }
     static void add(const img<T> &lhs, const T &rhs, img<T> &res)
     {
-        assert(lhs.rows_ == res.rows_);
-        assert(lhs.cols_ == res.cols_);
-
-        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { T::sum(lhs.vv_[i][j], rhs, res.vv_[i][j]); });
+        binary(lhs, rhs, res, [](const T &l, const T &r, T &out) { T::sum(l, r, out); });
     }
     static void add(const T &lhs, const img<T> &rhs, img<T> &res)
     {
-        assert(rhs.rows_ == res.rows_);
-        assert(rhs.cols_ == res.cols_);
-
-        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { T::sum(lhs, rhs.vv_[i][j], res.vv_[i][j]); });
+        binary(lhs, rhs, res, [](const T &l, const T &r, T &out) { T::sum(l, r, out); });
     }
     img operator*(const T &rhs) const
     {
         img res(*this);
-        for_each(rows_, cols_, [&](idx_t i, idx_t j) { T::mult(res.vv_[i][j], rhs, res.vv_[i][j]); });
+        mult(*this, rhs, res);
 
         return res;
     }
     static void mult(const img<T> &lhs, const img<T> &rhs, img<T> &res)
     {
-        assert((rhs.rows_ == lhs.rows_) == res.rows_);
-        assert((rhs.cols_ == lhs.cols_) == res.cols_);
-
-        for_each(res.rows(), res.cols(),
-                 [&](idx_t i, idx_t j) { T::mult(lhs.vv_[i][j], rhs.vv_[i][j], res.vv_[i][j]); });
+        binary(lhs, rhs, res, [](const T &l, const T &r, T &out) { T::mult(l, r, out); });
     }
     static void mult(const img<T> &lhs, const T &rhs, img<T> &res)
     {
-        assert(lhs.rows_ == res.rows_);
-        assert(lhs.cols_ == res.cols_);
-
-        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { T::mult(lhs.vv_[i][j], rhs, res.vv_[i][j]); });
+        const const_coef<T> coef(rhs);
+        binary(lhs, rhs, res, [&coef](const T &l, const T &, T &out) { coef.mult(l, out); });
     }
     static void mult(const T &lhs, const img<T> &rhs, img<T> &res)
     {
-        assert(rhs.rows_ == res.rows_);
-        assert(rhs.cols_ == res.cols_);
-
-        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { T::mult(lhs, rhs.vv_[i][j], res.vv_[i][j]); });
+        const const_coef<T> coef(lhs);
+        binary(lhs, rhs, res, [&coef](const T &, const T &r, T &out) { coef.mult(r, out); });
     }
 
     img operator-(const T &rhs) const
     {
         img res(*this);
-        for_each(rows_, cols_, [&](idx_t i, idx_t j) { T::sub(res.vv_[i][j], rhs, res.vv_[i][j]); });
+        sub(*this, rhs, res);
 
         return res;
     }
     static void sub(const img<T> &lhs, const img<T> &rhs, img<T> &res)
     {
-        assert((rhs.rows_ == lhs.rows_) == res.rows_);
-        assert((rhs.cols_ == lhs.cols_) == res.cols_);
-
-        for_each(res.rows(), res.cols(),
-                 [&](idx_t i, idx_t j) { T::sub(lhs.vv_[i][j], rhs.vv_[i][j], res.vv_[i][j]); });
+        binary(lhs, rhs, res, [](const T &l, const T &r, T &out) { T::sub(l, r, out); });
     }
     static void sub(const img<T> &lhs, const T &rhs, img<T> &res)
     {
-        assert(lhs.rows_ == res.rows_);
-        assert(lhs.cols_ == res.cols_);
-
-        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { T::sub(lhs.vv_[i][j], rhs, res.vv_[i][j]); });
+        binary(lhs, rhs, res, [](const T &l, const T &r, T &out) { T::sub(l, r, out); });
     }
     static void sub(const T &lhs, const img<T> &rhs, img<T> &res)
     {
-        assert(rhs.rows_ == res.rows_);
-        assert(rhs.cols_ == res.cols_);
-
-        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { T::sub(lhs, rhs.vv_[i][j], res.vv_[i][j]); });
+        binary(lhs, rhs, res, [](const T &l, const T &r, T &out) { T::sub(l, r, out); });
     }
 
     img operator/(const T &rhs) const
@@ -372,7 +585,7 @@ template <typename T> class img final
 
         const T inv_rhs = T::from_arithmetic_t(rhs, 1.0f / rhs.to_float()); // comment this if INVERSION works correctly
 
-        for_each(rows_, cols_, [&](idx_t i, idx_t j) { T::mult(res.vv_[i][j], inv_rhs, res.vv_[i][j]); });
+        mult(*this, inv_rhs, res);
         return res;
     }
     static void inv(const img<T> &x, img<T> &res)
@@ -380,6 +593,15 @@ template <typename T> class img final
         assert(x.rows_ == res.rows_);
         assert(x.cols_ == res.cols_);
 
+        if (x.broadcast_)
+        {
+            T value = res.vv_[0][0];
+            T::inv(x.vv_[0][0], value);
+            res = broadcast(value, x.rows_, x.cols_);
+            return;
+        }
+
+        res.densify();
         for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { T::inv(x.vv_[i][j], res.vv_[i][j]); });
     }
     static void inv(const T &x, T &res)
@@ -397,7 +619,7 @@ template <typename T> class img final
         assert(rows_ == rhs.rows_);
 
         img res(*this);
-        for_each(rows_, cols_, [&](idx_t i, idx_t j) { T::sum(res.vv_[i][j], rhs.vv_[i][j], res.vv_[i][j]); });
+        add(*this, rhs, res);
 
         return res;
     }
@@ -407,7 +629,7 @@ template <typename T> class img final
         assert(rows_ == rhs.rows_);
 
         img res(*this);
-        for_each(rows_, cols_, [&](idx_t i, idx_t j) { T::mult(res.vv_[i][j], rhs.vv_[i][j], res.vv_[i][j]); });
+        mult(*this, rhs, res);
 
         return res;
     }
@@ -417,7 +639,7 @@ template <typename T> class img final
         assert(rows_ == rhs.rows_);
 
         img res(*this);
-        for_each(rows_, cols_, [&](idx_t i, idx_t j) { T::sub(res.vv_[i][j], rhs.vv_[i][j], res.vv_[i][j]); });
+        sub(*this, rhs, res);
 
         return res;
     }
@@ -426,7 +648,10 @@ template <typename T> class img final
         assert(cols_ == rhs.cols_);
         assert(rows_ == rhs.rows_);
 
-        img res(*this);
+        if (rhs.broadcast_)
+            return *this / rhs.vv_[0][0];
+
+        img res = dense();
         // The code below only works with correct implemented INVERSION function
 
         // T inverted(res.vv_[0][0]);
@@ -447,6 +672,14 @@ template <typename T> class img final
     {
         assert(image.rows() != 0);
         assert(image.cols() != 0);
+
+        if (image.broadcast_)
+        {
+            T value = image.vv_[0][0];
+            T::abs(image.vv_[0][0], value);
+            return broadcast(value, image.rows_, image.cols_);
+        }
+
         img<T> res(image(0, 0), image.rows(), image.cols());
 
         img<T>::for_each(image.rows(), image.cols(), [&](idx_t i, idx_t j) { T::abs(image(i, j), res(i, j)); });
@@ -454,17 +687,19 @@ template <typename T> class img final
         return res;
     }
 
+    /// Запись в широковещательное изображение развертывает его, поэтому из нескольких потоков сначала нужен densify
     inline T &operator()(idx_t i, idx_t j)
     {
+        densify();
         assert(i < vv_.size());
         assert(j < vv_[0].size());
         return vv_[i][j];
     }
     inline const T &operator()(idx_t i, idx_t j) const
     {
-        assert(i < vv_.size());
-        assert(j < vv_[0].size());
-        return vv_[i][j];
+        assert(i < rows_);
+        assert(j < cols_);
+        return broadcast_ ? vv_[0][0] : vv_[i][j];
     }
 
     /*! @brief Записывает одноцветынй кадр в Представление
@@ -472,11 +707,35 @@ template <typename T> class img final
      * \param[in] view Представление изображение
      * \param[in] clr Номер цвета
      */
-    void write(ImgView &view, idx_t clr = 0)
+    void write(ImgView &view, idx_t clr = 0) const
     {
+        assert(view.rows() == rows_);
+        assert(view.cols() == cols_);
+
+        // Плоскость записывается одним вызовом; если Представление хранит ее подряд - сразу на место
+        vector<ImgView::pixel_t> buf;
+        ImgView::pixel_t *plane = view.data(clr);
+        if (plane == nullptr)
+        {
+            buf.resize(rows_ * cols_);
+            plane = buf.data();
+        }
+
         for (idx_t i = 0; i < rows_; ++i)
             for (idx_t j = 0; j < cols_; ++j)
-                view.set(vv_[i][j].to_int(), i, j, clr);
+                plane[i * cols_ + j] = (*this)(i, j).to_int();
+
+        if (!buf.empty())
+            view.write_plane(clr, buf.data(), cols_);
+    }
+
+    template <typename S>
+    void _ctor_plane(const T &prototype, const S *plane, idx_t rows, idx_t cols, idx_t req_threads = 0)
+    {
+        auto get_val = [&prototype, plane, cols](idx_t i, idx_t j) {
+            return T::from_arithmetic_t(prototype, static_cast<int>(plane[i * cols + j]));
+        };
+        _ctor_implt(rows, cols, get_val, req_threads);
     }
 
     template <typename Func> void _ctor_implt(idx_t rows, idx_t cols, Func get_val, idx_t req_threads = 0)
@@ -527,7 +786,7 @@ template <typename T> class img final
 
     #ifdef DEPRECATED_METHODS
 
-    static std::pair<idx_t, idx_t> transform_coordinates(const vector<vector<T>> &vv_, std::pair<int, int> coordinates,
+    static std::pair<idx_t, idx_t> transform_coordinates(const storage_t &vv_, std::pair<int, int> coordinates,
                                                          std::pair<int, int> center)
     {
         if (coordinates.first < 0)
@@ -654,6 +913,236 @@ template <typename T> class img final
         return res;
     }
 
+    /*! @brief Окно трафарета размера shape вокруг текущего пикселя
+     *
+     * \details Окно ссылается на строки построчного буфера, в которых граница изображения уже доопределена,
+     * поэтому обращение к соседу не требует ни проверок, ни копирования. Индексы (a, b) отсчитываются от левого
+     * верхнего угла окна: центральный пиксель окна 3x3 это w(1, 1)
+     */
+    class window
+    {
+        const T *const *lines_;
+        idx_t j_;
+
+      public:
+        window(const T *const *lines, idx_t j) : lines_(lines), j_(j)
+        {
+        }
+
+        const T &operator()(idx_t a, idx_t b) const
+        {
+            return lines_[a][j_ + b];
+        }
+    };
+
+    /*! @brief Трафаретная операция над изображением
+     *
+     * Для каждого пикселя (i, j) вычисляет func(w), где w - окно размера shape с центром в (i, j). Изображение
+     * обходится полосами строк, каждая полоса в своем потоке. Поток держит кольцевой буфер из shape.first строк
+     * шириной cols + shape.second - 1, в котором граница уже доопределена согласно border. При переходе к
+     * следующей строке в буфер дочитывается только одна строка, поэтому изображение читается примерно один раз,
+     * а дополненная копия и сдвинутые копии (как в get_window) не создаются
+     *
+     * \param[in] image Изображение
+     * \param[in] shape Размер окна {строки, столбцы}. Оба размера нечетные
+     * \param[in] func Функция T(const window &)
+     * \param[in] border Способ доопределения за границами
+     * \param[in] fill Значение за границами для border_t::constant
+     */
+    template <typename Func>
+    static img<T> stencil(const img<T> &image, std::pair<idx_t, idx_t> shape, Func func,
+                          border_t border = border_t::mirror, const T &fill = T(), idx_t req_threads = 0)
+    {
+        assert(image.rows() != 0 && image.cols() != 0);
+        assert(shape.first % 2 == 1);
+        assert(shape.second % 2 == 1);
+        assert(border != border_t::mirror || (shape.first / 2 < image.rows() && shape.second / 2 < image.cols()));
+
+        // Окнам нужны строки в памяти
+        if (image.broadcast_)
+            return stencil(image.dense(req_threads), shape, func, border, fill, req_threads);
+
+        img<T> res(image(0, 0), image.rows(), image.cols());
+
+        const idx_t MIN_THREAD_WORK = 10000;
+        idx_t nthreads = req_threads;
+        if (req_threads == 0)
+            nthreads = determine_threads(image.rows(), image.cols(),
+                                         std::max(MIN_THREAD_WORK / (shape.first * shape.second), 1lu));
+        nthreads = std::min(nthreads, image.rows());
+
+        work(nthreads, image.rows(), [&](idx_t st_row, idx_t en_row) {
+            stencil_lines lines(image, shape, border, fill);
+            lines.load(st_row);
+            for (idx_t i = st_row; i < en_row; ++i)
+            {
+                if (i != st_row)
+                    lines.advance();
+
+                T *out = res.row(i);
+                for (idx_t j = 0; j < image.cols(); ++j)
+                    out[j] = func(window(lines.lines(), j));
+            }
+        });
+
+        return res;
+    }
+
+    /*! @brief Свертка с постоянными коэффициентами
+     *
+     * Вычисляет sum(kernel[a][b] * image(i + a - di, j + b - dj)) в порядке обхода ядра по строкам, как
+     * convolution(kernel, get_window(image, shape)), но за один проход без промежуточных изображений. Нулевые
+     * коэффициенты и ±2^k определяются один раз и умножаются без T::mult (см. const_coef). Для больших ядер в
+     * форматах с достаточным запасом точности можно явно вызвать fft_convolution
+     *
+     * \param[in] kernel Коэффициенты ядра. Размеры нечетные
+     * \param[in] image Изображение
+     * \param[in] border Способ доопределения за границами
+     * \param[in] fill Значение за границами для border_t::constant
+     */
+    static img<T> convolution(const vector<vector<T>> &kernel, const img<T> &image,
+                              border_t border = border_t::mirror, const T &fill = T(), idx_t req_threads = 0)
+    {
+        assert(!kernel.empty() && !kernel[0].empty());
+
+        const T ZERO = T::from_arithmetic_t(kernel[0][0], 0);
+        const idx_t kh = kernel.size(), kw = kernel[0].size();
+
+        vector<vector<const_coef<T>>> coefs(kh);
+        for (idx_t a = 0; a < kh; ++a)
+            for (idx_t b = 0; b < kw; ++b)
+                coefs[a].emplace_back(kernel[a][b]);
+
+        auto func = [&](const window &w) {
+            T acc = ZERO;
+            for (idx_t a = 0; a < kh; ++a)
+                for (idx_t b = 0; b < kw; ++b)
+                    coefs[a][b].mult_add(w(a, b), acc);
+            return acc;
+        };
+
+        return stencil(image, {kh, kw}, func, border, fill, req_threads);
+    }
+
+    static img<T> convolution(const img<T> &kernel, const img<T> &image, border_t border = border_t::mirror,
+                              const T &fill = T(), idx_t req_threads = 0)
+    {
+        return convolution(kernel.vv(), image, border, fill, req_threads);
+    }
+
+    /*! @brief Свертка с постоянными коэффициентами через FFT
+     *
+     * Вычисляет то же, что convolution(kernel, image, ...), но со сложностью O(log n) на пиксель вместо O(kh * kw).
+     * Изображение, доопределенное за границами согласно border, делится на блоки (overlap-add): каждый блок
+     * сворачивается с ядром через двумерное FFT размера n x n (n - степень двойки, не меньше удвоенного размера
+     * ядра), и результаты блоков складываются с перекрытием в порядке обхода блоков. Преобразования выполняются
+     * по строкам и столбцам в нескольких потоках (см. fft2d).
+     *
+     * Вычисления ведутся в формате kernel[0][0], в нем же результат. Каждый этап FFT округляется, поэтому результат
+     * совпадает с прямой сверткой в пределах ошибки округления, но не побитово. В узких форматах (например, E = 5,
+     * M = 10 или Flexfixed) эта ошибка заметно больше, чем у прямой свертки, поэтому convolution не переходит на
+     * FFT сама
+     *
+     * \param[in] kernel Коэффициенты ядра. Размеры нечетные
+     * \param[in] image Изображение
+     * \param[in] border Способ доопределения за границами
+     * \param[in] fill Значение за границами для border_t::constant
+     */
+    static img<T> fft_convolution(const vector<vector<T>> &kernel, const img<T> &image,
+                                  border_t border = border_t::mirror, const T &fill = T(), idx_t req_threads = 0)
+    {
+        assert(!kernel.empty() && !kernel[0].empty());
+        assert(kernel.size() % 2 == 1 && kernel[0].size() % 2 == 1);
+        assert(border != border_t::mirror || (kernel.size() / 2 < image.rows() && kernel[0].size() / 2 < image.cols()));
+
+        using cplx = complex_t<T>;
+
+        const T ZERO = T::from_arithmetic_t(kernel[0][0], 0);
+        const idx_t kh = kernel.size(), kw = kernel[0].size();
+        const idx_t rows = image.rows(), cols = image.cols();
+
+        auto pow2_at_least = [](idx_t n) {
+            idx_t p = 1;
+            while (p < n)
+                p *= 2;
+            return p;
+        };
+
+        // Блок вместе с хвостом свертки занимает всю сетку, поэтому циклическая свертка совпадает с линейной
+        const idx_t nr = pow2_at_least(std::max<idx_t>(2 * kh, 16)), nc = pow2_at_least(std::max<idx_t>(2 * kw, 16));
+        const idx_t tile_r = nr - kh + 1, tile_c = nc - kw + 1;
+        const fft_plan<T> row_plan(ZERO, nc), col_plan(ZERO, nr);
+
+        const idx_t MIN_THREAD_WORK = 4096;
+        idx_t nthreads = req_threads;
+        if (req_threads == 0)
+            nthreads = determine_threads(nr, nc, MIN_THREAD_WORK);
+
+        auto convert = [&ZERO](const T &x) {
+            T res = ZERO;
+            T::sum(ZERO, x, res);
+            return res;
+        };
+
+        // convolution - корреляция, поэтому ядро переворачивается
+        vector<cplx> kernel_f(nr * nc, cplx{ZERO, ZERO});
+        for (idx_t a = 0; a < kh; ++a)
+            for (idx_t b = 0; b < kw; ++b)
+                kernel_f[(kh - 1 - a) * nc + (kw - 1 - b)].re = convert(kernel[a][b]);
+        fft2d(kernel_f, row_plan, col_plan, false, nthreads);
+
+        // Пиксель (u, v) изображения, дополненного на kh / 2 строк и kw / 2 столбцов с каждой стороны
+        auto padded = [&](idx_t u, idx_t v) -> const T & {
+            const long p = static_cast<long>(u) - static_cast<long>(kh / 2);
+            const long q = static_cast<long>(v) - static_cast<long>(kw / 2);
+            if (border == border_t::constant && (p < 0 || p >= static_cast<long>(rows) || q < 0 ||
+                                                 q >= static_cast<long>(cols)))
+                return fill;
+            return image(remap(p, rows, border), remap(q, cols, border));
+        };
+
+        img<T> res(ZERO, rows, cols);
+        vector<cplx> grid(nr * nc, cplx{ZERO, ZERO});
+
+        const idx_t padded_rows = rows + kh - 1, padded_cols = cols + kw - 1;
+        for (idx_t r0 = 0; r0 < padded_rows; r0 += tile_r)
+            for (idx_t c0 = 0; c0 < padded_cols; c0 += tile_c)
+            {
+                const idx_t th = std::min(tile_r, padded_rows - r0), tw = std::min(tile_c, padded_cols - c0);
+
+                work(std::min(nthreads, nr), nr, [&](idx_t st_row, idx_t en_row) {
+                    for (idx_t u = st_row; u < en_row; ++u)
+                        for (idx_t v = 0; v < nc; ++v)
+                            grid[u * nc + v] = cplx{u < th && v < tw ? convert(padded(r0 + u, c0 + v)) : ZERO, ZERO};
+                });
+
+                fft2d(grid, row_plan, col_plan, false, nthreads);
+                work(std::min(nthreads, nr), nr, [&](idx_t st_row, idx_t en_row) {
+                    for (idx_t k = st_row * nc; k < en_row * nc; ++k)
+                        cplx::mult(grid[k], kernel_f[k], grid[k]);
+                });
+                fft2d(grid, row_plan, col_plan, true, nthreads);
+
+                // Точка (u, v) блока - точка (r0 + u, c0 + v) полной свертки, пиксель (r0 + u - kh + 1, ...) результата
+                for (idx_t u = 0; u < th + kh - 1; ++u)
+                {
+                    const long i = static_cast<long>(r0 + u) - static_cast<long>(kh - 1);
+                    if (i < 0 || i >= static_cast<long>(rows))
+                        continue;
+                    for (idx_t v = 0; v < tw + kw - 1; ++v)
+                    {
+                        const long j = static_cast<long>(c0 + v) - static_cast<long>(kw - 1);
+                        if (j < 0 || j >= static_cast<long>(cols))
+                            continue;
+                        T &out = res.vv_[static_cast<idx_t>(i)][static_cast<idx_t>(j)];
+                        T::sum(out, grid[u * nc + v].re, out);
+                    }
+                }
+            }
+
+        return res;
+    }
+
 #ifdef DEPRECATED_METHODS
 
     static img<T> convolution(const img<T> &image, std::pair<idx_t, idx_t> shape, std::function<T(const img<T> &)> func)
@@ -675,26 +1164,37 @@ template <typename T> class img final
 
         img<T> res(ZERO, right[0][0].rows(), right[0][0].cols());
 
-        // img<T> res(ZERO, right[0][0].rows(),right[0][0].cols());
-
-        // think about multithreading
-        for (idx_t i = 0; i < left.size(); ++i)
-        {
-            for (idx_t j = 0; j < left[0].size(); ++j)
-            {
-                assert((left[i][j].cols() == 1 && left[i][j].rows() == 1) ||
-                       (left[i][j].rows() == right[i][j].rows() && left[i][j].cols() == right[i][j].cols()));
-                if (left[i][j].rows() == 1 && left[i][j].cols() == 1)
-                {
-                    res = res + left[i][j](0, 0) * right[i][j];
-                }
-                else
+        for (idx_t a = 0; a < left.size(); ++a)
+            for (idx_t b = 0; b < left[0].size(); ++b)
+                assert((left[a][b].cols() == 1 && left[a][b].rows() == 1) ||
+                       (left[a][b].rows() == right[a][b].rows() && left[a][b].cols() == right[a][b].cols()));
+
+        // Коэффициенты 1x1 разбираются один раз (см. const_coef)
+        vector<vector<const_coef<T>>> scalars(left.size());
+        for (idx_t a = 0; a < left.size(); ++a)
+            for (idx_t b = 0; b < left[0].size(); ++b)
+                scalars[a].emplace_back(left[a][b](0, 0));
+
+        // Все слагаемые пикселя накапливаются за один проход, порядок операций тот же, что у
+        // res = res + left[a][b] * right[a][b]
+        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) {
+            for (idx_t a = 0; a < left.size(); ++a)
+                for (idx_t b = 0; b < left[0].size(); ++b)
                 {
-                    res = res + left[i][j] * right[i][j];
+                    const img<T> &coef = left[a][b];
+
+                    // Формат произведения как у left[a][b](0, 0) * right[a][b] и left[a][b] * right[a][b]
+                    if (coef.rows() == 1 && coef.cols() == 1)
+                    {
+                        scalars[a][b].mult_add(right[a][b](i, j), res.vv_[i][j]);
+                        continue;
+                    }
+
+                    T tap = coef(i, j);
+                    T::mult(coef(i, j), right[a][b](i, j), tap);
+                    T::sum(res.vv_[i][j], tap, res.vv_[i][j]);
                 }
-                // debug_vecvec(res.vv());
-            }
-        }
+        });
 
         return res;
     }
@@ -728,6 +1228,66 @@ template <typename T> class img final
         return result;
     }
 
+    /*! @brief Поэлементный выбор по маске: mask(i, j) ? true_val(i, j) : false_val(i, j)
+     *
+     * \param[in] mask Маска, например результат сравнения изображений
+     * \param[in] true_val Значения для установленных битов
+     * \param[in] false_val Значения для сброшенных битов
+     */
+    static img<T> select(const img_mask &mask, const img<T> &true_val, const img<T> &false_val)
+    {
+        assert(mask.rows() == true_val.rows() && true_val.rows() == false_val.rows());
+        assert(mask.cols() == true_val.cols() && true_val.cols() == false_val.cols());
+
+        img<T> result(true_val(0, 0), true_val.rows(), true_val.cols());
+
+        const idx_t MIN_THREAD_WORK = 10000;
+        work(result.determine_threads(MIN_THREAD_WORK), result.rows(), [&](idx_t st_row, idx_t en_row) {
+            for (idx_t i = st_row; i < en_row; ++i)
+            {
+                const img_mask::word_t *bits = mask.row(i);
+                for (idx_t j = 0; j < result.cols(); ++j)
+                {
+                    const bool flag = (bits[j / img_mask::WORD_BITS] >> (j % img_mask::WORD_BITS)) & 1u;
+                    result.vv_[i][j] = flag ? true_val(i, j) : false_val(i, j);
+                }
+            }
+        });
+
+        return result;
+    }
+
+    /*! @brief Выбор по результату сравнения без построения маски: compare(lhs, rhs) ? true_val : false_val
+     *
+     * \details Эквивалентно select(lhs < rhs, true_val, false_val) для compare = std::less, но сравнение и выбор
+     * выполняются за один проход
+     *
+     * \param[in] lhs, rhs Сравниваемые изображения
+     * \param[in] compare Предикат bool(const T &, const T &)
+     * \param[in] true_val Значения там, где предикат истинен
+     * \param[in] false_val Значения там, где предикат ложен
+     */
+    template <typename Compare>
+    static img<T> select(const img<T> &lhs, const img<T> &rhs, Compare compare, const img<T> &true_val,
+                         const img<T> &false_val)
+    {
+        assert(lhs.rows() == rhs.rows() && rhs.rows() == true_val.rows() && true_val.rows() == false_val.rows());
+        assert(lhs.cols() == rhs.cols() && rhs.cols() == true_val.cols() && true_val.cols() == false_val.cols());
+
+        img<T> result(true_val(0, 0), true_val.rows(), true_val.cols());
+
+        img<T>::for_each(result.rows(), result.cols(), [&](idx_t i, idx_t j) {
+            result.vv_[i][j] = compare(lhs(i, j), rhs(i, j)) ? true_val(i, j) : false_val(i, j);
+        });
+
+        return result;
+    }
+
+    static img<T> condition(const img_mask &mask, const img<T> &true_val, const img<T> &false_val)
+    {
+        return select(mask, true_val, false_val);
+    }
+
     static img<T> baer_matrix(const img<T> &r, const img<T> &g, const img<T> &b)
     {
         assert(r.rows() != 0 && r.rows() == g.rows() && g.rows() == b.rows());
@@ -778,88 +1338,247 @@ template <typename T> class img final
 
 #define CREATE_T(param, value) T::from_arithmetic_t(param, value)
 
-#define CREATE_IMG(param, value) img<T>({{CREATE_T(param, value)}})
-
-    static std::vector<img<T>> demosaic(const img<T> &r, const img<T> &g, const img<T> &b)
+    /*! @brief Демозаика (восстановление цветов по матрице Байера)
+     *
+     * \details Градиенты, интерполяция зелёного, низкочастотные фильтры и восстановление R/B считаются для пикселя
+     * за один проход по трем построчным буферам (см. stencil), полосы строк обрабатываются в разных потоках.
+     * Результат побитово совпадает с поэтапной формулировкой:
+     *
+     *     wg = get_window(g, {3, 3})
+     *     dgx = abs(convolution(mx, wg)), dgy = abs(convolution(my, wg))
+     *     g_new = wg[1][1] + condition(dgx < dgy, (wg[1][0] + wg[1][2]) / 2, (wg[0][1] + wg[2][1]) / 2)
+     *     g_lpf = convolution(m, wg) / 8, r_lpf = convolution(m, wr) / 4, b_lpf = convolution(m, wb) / 4
+     *     r_new = condition(g_lpf == 0, r_lpf, g_new * r_lpf / g_lpf), b_new аналогично
+     *
+     * Все промежуточные значения имеют тот же формат, что и в поэтапной версии: свертки накапливаются в формате
+     * r(0, 0), деление на константу - умножение на обратную величину, полученную через from_arithmetic_t
+     */
+    static std::vector<img<T>> demosaic(const img<T> &r, const img<T> &g, const img<T> &b, idx_t req_threads = 0)
     {
+        assert(r.rows() != 0 && r.rows() == g.rows() && g.rows() == b.rows());
+        assert(r.cols() != 0 && r.cols() == g.cols() && g.cols() == b.cols());
 
-        const std::vector<std::vector<img<T>>> mx(
-            {{CREATE_IMG(r(0, 0), 1), CREATE_IMG(r(0, 0), 0), CREATE_IMG(r(0, 0), -1)},
-             {CREATE_IMG(r(0, 0), 2), CREATE_IMG(r(0, 0), 0), CREATE_IMG(r(0, 0), -2)},
-             {CREATE_IMG(r(0, 0), 1), CREATE_IMG(r(0, 0), 0), CREATE_IMG(r(0, 0), -1)}});
+        if (r.broadcast_ || g.broadcast_ || b.broadcast_)
+            return demosaic(r.dense(req_threads), g.dense(req_threads), b.dense(req_threads), req_threads);
+
+        const idx_t rows = r.rows(), cols = r.cols();
+        const T &proto = r(0, 0);
+
+        // Коэффициенты ядер строятся один раз на вызов. Все они - ноль или ±2^k, поэтому умножения сводятся к сдвигам
+        // (см. const_coef)
+        using coef_t = const_coef<T>;
+        const T ZERO = CREATE_T(proto, 0);
+        auto k = [&proto](int value) { return coef_t(CREATE_T(proto, value)); };
+        const coef_t mx[3][3] = {{k(1), k(0), k(-1)}, {k(2), k(0), k(-2)}, {k(1), k(0), k(-1)}};
+        const coef_t my[3][3] = {{k(1), k(2), k(1)}, {k(0), k(0), k(0)}, {k(-1), k(-2), k(1)}};
+        const coef_t m[3][3] = {{k(1), k(2), k(1)}, {k(2), k(4), k(2)}, {k(1), k(2), k(1)}};
+
+        // x / c == x * from_arithmetic_t(c, 1 / c), как в operator/(const T &)
+        const T two = CREATE_T(proto, 2), four = CREATE_T(proto, 4), eight = CREATE_T(proto, 8);
+        const coef_t inv_two(CREATE_T(two, 1.0f / two.to_float()));
+        const coef_t inv_four(CREATE_T(four, 1.0f / four.to_float()));
+        const coef_t inv_eight(CREATE_T(eight, 1.0f / eight.to_float()));
+
+        auto conv = [&ZERO](const coef_t(&kernel)[3][3], const window &w) {
+            T acc = ZERO;
+            for (idx_t a = 0; a < 3; ++a)
+                for (idx_t c = 0; c < 3; ++c)
+                    kernel[a][c].mult_add(w(a, c), acc);
+            return acc;
+        };
 
-        const std::vector<std::vector<img<T>>> my(
-            {{CREATE_IMG(r(0, 0), 1), CREATE_IMG(r(0, 0), 2), CREATE_IMG(r(0, 0), 1)},
-             {CREATE_IMG(r(0, 0), 0), CREATE_IMG(r(0, 0), 0), CREATE_IMG(r(0, 0), 0)},
-             {CREATE_IMG(r(0, 0), -1), CREATE_IMG(r(0, 0), -2), CREATE_IMG(r(0, 0), 1)}});
+        img<T> r_new(proto, rows, cols), g_new(proto, rows, cols), b_new(proto, rows, cols);
 
-        std::vector<std::vector<img<T>>> wg = get_window(g, {3, 3});
+        // Демозаика дороже поэлементных операций примерно в 50 раз
+        const idx_t MIN_THREAD_WORK = 200;
+        idx_t nthreads = req_threads;
+        if (req_threads == 0)
+            nthreads = determine_threads(rows, cols, MIN_THREAD_WORK);
+        nthreads = std::min(nthreads, rows);
+
+        const std::pair<idx_t, idx_t> shape = {3, 3};
+        work(nthreads, rows, [&](idx_t st_row, idx_t en_row) {
+            stencil_lines lr(r, shape, border_t::mirror, ZERO);
+            stencil_lines lg(g, shape, border_t::mirror, ZERO);
+            stencil_lines lb(b, shape, border_t::mirror, ZERO);
+            lr.load(st_row);
+            lg.load(st_row);
+            lb.load(st_row);
 
-        img<T> dgx = abs(convolution(mx, wg));
+            for (idx_t i = st_row; i < en_row; ++i)
+            {
+                if (i != st_row)
+                {
+                    lr.advance();
+                    lg.advance();
+                    lb.advance();
+                }
 
-        img<T> dgy = abs(convolution(my, wg));
+                T *out_r = r_new.row(i), *out_g = g_new.row(i), *out_b = b_new.row(i);
+                for (idx_t j = 0; j < cols; ++j)
+                {
+                    const window wr(lr.lines(), j), wg(lg.lines(), j), wb(lb.lines(), j);
+
+                    // Градиенты
+                    T dgx = conv(mx, wg);
+                    T::abs(dgx, dgx);
+                    T dgy = conv(my, wg);
+                    T::abs(dgy, dgy);
+
+                    // Интерполяция зелёного вдоль меньшего градиента
+                    T interp = dgx < dgy ? wg(1, 0) : wg(0, 1);
+                    if (dgx < dgy)
+                        T::sum(wg(1, 0), wg(1, 2), interp);
+                    else
+                        T::sum(wg(0, 1), wg(2, 1), interp);
+                    inv_two.mult(interp, interp);
+
+                    T gn = wg(1, 1);
+                    T::sum(wg(1, 1), interp, gn);
+
+                    // Низкочастотные фильтры
+                    T g_lpf = conv(m, wg);
+                    inv_eight.mult(g_lpf, g_lpf);
+                    T r_lpf = conv(m, wr);
+                    inv_four.mult(r_lpf, r_lpf);
+                    T b_lpf = conv(m, wb);
+                    inv_four.mult(b_lpf, b_lpf);
+
+                    // Восстановление R/B: g_new * c_lpf / g_lpf
+                    if (g_lpf == ZERO)
+                    {
+                        out_r[j] = r_lpf;
+                        out_b[j] = b_lpf;
+                    }
+                    else
+                    {
+                        const T inv_g_lpf = CREATE_T(g_lpf, 1.0f / g_lpf.to_float());
+
+                        out_r[j] = gn;
+                        T::mult(gn, r_lpf, out_r[j]);
+                        T::mult(out_r[j], inv_g_lpf, out_r[j]);
+
+                        out_b[j] = gn;
+                        T::mult(gn, b_lpf, out_b[j]);
+                        T::mult(out_b[j], inv_g_lpf, out_b[j]);
+                    }
+                    out_g[j] = gn;
+                }
+            }
+        });
 
-        img<T> g_new = wg[1][1] + condition((dgx < dgy), (wg[1][0] + wg[1][2]) / (CREATE_T(r(0, 0), 2)),
-                                            (wg[0][1] + wg[2][1]) / (CREATE_T(r(0, 0), 2)));
+        return {r_new, g_new, b_new};
+    }
 
-        // debug_vecvec(g_new.vv());
+    /*! @brief Маска поэлементного сравнения compare(lhs(i, j), rhs(i, j))
+     *
+     * \details Каждый поток заполняет целые слова своих строк, поэтому запись в маску не требует синхронизации
+     */
+    template <typename Compare> static img_mask create_mask(const img<T> &lhs, const img<T> &rhs, Compare compare)
+    {
+        assert(lhs.rows() == rhs.rows());
+        assert(lhs.cols() == rhs.cols());
+
+        img_mask mask(lhs.rows(), lhs.cols());
 
-        const std::vector<std::vector<img<T>>> m(
-            {{CREATE_IMG(r(0, 0), 1), CREATE_IMG(r(0, 0), 2), CREATE_IMG(r(0, 0), 1)},
-             {CREATE_IMG(r(0, 0), 2), CREATE_IMG(r(0, 0), 4), CREATE_IMG(r(0, 0), 2)},
-             {CREATE_IMG(r(0, 0), 1), CREATE_IMG(r(0, 0), 2), CREATE_IMG(r(0, 0), 1)}});
+        const idx_t MIN_THREAD_WORK = 10000;
+        work(lhs.determine_threads(MIN_THREAD_WORK), lhs.rows(), [&](idx_t st_row, idx_t en_row) {
+            for (idx_t i = st_row; i < en_row; ++i)
+            {
+                img_mask::word_t *bits = mask.row(i);
+                for (idx_t w = 0; w < mask.stride(); ++w)
+                {
+                    const idx_t st_col = w * img_mask::WORD_BITS;
+                    const idx_t en_col = std::min(st_col + img_mask::WORD_BITS, lhs.cols());
 
-        auto g_lpf = convolution(m, wg) / T::from_arithmetic_t(r(0, 0), 8);
-        auto r_lpf = convolution(m, get_window(r, {3, 3})) / T::from_arithmetic_t(r(0, 0), 4);
-        auto b_lpf = convolution(m, get_window(b, {3, 3})) / T::from_arithmetic_t(r(0, 0), 4);
+                    img_mask::word_t word = 0;
+                    for (idx_t j = st_col; j < en_col; ++j)
+                        word |= img_mask::word_t(compare(lhs(i, j), rhs(i, j))) << (j - st_col);
+                    bits[w] = word;
+                }
+            }
+        });
 
-        // debug_vecvec(r_lpf.vv());
+        return mask;
+    }
 
-        // debug_vecvec(g_lpf.vv());
+    template <typename U> friend img_mask operator>(const img<U> &lhs, const img<U> &rhs);
 
-        // debug_vecvec(b_lpf.vv());
+    template <typename U> friend img_mask operator>=(const img<U> &lhs, const img<U> &rhs);
 
-        // zero value
-        const T ZERO = T::from_arithmetic_t(g_lpf(0, 0), 0);
+    template <typename U> friend img_mask operator<(const img<U> &lhs, const img<U> &rhs);
 
-        img<T> r_new = condition(g_lpf == img<T>(ZERO, g_lpf.rows(), g_lpf.cols()), r_lpf, g_new * r_lpf / g_lpf);
+    template <typename U> friend img_mask operator<=(const img<U> &lhs, const img<U> &rhs);
 
-        img<T> b_new = condition(g_lpf == img<T>(ZERO, g_lpf.rows(), g_lpf.cols()), b_lpf, g_new * b_lpf / g_lpf);
+    template <typename U> friend img_mask operator==(const img<U> &lhs, const img<U> &rhs);
 
-        return {r_new, g_new, b_new};
-    }
+    template <typename U> friend img_mask operator!=(const img<U> &lhs, const img<U> &rhs);
 
-    static std::vector<std::vector<bool>> create_bool_mask(const img<T> &lhs, const img<T> &rhs,
-                                                           std::function<bool(const T &, const T &)> compare)
-    {
-        assert(lhs.rows() == rhs.rows());
-        assert(lhs.cols() == rhs.cols());
+    template <typename U> friend class pipeline;
 
-        std::vector<std::vector<bool>> flags(lhs.rows(), std::vector<bool>(lhs.cols()));
+    template <typename U> friend class profiler;
 
-        img<T>::for_each(lhs.rows(), lhs.cols(),
-                         [&](idx_t i, idx_t j) { flags[i][j] = compare(lhs(i, j), rhs(i, j)); });
+#undef CREATE_T
 
-        return flags;
-    }
+  private:
+    // Поэлементная операция op(lhs, rhs, res) двух изображений. Широковещательный операнд передается как скаляр
+    template <typename Op> static void binary(const img<T> &lhs, const img<T> &rhs, img<T> &res, Op op)
+    {
+        assert(rhs.rows_ == lhs.rows_ && lhs.rows_ == res.rows_);
+        assert(rhs.cols_ == lhs.cols_ && lhs.cols_ == res.cols_);
 
-    template <typename U> friend std::vector<std::vector<bool>> operator>(const img<U> &lhs, const img<U> &rhs);
+        // Значение копируется: res может совпадать с операндом и быть развернут
+        if (rhs.broadcast_)
+        {
+            const T value = rhs.vv_[0][0];
+            return binary(lhs, value, res, op);
+        }
+        if (lhs.broadcast_)
+        {
+            const T value = lhs.vv_[0][0];
+            return binary(value, rhs, res, op);
+        }
 
-    template <typename U> friend std::vector<std::vector<bool>> operator>=(const img<U> &lhs, const img<U> &rhs);
+        res.densify();
+        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { op(lhs.vv_[i][j], rhs.vv_[i][j], res.vv_[i][j]); });
+    }
 
-    template <typename U> friend std::vector<std::vector<bool>> operator<(const img<U> &lhs, const img<U> &rhs);
+    // Операция изображения со скаляром. Для широковещательного изображения - одна операция, результат тоже
+    // широковещательный в формате res
+    template <typename Op> static void binary(const img<T> &lhs, const T &rhs, img<T> &res, Op op)
+    {
+        assert(lhs.rows_ == res.rows_);
+        assert(lhs.cols_ == res.cols_);
 
-    template <typename U> friend std::vector<std::vector<bool>> operator<=(const img<U> &lhs, const img<U> &rhs);
+        if (lhs.broadcast_)
+        {
+            T value = res.vv_[0][0];
+            op(lhs.vv_[0][0], rhs, value);
+            res = broadcast(value, lhs.rows_, lhs.cols_);
+            return;
+        }
 
-    template <typename U> friend std::vector<std::vector<bool>> operator==(const img<U> &lhs, const img<U> &rhs);
+        res.densify();
+        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { op(lhs.vv_[i][j], rhs, res.vv_[i][j]); });
+    }
 
-    template <typename U> friend std::vector<std::vector<bool>> operator!=(const img<U> &lhs, const img<U> &rhs);
+    template <typename Op> static void binary(const T &lhs, const img<T> &rhs, img<T> &res, Op op)
+    {
+        assert(rhs.rows_ == res.rows_);
+        assert(rhs.cols_ == res.cols_);
 
-#undef CREATE_IMG
+        if (rhs.broadcast_)
+        {
+            T value = res.vv_[0][0];
+            op(lhs, rhs.vv_[0][0], value);
+            res = broadcast(value, rhs.rows_, rhs.cols_);
+            return;
+        }
 
-#undef CREATE_T
+        res.densify();
+        for_each(res.rows(), res.cols(), [&](idx_t i, idx_t j) { op(lhs, rhs.vv_[i][j], res.vv_[i][j]); });
+    }
 
-  private:
     static img<T> get_subimg(const img<T> &initial, idx_t row_start, idx_t row_end, idx_t col_start, idx_t col_end)
     {
         std::vector<std::vector<T>> rect(row_end - row_start, std::vector<T>(col_end - col_start));
@@ -869,6 +1588,138 @@ template <typename T> class img final
         return img<T>(rect);
     }
 
+    // Построчный буфер для stencil: кольцо из shape.first строк, каждая дополнена на shape.second / 2
+    // элементов слева и справа. lines()[a] - строка i - di + a для текущей строки i
+    class stencil_lines
+    {
+        const img<T> &image_;
+        border_t border_;
+        const T &fill_;
+        idx_t di_, dj_;
+
+        vector<row_t> buf_;
+        vector<const T *> lines_;
+        idx_t top_ = 0;  // строка изображения, соответствующая центру окна
+        idx_t head_ = 0; // слот buf_, в котором лежит верхняя строка окна
+
+      public:
+        stencil_lines(const img<T> &image, std::pair<idx_t, idx_t> shape, border_t border, const T &fill)
+            : image_(image), border_(border), fill_(fill), di_(shape.first / 2), dj_(shape.second / 2),
+              buf_(shape.first, row_t(image.cols() + shape.second - 1, image(0, 0))), lines_(shape.first)
+        {
+        }
+
+        stencil_lines(const stencil_lines &) = delete;
+        stencil_lines &operator=(const stencil_lines &) = delete;
+
+        // Заполняет кольцо для строки i
+        void load(idx_t i)
+        {
+            top_ = i;
+            head_ = 0;
+            for (idx_t a = 0; a < buf_.size(); ++a)
+                fill_line(buf_[a], static_cast<long>(i + a) - static_cast<long>(di_));
+            relink();
+        }
+
+        // Сдвигает окно на строку вниз: дочитывается одна строка на место самой верхней
+        void advance()
+        {
+            const idx_t k = buf_.size();
+            ++top_;
+            fill_line(buf_[head_], static_cast<long>(top_ + k - 1) - static_cast<long>(di_));
+            head_ = (head_ + 1) % k;
+            relink();
+        }
+
+        const T *const *lines() const
+        {
+            return lines_.data();
+        }
+
+      private:
+        void relink()
+        {
+            for (idx_t a = 0; a < buf_.size(); ++a)
+                lines_[a] = buf_[(head_ + a) % buf_.size()].data();
+        }
+
+        void fill_line(row_t &line, long p)
+        {
+            const idx_t w = image_.cols();
+            const long h = static_cast<long>(image_.rows());
+
+            if (border_ == border_t::constant && (p < 0 || p >= h))
+            {
+                std::fill(line.begin(), line.end(), fill_);
+                return;
+            }
+
+            const T *src = image_.row(remap(p, image_.rows(), border_));
+            std::copy(src, src + w, line.begin() + static_cast<long>(dj_));
+
+            for (idx_t q = 1; q <= dj_; ++q)
+            {
+                const long l = -static_cast<long>(q), r = static_cast<long>(w - 1 + q);
+                if (border_ == border_t::constant)
+                {
+                    line[dj_ - q] = fill_;
+                    line[dj_ + w - 1 + q] = fill_;
+                }
+                else
+                {
+                    line[dj_ - q] = src[remap(l, w, border_)];
+                    line[dj_ + w - 1 + q] = src[remap(r, w, border_)];
+                }
+            }
+        }
+    };
+
+    // Отображает индекс p, лежащий за границами [0, n), внутрь изображения
+    static idx_t remap(long p, idx_t n, border_t border)
+    {
+        const long last = static_cast<long>(n) - 1;
+        if (p >= 0 && p <= last)
+            return static_cast<idx_t>(p);
+
+        if (border == border_t::clamp)
+            return p < 0 ? 0 : static_cast<idx_t>(last);
+
+        assert(border == border_t::mirror);
+        assert(p > -static_cast<long>(n) && p < 2 * last + 1);
+        return static_cast<idx_t>(p < 0 ? -p : 2 * last - p);
+    }
+
+    // Поддеревья tree_fold на глубине depth (или листья выше нее) в порядке обхода
+    static void tree_split(idx_t lo, idx_t hi, idx_t leaf, idx_t depth, vector<std::pair<idx_t, idx_t>> &tasks)
+    {
+        if (hi - lo <= leaf || depth == 0)
+        {
+            tasks.emplace_back(lo, hi);
+            return;
+        }
+
+        const idx_t mid = lo + (hi - lo) / 2;
+        tree_split(lo, mid, leaf, depth - 1, tasks);
+        tree_split(mid, hi, leaf, depth - 1, tasks);
+    }
+
+    // Собирает результаты поддеревьев tree_split так же, как это сделал бы tree_fold
+    template <typename Combine>
+    static T tree_join(Combine combine, idx_t lo, idx_t hi, idx_t leaf, idx_t depth, const vector<T> &parts,
+                       idx_t &next)
+    {
+        if (hi - lo <= leaf || depth == 0)
+            return parts[next++];
+
+        const idx_t mid = lo + (hi - lo) / 2;
+        T left = tree_join(combine, lo, mid, leaf, depth - 1, parts, next);
+        T right = tree_join(combine, mid, hi, leaf, depth - 1, parts, next);
+        combine(left, right, left);
+
+        return left;
+    }
+
     // Выполняет func над this, разделяя работу на nthreads потоков
     // Пример использования в mean
     template <typename Func, typename... Args> static void work(idx_t nthreads, idx_t rows, Func func, Args... args)
@@ -882,23 +1733,10 @@ template <typename T> class img final
             return;
         }
 
-        vector<std::thread> threads(nthreads);
-        idx_t bsize = std::max(rows / nthreads, 1lu);
-
-        /////////////////// Создаем потоки ///////////////////
-        idx_t tidx = 0;
-        idx_t last_row = 0;
-        for (; rows >= bsize * (tidx + 1) && tidx < nthreads; last_row += bsize, tidx += 1)
-            threads[tidx] = std::thread(func, last_row, last_row + bsize, args...);
-
-        // Обрабатываем остаток работ
-        auto remainder = rows - bsize * tidx;
-        if (remainder > 0)
-            func(last_row, rows, args...);
-
-        // Ждем потоки
-        for (idx_t th = 0; th < nthreads; ++th)
-            threads[th].join();
+        // Полосы строк выполняются закрепленными за узлами NUMA потоками пула. Отображение полосы на поток
+        // зависит только от ее положения в изображении, поэтому строки, записанные в конструкторе, и все
+        // последующие проходы по ним выполняются на одном узле
+        thread_pool::instance().bands(nthreads, rows, [&](idx_t st, idx_t en) { func(st, en, args...); });
     }
 
     // Определение оптимального количество потоков исходя из количества работы и параметров системы
@@ -970,59 +1808,61 @@ template <typename T> class img final
     // }
 };
 
+
 template <typename T> img<T> operator+(const T &lhs, const img<T> &rhs)
 {
     img<T> res(rhs);
-    img<T>::for_each(rhs.rows(), rhs.cols(), [&](idx_t i, idx_t j) { T::sum(lhs, res.vv_[i][j], res.vv_[i][j]); });
+    img<T>::add(lhs, rhs, res);
 
     return res;
 }
 template <typename T> img<T> operator*(const T &lhs, const img<T> &rhs)
 {
     img<T> res(rhs);
-    img<T>::for_each(rhs.rows(), rhs.cols(), [&](idx_t i, idx_t j) { T::mult(lhs, res.vv_[i][j], res.vv_[i][j]); });
+    img<T>::mult(lhs, rhs, res);
 
     return res;
 }
 template <typename T> img<T> operator-(const T &lhs, const img<T> &rhs)
 {
     img<T> res(rhs);
-    img<T>::for_each(rhs.rows(), rhs.cols(), [&](idx_t i, idx_t j) { T::sub(lhs, res.vv_[i][j], res.vv_[i][j]); });
+    img<T>::sub(lhs, rhs, res);
 
     return res;
 }
 
-template <typename T> std::vector<std::vector<bool>> operator>(const img<T> &lhs, const img<T> &rhs)
+template <typename T> img_mask operator>(const img<T> &lhs, const img<T> &rhs)
 {
-    return img<T>::create_bool_mask(lhs, rhs, [](const T &left, const T &right) { return left > right; });
+    return img<T>::create_mask(lhs, rhs, [](const T &left, const T &right) { return left > right; });
 }
 
-template <typename T> std::vector<std::vector<bool>> operator>=(const img<T> &lhs, const img<T> &rhs)
+template <typename T> img_mask operator>=(const img<T> &lhs, const img<T> &rhs)
 {
-    return img<T>::create_bool_mask(lhs, rhs, [](const T &left, const T &right) { return left >= right; });
+    return img<T>::create_mask(lhs, rhs, [](const T &left, const T &right) { return left >= right; });
 }
 
-template <typename T> std::vector<std::vector<bool>> operator<(const img<T> &lhs, const img<T> &rhs)
+template <typename T> img_mask operator<(const img<T> &lhs, const img<T> &rhs)
 {
-    return img<T>::create_bool_mask(lhs, rhs, [](const T &left, const T &right) { return left < right; });
+    return img<T>::create_mask(lhs, rhs, [](const T &left, const T &right) { return left < right; });
 }
 
-template <typename T> std::vector<std::vector<bool>> operator<=(const img<T> &lhs, const img<T> &rhs)
+template <typename T> img_mask operator<=(const img<T> &lhs, const img<T> &rhs)
 {
-    return img<T>::create_bool_mask(lhs, rhs, [](const T &left, const T &right) { return left <= right; });
+    return img<T>::create_mask(lhs, rhs, [](const T &left, const T &right) { return left <= right; });
 }
 
-template <typename T> std::vector<std::vector<bool>> operator==(const img<T> &lhs, const img<T> &rhs)
+template <typename T> img_mask operator==(const img<T> &lhs, const img<T> &rhs)
 {
-    return img<T>::create_bool_mask(lhs, rhs, [](const T &left, const T &right) { return left == right; });
+    return img<T>::create_mask(lhs, rhs, [](const T &left, const T &right) { return left == right; });
 }
 
-template <typename T> std::vector<std::vector<bool>> operator!=(const img<T> &lhs, const img<T> &rhs)
+template <typename T> img_mask operator!=(const img<T> &lhs, const img<T> &rhs)
 {
-    return img<T>::create_bool_mask(lhs, rhs, [](const T &left, const T &right) { return left != right; });
+    return img<T>::create_mask(lhs, rhs, [](const T &left, const T &right) { return left != right; });
 }
 
 extern template class img<Flexfloat>;
+extern template class img<Fastfloat>;
 
 /*!
  * \brief Обёртка над трёхцветным Image
@@ -1074,7 +1914,7 @@ template <typename T> class img_rgb
      *
      * \param[in] view Представление изображения
      */
-    void write(ImgView &view)
+    void write(ImgView &view) const
     {
         r_.write(view, ImgView::R);
         g_.write(view, ImgView::G);
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "reduce.hpp"
+#include "tasks.hpp"
+
+namespace clib
+{
+
+/*!
+ * \brief Плотная матрица rows x cols
+ *
+ * \details Элементы хранятся по строкам подряд в одном массиве, поэтому строка - непрерывный отрезок памяти
+ */
+template <typename T> class matrix
+{
+    idx_t rows_ = 0;
+    idx_t cols_ = 0;
+    std::vector<T> data_;
+
+  public:
+    matrix() = default;
+
+    /*! @brief Матрица, заполненная prototype
+     */
+    matrix(const T &prototype, idx_t rows, idx_t cols) : rows_(rows), cols_(cols), data_(rows * cols, prototype)
+    {
+        assert(rows > 0);
+        assert(cols > 0);
+    }
+
+    /*! @brief Матрица из массива строк одинаковой длины
+     */
+    explicit matrix(const std::vector<std::vector<T>> &vv) : rows_(vv.size()), cols_(vv.empty() ? 0 : vv[0].size())
+    {
+        assert(rows_ > 0);
+        assert(cols_ > 0);
+
+        data_.reserve(rows_ * cols_);
+        for (const auto &line : vv)
+        {
+            assert(line.size() == cols_);
+            data_.insert(data_.end(), line.begin(), line.end());
+        }
+    }
+
+    idx_t rows() const noexcept
+    {
+        return rows_;
+    }
+    idx_t cols() const noexcept
+    {
+        return cols_;
+    }
+
+    T &operator()(idx_t i, idx_t j)
+    {
+        assert(i < rows_ && j < cols_);
+        return data_[i * cols_ + j];
+    }
+    const T &operator()(idx_t i, idx_t j) const
+    {
+        assert(i < rows_ && j < cols_);
+        return data_[i * cols_ + j];
+    }
+
+    /// @brief Указатель на начало строки i
+    T *row(idx_t i)
+    {
+        assert(i < rows_);
+        return data_.data() + i * cols_;
+    }
+    const T *row(idx_t i) const
+    {
+        assert(i < rows_);
+        return data_.data() + i * cols_;
+    }
+
+    matrix transposed() const
+    {
+        matrix res(data_[0], cols_, rows_);
+        for (idx_t i = 0; i < rows_; ++i)
+            for (idx_t j = 0; j < cols_; ++j)
+                res(j, i) = (*this)(i, j);
+        return res;
+    }
+
+    std::vector<std::vector<T>> vv() const
+    {
+        std::vector<std::vector<T>> res;
+        res.reserve(rows_);
+        for (idx_t i = 0; i < rows_; ++i)
+            res.emplace_back(row(i), row(i) + cols_);
+        return res;
+    }
+};
+
+/*! @brief Скалярное произведение sum(a[k] * b[k]), k = 0..n - 1
+ *
+ * \details Произведения вычисляются в формате a[k] и складываются в порядке spec (см. fold). Результат побитово
+ * совпадает с циклом из T::mult и T::sum в том же порядке
+ *
+ * \param[in] a, b Массивы из n элементов
+ * \param[in] spec Порядок накопления
+ */
+template <typename T> T dot(const T *a, const T *b, idx_t n, const order_spec &spec = order_spec())
+{
+    auto product = [a, b](idx_t k) {
+        T res = a[k];
+        T::mult(a[k], b[k], res);
+        return res;
+    };
+    return fold<T>(product, [](const T &lhs, const T &rhs, T &res) { T::sum(lhs, rhs, res); }, n, spec);
+}
+
+template <typename T> T dot(const std::vector<T> &a, const std::vector<T> &b, const order_spec &spec = order_spec())
+{
+    assert(a.size() == b.size());
+    return dot(a.data(), b.data(), a.size(), spec);
+}
+
+/*! @brief Параметры gemm
+ */
+struct gemm_spec
+{
+    order_spec order;       ///< порядок накопления по общему индексу k
+    idx_t block_rows = 32;  ///< строк результата в блоке
+    idx_t block_cols = 32;  ///< столбцов результата в блоке
+
+    gemm_spec() = default;
+    explicit gemm_spec(const order_spec &order_n, idx_t block_rows_n = 32, idx_t block_cols_n = 32)
+        : order(order_n), block_rows(block_rows_n), block_cols(block_cols_n)
+    {
+    }
+};
+
+namespace detail
+{
+// Несколько накопителей, которые сворачиваются одновременно, каждый в том же порядке, что и одиночный
+template <typename T, size_t N> using lanes = std::array<T, N>;
+
+// Блок результата: строки [i0, i1), столбцы [j0, j1). bt - транспонированная b, ее строки - столбцы b
+template <typename T>
+void gemm_block(const matrix<T> &a, const matrix<T> &bt, matrix<T> &c, idx_t i0, idx_t i1, idx_t j0, idx_t j1,
+                const order_spec &spec)
+{
+    constexpr size_t N = 4;
+    const idx_t n = a.cols();
+
+    auto combine = [](const lanes<T, N> &lhs, const lanes<T, N> &rhs, lanes<T, N> &res) {
+        for (size_t l = 0; l < N; ++l)
+            T::sum(lhs[l], rhs[l], res[l]);
+    };
+
+    for (idx_t i = i0; i < i1; ++i)
+    {
+        const T *arow = a.row(i);
+
+        // Четыре столбца за проход: a[i][k] читается один раз на четыре произведения
+        idx_t j = j0;
+        for (; j + N <= j1; j += N)
+        {
+            const T *brow[N] = {bt.row(j), bt.row(j + 1), bt.row(j + 2), bt.row(j + 3)};
+            auto product = [&](idx_t k) {
+                lanes<T, N> res;
+                for (size_t l = 0; l < N; ++l)
+                {
+                    res[l] = arow[k];
+                    T::mult(arow[k], brow[l][k], res[l]);
+                }
+                return res;
+            };
+
+            const lanes<T, N> acc = fold<lanes<T, N>>(product, combine, n, spec);
+            for (size_t l = 0; l < N; ++l)
+                c(i, j + l) = acc[l];
+        }
+
+        for (; j < j1; ++j)
+            c(i, j) = dot(arow, bt.row(j), n, spec);
+    }
+}
+} // namespace detail
+
+/*! @brief Произведение матриц a * b
+ *
+ * \details Элемент (i, j) результата - dot(строка i матрицы a, столбец j матрицы b, spec.order), поэтому результат
+ * побитово совпадает с наивным циклом в том же порядке накопления и не зависит от размеров блоков и количества
+ * потоков. Формат элементов результата - формат элементов a.
+ *
+ * b транспонируется один раз, чтобы столбцы лежали в памяти подряд. Результат делится на блоки
+ * block_rows x block_cols, которые распределяются по потокам; строки a и столбцы b блока переиспользуются из кэша.
+ * Внутри блока четыре соседних столбца накапливаются одновременно
+ *
+ * \param[in] a Матрица m x n
+ * \param[in] b Матрица n x p
+ * \param[in] spec Порядок накопления и размеры блоков
+ * \param[in] req_threads Количество потоков. 0 - по количеству ядер
+ */
+template <typename T>
+matrix<T> gemm(const matrix<T> &a, const matrix<T> &b, const gemm_spec &spec = gemm_spec(), idx_t req_threads = 0)
+{
+    assert(a.cols() == b.rows());
+    assert(spec.block_rows > 0 && spec.block_cols > 0);
+
+    const matrix<T> bt = b.transposed();
+    matrix<T> c(a(0, 0), a.rows(), b.cols());
+
+    const idx_t blocks_r = (a.rows() + spec.block_rows - 1) / spec.block_rows;
+    const idx_t blocks_c = (b.cols() + spec.block_cols - 1) / spec.block_cols;
+
+    run_tasks(blocks_r * blocks_c, req_threads, [&](idx_t task) {
+        const idx_t i0 = task / blocks_c * spec.block_rows, j0 = task % blocks_c * spec.block_cols;
+        detail::gemm_block(a, bt, c, i0, std::min(i0 + spec.block_rows, a.rows()), j0,
+                           std::min(j0 + spec.block_cols, b.cols()), spec.order);
+    });
+
+    return c;
+}
+
+} // namespace clib
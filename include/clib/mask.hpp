@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ImgView.hpp"
+
+namespace clib
+{
+
+/*!
+ * \brief Двумерная битовая маска
+ *
+ * \details Результат поэлементного сравнения изображений. Биты хранятся в одном непрерывном буфере машинных слов,
+ * каждая строка начинается с нового слова. Поэтому разные строки никогда не делят слово, и потоки, обрабатывающие
+ * разные полосы строк, могут записывать маску без синхронизации. Хвост последнего слова строки всегда нулевой
+ */
+class img_mask final
+{
+  public:
+    using idx_t = ImgView::idx_t;
+    using word_t = uint64_t;
+
+    static constexpr idx_t WORD_BITS = 64;
+
+  private:
+    idx_t rows_ = 0;
+    idx_t cols_ = 0;
+    idx_t stride_ = 0; // слов на строку
+
+    std::vector<word_t> words_;
+
+  public:
+    img_mask() = default;
+
+    /*! @brief Маска заданного размера
+     *
+     * \param[in] rows Количество строк
+     * \param[in] cols Количество столбцов
+     * \param[in] value Начальное значение всех битов
+     */
+    img_mask(idx_t rows, idx_t cols, bool value = false);
+
+    /*! @brief Маска из вложенных векторов
+     *
+     * \param[in] flags Прямоугольный массив флагов
+     */
+    explicit img_mask(const std::vector<std::vector<bool>> &flags);
+
+    idx_t rows() const noexcept
+    {
+        return rows_;
+    }
+    idx_t cols() const noexcept
+    {
+        return cols_;
+    }
+
+    /*! @brief Количество слов в строке
+     */
+    idx_t stride() const noexcept
+    {
+        return stride_;
+    }
+
+    /*! @brief Указатель на первое слово строки
+     *
+     * \param[in] i Номер строки
+     */
+    const word_t *row(idx_t i) const noexcept
+    {
+        return words_.data() + i * stride_;
+    }
+    word_t *row(idx_t i) noexcept
+    {
+        return words_.data() + i * stride_;
+    }
+
+    bool operator()(idx_t i, idx_t j) const noexcept
+    {
+        return (row(i)[j / WORD_BITS] >> (j % WORD_BITS)) & 1u;
+    }
+
+    void set(idx_t i, idx_t j, bool value) noexcept
+    {
+        word_t &word = row(i)[j / WORD_BITS];
+        const word_t bit = word_t(1) << (j % WORD_BITS);
+        word = value ? (word | bit) : (word & ~bit);
+    }
+
+    /*! @brief Количество установленных битов
+     */
+    idx_t count() const noexcept;
+
+    /*! @brief Установлен ли хотя бы один бит
+     */
+    bool any() const noexcept;
+
+    /*! @brief Установлены ли все биты
+     */
+    bool all() const noexcept;
+
+    /*! @brief Преобразование во вложенные векторы
+     */
+    std::vector<std::vector<bool>> to_vector() const;
+
+    img_mask &operator&=(const img_mask &rhs) noexcept;
+    img_mask &operator|=(const img_mask &rhs) noexcept;
+    img_mask &operator^=(const img_mask &rhs) noexcept;
+
+    img_mask operator~() const;
+
+    friend bool operator==(const img_mask &lhs, const img_mask &rhs) noexcept;
+
+  private:
+    // Маска битов, которые принадлежат изображению в последнем слове строки
+    word_t tail_mask() const noexcept;
+};
+
+img_mask operator&(img_mask lhs, const img_mask &rhs) noexcept;
+img_mask operator|(img_mask lhs, const img_mask &rhs) noexcept;
+img_mask operator^(img_mask lhs, const img_mask &rhs) noexcept;
+
+bool operator==(const img_mask &lhs, const img_mask &rhs) noexcept;
+bool operator!=(const img_mask &lhs, const img_mask &rhs) noexcept;
+
+} // namespace clib
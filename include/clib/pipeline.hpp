@@ -0,0 +1,346 @@
+#pragma once
+
+#include <functional>
+#include <unistd.h>
+
+#include "image.hpp"
+
+namespace clib
+{
+
+/*!
+ * \brief Цепочка поэлементных и трафаретных операций, выполняемая по тайлам
+ *
+ * \details Вместо того чтобы прогонять весь кадр через каждую операцию по очереди, изображение делится на тайлы,
+ * и вся цепочка выполняется для одного тайла, пока его данные лежат в кэше. Промежуточные результаты хранятся
+ * только в двух буферах потока, которые переиспользуются между стадиями и тайлами.
+ *
+ * Буфер стадии s покрывает тайл, расширенный на суммарный ореол оставшихся стадий, поэтому соседние тайлы
+ * пересчитывают общие края. Часть буфера за границей изображения заполняется так же, как это делает stencil
+ * (border), поэтому результат побитово совпадает с последовательным вызовом img<T>::stencil для каждой стадии.
+ * Тайлы обрабатываются параллельно
+ *
+ * Пример:
+ *
+ *     pipeline<T> p;
+ *     p.convolution(kernel).map(gamma).stencil({3, 3}, max3x3);
+ *     img<T> res = p.run(image);
+ */
+template <typename T> class pipeline
+{
+  public:
+    using window = typename img<T>::window;
+    using stage_func = std::function<T(const window &)>;
+
+  private:
+    struct stage
+    {
+        idx_t di, dj; // ореол: половина окна по строкам и столбцам
+        stage_func func;
+    };
+
+    // Прямоугольная часть промежуточного изображения. Координаты могут выходить за границы изображения
+    struct tile_buffer
+    {
+        long row0 = 0, col0 = 0;
+        idx_t rows = 0, cols = 0;
+
+        vector<T> data;
+        vector<const T *> lines;
+
+        void reshape(long r0, long c0, idx_t h, idx_t w, const T &prototype)
+        {
+            row0 = r0;
+            col0 = c0;
+            rows = h;
+            cols = w;
+            if (data.size() < h * w)
+                data.resize(h * w, prototype);
+
+            lines.resize(h);
+            for (idx_t k = 0; k < h; ++k)
+                lines[k] = data.data() + k * w;
+        }
+
+        T &at(long i, long j)
+        {
+            return data[static_cast<idx_t>(i - row0) * cols + static_cast<idx_t>(j - col0)];
+        }
+    };
+
+    // Полуинтервал [first, second)
+    using span = std::pair<long, long>;
+
+    vector<stage> stages_;
+    border_t border_;
+    T fill_;
+    idx_t tile_rows_ = 0, tile_cols_ = 0;
+
+  public:
+    /*!
+     * \param[in] border Способ доопределения за границами для всех трафаретных стадий
+     * \param[in] fill Значение за границами для border_t::constant
+     */
+    explicit pipeline(border_t border = border_t::mirror, const T &fill = T()) : border_(border), fill_(fill)
+    {
+    }
+
+    /*! @brief Добавляет поэлементную стадию
+     *
+     * \param[in] func Функция T(const T &)
+     */
+    pipeline &map(std::function<T(const T &)> func)
+    {
+        stages_.push_back({0, 0, [func](const window &w) { return func(w(0, 0)); }});
+        return *this;
+    }
+
+    /*! @brief Добавляет трафаретную стадию, аналог img<T>::stencil
+     *
+     * \param[in] shape Размер окна {строки, столбцы}. Оба размера нечетные
+     * \param[in] func Функция T(const window &)
+     */
+    pipeline &stencil(std::pair<idx_t, idx_t> shape, stage_func func)
+    {
+        assert(shape.first % 2 == 1);
+        assert(shape.second % 2 == 1);
+
+        stages_.push_back({shape.first / 2, shape.second / 2, std::move(func)});
+        return *this;
+    }
+
+    /*! @brief Добавляет свертку с постоянными коэффициентами, аналог img<T>::convolution
+     *
+     * \param[in] kernel Коэффициенты ядра. Размеры нечетные
+     */
+    pipeline &convolution(const vector<vector<T>> &kernel)
+    {
+        assert(!kernel.empty() && !kernel[0].empty());
+
+        const T ZERO = T::from_arithmetic_t(kernel[0][0], 0);
+        return stencil({kernel.size(), kernel[0].size()}, [kernel, ZERO](const window &w) {
+            T acc = ZERO;
+            for (idx_t a = 0; a < kernel.size(); ++a)
+                for (idx_t b = 0; b < kernel[0].size(); ++b)
+                {
+                    T tap = w(a, b);
+                    T::mult(kernel[a][b], tap, tap);
+                    T::sum(acc, tap, acc);
+                }
+            return acc;
+        });
+    }
+
+    /*! @brief Задает размер тайла вместо подобранного по размеру кэша L2
+     *
+     * \param[in] rows, cols Размер тайла. 0 - подобрать автоматически
+     */
+    pipeline &tile(idx_t rows, idx_t cols)
+    {
+        tile_rows_ = rows;
+        tile_cols_ = cols;
+        return *this;
+    }
+
+    idx_t stages() const
+    {
+        return stages_.size();
+    }
+
+    /*! @brief Суммарный ореол цепочки {строки, столбцы}
+     */
+    std::pair<idx_t, idx_t> halo() const
+    {
+        return halo_after(0);
+    }
+
+    /*! @brief Выполняет цепочку над изображением
+     *
+     * \param[in] image Изображение
+     * \param[in] req_threads Количество потоков. 0 - определить автоматически
+     */
+    img<T> run(const img<T> &image, idx_t req_threads = 0) const
+    {
+        assert(image.rows() != 0 && image.cols() != 0);
+
+        if (stages_.empty())
+            return image;
+
+        // Тайлы копируются из строк изображения
+        if (image.is_broadcast())
+            return run(image.dense(req_threads), req_threads);
+
+        for (const auto &st : stages_)
+        {
+            (void)st;
+            assert(border_ != border_t::mirror || (st.di < image.rows() && st.dj < image.cols()));
+        }
+
+        const std::pair<idx_t, idx_t> shape = tile_shape(image.rows(), image.cols());
+        const idx_t tiles_r = (image.rows() + shape.first - 1) / shape.first;
+        const idx_t tiles_c = (image.cols() + shape.second - 1) / shape.second;
+        const idx_t ntiles = tiles_r * tiles_c;
+
+        img<T> res(image(0, 0), image.rows(), image.cols());
+
+        const idx_t MIN_THREAD_WORK = 10000;
+        idx_t nthreads = req_threads;
+        if (req_threads == 0)
+            nthreads = img<T>::determine_threads(image.rows(), image.cols(),
+                                                 std::max(MIN_THREAD_WORK / stages_.size(), 1lu));
+        nthreads = std::min(nthreads, ntiles);
+
+        img<T>::work(nthreads, ntiles, [&](idx_t st_tile, idx_t en_tile) {
+            tile_buffer buf[2];
+            for (idx_t t = st_tile; t < en_tile; ++t)
+            {
+                const long r0 = static_cast<long>((t / tiles_c) * shape.first);
+                const long c0 = static_cast<long>((t % tiles_c) * shape.second);
+                const span rows = {r0, std::min(r0 + static_cast<long>(shape.first), static_cast<long>(image.rows()))};
+                const span cols = {c0, std::min(c0 + static_cast<long>(shape.second), static_cast<long>(image.cols()))};
+
+                run_tile(image, res, rows, cols, buf[0], buf[1]);
+            }
+        });
+
+        return res;
+    }
+
+    /*! @brief Выполняет цепочку над каждым каналом трёхцветного изображения
+     *
+     * \param[in] image Изображение
+     * \param[in] req_threads Количество потоков. 0 - определить автоматически
+     */
+    img_rgb<T> run(const img_rgb<T> &image, idx_t req_threads = 0) const
+    {
+        img_rgb<T> res;
+        res.r() = run(image.r(), req_threads);
+        res.g() = run(image.g(), req_threads);
+        res.b() = run(image.b(), req_threads);
+
+        return res;
+    }
+
+    /*! @brief Размер тайла для изображения rows x cols
+     *
+     * \details Если размер не задан через tile(), два буфера потока вместе с ореолом должны помещаться в L2
+     */
+    std::pair<idx_t, idx_t> tile_shape(idx_t rows, idx_t cols) const
+    {
+        idx_t th = tile_rows_, tw = tile_cols_;
+        if (th == 0 || tw == 0)
+        {
+            const std::pair<idx_t, idx_t> h = halo();
+
+            long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+            const idx_t cache = l2 > 0 ? static_cast<idx_t>(l2) : 256 * 1024;
+            const idx_t elems = std::max(cache / (2 * sizeof(T)), 1lu);
+
+            if (tw == 0)
+                tw = std::min(cols, 256lu);
+            if (th == 0)
+            {
+                const idx_t line = tw + 2 * h.second;
+                th = elems / line > 2 * h.first ? elems / line - 2 * h.first : 1;
+            }
+        }
+
+        return {std::min(std::max(th, 1lu), rows), std::min(std::max(tw, 1lu), cols)};
+    }
+
+  private:
+    // Суммарный ореол стадий, начиная с from
+    std::pair<idx_t, idx_t> halo_after(idx_t from) const
+    {
+        std::pair<idx_t, idx_t> h = {0, 0};
+        for (idx_t s = from; s < stages_.size(); ++s)
+        {
+            h.first += stages_[s].di;
+            h.second += stages_[s].dj;
+        }
+        return h;
+    }
+
+    // Область буфера: отрезок [lo - grow, hi + grow), из которого за пределы [0, n) выходит не больше margin
+    static span expand(span s, idx_t grow, idx_t margin, idx_t n)
+    {
+        const long g = static_cast<long>(grow), m = static_cast<long>(margin);
+        return {std::max(s.first - g, -m), std::min(s.second + g, static_cast<long>(n) + m)};
+    }
+
+    // Заполняет часть буфера за границей изображения значениями из его внутренней части
+    void fill_border(tile_buffer &buf, idx_t n_rows, idx_t n_cols) const
+    {
+        const long h = static_cast<long>(n_rows), w = static_cast<long>(n_cols);
+        for (long i = buf.row0; i < buf.row0 + static_cast<long>(buf.rows); ++i)
+        {
+            const bool row_out = i < 0 || i >= h;
+            for (long j = buf.col0; j < buf.col0 + static_cast<long>(buf.cols); ++j)
+            {
+                if (!row_out && j >= 0 && j < w)
+                    continue;
+
+                if (border_ == border_t::constant)
+                    buf.at(i, j) = fill_;
+                else
+                    buf.at(i, j) = buf.at(static_cast<long>(img<T>::remap(i, n_rows, border_)),
+                                          static_cast<long>(img<T>::remap(j, n_cols, border_)));
+            }
+        }
+    }
+
+    void run_tile(const img<T> &image, img<T> &res, span rows, span cols, tile_buffer &in, tile_buffer &out) const
+    {
+        const idx_t n_rows = image.rows(), n_cols = image.cols();
+        const T &prototype = image(0, 0);
+
+        // Исходные данные: тайл с полным ореолом, за границей - не дальше ореола первой стадии
+        {
+            const std::pair<idx_t, idx_t> h = halo_after(0);
+            const span r = expand(rows, h.first, stages_[0].di, n_rows);
+            const span c = expand(cols, h.second, stages_[0].dj, n_cols);
+            in.reshape(r.first, c.first, static_cast<idx_t>(r.second - r.first),
+                       static_cast<idx_t>(c.second - c.first), prototype);
+
+            const long j0 = std::max(c.first, 0l), j1 = std::min(c.second, static_cast<long>(n_cols));
+            for (long i = std::max(r.first, 0l); i < std::min(r.second, static_cast<long>(n_rows)); ++i)
+            {
+                const T *src = image.row(static_cast<idx_t>(i));
+                std::copy(src + j0, src + j1, &in.at(i, j0));
+            }
+            fill_border(in, n_rows, n_cols);
+        }
+
+        for (idx_t s = 0; s < stages_.size(); ++s)
+        {
+            const stage &st = stages_[s];
+            const bool last = s + 1 == stages_.size();
+
+            const std::pair<idx_t, idx_t> h = halo_after(s + 1);
+            const span r = last ? rows : expand(rows, h.first, stages_[s + 1].di, n_rows);
+            const span c = last ? cols : expand(cols, h.second, stages_[s + 1].dj, n_cols);
+            if (!last)
+                out.reshape(r.first, c.first, static_cast<idx_t>(r.second - r.first),
+                            static_cast<idx_t>(c.second - c.first), prototype);
+
+            // Вычисляется только часть внутри изображения, остальное доопределяется по border
+            const long i0 = std::max(r.first, 0l), i1 = std::min(r.second, static_cast<long>(n_rows));
+            const long j0 = std::max(c.first, 0l), j1 = std::min(c.second, static_cast<long>(n_cols));
+            for (long i = i0; i < i1; ++i)
+            {
+                const T *const *lines = in.lines.data() + (i - static_cast<long>(st.di) - in.row0);
+                T *dst = last ? res.row(static_cast<idx_t>(i)) + j0 : &out.at(i, j0);
+                for (long j = j0; j < j1; ++j)
+                    *dst++ = st.func(window(lines, static_cast<idx_t>(j - static_cast<long>(st.dj) - in.col0)));
+            }
+
+            if (!last)
+            {
+                fill_border(out, n_rows, n_cols);
+                std::swap(in, out);
+            }
+        }
+    }
+};
+
+} // namespace clib
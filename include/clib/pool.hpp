@@ -0,0 +1,132 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ImgView.hpp"
+
+namespace clib
+{
+
+/*! @brief Топология NUMA: логические процессоры каждого узла
+ *
+ * \details Читается из /sys/devices/system/node и ограничивается процессорами, разрешенными процессу
+ * (sched_getaffinity: taskset, cpuset контейнера). Если информации об узлах нет, считается, что узел один и содержит
+ * разрешенные процессоры
+ */
+struct numa_topology
+{
+    std::vector<std::vector<int>> node_cpus{};
+
+    static numa_topology detect();
+
+    /// Процессоры, на которых разрешено выполняться процессу. Пусто, если маску узнать не удалось
+    static std::vector<int> allowed_cpus();
+
+    /*! @brief Оставляет в узлах только процессоры из allowed. Узлы без процессоров удаляются
+     */
+    void restrict_to(const std::vector<int> &allowed);
+
+    /*! @brief Разбор списка процессоров в формате sysfs, например "0-3,8,10-11"
+     */
+    static std::vector<int> parse_cpulist(const std::string &list);
+};
+
+/*!
+ * \brief Пул рабочих потоков, закрепленных за узлами NUMA
+ *
+ * \details Рабочих потоков столько же, сколько процессоров в топологии (для detect - разрешенных процессу). Потоки
+ * упорядочены по узлам (сначала все потоки узла 0, затем узла 1 и т.д.), каждый закреплен за процессорами своего узла.
+ *
+ * Полоса строк отображается на рабочий поток по ее положению в изображении: полоса, начинающаяся со строки r
+ * изображения из rows строк, выполняется потоком r * workers() / rows. Отображение не зависит от количества полос,
+ * поэтому последовательные операции над изображением (конструктор, for_each, stencil, ...) обрабатывают одни и те же
+ * строки на одном и том же узле, а строки, выделенные в конструкторе, впервые записываются (first touch) потоком
+ * узла, который будет их обрабатывать.
+ *
+ * Вызов из рабочего потока пула выполняется в нем же последовательно, поэтому вложенный параллелизм не блокирует
+ * пул. Рабочие потоки наследуют текущую арену (frame_arena) вызывающего потока
+ */
+class thread_pool
+{
+  public:
+    using idx_t = ImgView::idx_t;
+    using band_func = std::function<void(idx_t, idx_t)>;
+    using task_func = std::function<void(idx_t)>;
+
+    /// Общий пул процесса. Создается при первом обращении
+    static thread_pool &instance();
+
+    explicit thread_pool(const numa_topology &topology, bool pin = true);
+    ~thread_pool();
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    idx_t workers() const noexcept
+    {
+        return workers_.size();
+    }
+
+    /// Узел NUMA рабочего потока
+    idx_t worker_node(idx_t worker) const
+    {
+        return workers_.at(worker)->node;
+    }
+
+    /// Рабочий поток закреплен за процессорами своего узла. false, если закрепление не запрошено или не удалось:
+    /// тогда поток выполняется на любом разрешенном процессоре
+    bool pinned(idx_t worker) const
+    {
+        return workers_.at(worker)->pinned;
+    }
+
+    /// Номер рабочего потока этого пула, выполняющего текущий код, или workers(), если это не рабочий поток
+    idx_t current_worker() const noexcept;
+
+    /// Рабочий поток для полосы, начинающейся со строки row изображения из rows строк
+    idx_t worker_for(idx_t row, idx_t rows) const noexcept
+    {
+        return rows == 0 ? 0 : row * workers() / rows;
+    }
+
+    /*! @brief Делит rows строк на nthreads полос (как img::work) и выполняет их на рабочих потоках
+     *
+     * \details Полосы по rows / nthreads строк, остаток - отдельной последней полосой. Возвращается после
+     * выполнения всех полос. Исключение из полосы передается вызывающему
+     */
+    void bands(idx_t nthreads, idx_t rows, const band_func &func);
+
+    /*! @brief Выполняет независимые задачи 0..tasks-1 на nthreads потоках
+     *
+     * \details Потоки забирают задачи по одной из общего счетчика, вызывающий поток тоже выполняет задачи, поэтому
+     * задачи разной длительности распределяются равномерно. Возвращается после выполнения всех задач. Первое
+     * исключение останавливает выдачу задач и передается вызывающему
+     */
+    void tasks(idx_t tasks, idx_t nthreads, const task_func &func);
+
+  private:
+    struct worker_state
+    {
+        idx_t node = 0;
+        bool pinned = false;
+        std::thread thread{};
+        std::mutex mutex{};
+        std::condition_variable cv{};
+        std::deque<std::function<void()>> queue{};
+        bool stop = false;
+    };
+
+    std::vector<std::unique_ptr<worker_state>> workers_;
+
+    void submit(idx_t worker, std::function<void()> task);
+    void loop(idx_t index);
+};
+
+} // namespace clib
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+
+#include "ImgView.hpp"
+
+namespace clib
+{
+
+/*! @brief Порядок свертки (редукции) двумерного массива
+ *
+ * \details Операции над T в общем случае не ассоциативны, поэтому результат редукции определяется порядком
+ * применения combine. Для каждого порядка результат не зависит от количества потоков
+ */
+enum class order_t
+{
+    /*! Каждая строка сворачивается по остаткам индекса по модулю modulus (как в img::sum), затем так же
+     * сворачиваются результаты строк. Если строк или столбцов меньше modulus - последовательно */
+    modulus,
+    /*! Массив рассматривается как одна строка (построчно) и сворачивается фиксированным бинарным деревом:
+     * отрезок делится пополам, пока его длина больше leaf; листья сворачиваются последовательно */
+    pairwise,
+    /*! Последовательно слева направо построчно, в одном потоке */
+    sequential
+};
+
+/*! @brief Спецификация порядка редукции
+ */
+struct order_spec
+{
+    order_t order = order_t::modulus;
+    ImgView::idx_t modulus = 3; ///< для order_t::modulus
+    ImgView::idx_t leaf = 16;   ///< для order_t::pairwise
+
+    order_spec() = default;
+    order_spec(order_t order_n, ImgView::idx_t modulus_n = 3, ImgView::idx_t leaf_n = 16)
+        : order(order_n), modulus(modulus_n), leaf(leaf_n)
+    {
+    }
+};
+
+/*! @brief Свертка at(k), k = 0..n - 1, по остаткам индекса по модулю modulus (см. img::sum), n >= modulus
+ *
+ * \param[in] at Функция T(idx_t k)
+ * \param[in] combine Функция void(const T &lhs, const T &rhs, T &res). res может совпадать с lhs или rhs
+ */
+template <typename T, typename At, typename Combine>
+T modulus_fold(At at, Combine combine, ImgView::idx_t n, ImgView::idx_t modulus)
+{
+    using idx_t = ImgView::idx_t;
+
+    std::vector<T> part_sums;
+    part_sums.reserve(modulus);
+    for (idx_t j = 0; j < modulus; ++j)
+        part_sums.push_back(at(j));
+
+    for (idx_t j = modulus; j < n; ++j)
+        combine(at(j), part_sums[j % modulus], part_sums[j % modulus]);
+
+    // Собираем промежуточные суммы для разных остатков по модулю
+    auto st_indx = (n - modulus) % modulus;
+    T ans = part_sums[st_indx];
+    for (idx_t j = 1; j < modulus; ++j)
+        combine(part_sums[(st_indx + j) % modulus], ans, ans);
+
+    return ans;
+}
+
+/*! @brief Последовательная свертка at(k), k = lo..hi - 1
+ */
+template <typename T, typename At, typename Combine>
+T sequential_fold(At at, Combine combine, ImgView::idx_t lo, ImgView::idx_t hi)
+{
+    assert(lo < hi);
+
+    T acc = at(lo);
+    for (ImgView::idx_t k = lo + 1; k < hi; ++k)
+        combine(acc, at(k), acc);
+
+    return acc;
+}
+
+/*! @brief Свертка отрезка [lo, hi) деревом: пополам, пока длина больше leaf
+ */
+template <typename T, typename At, typename Combine>
+T tree_fold(At at, Combine combine, ImgView::idx_t lo, ImgView::idx_t hi, ImgView::idx_t leaf)
+{
+    if (hi - lo <= leaf)
+        return sequential_fold<T>(at, combine, lo, hi);
+
+    const ImgView::idx_t mid = lo + (hi - lo) / 2;
+    T left = tree_fold<T>(at, combine, lo, mid, leaf);
+    T right = tree_fold<T>(at, combine, mid, hi, leaf);
+    combine(left, right, left);
+
+    return left;
+}
+
+/*! @brief Свертка одномерного массива at(k), k = 0..n - 1, в порядке spec
+ *
+ * \details Порядки те же, что для строки изображения: modulus - по остаткам индекса (последовательно, если
+ * n < modulus), pairwise - деревом с листом leaf, sequential - слева направо
+ */
+template <typename T, typename At, typename Combine>
+T fold(At at, Combine combine, ImgView::idx_t n, const order_spec &spec = order_spec())
+{
+    assert(n != 0);
+
+    switch (spec.order)
+    {
+    case order_t::sequential:
+        return sequential_fold<T>(at, combine, 0, n);
+    case order_t::pairwise:
+        assert(spec.leaf > 0);
+        return tree_fold<T>(at, combine, 0, n, spec.leaf);
+    case order_t::modulus:
+    default:
+        assert(spec.modulus > 0);
+        if (n < spec.modulus)
+            return sequential_fold<T>(at, combine, 0, n);
+        return modulus_fold<T>(at, combine, n, spec.modulus);
+    }
+}
+
+} // namespace clib
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+#include "Flexfloat.hpp"
+#include "image.hpp"
+
+namespace clib
+{
+
+/*! @brief Параметры сбора статистики
+ */
+struct stats_spec
+{
+    idx_t bins = 0;       ///< количество интервалов гистограммы значений. 0 - не строить
+    float lo = 0.0f;      ///< нижняя граница гистограммы значений
+    float hi = 256.0f;    ///< верхняя граница гистограммы значений (не включается)
+    idx_t block_rows = 0; ///< высота блока сетки. 0 - сетка не строится
+    idx_t block_cols = 0; ///< ширина блока сетки. 0 - сетка не строится
+};
+
+/*! @brief Статистика области изображения
+ */
+template <typename T> struct block_stats
+{
+    T min, max;
+    T sum, sum_sq; ///< сумма и сумма квадратов. Квадраты вычисляются в формате элемента
+    idx_t count = 0;
+
+    /*! @brief Среднее, вычисляется так же, как img::mean
+     */
+    T mean() const
+    {
+        return scale(sum);
+    }
+
+    /*! @brief Дисперсия mean(x^2) - mean(x)^2
+     */
+    T variance() const
+    {
+        T mu = mean();
+        T mu_sq = mu;
+        T::mult(mu, mu, mu_sq);
+
+        T res = scale(sum_sq);
+        T::sub(res, mu_sq, res);
+        return res;
+    }
+
+  private:
+    T scale(const T &val) const
+    {
+        assert(count != 0);
+
+        T res = val;
+        T volume = T::from_arithmetic_t(val, count);
+        T inv_volume = T::from_arithmetic_t(val, 0lu);
+        T::inv(volume, inv_volume);
+        T::mult(res, inv_volume, res);
+        return res;
+    }
+};
+
+/*! @brief Статистика изображения: min, max, sum, сумма квадратов, гистограммы и сетка блоков
+ */
+template <typename T> struct img_stats : block_stats<T>
+{
+    int exp_min = 0;        ///< экспонента exp_hist[0] (см. stats_exponent_min)
+    vector<idx_t> exp_hist; ///< гистограмма по экспоненте: exp_hist[k] - значения с stats_exponent = exp_min + k
+
+    vector<idx_t> hist;  ///< гистограмма значений, stats_spec::bins равных интервалов [lo, hi)
+    idx_t underflow = 0; ///< значения меньше lo
+    idx_t overflow = 0;  ///< значения не меньше hi
+
+    idx_t grid_rows = 0, grid_cols = 0;
+    vector<block_stats<T>> grid; ///< статистика блоков построчно, grid_rows * grid_cols
+
+    const block_stats<T> &block(idx_t i, idx_t j) const
+    {
+        return grid[i * grid_cols + j];
+    }
+};
+
+/*! @brief Наименьшая экспонента для гистограммы Flexfloat, см. stats_exponent
+ */
+inline int stats_exponent_min(const Flexfloat &)
+{
+    return 0;
+}
+
+/*! @brief Наименьшая экспонента для гистограммы: на 1 меньше ilogb наименьшего денормализованного float
+ */
+template <typename T> int stats_exponent_min(const T &)
+{
+    return std::numeric_limits<float>::min_exponent - std::numeric_limits<float>::digits - 1;
+}
+
+/*! @brief Экспонента для гистограммы: смещенное поле экспоненты (0 - ноль и денормализованные числа)
+ */
+inline int stats_exponent(const Flexfloat &val)
+{
+    return val.get_e();
+}
+
+/*! @brief Экспонента для гистограммы: ilogb(val), stats_exponent_min для нуля
+ */
+template <typename T> int stats_exponent(const T &val)
+{
+    const float flt = val.to_float();
+    return flt == 0.0f ? stats_exponent_min(val) : std::ilogb(flt);
+}
+
+/*!
+ * \brief Сбор статистики изображения за один проход
+ *
+ * \details Строки распределяются по потокам (при построении сетки - полосами высотой в блок). Для каждой строки
+ * считаются частичные min, max, sum и sum_sq, затем они сворачиваются в порядке строк: sum и sum_sq в порядке
+ * order_t::modulus, как img::sum, поэтому profile(image).sum == image.sum(). Блок сетки целиком принадлежит
+ * одному потоку и сворачивается последовательно построчно. Гистограммы - счетчики, их порядок слияния не важен.
+ * Результат не зависит от количества потоков
+ */
+template <typename T> class profiler
+{
+    using partial = block_stats<T>;
+
+    // Частичные гистограммы потока. Экспоненты ограничены форматом, поэтому exp_hist - массив от exp_min, который
+    // растет до наибольшей встреченной экспоненты
+    struct counters
+    {
+        int exp_min = 0;
+        vector<idx_t> exp_hist;
+        vector<idx_t> hist;
+        idx_t underflow = 0, overflow = 0;
+    };
+
+  public:
+    static img_stats<T> run(const img<T> &image, const stats_spec &spec = stats_spec(), idx_t req_threads = 0)
+    {
+        assert(image.rows() != 0 && image.cols() != 0);
+        assert(spec.bins == 0 || spec.lo < spec.hi);
+
+        if (image.is_broadcast())
+            return run(image.dense(req_threads), spec, req_threads);
+
+        const idx_t rows = image.rows(), cols = image.cols();
+        const bool with_grid = spec.block_rows != 0 && spec.block_cols != 0;
+
+        img_stats<T> res;
+        if (with_grid)
+        {
+            res.grid_rows = (rows + spec.block_rows - 1) / spec.block_rows;
+            res.grid_cols = (cols + spec.block_cols - 1) / spec.block_cols;
+            res.grid.resize(res.grid_rows * res.grid_cols);
+        }
+
+        // Единица работы - строка или полоса блоков
+        const idx_t band = with_grid ? spec.block_rows : 1;
+        const idx_t units = (rows + band - 1) / band;
+
+        const idx_t MIN_THREAD_WORK = 4000;
+        idx_t nthreads = req_threads;
+        if (req_threads == 0)
+            nthreads = img<T>::determine_threads(rows, cols, MIN_THREAD_WORK);
+        nthreads = std::min(nthreads, units);
+
+        vector<partial> lines(rows);
+
+        if (spec.bins != 0)
+            res.hist.assign(spec.bins, 0);
+        res.exp_min = stats_exponent_min(image(0, 0));
+        std::mutex merge_mutex;
+
+        img<T>::work(nthreads, units, [&](idx_t st_unit, idx_t en_unit) {
+            counters cnt;
+            cnt.exp_min = res.exp_min;
+            if (spec.bins != 0)
+                cnt.hist.assign(spec.bins, 0);
+
+            for (idx_t u = st_unit; u < en_unit; ++u)
+                for (idx_t i = u * band; i < std::min((u + 1) * band, rows); ++i)
+                {
+                    const T *line = image.row(i);
+                    lines[i] = fold_line(line, cols);
+
+                    for (idx_t j = 0; j < cols; ++j)
+                    {
+                        count(line[j], spec, cnt);
+                        if (with_grid)
+                            accumulate(res.grid[(i / spec.block_rows) * res.grid_cols + j / spec.block_cols], line[j]);
+                    }
+                }
+
+            // Счетчики складываются, поэтому порядок слияния потоков не важен
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            if (res.exp_hist.size() < cnt.exp_hist.size())
+                res.exp_hist.resize(cnt.exp_hist.size(), 0);
+            for (idx_t k = 0; k < cnt.exp_hist.size(); ++k)
+                res.exp_hist[k] += cnt.exp_hist[k];
+            for (idx_t k = 0; k < cnt.hist.size(); ++k)
+                res.hist[k] += cnt.hist[k];
+            res.underflow += cnt.underflow;
+            res.overflow += cnt.overflow;
+        });
+
+        // Слияние строк в порядке строк
+        const idx_t modulus = order_spec().modulus;
+        if (rows < modulus || cols < modulus)
+        {
+            // Как в img::sum: последовательно, начиная с нуля
+            res.sum = T::from_arithmetic_t(image(0, 0), 0.0f);
+            res.sum_sq = res.sum;
+            for (idx_t i = 0; i < rows; ++i)
+                for (idx_t j = 0; j < cols; ++j)
+                {
+                    T::sum(res.sum, image(i, j), res.sum);
+                    T::sum(res.sum_sq, square(image(i, j)), res.sum_sq);
+                }
+        }
+        else
+        {
+            auto sum_op = [](const T &lhs, const T &rhs, T &out) { T::sum(lhs, rhs, out); };
+            res.sum = modulus_fold<T>([&](idx_t k) -> const T & { return lines[k].sum; }, sum_op, rows, modulus);
+            res.sum_sq =
+                modulus_fold<T>([&](idx_t k) -> const T & { return lines[k].sum_sq; }, sum_op, rows, modulus);
+        }
+
+        res.min = lines[0].min;
+        res.max = lines[0].max;
+        for (idx_t i = 1; i < rows; ++i)
+        {
+            T::min(res.min, lines[i].min, res.min);
+            T::max(res.max, lines[i].max, res.max);
+        }
+        res.count = rows * cols;
+
+        return res;
+    }
+
+    static vector<img_stats<T>> run(const img_rgb<T> &image, const stats_spec &spec = stats_spec(),
+                                    idx_t req_threads = 0)
+    {
+        return {run(image.r(), spec, req_threads), run(image.g(), spec, req_threads),
+                run(image.b(), spec, req_threads)};
+    }
+
+  private:
+    static T square(const T &val)
+    {
+        T res = val;
+        T::mult(val, val, res);
+        return res;
+    }
+
+    // Частичная статистика строки: sum и sum_sq по остаткам по модулю, как в img::sum
+    static partial fold_line(const T *line, idx_t cols)
+    {
+        partial res;
+        res.min = line[0];
+        res.max = line[0];
+        for (idx_t j = 1; j < cols; ++j)
+        {
+            T::min(res.min, line[j], res.min);
+            T::max(res.max, line[j], res.max);
+        }
+
+        const idx_t modulus = order_spec().modulus;
+        if (cols >= modulus)
+        {
+            auto sum_op = [](const T &lhs, const T &rhs, T &out) { T::sum(lhs, rhs, out); };
+            res.sum = modulus_fold<T>([line](idx_t j) -> const T & { return line[j]; }, sum_op, cols, modulus);
+            res.sum_sq = modulus_fold<T>([line](idx_t j) { return square(line[j]); }, sum_op, cols, modulus);
+        }
+        res.count = cols;
+
+        return res;
+    }
+
+    static void accumulate(partial &block, const T &val)
+    {
+        if (block.count == 0)
+        {
+            block.min = val;
+            block.max = val;
+            block.sum = val;
+            block.sum_sq = square(val);
+        }
+        else
+        {
+            T::min(block.min, val, block.min);
+            T::max(block.max, val, block.max);
+            T::sum(block.sum, val, block.sum);
+            T::sum(block.sum_sq, square(val), block.sum_sq);
+        }
+        ++block.count;
+    }
+
+    static void count(const T &val, const stats_spec &spec, counters &cnt)
+    {
+        const auto exp = static_cast<idx_t>(stats_exponent(val) - cnt.exp_min);
+        if (exp >= cnt.exp_hist.size())
+            cnt.exp_hist.resize(exp + 1, 0);
+        ++cnt.exp_hist[exp];
+
+        if (spec.bins == 0)
+            return;
+
+        const float flt = val.to_float();
+        if (flt < spec.lo)
+            ++cnt.underflow;
+        else if (flt >= spec.hi)
+            ++cnt.overflow;
+        else
+        {
+            auto bin = static_cast<idx_t>((flt - spec.lo) / (spec.hi - spec.lo) * static_cast<float>(spec.bins));
+            ++cnt.hist[std::min(bin, spec.bins - 1)];
+        }
+    }
+};
+
+/*! @brief Статистика изображения за один проход, см. profiler
+ *
+ * \param[in] image Изображение
+ * \param[in] spec Параметры гистограммы и сетки
+ * \param[in] req_threads Количество потоков. 0 - определить автоматически
+ */
+template <typename T>
+img_stats<T> profile(const img<T> &image, const stats_spec &spec = stats_spec(), idx_t req_threads = 0)
+{
+    return profiler<T>::run(image, spec, req_threads);
+}
+
+/*! @brief Поканальная статистика трёхцветного изображения {R, G, B}
+ */
+template <typename T>
+vector<img_stats<T>> profile(const img_rgb<T> &image, const stats_spec &spec = stats_spec(), idx_t req_threads = 0)
+{
+    return profiler<T>::run(image, spec, req_threads);
+}
+
+} // namespace clib
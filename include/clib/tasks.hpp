@@ -0,0 +1,183 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ImgView.hpp"
+#include "arena.hpp"
+#include "pool.hpp"
+
+namespace clib
+{
+
+using idx_t = ImgView::idx_t;
+
+/*! @brief Выполняет независимые задачи 0..tasks-1, динамически распределяя их по потокам
+ *
+ * \details Задачи выполняются на рабочих потоках общего пула (thread_pool::instance), поэтому повторные вызовы,
+ * например по уровню графа на каждый кадр, не создают потоков. Потоки забирают задачи по одной из общего счетчика,
+ * поэтому задачи разной длительности распределяются равномерно. Вызывающий поток тоже выполняет задачи, рабочие
+ * потоки наследуют его текущую арену
+ *
+ * \param[in] tasks Количество задач
+ * \param[in] req_threads Количество потоков. 0 - по количеству рабочих потоков пула
+ * \param[in] func Задача, вызывается как func(idx_t task)
+ */
+template <typename Func> void run_tasks(idx_t tasks, idx_t req_threads, Func func)
+{
+    if (tasks == 0)
+        return;
+
+    thread_pool &pool = thread_pool::instance();
+    pool.tasks(tasks, req_threads != 0 ? req_threads : pool.workers(), func);
+}
+
+/*! @brief Трехстадийный конвейер с ограниченной очередью: чтение -> обработка -> запись
+ *
+ * \details Стадии выполняются одновременно: produce - в отдельном потоке, process - в workers потоках, consume - в
+ * вызывающем потоке. Элементы передаются через кольцо из depth ячеек, поэтому одновременно существует не более depth
+ * элементов: produce ждет, пока consume освободит ячейку. Обработка идет в нескольких потоках, но consume получает
+ * элементы строго в порядке produce. Пропускная способность ограничена самой медленной стадией.
+ *
+ * Исключение из любой стадии останавливает конвейер и передается вызывающему после завершения всех потоков.
+ * Рабочие потоки наследуют текущую арену вызывающего потока
+ *
+ * \param[in] produce Функция bool(Item &item): заполняет item и возвращает true или возвращает false в конце
+ * \param[in] process Функция void(Item &item), обрабатывает элемент на месте
+ * \param[in] consume Функция void(idx_t index, Item &item), index - номер элемента от 0
+ * \param[in] workers Количество потоков обработки. 0 - по количеству ядер
+ * \param[in] depth Количество ячеек кольца. 0 - workers * 2
+ *
+ * \return Количество элементов
+ */
+template <typename Item, typename Produce, typename Process, typename Consume>
+idx_t run_ordered(Produce produce, Process process, Consume consume, idx_t workers = 0, idx_t depth = 0)
+{
+    if (workers == 0)
+    {
+        idx_t hard_conc = std::thread::hardware_concurrency();
+        workers = hard_conc != 0 ? hard_conc : 2;
+    }
+    if (depth == 0)
+        depth = workers * 2;
+    assert(depth > 0);
+
+    std::vector<Item> items(depth);
+    std::vector<char> ready(depth, 0);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    idx_t produced = 0, taken = 0, consumed = 0;
+    bool eof = false;
+    std::exception_ptr error;
+
+    // Первое исключение останавливает все стадии
+    auto fail = [&](std::exception_ptr err) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error)
+            error = err;
+        cv.notify_all();
+    };
+
+    frame_arena *arena = current_arena();
+
+    std::thread producer([&]() {
+        arena_scope scope(arena);
+        try
+        {
+            while (true)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return produced - consumed < depth || error; });
+                if (error)
+                    return;
+
+                // Ячейка свободна, пока consume не дойдет до нее снова; заполняется без блокировки
+                const idx_t index = produced;
+                lock.unlock();
+                const bool more = produce(items[index % depth]);
+                lock.lock();
+
+                if (!more)
+                {
+                    eof = true;
+                    cv.notify_all();
+                    return;
+                }
+                ++produced;
+                cv.notify_all();
+            }
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        }
+    });
+
+    auto worker = [&]() {
+        arena_scope scope(arena);
+        try
+        {
+            while (true)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return taken < produced || eof || error; });
+                if (error || taken == produced)
+                    return;
+
+                const idx_t index = taken++;
+                lock.unlock();
+                process(items[index % depth]);
+                lock.lock();
+
+                ready[index % depth] = 1;
+                cv.notify_all();
+            }
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (idx_t th = 0; th < workers; ++th)
+        threads.emplace_back(worker);
+
+    try
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return ready[consumed % depth] || (eof && consumed == produced) || error; });
+            if (error || !ready[consumed % depth])
+                break;
+
+            lock.unlock();
+            consume(consumed, items[consumed % depth]);
+            lock.lock();
+
+            ready[consumed % depth] = 0;
+            ++consumed;
+            cv.notify_all();
+        }
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+    }
+
+    producer.join();
+    for (auto &th : threads)
+        th.join();
+
+    if (error)
+        std::rethrow_exception(error);
+
+    return consumed;
+}
+
+} // namespace clib
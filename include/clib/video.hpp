@@ -5,9 +5,13 @@
 
 #include "CImg.h"
 #include "image.hpp"
+#include "pipeline.hpp"
+#include "tasks.hpp"
 #include "video.hpp"
 
+#include "VideoReader.hpp"
 #include "VideoView.hpp"
+#include "VideoWriter.hpp"
 
 namespace clib
 {
@@ -16,7 +20,7 @@ using std::vector;
 using idx_t = VideoView::idx_t;
 template <typename T> class video
 {
-    vector<img_rgb<T>> frames_;
+    vector<img_rgb<T>> frames_{};
 
   public:
     /*! @brief Инициализации изображения из Представления
@@ -41,16 +45,34 @@ template <typename T> class video
         work(
             nthreads, view.frames(),
             [&](idx_t st_fr, idx_t en_fr, idx_t rows, idx_t cols) {
+                vector<VideoView::pixel_t> buf(rows * cols);
                 for (idx_t fr = st_fr; fr < en_fr; ++fr)
                 {
                     auto cur_img = img_rgb<T>(prototype, rows, cols, 1);
                     for (idx_t clr = 0; clr < 3; ++clr)
-                        for (idx_t i = 0; i < rows; ++i)
-                            for (idx_t j = 0; j < cols; ++j)
-                            {
-                                auto val = T::from_arithmetic_t(prototype, static_cast<int>(view.get(i, j, clr, fr)));
-                                cur_img(i, j, clr) = val;
-                            }
+                    {
+                        auto fill = [&](const auto *plane) {
+                            for (idx_t i = 0; i < rows; ++i)
+                                for (idx_t j = 0; j < cols; ++j)
+                                    cur_img(i, j, clr) =
+                                        T::from_arithmetic_t(prototype, static_cast<int>(plane[i * cols + j]));
+                        };
+
+                        // Отсчеты переводятся в T прямо из хранилища Представления; иначе плоскость кадра читается
+                        // одним вызовом
+                        const void *samples = view.samples(clr, fr);
+                        if (samples != nullptr && view.sample_type() == sample_t::u8)
+                            fill(static_cast<const uint8_t *>(samples));
+                        else if (samples != nullptr && view.sample_type() == sample_t::u16)
+                            fill(static_cast<const uint16_t *>(samples));
+                        else if (samples != nullptr && view.sample_type() == sample_t::i32)
+                            fill(static_cast<const int *>(samples));
+                        else
+                        {
+                            view.read_plane(clr, fr, buf.data(), cols);
+                            fill(buf.data());
+                        }
+                    }
                     frames_[fr] = std::move(cur_img);
                 }
             },
@@ -77,6 +99,97 @@ template <typename T> class video
         frames_ = frames;
     }
 
+    /*! @brief Инициализация кадрами из потока
+     *
+     * \details Кадры декодируются по одному (см. VideoReader), поэтому в памяти, кроме кадров video, держится только
+     * буфер декодера
+     *
+     * \param[in] prototype Элемент, из которого берутся гиперпараметры
+     * \param[in] reader Поток. Читается с текущей позиции
+     * \param[in] max_frames Наибольшее количество кадров. 0 - до конца потока
+     */
+    video(const T &prototype, VideoReader &reader, idx_t max_frames = 0)
+    {
+        if (reader.info().frames != 0)
+            frames_.reserve(max_frames != 0 ? std::min(max_frames, reader.info().frames) : reader.info().frames);
+
+        for_each_frame(prototype, reader, [this](idx_t, img_rgb<T> &frame) { frames_.push_back(std::move(frame)); },
+                       max_frames);
+        assert(!frames_.empty());
+    }
+
+    /*! @brief Обрабатывает кадры потока по одному, не сохраняя их
+     *
+     * \details В памяти одновременно находятся один кадр img_rgb<T> и буфер декодера, независимо от длины ролика
+     *
+     * \param[in] prototype Элемент, из которого берутся гиперпараметры
+     * \param[in] reader Поток. Читается с текущей позиции
+     * \param[in] func Функция void(idx_t frame, img_rgb<T> &image)
+     * \param[in] max_frames Наибольшее количество кадров. 0 - до конца потока
+     *
+     * \return Количество обработанных кадров
+     */
+    template <typename Func>
+    static idx_t for_each_frame(const T &prototype, VideoReader &reader, Func func, idx_t max_frames = 0)
+    {
+        assert(reader.clrs() == 3);
+
+        idx_t count = 0;
+        while ((max_frames == 0 || count < max_frames) && reader.next())
+        {
+            img_rgb<T> frame(prototype, reader.view());
+            func(count, frame);
+            ++count;
+        }
+        return count;
+    }
+
+    /*! @brief Конвейер декодирование -> обработка -> кодирование
+     *
+     * \details Стадии выполняются одновременно (см. run_ordered): reader декодирует следующий кадр, пока workers
+     * потоков обрабатывают предыдущие, а вызывающий поток кодирует готовые кадры в writer строго в исходном порядке.
+     * В памяти одновременно находится не более depth кадров img_rgb<T>
+     *
+     * \param[in] prototype Элемент, из которого берутся гиперпараметры
+     * \param[in] reader Поток. Читается с текущей позиции
+     * \param[in] writer Поток записи с размером кадра reader
+     * \param[in] process Функция img_rgb<T>(const img_rgb<T> &frame)
+     * \param[in] workers Количество кадров, обрабатываемых одновременно. 0 - по количеству ядер
+     * \param[in] depth Наибольшее количество кадров в конвейере. 0 - workers * 2
+     *
+     * \return Количество записанных кадров
+     */
+    template <typename Func>
+    static idx_t transcode(const T &prototype, VideoReader &reader, VideoWriter &writer, Func process,
+                           idx_t workers = 0, idx_t depth = 0)
+    {
+        assert(reader.rows() == writer.rows());
+        assert(reader.cols() == writer.cols());
+
+        return run_ordered<img_rgb<T>>(
+            [&](img_rgb<T> &frame) {
+                if (!reader.next())
+                    return false;
+                frame = img_rgb<T>(prototype, reader.view(), 1);
+                return true;
+            },
+            [&](img_rgb<T> &frame) { frame = process(frame); },
+            [&](idx_t, img_rgb<T> &frame) {
+                frame.write(writer.view());
+                writer.write_frame();
+            },
+            workers, depth);
+    }
+
+    /// Конвейер с цепочкой операций над каждым кадром
+    static idx_t transcode(const T &prototype, VideoReader &reader, VideoWriter &writer, const pipeline<T> &pipe,
+                           idx_t workers = 0, idx_t depth = 0)
+    {
+        return transcode(
+            prototype, reader, writer, [&pipe](const img_rgb<T> &frame) { return pipe.run(frame, 1); }, workers,
+            depth);
+    }
+
     void write(VideoView &view)
     {
         assert(view.rows() == rows());
@@ -90,18 +203,87 @@ template <typename T> class video
         work(
             nthreads, view.frames(),
             [&](idx_t st_fr, idx_t en_fr, idx_t rows, idx_t cols) {
+                vector<VideoView::pixel_t> buf(rows * cols);
                 for (idx_t fr = st_fr; fr < en_fr; ++fr)
                     for (idx_t clr = 0; clr < 3; ++clr)
+                    {
+                        // Плоскость кадра записывается одним вызовом или сразу на место
+                        VideoView::pixel_t *plane = view.data(clr, fr);
+                        const bool direct = plane != nullptr;
+                        if (!direct)
+                            plane = buf.data();
+
+                        const img_rgb<T> &frame = frames_[fr];
                         for (idx_t i = 0; i < rows; ++i)
                             for (idx_t j = 0; j < cols; ++j)
-                            {
-                                auto val = frames_[fr](i, j, clr).to_int();
-                                view.set(val, i, j, clr, fr);
-                            }
+                                plane[i * cols + j] = frame(i, j, clr).to_int();
+
+                        if (!direct)
+                            view.write_plane(clr, fr, buf.data(), cols);
+                    }
             },
             view.rows(), view.cols());
     }
 
+    /*! @brief Выполняет цепочку операций над каждым кадром
+     *
+     * \details Если кадров не меньше, чем потоков пула, кадры распределяются по потокам и каждый кадр считается в
+     * своем потоке. Иначе кадры обрабатываются по очереди, и тайлы кадра делят все потоки пула: вложенная работа пула
+     * выполняется в вызвавшем потоке, поэтому потоки, оставшиеся без кадра, простаивали бы
+     *
+     * \param[in] pipe Цепочка операций
+     */
+    video<T> apply(const pipeline<T> &pipe) const
+    {
+        vector<img_rgb<T>> res(frames_.size());
+
+        const idx_t workers = thread_pool::instance().workers();
+        if (frames_.size() < workers)
+        {
+            for (idx_t fr = 0; fr < frames_.size(); ++fr)
+                res[fr] = pipe.run(frames_[fr], workers);
+        }
+        else
+            work(workers, frames_.size(), [&](idx_t st_fr, idx_t en_fr) {
+                for (idx_t fr = st_fr; fr < en_fr; ++fr)
+                    res[fr] = pipe.run(frames_[fr], 1);
+            });
+
+        return video<T>(res);
+    }
+
+    /*! @brief Свертка всех отсчетов видео функцией combine в порядке spec
+     *
+     * \details Видео рассматривается как массив из frames * 3 * rows строк: кадры по порядку, внутри кадра каналы
+     * R, G, B, внутри канала строки. Порядок и гарантии те же, что у img<T>::transform_reduce
+     *
+     * \param[in] combine Функция void(const T &lhs, const T &rhs, T &res)
+     * \param[in] spec Порядок свертки
+     */
+    template <typename Combine>
+    T reduce(Combine combine, const order_spec &spec = order_spec(), idx_t req_threads = 0) const
+    {
+        const idx_t h = rows();
+        auto elem = [&](idx_t i, idx_t j) -> const T & { return frames_[i / (3 * h)][(i / h) % 3](i % h, j); };
+
+        return img<T>::transform_reduce(frames() * 3 * h, cols(), elem, combine, spec, req_threads);
+    }
+
+    T sum(const order_spec &spec = order_spec(), idx_t req_threads = 0) const
+    {
+        return reduce([](const T &lhs, const T &rhs, T &res) { T::sum(lhs, rhs, res); }, spec, req_threads);
+    }
+
+    T minimum(const order_spec &spec = order_spec(), idx_t req_threads = 0) const
+    {
+        return reduce([](const T &lhs, const T &rhs, T &res) { T::min(lhs, rhs, res); }, spec, req_threads);
+    }
+
+    T maximum(const order_spec &spec = order_spec(), idx_t req_threads = 0) const
+    {
+        return reduce([](const T &lhs, const T &rhs, T &res) { T::max(lhs, rhs, res); }, spec, req_threads);
+    }
+
     // rows - height of image
     idx_t rows() const
     {
@@ -134,7 +316,7 @@ template <typename T> class video
     }
 
   private:
-    // Выполняет func над this, разделяя работу на nthreads потоков
+    // Выполняет func над this, разделяя кадры на nthreads полос, на рабочих потоках общего пула (см. thread_pool)
     // Пример использования в ctor
     template <typename Func, typename... Args> static void work(idx_t nthreads, idx_t frames, Func func, Args... args)
     {
@@ -147,23 +329,7 @@ template <typename T> class video
             return;
         }
 
-        vector<std::thread> threads(nthreads);
-        idx_t bsize = std::max(frames / nthreads, 1lu);
-
-        /////////////////// Создаем потоки ///////////////////
-        idx_t tidx = 0;
-        idx_t last_fr = 0;
-        for (; frames >= bsize * (tidx + 1) && tidx < nthreads; last_fr += bsize, tidx += 1)
-            threads[tidx] = std::thread(func, last_fr, last_fr + bsize, args...);
-
-        // Обрабатываем остаток работ
-        auto remainder = frames - bsize * tidx;
-        if (remainder > 0)
-            func(last_fr, frames, args...);
-
-        // Ждем потоки
-        for (idx_t th = 0; th < tidx; ++th)
-            threads[th].join();
+        thread_pool::instance().bands(nthreads, frames, [&](idx_t st, idx_t en) { func(st, en, args...); });
     }
 
     // Определение оптимального количество потоков
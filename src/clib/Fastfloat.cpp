@@ -0,0 +1,213 @@
+#include "clib/Fastfloat.hpp"
+#include "clib/logs.hpp"
+
+namespace clib
+{
+
+Fastfloat::Fastfloat(Etype E_n, Mtype M_n, Btype B_n, float value, rounding rnd)
+    : v_(0.0f), E_(E_n), M_(M_n), rnd_(rnd), B_(B_n)
+{
+    if (!fits(E_n, M_n, B_n))
+        throw std::runtime_error{"Fastfloat: format does not fit into float"};
+
+    v_ = quantize(value);
+}
+
+bool Fastfloat::fits(Etype E, Mtype M, Btype B) noexcept
+{
+    if (E == 0 || E >= 31 || M > 23)
+        return false;
+
+    const long emax = (1l << E) - 1 - B;
+    return emax <= 128 && 1 - B >= -126;
+}
+
+Fastfloat Fastfloat::pack(const Fastfloat &in, hyper_params req_hyperparams)
+{
+    return Fastfloat(req_hyperparams.E, req_hyperparams.M, req_hyperparams.B, in.v_, in.rnd_);
+}
+
+Fastfloat Fastfloat::max_norm() const
+{
+    Fastfloat res(*this);
+    const uint32_t bits = max_norm_bits();
+    std::memcpy(&res.v_, &bits, sizeof(res.v_));
+    return res;
+}
+
+Fastfloat Fastfloat::min_norm() const
+{
+    Fastfloat res(*this);
+    res.v_ = pow2(1 - B_);
+    return res;
+}
+
+Fastfloat Fastfloat::min_denorm() const
+{
+    Fastfloat res(*this);
+    res.v_ = pow2(1 - B_ - M_);
+    return res;
+}
+
+int Fastfloat::to_int() const
+{
+    const float rounded = std::round(v_);
+    if (std::fabs(rounded) > static_cast<float>(std::numeric_limits<int>::max()))
+        throw std::runtime_error{"Fastfloat can not fit to int: ff > max(int)"};
+
+    return static_cast<int>(rounded);
+}
+
+Fastfloat Fastfloat::from_flexfloat(const Flexfloat &val)
+{
+    Fastfloat res(val.get_E(), val.get_M(), val.get_B(), 0.0f);
+
+    // Flexfloat::to_float возвращает min_denorm для нуля
+    if (Flexfloat::is_zero(val))
+        res.v_ = val.get_s() ? -0.0f : 0.0f;
+    else
+        res.v_ = res.quantize(val.to_float());
+
+    return res;
+}
+
+Flexfloat Fastfloat::to_flexfloat() const
+{
+    if ((float_bits(v_) & 0x7fffffffu) == 0)
+        return Flexfloat::zero(E_, M_, B_, std::signbit(v_) ? 1 : 0);
+
+    return Flexfloat::from_arithmetic_t(E_, M_, B_, v_);
+}
+
+Fastfloat Fastfloat::from_arithmetic_t(Etype E, Mtype M, Btype B, float flt)
+{
+    return Fastfloat(E, M, B, flt);
+}
+
+Fastfloat Fastfloat::from_arithmetic_t(const Fastfloat &hyperparams, float flt)
+{
+    Fastfloat res(hyperparams);
+    res.v_ = res.quantize(flt);
+    return res;
+}
+
+void Fastfloat::from_arithmetic_t(float flt, const Fastfloat &in, Fastfloat &out)
+{
+    out = from_arithmetic_t(in, flt);
+}
+
+Fastfloat Fastfloat::from_arithmetic_t(Etype E, Mtype M, Btype B, int n)
+{
+    return Fastfloat(E, M, B, static_cast<float>(n));
+}
+
+Fastfloat Fastfloat::from_arithmetic_t(const Fastfloat &hyperparams, int n)
+{
+    return from_arithmetic_t(hyperparams, static_cast<float>(n));
+}
+
+void Fastfloat::from_arithmetic_t(int n, const Fastfloat &in, Fastfloat &out)
+{
+    out = from_arithmetic_t(in, static_cast<float>(n));
+}
+
+Fastfloat Fastfloat::from_arithmetic_t(Etype E, Mtype M, Btype B, long unsigned n)
+{
+    return Fastfloat(E, M, B, static_cast<float>(n));
+}
+
+Fastfloat Fastfloat::from_arithmetic_t(const Fastfloat &hyperparams, long unsigned n)
+{
+    return from_arithmetic_t(hyperparams, static_cast<float>(n));
+}
+
+void Fastfloat::from_arithmetic_t(long unsigned n, const Fastfloat &in, Fastfloat &out)
+{
+    out = from_arithmetic_t(in, static_cast<float>(n));
+}
+
+Fastfloat Fastfloat::from_arithmetic_t(Etype E, Mtype M, Btype B, int64_t n)
+{
+    return Fastfloat(E, M, B, static_cast<float>(n));
+}
+
+Fastfloat Fastfloat::from_arithmetic_t(const Fastfloat &hyperparams, int64_t n)
+{
+    return from_arithmetic_t(hyperparams, static_cast<float>(n));
+}
+
+void Fastfloat::from_arithmetic_t(int64_t n, const Fastfloat &in, Fastfloat &out)
+{
+    out = from_arithmetic_t(in, static_cast<float>(n));
+}
+
+void Fastfloat::min(const Fastfloat &first, const Fastfloat &second, Fastfloat &res) noexcept
+{
+    if (first > second)
+        res = second;
+    else
+        res = first;
+}
+
+void Fastfloat::max(const Fastfloat &first, const Fastfloat &second, Fastfloat &res) noexcept
+{
+    if (first < second)
+        res = second;
+    else
+        res = first;
+}
+
+void Fastfloat::clip(const Fastfloat &a, const Fastfloat &x, const Fastfloat &b, Fastfloat &out) noexcept
+{
+    min(x, b, out);
+    max(a, out, out);
+}
+
+std::ostream &operator<<(std::ostream &oss, const Fastfloat &num)
+{
+    oss << "(E, M, B) = (" << +num.E_ << ", " << +num.M_ << ", " << +num.B_ << ")";
+    oss << "  val = " << num.v_;
+
+    return oss;
+}
+
+bool operator>(const Fastfloat &lhs, const Fastfloat &rhs) noexcept
+{
+    assert(lhs.E_ == rhs.E_ && lhs.B_ == rhs.B_ && lhs.M_ == rhs.M_);
+
+    // Как в Flexfloat: знак сравнивается первым, поэтому +0 > -0
+    const bool lhs_neg = std::signbit(lhs.v_), rhs_neg = std::signbit(rhs.v_);
+    if (lhs_neg != rhs_neg)
+        return !lhs_neg;
+
+    return lhs.v_ > rhs.v_;
+}
+
+bool operator==(const Fastfloat &lhs, const Fastfloat &rhs) noexcept
+{
+    assert(lhs.E_ == rhs.E_ && lhs.B_ == rhs.B_ && lhs.M_ == rhs.M_);
+    // ±0 различаются знаком, как в Flexfloat; inf и NaN в формате не бывает
+    return Fastfloat::float_bits(lhs.v_) == Fastfloat::float_bits(rhs.v_);
+}
+
+bool operator<(const Fastfloat &lhs, const Fastfloat &rhs) noexcept
+{
+    return !(lhs > rhs);
+}
+
+bool operator>=(const Fastfloat &lhs, const Fastfloat &rhs) noexcept
+{
+    return (lhs > rhs) || (lhs == rhs);
+}
+
+bool operator<=(const Fastfloat &lhs, const Fastfloat &rhs) noexcept
+{
+    return !(lhs > rhs) || (lhs == rhs);
+}
+
+bool operator!=(const Fastfloat &lhs, const Fastfloat &rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+} // namespace clib
@@ -83,6 +83,24 @@ void Flexfixed::mult(const Flexfixed &lhs, const Flexfixed &rhs, Flexfixed &res)
     $(CLOG(trace) << "Result of flex mult: " << res << std::endl);
 }
 
+void Flexfixed::mult_pow2(const Flexfixed &coef, const Flexfixed &x, Flexfixed &res)
+{
+    assert(is_pow2(coef));
+
+    // Как в mult: произведение ntype, затем сдвиг на delta_f
+    const ntype prod = coef.n == 0 ? 0 : static_cast<ntype>(x.n << __builtin_ctzll(coef.n));
+    const wtype delta_f = static_cast<wtype>(coef.F + x.F - res.F);
+
+    nrestype res_n = prod;
+    if (delta_f >= 0)
+        res_n = res_n >> delta_f;
+    else
+        res_n = res_n << std::abs(delta_f);
+
+    res.s = coef.s ^ x.s;
+    res.n = static_cast<ntype>(check_ovf(res_n, res.I, res.F));
+}
+
 void Flexfixed::sum(const Flexfixed &lhs, const Flexfixed &rhs, Flexfixed &res)
 {
 #ifdef BOOST_LOGS
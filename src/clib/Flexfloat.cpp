@@ -240,6 +240,40 @@ void Flexfloat::mult(const Flexfloat &lhs, const Flexfloat &rhs, Flexfloat &res)
     return;
 }
 
+bool Flexfloat::is_pow2(const Flexfloat &val)
+{
+    return is_zero(val) || (val.e > 0 && val.m == 0);
+}
+
+void Flexfloat::mult_pow2(const Flexfloat &coef, const Flexfloat &x, Flexfloat &res)
+{
+    assert(is_pow2(coef));
+
+    if (is_zero(coef) || is_zero(x))
+    {
+        res.e = 0;
+        res.m = 0;
+        res.s = coef.s ^ x.s;
+        return;
+    }
+
+    // Мантисса coef равна 1, поэтому произведение мантисс в mult - мантисса x, сдвинутая на LM бит, и normalise
+    // возвращает ее без изменений, пока экспонента результата лежит в [1, max_exp]
+    if (x.e > 0 && x.E == res.E && x.M == res.M && x.B == res.B)
+    {
+        const eexttype nexp = static_cast<eexttype>(x.e) + coef.e - coef.B;
+        if (nexp >= 1 && nexp <= max_exp(res.E))
+        {
+            res.s = coef.s ^ x.s;
+            res.e = static_cast<etype>(nexp);
+            res.m = x.m;
+            return;
+        }
+    }
+
+    mult(coef, x, res);
+}
+
 std::ostream &operator<<(std::ostream &oss, const Flexfloat &num)
 {
     oss << "(E, M, B) = (" << +num.E << ", " << +num.M << ", " << +num.B << ")";
@@ -595,6 +629,38 @@ void Flexfloat::sin(const Flexfloat &x, Flexfloat &res, uint8_t F)
     to_flexfloat(fx, res);
 }
 
+void Flexfloat::cos_sin_turn(uint64_t k, uint64_t n, Flexfloat &cos_res, Flexfloat &sin_res, uint8_t F)
+{
+    assert(n != 0);
+
+    // Четверть оборота и положение внутри нее, как integer_part и fractional_part для x / (pi / 2)
+    k %= n;
+    auto quarter = 4 * k / n;
+    auto rem = 4 * k % n;
+
+    if (rem == 0)
+    {
+        const int cos_exact[] = {1, 0, -1, 0}, sin_exact[] = {0, 1, 0, -1};
+        cos_res = from_arithmetic_t(cos_res, cos_exact[quarter]);
+        sin_res = from_arithmetic_t(sin_res, sin_exact[quarter]);
+        return;
+    }
+
+    polyfit_t frac = (static_cast<polyfit_t>(rem) << F) / n;
+
+    // В нечетной четверти положение отражается, как в cos и sin
+    if (quarter % 2 != 0)
+        frac = (polyfit_t(1) << F) - frac;
+
+    uint8_t cos_sign = quarter == 1 || quarter == 2;
+    uint8_t sin_sign = quarter == 2 || quarter == 3;
+
+    Flexfixed fx_cos(1, F, cos_sign, polyfit::get()->calc("cos", frac, F, F));
+    Flexfixed fx_sin(1, F, sin_sign, polyfit::get()->calc("sin", frac, F, F));
+    to_flexfloat(fx_cos, cos_res);
+    to_flexfloat(fx_sin, sin_res);
+}
+
 void Flexfloat::ctan(const Flexfloat &x, Flexfloat &res, uint8_t F)
 {
 #ifdef BOOST_LOGS
@@ -0,0 +1,499 @@
+#include "clib/FrameCache.hpp"
+#include "clib/VideoReader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace clib
+{
+
+namespace
+{
+const char raw_magic[8] = {'C', 'L', 'I', 'B', 'R', 'A', 'W', '1'};
+
+// Заголовок файла сырых кадров; за ним путь исходного файла и, с выравниванием data_offset, отсчеты
+struct raw_header
+{
+    char magic[8];
+    uint64_t data_offset;
+    uint64_t bits;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t clrs;
+    uint64_t frames;
+    uint64_t fps;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_path_size;
+};
+
+// Размер и время изменения исходного файла
+struct source_stamp
+{
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+std::system_error sys_error(const std::string &what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+source_stamp stat_source(const std::string &path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        throw sys_error("stat " + path);
+
+    source_stamp stamp;
+    stamp.size = static_cast<uint64_t>(st.st_size);
+    stamp.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return stamp;
+}
+
+std::string absolute_path(const std::string &path)
+{
+    char buf[PATH_MAX];
+    return realpath(path.c_str(), buf) != nullptr ? std::string(buf) : path;
+}
+
+ImgView::idx_t sample_bits(sample_t sample)
+{
+    return sample == sample_t::u8 ? 8 : sample == sample_t::u16 ? 16 : 32;
+}
+
+// Размер отсчетов по заголовку: frames * clrs * rows * cols * bits / 8. false, если произведение не помещается в
+// uint64_t; каждое умножение проверяется отдельно
+bool data_bytes(const raw_header &header, uint64_t &bytes)
+{
+    bytes = header.bits / 8;
+    for (const uint64_t factor : {header.frames, header.clrs, header.rows, header.cols})
+    {
+        if (factor != 0 && bytes > std::numeric_limits<uint64_t>::max() / factor)
+            return false;
+        bytes *= factor;
+    }
+    return true;
+}
+
+/*
+ * Запись файла сырых кадров: заголовок, затем плоскости по порядку (кадр, цвет). Файл пишется под временным именем
+ * и переименовывается в commit(), поэтому читатели не видят его частично записанным. Без commit() временный файл
+ * удаляется
+ */
+class raw_writer
+{
+    using idx_t = ImgView::idx_t;
+    using pixel_t = ImgView::pixel_t;
+
+    std::string path_;
+    std::string tmp_;
+    std::ofstream file_;
+    raw_header header_;
+    idx_t planes_ = 0;
+    bool committed_ = false;
+    std::vector<char> convert_;
+
+  public:
+    raw_writer(const std::string &path, idx_t rows, idx_t cols, idx_t clrs, size_t fps, sample_t sample,
+               const std::string &source, const source_stamp &stamp)
+        : path_(path), tmp_(path + ".tmp" + std::to_string(getpid())), file_(), header_(), convert_()
+    {
+        std::memcpy(header_.magic, raw_magic, sizeof(raw_magic));
+        header_.data_offset = (sizeof(raw_header) + source.size() + 63) / 64 * 64;
+        header_.bits = sample_bits(sample);
+        header_.rows = rows;
+        header_.cols = cols;
+        header_.clrs = clrs;
+        header_.fps = fps;
+        header_.source_size = stamp.size;
+        header_.source_mtime = stamp.mtime;
+        header_.source_path_size = source.size();
+
+        file_.open(tmp_, std::ios::binary | std::ios::trunc);
+        if (!file_)
+            throw std::runtime_error("Error creating raw frames file: " + tmp_);
+
+        std::vector<char> head(header_.data_offset, 0);
+        std::memcpy(head.data(), &header_, sizeof(raw_header));
+        std::memcpy(head.data() + sizeof(raw_header), source.data(), source.size());
+        write(head.data(), head.size());
+    }
+
+    ~raw_writer()
+    {
+        if (!committed_)
+        {
+            file_.close();
+            std::remove(tmp_.c_str());
+        }
+    }
+
+    raw_writer(const raw_writer &) = delete;
+    raw_writer &operator=(const raw_writer &) = delete;
+
+    idx_t plane_size() const
+    {
+        return header_.rows * header_.cols;
+    }
+
+    /// Плоскость в типе отсчетов файла
+    void write_samples(const void *plane)
+    {
+        write(static_cast<const char *>(plane), plane_size() * header_.bits / 8);
+        ++planes_;
+    }
+
+    /// Плоскость pixel_t с насыщением до типа отсчетов файла
+    void write_pixels(const pixel_t *plane)
+    {
+        const idx_t n = plane_size();
+        convert_.resize(n * header_.bits / 8);
+        if (header_.bits == 8)
+            std::transform(plane, plane + n, reinterpret_cast<uint8_t *>(convert_.data()),
+                           detail::to_sample<uint8_t>);
+        else if (header_.bits == 16)
+            std::transform(plane, plane + n, reinterpret_cast<uint16_t *>(convert_.data()),
+                           detail::to_sample<uint16_t>);
+        else
+            std::memcpy(convert_.data(), plane, n * sizeof(pixel_t));
+        write_samples(convert_.data());
+    }
+
+    /// Дописывает количество кадров в заголовок и переименовывает файл
+    void commit()
+    {
+        assert(planes_ % header_.clrs == 0);
+
+        header_.frames = planes_ / header_.clrs;
+        file_.seekp(0);
+        write(reinterpret_cast<const char *>(&header_), sizeof(raw_header));
+        file_.close();
+        if (!file_)
+            throw std::runtime_error("Error writing raw frames file: " + tmp_);
+
+        if (std::rename(tmp_.c_str(), path_.c_str()) != 0)
+            throw sys_error("rename " + tmp_);
+        committed_ = true;
+    }
+
+  private:
+    void write(const char *data, idx_t bytes)
+    {
+        if (!file_.write(data, static_cast<std::streamsize>(bytes)))
+            throw std::runtime_error("Error writing raw frames file: " + tmp_);
+    }
+};
+
+// Декодирует изображение: 16-битное хранение, только если отсчеты не помещаются в 8 бит
+void decode_image(const std::string &source, const std::string &path, const source_stamp &stamp)
+{
+    CImgView16 view;
+    view.read_img(source);
+
+    const ImgView::idx_t rows = view.rows(), cols = view.cols(), clrs = view.clrs();
+    std::vector<ImgView::pixel_t> planes(clrs * rows * cols);
+    for (ImgView::idx_t c = 0; c < clrs; ++c)
+        view.read_plane(c, planes.data() + c * rows * cols, cols);
+    const bool wide = !planes.empty() && *std::max_element(planes.begin(), planes.end()) > 255;
+
+    raw_writer writer(path, rows, cols, clrs, 0, wide ? sample_t::u16 : sample_t::u8, source, stamp);
+    for (ImgView::idx_t c = 0; c < clrs; ++c)
+        writer.write_pixels(planes.data() + c * rows * cols);
+    writer.commit();
+}
+
+// Декодирует видео по одному кадру: RGB декодера раскладывается по плоскостям uint8_t
+void decode_video(const std::string &source, const std::string &path, const source_stamp &stamp)
+{
+    VideoReader reader(source);
+    const ImgView::idx_t rows = reader.rows(), cols = reader.cols(), clrs = reader.clrs();
+
+    raw_writer writer(path, rows, cols, clrs, reader.info().fps, sample_t::u8, source, stamp);
+    std::vector<uint8_t> plane(rows * cols);
+    ImgView::idx_t frames = 0;
+    for (; reader.next(); ++frames)
+        for (ImgView::idx_t c = 0; c < clrs; ++c)
+        {
+            for (ImgView::idx_t i = 0; i < rows; ++i)
+            {
+                const uint8_t *src = reader.row(i) + c;
+                uint8_t *dst = plane.data() + i * cols;
+                for (ImgView::idx_t j = 0; j < cols; ++j)
+                    dst[j] = src[j * 3];
+            }
+            writer.write_samples(plane.data());
+        }
+
+    // Пустой кэш не публикуется: без commit временный файл удаляется
+    if (frames == 0)
+        throw std::runtime_error("No frames decoded: " + source);
+    writer.commit();
+}
+
+void save_planes(raw_writer &writer, const VideoView &video, VideoView::idx_t frame)
+{
+    std::vector<VideoView::pixel_t> plane;
+    for (VideoView::idx_t c = 0; c < video.clrs(); ++c)
+        if (const void *samples = video.samples(c, frame))
+            writer.write_samples(samples);
+        else
+        {
+            plane.resize(video.rows() * video.cols());
+            video.read_plane(c, frame, plane.data(), video.cols());
+            writer.write_pixels(plane.data());
+        }
+}
+
+// Кэш записан из того же исходного файла, и файл с тех пор не менялся
+bool fresh(const RawVideoView &raw, const std::string &source, const source_stamp &stamp)
+{
+    return raw.source() == source && raw.source_size() == stamp.size && raw.source_mtime() == stamp.mtime;
+}
+} // namespace
+
+ImgView::pixel_t raw_frames::get(idx_t i, idx_t j, idx_t clr, idx_t frame) const
+{
+    assert(i < rows);
+    assert(j < cols);
+
+    const idx_t k = i * cols + j;
+    const void *p = plane(clr, frame);
+    if (sample == sample_t::u8)
+        return static_cast<const uint8_t *>(p)[k];
+    if (sample == sample_t::u16)
+        return static_cast<const uint16_t *>(p)[k];
+    return static_cast<const pixel_t *>(p)[k];
+}
+
+void raw_frames::read_row(idx_t i, idx_t clr, idx_t frame, pixel_t *dst) const
+{
+    assert(i < rows);
+
+    const void *p = plane(clr, frame);
+    if (sample == sample_t::u8)
+        std::copy_n(static_cast<const uint8_t *>(p) + i * cols, cols, dst);
+    else if (sample == sample_t::u16)
+        std::copy_n(static_cast<const uint16_t *>(p) + i * cols, cols, dst);
+    else
+        std::copy_n(static_cast<const pixel_t *>(p) + i * cols, cols, dst);
+}
+
+void RawImgView::read_plane(idx_t clr, pixel_t *dst, idx_t stride) const
+{
+    assert(stride >= raw_.cols);
+
+    for (idx_t i = 0; i < raw_.rows; ++i)
+        raw_.read_row(i, clr, frame_, dst + i * stride);
+}
+
+RawVideoView::RawVideoView() : raw_(), source_()
+{
+    fps_ = 0;
+}
+
+RawVideoView::RawVideoView(const std::string &path) : RawVideoView()
+{
+    read_video(path);
+}
+
+RawVideoView::RawVideoView(RawVideoView &&other) noexcept
+    : VideoView(other), raw_(other.raw_), map_(other.map_), bytes_(other.bytes_), source_size_(other.source_size_),
+      source_mtime_(other.source_mtime_), source_(std::move(other.source_))
+{
+    other.raw_ = raw_frames();
+    other.map_ = nullptr;
+    other.bytes_ = 0;
+}
+
+RawVideoView &RawVideoView::operator=(RawVideoView &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        fps_ = other.fps_;
+        std::swap(raw_, other.raw_);
+        std::swap(map_, other.map_);
+        std::swap(bytes_, other.bytes_);
+        std::swap(source_size_, other.source_size_);
+        std::swap(source_mtime_, other.source_mtime_);
+        std::swap(source_, other.source_);
+    }
+    return *this;
+}
+
+RawVideoView::~RawVideoView()
+{
+    release();
+}
+
+void RawVideoView::read_plane(idx_t clr, idx_t frame, pixel_t *dst, idx_t stride) const
+{
+    assert(stride >= raw_.cols);
+
+    for (idx_t i = 0; i < raw_.rows; ++i)
+        raw_.read_row(i, clr, frame, dst + i * stride);
+}
+
+void RawVideoView::read_video(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw sys_error("open " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw sys_error("fstat " + path);
+    }
+
+    const idx_t bytes = static_cast<idx_t>(st.st_size);
+    void *map = bytes >= sizeof(raw_header) ? mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (map == MAP_FAILED)
+        throw std::runtime_error("Error mapping raw frames file: " + path);
+
+    // Проверка заголовка до замены текущего отображения
+    raw_header header;
+    std::memcpy(&header, map, sizeof(raw_header));
+    // Поля заголовка произвольны, поэтому суммы и произведения сравниваются с размером файла без переполнения
+    uint64_t data = 0;
+    const bool known = std::memcmp(header.magic, raw_magic, sizeof(raw_magic)) == 0 &&
+                       (header.bits == 8 || header.bits == 16 || header.bits == 32) &&
+                       header.data_offset >= sizeof(raw_header) &&
+                       header.source_path_size <= header.data_offset - sizeof(raw_header) &&
+                       header.data_offset <= bytes && data_bytes(header, data) && data <= bytes - header.data_offset;
+    if (!known)
+    {
+        munmap(map, bytes);
+        throw std::runtime_error("Not a raw frames file: " + path);
+    }
+
+    release();
+    map_ = map;
+    bytes_ = bytes;
+    fps_ = header.fps;
+    source_size_ = header.source_size;
+    source_mtime_ = header.source_mtime;
+    source_.assign(static_cast<const char *>(map) + sizeof(raw_header), header.source_path_size);
+
+    raw_.base = static_cast<const unsigned char *>(map) + header.data_offset;
+    raw_.rows = header.rows;
+    raw_.cols = header.cols;
+    raw_.clrs = header.clrs;
+    raw_.frames = header.frames;
+    raw_.sample = header.bits == 8 ? sample_t::u8 : header.bits == 16 ? sample_t::u16 : sample_t::i32;
+}
+
+void RawVideoView::write_video(const std::string &path)
+{
+    save_raw(path, *this);
+}
+
+void RawVideoView::release() noexcept
+{
+    if (map_ != nullptr)
+        munmap(map_, bytes_);
+    map_ = nullptr;
+    bytes_ = 0;
+    raw_ = raw_frames();
+}
+
+void save_raw(const std::string &path, const VideoView &video)
+{
+    raw_writer writer(path, video.rows(), video.cols(), video.clrs(), video.fps(), video.sample_type(), "", {});
+    for (VideoView::idx_t f = 0; f < video.frames(); ++f)
+        save_planes(writer, video, f);
+    writer.commit();
+}
+
+void save_raw(const std::string &path, const ImgView &image)
+{
+    raw_writer writer(path, image.rows(), image.cols(), image.clrs(), 0, image.sample_type(), "", {});
+    std::vector<ImgView::pixel_t> plane;
+    for (ImgView::idx_t c = 0; c < image.clrs(); ++c)
+        if (const void *samples = image.samples(c))
+            writer.write_samples(samples);
+        else
+        {
+            plane.resize(image.rows() * image.cols());
+            image.read_plane(c, plane.data(), image.cols());
+            writer.write_pixels(plane.data());
+        }
+    writer.commit();
+}
+
+FrameCache::FrameCache(const std::string &dir) : dir_(dir)
+{
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        throw sys_error("mkdir " + dir);
+}
+
+std::string FrameCache::raw_path(const std::string &source) const
+{
+    // Имя файла для наглядности и хэш полного пути против совпадений имен из разных каталогов
+    const std::string abs = absolute_path(source);
+    const std::string name = abs.substr(abs.find_last_of('/') + 1);
+
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(std::hash<std::string>()(abs)));
+    return dir_ + "/" + name + "." + hash + ".raw";
+}
+
+bool FrameCache::valid(const std::string &source) const
+{
+    const source_stamp stamp = stat_source(source);
+    try
+    {
+        return fresh(RawVideoView(raw_path(source)), absolute_path(source), stamp);
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+RawVideoView FrameCache::open(const std::string &source) const
+{
+    // Отметка снимается до декодирования: изменение исходного файла во время декодирования сделает кэш устаревшим
+    const source_stamp stamp = stat_source(source);
+    const std::string abs = absolute_path(source);
+    const std::string path = raw_path(source);
+
+    try
+    {
+        RawVideoView raw(path);
+        if (fresh(raw, abs, stamp))
+            return raw;
+    }
+    catch (const std::exception &)
+    {
+        // Кэша нет или он поврежден: декодируется заново
+    }
+
+    if (check_ext(source, image_extensions))
+        decode_image(abs, path, stamp);
+    else if (check_ext(source, video_extensions))
+        decode_video(abs, path, stamp);
+    else
+        throw std::invalid_argument("Unknown format: " + source);
+
+    return RawVideoView(path);
+}
+
+} // namespace clib
@@ -1,4 +1,5 @@
 #include "clib/ImgView.hpp"
+#include <algorithm>
 #include <cassert>
 #include <limits>
 
@@ -8,34 +9,72 @@ namespace clib
 using idx_t = ImgView::idx_t;
 using pixel_t = ImgView::pixel_t;
 
-void CImgView::init(idx_t rows, idx_t cols, idx_t clrs)
+void ImgView::read_row(idx_t i, idx_t clr, pixel_t *dst) const
+{
+    for (idx_t j = 0, cols = this->cols(); j < cols; ++j)
+        dst[j] = get(i, j, clr);
+}
+
+void ImgView::write_row(idx_t i, idx_t clr, const pixel_t *src)
+{
+    for (idx_t j = 0, cols = this->cols(); j < cols; ++j)
+        set(src[j], i, j, clr);
+}
+
+void ImgView::read_plane(idx_t clr, pixel_t *dst, idx_t stride) const
+{
+    assert(stride >= cols());
+
+    for (idx_t i = 0, rows = this->rows(); i < rows; ++i)
+        read_row(i, clr, dst + i * stride);
+}
+
+void ImgView::write_plane(idx_t clr, const pixel_t *src, idx_t stride)
+{
+    assert(stride >= cols());
+
+    for (idx_t i = 0, rows = this->rows(); i < rows; ++i)
+        write_row(i, clr, src + i * stride);
+}
+
+pixel_t *ImgView::data(idx_t)
+{
+    return nullptr;
+}
+
+const pixel_t *ImgView::data(idx_t) const
+{
+    return nullptr;
+}
+
+template <typename S> void CImgViewT<S>::init(idx_t rows, idx_t cols, idx_t clrs)
 {
     assert(rows <= std::numeric_limits<unsigned>::max());
     assert(cols <= std::numeric_limits<unsigned>::max());
     assert(clrs <= std::numeric_limits<unsigned>::max());
-    image_ = cimg_library::CImg<pixel_t>(static_cast<unsigned>(cols), static_cast<unsigned>(rows), 1,
-                                         static_cast<unsigned>(clrs));
+    image_ = cimg_library::CImg<S>(static_cast<unsigned>(cols), static_cast<unsigned>(rows), 1,
+                                   static_cast<unsigned>(clrs));
     img_created_ = true;
 }
 
-idx_t CImgView::rows() const
+template <typename S> idx_t CImgViewT<S>::rows() const
 {
     check_created();
     return static_cast<idx_t>(image_.height());
 }
-idx_t CImgView::cols() const
+template <typename S> idx_t CImgViewT<S>::cols() const
 {
     check_created();
     return static_cast<idx_t>(image_.width());
 }
-idx_t CImgView::clrs() const
+template <typename S> idx_t CImgViewT<S>::clrs() const
 {
     check_created();
     return static_cast<idx_t>(image_.spectrum());
 }
 
 // CImg stores data as [width,height]. Therefore, the data in cimg are transposed
-pixel_t CImgView::get(idx_t i, idx_t j, idx_t clr) const
+template <typename S> pixel_t CImgViewT<S>::get(idx_t i, idx_t j, idx_t clr) const
 {
     assert(image_.depth() == 1);
     assert(i < rows());
@@ -47,7 +86,7 @@ pixel_t CImgView::get(idx_t i, idx_t j, idx_t clr) const
 }
 
 // CImg stores data as [width,height]. Therefore, the data in cimg are transposed
-void CImgView::set(pixel_t val, idx_t i, idx_t j, idx_t clr)
+template <typename S> void CImgViewT<S>::set(pixel_t val, idx_t i, idx_t j, idx_t clr)
 {
     assert(image_.depth() == 1);
     assert(i < rows());
@@ -55,16 +94,74 @@ void CImgView::set(pixel_t val, idx_t i, idx_t j, idx_t clr)
     assert(clr < clrs());
 
     check_created();
-    image_(static_cast<unsigned>(j), static_cast<unsigned>(i), 0, static_cast<unsigned>(clr)) = val;
+    image_(static_cast<unsigned>(j), static_cast<unsigned>(i), 0, static_cast<unsigned>(clr)) =
+        detail::to_sample<S>(val);
 }
 
-void CImgView::read_img(const std::string &path)
+template <typename S> void CImgViewT<S>::read_row(idx_t i, idx_t clr, pixel_t *dst) const
+{
+    assert(i < rows());
+
+    const S *src = plane(clr) + i * cols();
+    std::copy(src, src + cols(), dst);
+}
+
+template <typename S> void CImgViewT<S>::write_row(idx_t i, idx_t clr, const pixel_t *src)
+{
+    assert(i < rows());
+
+    S *dst = plane(clr) + i * cols();
+    std::transform(src, src + cols(), dst, detail::to_sample<S>);
+}
+
+template <typename S> void CImgViewT<S>::read_plane(idx_t clr, pixel_t *dst, idx_t stride) const
+{
+    const idx_t rows = this->rows(), cols = this->cols();
+    assert(stride >= cols);
+
+    const S *src = plane(clr);
+    if (stride == cols)
+        std::copy(src, src + rows * cols, dst);
+    else
+        for (idx_t i = 0; i < rows; ++i)
+            std::copy(src + i * cols, src + (i + 1) * cols, dst + i * stride);
+}
+
+template <typename S> void CImgViewT<S>::write_plane(idx_t clr, const pixel_t *src, idx_t stride)
+{
+    const idx_t rows = this->rows(), cols = this->cols();
+    assert(stride >= cols);
+
+    S *dst = plane(clr);
+    if (stride == cols)
+        std::transform(src, src + rows * cols, dst, detail::to_sample<S>);
+    else
+        for (idx_t i = 0; i < rows; ++i)
+            std::transform(src + i * stride, src + i * stride + cols, dst + i * cols, detail::to_sample<S>);
+}
+
+template <typename S> pixel_t *CImgViewT<S>::data(idx_t clr)
+{
+    return detail::int_plane(plane(clr));
+}
+
+template <typename S> const pixel_t *CImgViewT<S>::data(idx_t clr) const
+{
+    return detail::int_plane(plane(clr));
+}
+
+template <typename S> const void *CImgViewT<S>::samples(idx_t clr) const
+{
+    return plane(clr);
+}
+
+template <typename S> void CImgViewT<S>::read_img(const std::string &path)
 {
     if (check_ext(path, {"jpeg", "jpg"}))
-        image_ = cimg_library::CImg<pixel_t>::get_load_jpeg(path.c_str());
+        image_ = cimg_library::CImg<S>::get_load_jpeg(path.c_str());
 
     else if (check_ext(path, {"png"}))
-        image_ = cimg_library::CImg<pixel_t>::get_load_png(path.c_str());
+        image_ = cimg_library::CImg<S>::get_load_png(path.c_str());
 
     else
         throw std::invalid_argument("Unknown format. Please check again" + path);
@@ -72,7 +169,7 @@ void CImgView::read_img(const std::string &path)
     img_created_ = true;
 }
 
-void CImgView::write_img(const std::string &path)
+template <typename S> void CImgViewT<S>::write_img(const std::string &path)
 {
     check_created();
 
@@ -85,7 +182,8 @@ void CImgView::write_img(const std::string &path)
     else
         throw std::invalid_argument("Unknown format. Please check again" + path);
 }
-bool CImgView::check_ext(const std::string &s, const std::vector<std::string> &exts)
+
+template <typename S> bool CImgViewT<S>::check_ext(const std::string &s, const std::vector<std::string> &exts)
 {
     for (auto ext : exts)
         if (s.substr(s.find_last_of(".") + 1) == ext)
@@ -93,10 +191,28 @@ bool CImgView::check_ext(const std::string &s, const std::vector<std::string> &e
     return false;
 }
 
-void CImgView::check_created() const
+template <typename S> void CImgViewT<S>::check_created() const
 {
     if (!img_created_)
         throw std::runtime_error{"image was not readed"};
 }
 
+template <typename S> const S *CImgViewT<S>::plane(idx_t clr) const
+{
+    assert(image_.depth() == 1);
+    assert(clr < clrs());
+
+    check_created();
+    return image_.data(0, 0, 0, static_cast<unsigned>(clr));
+}
+
+template <typename S> S *CImgViewT<S>::plane(idx_t clr)
+{
+    return const_cast<S *>(static_cast<const CImgViewT &>(*this).plane(clr));
+}
+
+template struct CImgViewT<uint8_t>;
+template struct CImgViewT<uint16_t>;
+template struct CImgViewT<int>;
+
 } // namespace clib
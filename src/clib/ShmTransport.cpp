@@ -0,0 +1,367 @@
+#include "clib/ShmTransport.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace vsim
+{
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "shared memory counters must be lock-free to be shared between processes");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit value");
+
+struct ShmRing::header
+{
+    static constexpr uint64_t MAGIC = 0x636c69622d726e67; // "clib-rng"
+
+    uint64_t magic = 0;
+    uint64_t capacity = 0;
+    shm_media media{};
+
+    // Счетчики писателя и читателя в разных строках кэша
+    alignas(64) std::atomic<uint64_t> head{0}; ///< записано отсчетов
+    std::atomic<uint32_t> data_seq{0};         ///< futex: появились данные
+    std::atomic<uint32_t> data_waiters{0};
+
+    alignas(64) std::atomic<uint64_t> tail{0}; ///< прочитано отсчетов
+    std::atomic<uint32_t> space_seq{0};        ///< futex: освободилось место
+    std::atomic<uint32_t> space_waiters{0};
+
+    alignas(64) std::atomic<uint32_t> closed{0};
+};
+
+constexpr uint64_t ShmRing::header::MAGIC;
+
+namespace
+{
+// Futex в разделяемой памяти (без FUTEX_PRIVATE_FLAG): ждет, пока слово равно expected
+void futex_wait(std::atomic<uint32_t> &word, uint32_t expected)
+{
+    syscall(SYS_futex, &word, FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t> &word)
+{
+    syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Отмечает событие и будит ожидающих, если они есть
+void notify(std::atomic<uint32_t> &seq, const std::atomic<uint32_t> &waiters)
+{
+    seq.fetch_add(1);
+    if (waiters.load() != 0)
+        futex_wake(seq);
+}
+
+// Ждет события seq, пока ready() ложно. Порядок (waiters, seq, ready) согласован с notify: либо notify увидит
+// ожидающего, либо ready() увидит изменения, сделанные до notify
+template <typename Ready> void wait(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiters, Ready ready)
+{
+    waiters.fetch_add(1);
+    const uint32_t expected = seq.load();
+    if (!ready())
+        futex_wait(seq, expected);
+    waiters.fetch_sub(1);
+}
+
+std::system_error sys_error(const std::string &what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+} // namespace
+
+ShmRing ShmRing::create(const std::string &name, idx_t capacity, const shm_media &media)
+{
+    assert(capacity > 0);
+
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        throw sys_error("shm_open " + name);
+
+    ShmRing ring;
+    ring.name_ = name;
+    ring.owner_ = true;
+    try
+    {
+        const idx_t bytes = sizeof(header) + capacity * sizeof(pixel_t);
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+            throw sys_error("ftruncate " + name);
+        ring.map(fd, bytes);
+    }
+    catch (...)
+    {
+        ::close(fd);
+        ring.release();
+        throw;
+    }
+    ::close(fd);
+
+    header *hdr = new (ring.hdr_) header();
+    hdr->capacity = capacity;
+    hdr->media = media;
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->magic = header::MAGIC;
+
+    return ring;
+}
+
+ShmRing ShmRing::open(const std::string &name)
+{
+    const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+        throw sys_error("shm_open " + name);
+
+    ShmRing ring;
+    ring.name_ = name;
+    try
+    {
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            throw sys_error("fstat " + name);
+        if (static_cast<idx_t>(st.st_size) < sizeof(header))
+            throw std::runtime_error("Shared memory segment is too small: " + name);
+        ring.map(fd, static_cast<idx_t>(st.st_size));
+    }
+    catch (...)
+    {
+        ::close(fd);
+        ring.release();
+        throw;
+    }
+    ::close(fd);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (ring.hdr_->magic != header::MAGIC ||
+        sizeof(header) + ring.hdr_->capacity * sizeof(pixel_t) > ring.bytes_)
+        throw std::runtime_error("Not a clib ring: " + name);
+
+    return ring;
+}
+
+ShmRing::ShmRing(ShmRing &&other) noexcept
+    : hdr_(other.hdr_), data_(other.data_), bytes_(other.bytes_), name_(std::move(other.name_)), owner_(other.owner_)
+{
+    other.hdr_ = nullptr;
+    other.data_ = nullptr;
+    other.bytes_ = 0;
+    other.owner_ = false;
+}
+
+ShmRing &ShmRing::operator=(ShmRing &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        std::swap(hdr_, other.hdr_);
+        std::swap(data_, other.data_);
+        std::swap(bytes_, other.bytes_);
+        std::swap(name_, other.name_);
+        std::swap(owner_, other.owner_);
+    }
+    return *this;
+}
+
+ShmRing::~ShmRing()
+{
+    release();
+}
+
+idx_t ShmRing::capacity() const
+{
+    return static_cast<idx_t>(hdr_->capacity);
+}
+
+shm_media ShmRing::media() const
+{
+    return hdr_->media;
+}
+
+idx_t ShmRing::write(const pixel_t *src, idx_t n)
+{
+    const uint64_t cap = hdr_->capacity;
+    uint64_t head = hdr_->head.load(std::memory_order_relaxed);
+
+    idx_t done = 0;
+    while (done < n)
+    {
+        auto space = [&]() { return cap - (head - hdr_->tail.load(std::memory_order_acquire)); };
+        auto ready = [&]() { return space() != 0 || hdr_->closed.load() != 0; };
+        while (!ready())
+            wait(hdr_->space_seq, hdr_->space_waiters, ready);
+        if (hdr_->closed.load() != 0)
+            break;
+
+        // Пачка до конца свободного места или до конца кольца
+        const uint64_t pos = head % cap;
+        const idx_t run = static_cast<idx_t>(std::min<uint64_t>({space(), cap - pos, n - done}));
+        std::memcpy(data_ + pos, src + done, run * sizeof(pixel_t));
+
+        head += run;
+        done += run;
+        hdr_->head.store(head, std::memory_order_release);
+        notify(hdr_->data_seq, hdr_->data_waiters);
+    }
+    return done;
+}
+
+idx_t ShmRing::read_some(pixel_t *dst, idx_t n)
+{
+    if (n == 0)
+        return 0;
+
+    const uint64_t cap = hdr_->capacity;
+    const uint64_t tail = hdr_->tail.load(std::memory_order_relaxed);
+
+    auto available = [&]() { return hdr_->head.load(std::memory_order_acquire) - tail; };
+    auto ready = [&]() { return available() != 0 || hdr_->closed.load() != 0; };
+    while (!ready())
+        wait(hdr_->data_seq, hdr_->data_waiters, ready);
+
+    // Писатель закрывает кольцо после последней записи, поэтому после closed счетчик head окончательный
+    const uint64_t avail = available();
+    if (avail == 0)
+        return 0;
+
+    const uint64_t pos = tail % cap;
+    const idx_t first = static_cast<idx_t>(std::min<uint64_t>({avail, cap - pos, n}));
+    std::memcpy(dst, data_ + pos, first * sizeof(pixel_t));
+
+    // Продолжение с начала кольца
+    const idx_t second = static_cast<idx_t>(std::min<uint64_t>(avail - first, n - first));
+    std::memcpy(dst + first, data_, second * sizeof(pixel_t));
+
+    hdr_->tail.store(tail + first + second, std::memory_order_release);
+    notify(hdr_->space_seq, hdr_->space_waiters);
+    return first + second;
+}
+
+idx_t ShmRing::read(pixel_t *dst, idx_t n)
+{
+    idx_t done = 0;
+    while (done < n)
+    {
+        const idx_t got = read_some(dst + done, n - done);
+        if (got == 0)
+            break;
+        done += got;
+    }
+    return done;
+}
+
+void ShmRing::close()
+{
+    hdr_->closed.store(1);
+    notify(hdr_->data_seq, hdr_->data_waiters);
+    notify(hdr_->space_seq, hdr_->space_waiters);
+}
+
+bool ShmRing::closed() const
+{
+    return hdr_->closed.load() != 0;
+}
+
+void ShmRing::map(int fd, idx_t bytes)
+{
+    void *addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+        throw sys_error("mmap " + name_);
+
+    hdr_ = static_cast<header *>(addr);
+    data_ = reinterpret_cast<pixel_t *>(static_cast<char *>(addr) + sizeof(header));
+    bytes_ = bytes;
+}
+
+void ShmRing::release() noexcept
+{
+    if (hdr_ != nullptr)
+        munmap(hdr_, bytes_);
+    if (owner_)
+        shm_unlink(name_.c_str());
+
+    hdr_ = nullptr;
+    data_ = nullptr;
+    bytes_ = 0;
+    owner_ = false;
+}
+
+idx_t ShmSerializer::pop_n(pixel_t *dst, idx_t n)
+{
+    n = std::min(n, media_.size() - count_);
+
+    // Сначала остаток буфера, затем большие пачки напрямую из кольца
+    idx_t done = std::min(n, buf_end_ - buf_pos_);
+    std::copy_n(buf_.data() + buf_pos_, done, dst);
+    buf_pos_ += done;
+
+    if (done < n)
+        done += ring_.read(dst + done, n - done);
+
+    count_ += done;
+    return done;
+}
+
+bool ShmSerializer::fill()
+{
+    if (count_ >= media_.size())
+        return false;
+
+    buf_pos_ = 0;
+    buf_end_ = ring_.read_some(buf_.data(), std::min(buf_.size(), media_.size() - count_));
+    return buf_end_ != 0;
+}
+
+ShmDeserializer::~ShmDeserializer()
+{
+    flush();
+}
+
+idx_t ShmDeserializer::push_n(const pixel_t *src, idx_t n)
+{
+    n = std::min(n, media_.size() - count_);
+
+    // Большие пачки идут в кольцо напрямую, без буфера
+    flush();
+    if (stopped_)
+        return 0;
+
+    const idx_t done = ring_.write(src, n);
+    count_ += done;
+    stopped_ = done < n;
+    return done;
+}
+
+idx_t ShmDeserializer::flush()
+{
+    if (buf_end_ == 0)
+        return 0;
+
+    const idx_t done = ring_.write(buf_.data(), buf_end_);
+    if (done < buf_end_)
+    {
+        count_ -= buf_end_ - done;
+        stopped_ = true;
+    }
+    buf_end_ = 0;
+    return done;
+}
+
+void ShmDeserializer::close()
+{
+    flush();
+    ring_.close();
+}
+
+} // namespace vsim
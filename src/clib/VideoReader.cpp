@@ -0,0 +1,151 @@
+#include "clib/VideoReader.hpp"
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+#include <cassert>
+#include <limits>
+
+namespace clib
+{
+
+using idx_t = VideoReader::idx_t;
+
+VideoReader::VideoReader(const std::string &path) : view_(*this)
+{
+    if (avformat_open_input(&format_, path.c_str(), nullptr, nullptr) != 0)
+        throw std::runtime_error("Error opening video file: " + path);
+
+    try
+    {
+        if (avformat_find_stream_info(format_, nullptr) < 0)
+            throw std::runtime_error("Error finding stream information");
+
+        stream_ = av_find_best_stream(format_, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (stream_ < 0)
+            throw std::runtime_error("No video stream found in the input file");
+
+        const AVStream *stream = format_->streams[stream_];
+        const AVCodec *decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+        if (decoder == nullptr)
+            throw std::runtime_error("Unsupported video codec");
+
+        codec_ = avcodec_alloc_context3(decoder);
+        if (codec_ == nullptr || avcodec_parameters_to_context(codec_, stream->codecpar) < 0)
+            throw std::runtime_error("Error creating video decoder");
+
+        // Декодер сам выбирает количество потоков
+        codec_->thread_count = 0;
+        if (avcodec_open2(codec_, decoder, nullptr) < 0)
+            throw std::runtime_error("Error opening video decoder");
+
+        frame_ = av_frame_alloc();
+        packet_ = av_packet_alloc();
+        if (frame_ == nullptr || packet_ == nullptr)
+            throw std::bad_alloc();
+
+        assert(codec_->width > 0 && codec_->height > 0);
+        info_.rows = static_cast<size_t>(codec_->height);
+        info_.cols = static_cast<size_t>(codec_->width);
+
+        AVRational rate = stream->avg_frame_rate;
+        if (rate.num == 0 || rate.den == 0)
+            rate = stream->r_frame_rate;
+        info_.frame_rate = rate.den != 0 ? av_q2d(rate) : 0.0;
+        info_.fps = static_cast<size_t>(info_.frame_rate);
+
+        info_.frames = stream->nb_frames > 0 ? static_cast<size_t>(stream->nb_frames) : 0;
+        if (stream->duration != AV_NOPTS_VALUE)
+            info_.duration = static_cast<double>(stream->duration) * av_q2d(stream->time_base);
+        else if (format_->duration != AV_NOPTS_VALUE)
+            info_.duration = static_cast<double>(format_->duration) / AV_TIME_BASE;
+        info_.codec = avcodec_get_name(stream->codecpar->codec_id);
+
+        rgb_.resize(info_.rows * info_.cols * 3);
+    }
+    catch (...)
+    {
+        close();
+        throw;
+    }
+}
+
+VideoReader::~VideoReader()
+{
+    close();
+}
+
+bool VideoReader::next()
+{
+    // Декодер выдает кадры с задержкой: сначала забираем готовый кадр, затем подаем следующий пакет потока
+    while (true)
+    {
+        int ret = avcodec_receive_frame(codec_, frame_);
+        if (ret == 0)
+        {
+            convert();
+            av_frame_unref(frame_);
+            ++decoded_;
+            return true;
+        }
+        if (ret == AVERROR_EOF)
+            return false;
+        if (ret != AVERROR(EAGAIN))
+            throw std::runtime_error("Error decoding video frame");
+
+        // Пакеты кончились: декодер отдает оставшиеся кадры
+        if (draining_)
+            return false;
+
+        ret = av_read_frame(format_, packet_);
+        if (ret < 0)
+        {
+            draining_ = true;
+            ret = avcodec_send_packet(codec_, nullptr);
+        }
+        else
+        {
+            if (packet_->stream_index == stream_)
+                ret = avcodec_send_packet(codec_, packet_);
+            av_packet_unref(packet_);
+        }
+
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            throw std::runtime_error("Error sending packet to video decoder");
+    }
+}
+
+void VideoReader::convert()
+{
+    assert(info_.rows <= static_cast<size_t>(std::numeric_limits<int>::max()));
+    assert(info_.cols * 3 <= static_cast<size_t>(std::numeric_limits<int>::max()));
+
+    const int rows = static_cast<int>(info_.rows), cols = static_cast<int>(info_.cols);
+
+    // Контекст пересоздается, только если размер или формат кадров изменился
+    sws_ = sws_getCachedContext(sws_, frame_->width, frame_->height, static_cast<AVPixelFormat>(frame_->format),
+                                cols, rows, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (sws_ == nullptr)
+        throw std::runtime_error("Error creating pixel format converter");
+
+    uint8_t *dst[1] = {rgb_.data()};
+    const int dst_stride[1] = {cols * 3};
+    sws_scale(sws_, frame_->data, frame_->linesize, 0, frame_->height, dst, dst_stride);
+}
+
+void VideoReader::close() noexcept
+{
+    sws_freeContext(sws_);
+    sws_ = nullptr;
+    av_packet_free(&packet_);
+    av_frame_free(&frame_);
+    avcodec_free_context(&codec_);
+    if (format_ != nullptr)
+        avformat_close_input(&format_);
+}
+
+} // namespace clib
@@ -1,4 +1,6 @@
 #include "clib/VideoView.hpp"
+#include "clib/VideoReader.hpp"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <limits>
@@ -9,42 +11,80 @@ namespace clib
 using idx_t = VideoView::idx_t;
 using pixel_t = VideoView::pixel_t;
 
-void CVideoView::init(idx_t rows, idx_t cols, idx_t colors, idx_t frames, size_t fps)
+void VideoView::read_row(idx_t i, idx_t clr, idx_t frame, pixel_t *dst) const
+{
+    for (idx_t j = 0, cols = this->cols(); j < cols; ++j)
+        dst[j] = get(i, j, clr, frame);
+}
+
+void VideoView::write_row(idx_t i, idx_t clr, idx_t frame, const pixel_t *src)
+{
+    for (idx_t j = 0, cols = this->cols(); j < cols; ++j)
+        set(src[j], i, j, clr, frame);
+}
+
+void VideoView::read_plane(idx_t clr, idx_t frame, pixel_t *dst, idx_t stride) const
+{
+    assert(stride >= cols());
+
+    for (idx_t i = 0, rows = this->rows(); i < rows; ++i)
+        read_row(i, clr, frame, dst + i * stride);
+}
+
+void VideoView::write_plane(idx_t clr, idx_t frame, const pixel_t *src, idx_t stride)
+{
+    assert(stride >= cols());
+
+    for (idx_t i = 0, rows = this->rows(); i < rows; ++i)
+        write_row(i, clr, frame, src + i * stride);
+}
+
+pixel_t *VideoView::data(idx_t, idx_t)
+{
+    return nullptr;
+}
+
+const pixel_t *VideoView::data(idx_t, idx_t) const
+{
+    return nullptr;
+}
+
+template <typename S> void CVideoViewT<S>::init(idx_t rows, idx_t cols, idx_t colors, idx_t frames, size_t fps)
 {
     assert(rows <= std::numeric_limits<unsigned>::max());
     assert(cols <= std::numeric_limits<unsigned>::max());
     assert(frames <= std::numeric_limits<unsigned>::max());
     assert(colors <= std::numeric_limits<unsigned>::max());
 
-    video_ = cimg_library::CImg<pixel_t>(static_cast<unsigned>(cols), static_cast<unsigned>(rows),
-                                         static_cast<unsigned>(frames), static_cast<unsigned>(colors));
+    video_ = cimg_library::CImg<S>(static_cast<unsigned>(cols), static_cast<unsigned>(rows),
+                                   static_cast<unsigned>(frames), static_cast<unsigned>(colors));
     fps_ = fps;
     video_created_ = true;
 }
 
-idx_t CVideoView::rows() const
+template <typename S> idx_t CVideoViewT<S>::rows() const
 {
     check_created();
     return static_cast<idx_t>(video_.height());
 }
-idx_t CVideoView::cols() const
+template <typename S> idx_t CVideoViewT<S>::cols() const
 {
     check_created();
     return static_cast<idx_t>(video_.width());
 }
-idx_t CVideoView::clrs() const
+template <typename S> idx_t CVideoViewT<S>::clrs() const
 {
     check_created();
     return static_cast<idx_t>(video_.spectrum());
 }
-idx_t CVideoView::frames() const
+template <typename S> idx_t CVideoViewT<S>::frames() const
 {
     check_created();
     return static_cast<idx_t>(video_.depth());
 }
 
 // CImg stores data as [width,height]. Therefore, the data in cimg are transposed
-pixel_t CVideoView::get(idx_t i, idx_t j, idx_t clr, idx_t frame) const
+template <typename S> pixel_t CVideoViewT<S>::get(idx_t i, idx_t j, idx_t clr, idx_t frame) const
 {
     assert(i < rows());
     assert(j < cols());
@@ -57,7 +97,7 @@ pixel_t CVideoView::get(idx_t i, idx_t j, idx_t clr, idx_t frame) const
 }
 
 // CImg stores data as [width,height]. Therefore, the data in cimg are transposed
-void CVideoView::set(pixel_t val, idx_t i, idx_t j, idx_t clr, idx_t frame)
+template <typename S> void CVideoViewT<S>::set(pixel_t val, idx_t i, idx_t j, idx_t clr, idx_t frame)
 {
     assert(i < rows());
     assert(j < cols());
@@ -66,25 +106,107 @@ void CVideoView::set(pixel_t val, idx_t i, idx_t j, idx_t clr, idx_t frame)
 
     check_created();
     video_(static_cast<unsigned>(j), static_cast<unsigned>(i), static_cast<unsigned>(frame),
-           static_cast<unsigned>(clr)) = val;
+           static_cast<unsigned>(clr)) = detail::to_sample<S>(val);
 }
 
-void CVideoView::read_video(const std::string &path)
+template <typename S> void CVideoViewT<S>::read_row(idx_t i, idx_t clr, idx_t frame, pixel_t *dst) const
 {
-    if (check_ext(path, video_extensions))
-    {
-        video_ = cimg_library::CImg<pixel_t>::get_load_video(path.c_str());
-        fps_ = get_fps(path);
-    }
+    assert(i < rows());
+
+    const S *src = plane(clr, frame) + i * cols();
+    std::copy(src, src + cols(), dst);
+}
+
+template <typename S> void CVideoViewT<S>::write_row(idx_t i, idx_t clr, idx_t frame, const pixel_t *src)
+{
+    assert(i < rows());
+
+    std::transform(src, src + cols(), plane(clr, frame) + i * cols(), detail::to_sample<S>);
+}
+
+template <typename S> void CVideoViewT<S>::read_plane(idx_t clr, idx_t frame, pixel_t *dst, idx_t stride) const
+{
+    const idx_t rows = this->rows(), cols = this->cols();
+    assert(stride >= cols);
+
+    const S *src = plane(clr, frame);
+    if (stride == cols)
+        std::copy(src, src + rows * cols, dst);
     else
-    {
+        for (idx_t i = 0; i < rows; ++i)
+            std::copy(src + i * cols, src + (i + 1) * cols, dst + i * stride);
+}
+
+template <typename S> void CVideoViewT<S>::write_plane(idx_t clr, idx_t frame, const pixel_t *src, idx_t stride)
+{
+    const idx_t rows = this->rows(), cols = this->cols();
+    assert(stride >= cols);
+
+    S *dst = plane(clr, frame);
+    if (stride == cols)
+        std::transform(src, src + rows * cols, dst, detail::to_sample<S>);
+    else
+        for (idx_t i = 0; i < rows; ++i)
+            std::transform(src + i * stride, src + i * stride + cols, dst + i * cols, detail::to_sample<S>);
+}
+
+template <typename S> pixel_t *CVideoViewT<S>::data(idx_t clr, idx_t frame)
+{
+    return detail::int_plane(plane(clr, frame));
+}
+
+template <typename S> const pixel_t *CVideoViewT<S>::data(idx_t clr, idx_t frame) const
+{
+    return detail::int_plane(plane(clr, frame));
+}
+
+template <typename S> const void *CVideoViewT<S>::samples(idx_t clr, idx_t frame) const
+{
+    return plane(clr, frame);
+}
+
+template <typename S> void CVideoViewT<S>::read_video(const std::string &path)
+{
+    if (!check_ext(path, video_extensions))
         throw std::invalid_argument("Unknown format: " + path);
+
+    // Файл открывается один раз; кадры декодируются по одному и сразу раскладываются по плоскостям CImg. Количество
+    // кадров из заголовка - только оценка: при нехватке места глубина растет на постоянную долю оценки (а не вдвое,
+    // чтобы запас не доходил до размера ролика), лишние кадры отрезаются один раз в конце
+    VideoReader reader(path);
+    const idx_t rows = reader.rows(), cols = reader.cols();
+
+    idx_t capacity = std::max<idx_t>(reader.info().frames, 1);
+    const idx_t chunk = std::max<idx_t>(capacity / 8, 1);
+    init(rows, cols, 3, capacity, reader.info().fps);
+
+    idx_t count = 0;
+    for (; reader.next(); ++count)
+    {
+        if (count == capacity)
+        {
+            capacity += chunk;
+            resize_frames(capacity);
+        }
+
+        // Разделение троек R, G, B по плоскостям
+        S *dst[3] = {plane(0, count), plane(1, count), plane(2, count)};
+        for (idx_t i = 0; i < rows; ++i)
+        {
+            const uint8_t *src = reader.row(i);
+            for (idx_t j = 0; j < cols; ++j)
+                for (idx_t clr = 0; clr < 3; ++clr)
+                    dst[clr][i * cols + j] = static_cast<S>(src[j * 3 + clr]);
+        }
     }
 
-    video_created_ = true;
+    if (count == 0)
+        throw std::runtime_error("No frames decoded: " + path);
+    if (count != capacity)
+        resize_frames(count);
 }
 
-void CVideoView::write_video(const std::string &path)
+template <typename S> void CVideoViewT<S>::write_video(const std::string &path)
 {
     if (check_ext(path, video_extensions))
         video_.save_video(path.c_str(), static_cast<unsigned int>(fps_));
@@ -100,12 +222,40 @@ bool check_ext(const std::string &s, const std::vector<std::string> &exts)
     return false;
 }
 
-void CVideoView::check_created() const
+template <typename S> void CVideoViewT<S>::check_created() const
 {
     if (!video_created_)
         throw std::runtime_error{"video was not created"};
 }
 
+template <typename S> const S *CVideoViewT<S>::plane(idx_t clr, idx_t frame) const
+{
+    assert(clr < clrs());
+    assert(frame < frames());
+
+    check_created();
+    return video_.data(0, 0, static_cast<unsigned>(frame), static_cast<unsigned>(clr));
+}
+
+template <typename S> S *CVideoViewT<S>::plane(idx_t clr, idx_t frame)
+{
+    return const_cast<S *>(static_cast<const CVideoViewT &>(*this).plane(clr, frame));
+}
+
+template <typename S> void CVideoViewT<S>::resize_frames(idx_t frames)
+{
+    assert(frames > 0);
+    assert(frames <= static_cast<idx_t>(std::numeric_limits<int>::max()));
+
+    // Без интерполяции: первые кадры сохраняются, новые заполняются нулями
+    check_created();
+    video_.resize(-100, -100, static_cast<int>(frames), -100, 0);
+}
+
+template class CVideoViewT<uint8_t>;
+template class CVideoViewT<uint16_t>;
+template class CVideoViewT<int>;
+
 size_t get_fps(const std::string &path)
 {
     // Input video file path
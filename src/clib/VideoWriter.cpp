@@ -0,0 +1,161 @@
+#include "clib/VideoWriter.hpp"
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+#include <cassert>
+#include <limits>
+
+namespace clib
+{
+
+VideoWriter::VideoWriter(const std::string &path, idx_t rows, idx_t cols, double fps)
+    : rows_(rows), cols_(cols), rgb_(rows * cols * 3), view_(*this)
+{
+    assert(rows > 0 && rows % 2 == 0);
+    assert(cols > 0 && cols % 2 == 0);
+    assert(rows <= static_cast<idx_t>(std::numeric_limits<int>::max()));
+    assert(cols * 3 <= static_cast<idx_t>(std::numeric_limits<int>::max()));
+    assert(fps > 0);
+
+    if (avformat_alloc_output_context2(&format_, nullptr, nullptr, path.c_str()) < 0 || format_ == nullptr)
+        throw std::runtime_error("Unknown video format: " + path);
+
+    try
+    {
+        const AVCodec *encoder = avcodec_find_encoder(format_->oformat->video_codec);
+        if (encoder == nullptr)
+            throw std::runtime_error("No video encoder for: " + path);
+
+        stream_ = avformat_new_stream(format_, nullptr);
+        codec_ = avcodec_alloc_context3(encoder);
+        if (stream_ == nullptr || codec_ == nullptr)
+            throw std::bad_alloc();
+
+        const AVRational frame_rate = av_d2q(fps, 1 << 16);
+        codec_->width = static_cast<int>(cols);
+        codec_->height = static_cast<int>(rows);
+        codec_->pix_fmt = AV_PIX_FMT_YUV420P;
+        codec_->framerate = frame_rate;
+        codec_->time_base = av_inv_q(frame_rate);
+        codec_->thread_count = 0;
+        if ((format_->oformat->flags & AVFMT_GLOBALHEADER) != 0)
+            codec_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        if (avcodec_open2(codec_, encoder, nullptr) < 0)
+            throw std::runtime_error("Error opening video encoder");
+        if (avcodec_parameters_from_context(stream_->codecpar, codec_) < 0)
+            throw std::runtime_error("Error setting video stream parameters");
+        stream_->time_base = codec_->time_base;
+
+        if ((format_->oformat->flags & AVFMT_NOFILE) == 0 && avio_open(&format_->pb, path.c_str(), AVIO_FLAG_WRITE) < 0)
+            throw std::runtime_error("Error opening video file: " + path);
+        if (avformat_write_header(format_, nullptr) < 0)
+            throw std::runtime_error("Error writing video header");
+
+        frame_ = av_frame_alloc();
+        packet_ = av_packet_alloc();
+        if (frame_ == nullptr || packet_ == nullptr)
+            throw std::bad_alloc();
+
+        frame_->format = codec_->pix_fmt;
+        frame_->width = codec_->width;
+        frame_->height = codec_->height;
+        if (av_frame_get_buffer(frame_, 0) < 0)
+            throw std::bad_alloc();
+
+        sws_ = sws_getContext(codec_->width, codec_->height, AV_PIX_FMT_RGB24, codec_->width, codec_->height,
+                              codec_->pix_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (sws_ == nullptr)
+            throw std::runtime_error("Error creating pixel format converter");
+    }
+    catch (...)
+    {
+        close();
+        throw;
+    }
+}
+
+VideoWriter::~VideoWriter()
+{
+    try
+    {
+        finish();
+    }
+    catch (...)
+    {
+    }
+    close();
+}
+
+void VideoWriter::write_frame()
+{
+    assert(!finished_);
+
+    // Кодер может еще держать ссылку на буфер предыдущего кадра
+    if (av_frame_make_writable(frame_) < 0)
+        throw std::bad_alloc();
+
+    const uint8_t *src[1] = {rgb_.data()};
+    const int src_stride[1] = {static_cast<int>(cols_ * 3)};
+    sws_scale(sws_, src, src_stride, 0, static_cast<int>(rows_), frame_->data, frame_->linesize);
+
+    frame_->pts = static_cast<int64_t>(written_);
+    send(frame_);
+    ++written_;
+}
+
+void VideoWriter::finish()
+{
+    if (finished_)
+        return;
+    finished_ = true;
+
+    send(nullptr);
+    if (av_write_trailer(format_) < 0)
+        throw std::runtime_error("Error writing video trailer");
+}
+
+void VideoWriter::send(AVFrame *frame)
+{
+    if (avcodec_send_frame(codec_, frame) < 0)
+        throw std::runtime_error("Error sending frame to video encoder");
+
+    while (true)
+    {
+        int ret = avcodec_receive_packet(codec_, packet_);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            return;
+        if (ret < 0)
+            throw std::runtime_error("Error encoding video frame");
+
+        av_packet_rescale_ts(packet_, codec_->time_base, stream_->time_base);
+        packet_->stream_index = stream_->index;
+
+        // av_interleaved_write_frame забирает данные пакета
+        if (av_interleaved_write_frame(format_, packet_) < 0)
+            throw std::runtime_error("Error writing video packet");
+    }
+}
+
+void VideoWriter::close() noexcept
+{
+    sws_freeContext(sws_);
+    sws_ = nullptr;
+    av_packet_free(&packet_);
+    av_frame_free(&frame_);
+    avcodec_free_context(&codec_);
+    if (format_ != nullptr)
+    {
+        if ((format_->oformat->flags & AVFMT_NOFILE) == 0)
+            avio_closep(&format_->pb);
+        avformat_free_context(format_);
+        format_ = nullptr;
+    }
+}
+
+} // namespace clib
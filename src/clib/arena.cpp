@@ -0,0 +1,186 @@
+#include "clib/arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace clib
+{
+
+namespace
+{
+thread_local frame_arena *tls_arena = nullptr;
+
+// Счетчики выделений из кучи по потокам. Поток пишет только в свой счетчик, без атомарного сложения и без
+// разделяемой кэш-линии; heap_allocations складывает все счетчики. Счет завершившегося потока переносится в retired
+struct heap_counters
+{
+    std::mutex mutex{};
+    std::vector<const std::atomic<size_t> *> live{};
+    size_t retired = 0;
+};
+
+heap_counters &counters()
+{
+    static heap_counters res;
+    return res;
+}
+
+struct heap_counter
+{
+    std::atomic<size_t> count{0};
+
+    heap_counter()
+    {
+        heap_counters &all = counters();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        all.live.push_back(&count);
+    }
+
+    ~heap_counter()
+    {
+        heap_counters &all = counters();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        all.retired += count.load(std::memory_order_relaxed);
+        all.live.erase(std::find(all.live.begin(), all.live.end(), &count));
+    }
+
+    heap_counter(const heap_counter &) = delete;
+    heap_counter &operator=(const heap_counter &) = delete;
+};
+
+thread_local heap_counter tls_heap_counter;
+
+size_t align_up(size_t value, size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+} // namespace
+
+frame_arena::frame_arena(size_t block_size)
+    : block_size_(block_size), mutex_(), blocks_(), large_(), current_index_(0), current_(nullptr), allocations_(0),
+      bytes_(0), blocks_count_(0)
+{
+    assert(block_size_ != 0);
+}
+
+void *frame_arena::allocate(size_t bytes, size_t align)
+{
+    assert(align != 0 && (align & (align - 1)) == 0);
+    assert(align <= alignof(std::max_align_t));
+
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    if (bytes == 0)
+        bytes = 1;
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+
+    if (bytes > block_size_)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        large_.emplace_back(new char[bytes]);
+        blocks_count_.fetch_add(1, std::memory_order_relaxed);
+        return large_.back().get();
+    }
+
+    for (;;)
+    {
+        block *cur = current_.load(std::memory_order_acquire);
+        if (cur != nullptr)
+        {
+            size_t used = cur->used.load(std::memory_order_relaxed);
+            size_t start = align_up(used, align);
+            while (start + bytes <= block_size_)
+            {
+                if (cur->used.compare_exchange_weak(used, start + bytes, std::memory_order_relaxed))
+                    return cur->data.get() + start;
+                start = align_up(used, align);
+            }
+        }
+        next_block(cur);
+    }
+}
+
+void frame_arena::next_block(block *full)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Другой поток уже сменил блок
+    if (current_.load(std::memory_order_relaxed) != full)
+        return;
+
+    if (full != nullptr)
+        ++current_index_;
+    if (current_index_ == blocks_.size())
+    {
+        blocks_.emplace_back(new block{std::unique_ptr<char[]>(new char[block_size_]), {0}});
+        blocks_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    block *next = blocks_[current_index_].get();
+    next->used.store(0, std::memory_order_relaxed);
+    current_.store(next, std::memory_order_release);
+}
+
+void frame_arena::reset() noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    current_index_ = 0;
+    current_.store(blocks_.empty() ? nullptr : blocks_[0].get(), std::memory_order_release);
+    if (!blocks_.empty())
+        blocks_[0]->used.store(0, std::memory_order_relaxed);
+    large_.clear();
+    allocations_.store(0, std::memory_order_relaxed);
+    bytes_.store(0, std::memory_order_relaxed);
+}
+
+frame_arena::counters frame_arena::stats() const
+{
+    counters res;
+    res.allocations = allocations_.load(std::memory_order_relaxed);
+    res.bytes = bytes_.load(std::memory_order_relaxed);
+    res.blocks = blocks_count_.load(std::memory_order_relaxed);
+    return res;
+}
+
+frame_arena *current_arena() noexcept
+{
+    return tls_arena;
+}
+
+size_t heap_allocations() noexcept
+{
+    heap_counters &all = counters();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    size_t res = all.retired;
+    for (const std::atomic<size_t> *count : all.live)
+        res += count->load(std::memory_order_relaxed);
+    return res;
+}
+
+arena_scope::arena_scope(frame_arena &arena) : prev_(tls_arena)
+{
+    tls_arena = &arena;
+}
+
+arena_scope::arena_scope(frame_arena *arena) : prev_(tls_arena)
+{
+    tls_arena = arena;
+}
+
+arena_scope::~arena_scope()
+{
+    tls_arena = prev_;
+}
+
+namespace detail
+{
+void *heap_allocate(size_t bytes)
+{
+    // Единственный писатель: обычный инкремент, atomic только для чтения из heap_allocations
+    std::atomic<size_t> &count = tls_heap_counter.count;
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return ::operator new(bytes);
+}
+} // namespace detail
+
+} // namespace clib
@@ -0,0 +1,189 @@
+#include "clib/dump.hpp"
+
+#include <cerrno>
+#include <limits>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace clib
+{
+
+namespace
+{
+const char dump_magic[8] = {'C', 'L', 'I', 'B', 'D', 'M', 'P', '1'};
+constexpr uint64_t dump_align = 64;
+
+// Заголовок записи; за ним имя и, с выравниванием words_offset, слова. Записи начинаются с адресов, кратных dump_align
+struct record_header
+{
+    char magic[8] = {};
+    uint64_t words_offset = 0; ///< от начала записи
+    uint64_t words_size = 0;   ///< байт слов
+    uint64_t name_size = 0;
+    uint64_t frames = 0;
+    uint64_t clrs = 0;
+    uint64_t rows = 0;
+    uint64_t cols = 0;
+    dump_format format{};
+};
+
+uint64_t align_up(uint64_t n)
+{
+    return (n + dump_align - 1) / dump_align * dump_align;
+}
+
+bool known_format(const dump_format &format)
+{
+    return (format.kind == dump_format::flexfloat || format.kind == dump_format::flexfixed) &&
+           (format.word == 1 || format.word == 2 || format.word == 4 || format.word == 8);
+}
+
+// Размер слов записи по размерам из заголовка; false, если произведение не помещается в uint64_t
+bool words_bytes(const record_header &header, uint64_t &bytes)
+{
+    bytes = header.format.word;
+    for (const uint64_t factor : {header.frames, header.clrs, header.rows, header.cols})
+    {
+        if (factor != 0 && bytes > std::numeric_limits<uint64_t>::max() / factor)
+            return false;
+        bytes *= factor;
+    }
+    return true;
+}
+} // namespace
+
+dump_writer::dump_writer(const std::string &path) : file_(path, std::ios::binary | std::ios::trunc), path_(path), buf_()
+{
+    if (!file_)
+        throw std::runtime_error("Error creating dump file: " + path);
+}
+
+void dump_writer::flush()
+{
+    if (!file_.flush())
+        throw std::runtime_error("Error writing dump file: " + path_);
+}
+
+void dump_writer::begin(const std::string &name, const dump_format &format, idx_t frames, idx_t clrs, idx_t rows,
+                        idx_t cols)
+{
+    if (left_ != 0)
+        throw std::logic_error("Previous dump record is incomplete: " + path_);
+
+    record_header header;
+    std::memcpy(header.magic, dump_magic, sizeof(dump_magic));
+    header.words_offset = align_up(sizeof(record_header) + name.size());
+    header.words_size = frames * clrs * rows * cols * format.word;
+    header.name_size = name.size();
+    header.frames = frames;
+    header.clrs = clrs;
+    header.rows = rows;
+    header.cols = cols;
+    header.format = format;
+
+    std::vector<char> head(header.words_offset, 0);
+    std::memcpy(head.data(), &header, sizeof(record_header));
+    std::memcpy(head.data() + sizeof(record_header), name.data(), name.size());
+    put(head.data(), head.size());
+
+    left_ = header.words_size;
+}
+
+void dump_writer::put(const char *data, uint64_t bytes)
+{
+    if (!file_.write(data, static_cast<std::streamsize>(bytes)))
+        throw std::runtime_error("Error writing dump file: " + path_);
+    left_ -= std::min(left_, bytes);
+}
+
+void dump_writer::end()
+{
+    assert(left_ == 0);
+
+    // Следующая запись начинается с выровненного адреса
+    const uint64_t pos = static_cast<uint64_t>(file_.tellp());
+    const std::vector<char> pad(align_up(pos) - pos, 0);
+    put(pad.data(), pad.size());
+}
+
+dump_reader::dump_reader(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::system_error(errno, std::generic_category(), "fstat " + path);
+    }
+
+    bytes_ = static_cast<idx_t>(st.st_size);
+    if (bytes_ != 0)
+    {
+        map_ = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+        if (map_ == MAP_FAILED)
+        {
+            map_ = nullptr;
+            ::close(fd);
+            throw std::system_error(errno, std::generic_category(), "mmap " + path);
+        }
+    }
+    ::close(fd);
+
+    // Последняя запись, оборванная при записи, не читается
+    const unsigned char *base = static_cast<const unsigned char *>(map_);
+    for (uint64_t pos = 0; pos + sizeof(record_header) <= bytes_;)
+    {
+        record_header header;
+        std::memcpy(&header, base + pos, sizeof(record_header));
+        // Поля заголовка произвольны, поэтому суммы и произведения проверяются без переполнения
+        uint64_t words = 0;
+        const bool known = std::memcmp(header.magic, dump_magic, sizeof(dump_magic)) == 0 &&
+                           known_format(header.format) && header.words_offset >= sizeof(record_header) &&
+                           header.name_size <= header.words_offset - sizeof(record_header) &&
+                           words_bytes(header, words) && header.words_size == words;
+        if (!known)
+        {
+            munmap(map_, bytes_);
+            throw std::runtime_error("Not a dump file: " + path);
+        }
+
+        const uint64_t left = bytes_ - pos;
+        if (header.words_offset > left || header.words_size > left - header.words_offset)
+            break;
+
+        entry e;
+        e.name.assign(reinterpret_cast<const char *>(base + pos + sizeof(record_header)), header.name_size);
+        e.format = header.format;
+        e.frames = header.frames;
+        e.clrs = header.clrs;
+        e.rows = header.rows;
+        e.cols = header.cols;
+        e.words = base + pos + header.words_offset;
+        entries_.push_back(e);
+
+        pos += align_up(header.words_offset + header.words_size);
+    }
+}
+
+dump_reader::~dump_reader()
+{
+    if (map_ != nullptr)
+        munmap(map_, bytes_);
+}
+
+const dump_reader::entry &dump_reader::find(const std::string &name) const
+{
+    for (const entry &e : entries_)
+        if (e.name == name)
+            return e;
+    throw std::out_of_range("No dump record: " + name);
+}
+
+} // namespace clib
@@ -0,0 +1,41 @@
+#include "clib/fft.hpp"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace clib
+{
+
+namespace
+{
+using twiddle_key = std::tuple<int, int, int, ImgView::idx_t>;
+
+std::mutex twiddles_mutex;
+std::map<twiddle_key, fft_twiddles<Flexfloat>::table_t> twiddles_cache;
+} // namespace
+
+fft_twiddles<Flexfloat>::table_t fft_twiddles<Flexfloat>::get(const Flexfloat &proto, ImgView::idx_t n)
+{
+    const twiddle_key key(proto.get_E(), proto.get_M(), proto.get_B(), n);
+
+    std::lock_guard<std::mutex> lock(twiddles_mutex);
+
+    auto it = twiddles_cache.find(key);
+    if (it != twiddles_cache.end())
+        return it->second;
+
+    auto table = std::make_shared<std::vector<complex_t<Flexfloat>>>(n, complex_t<Flexfloat>{proto, proto});
+    for (ImgView::idx_t k = 0; k < n; ++k)
+    {
+        auto &w = (*table)[k];
+        Flexfloat::cos_sin_turn(k, n, w.re, w.im);
+
+        // exp(-i * phi) = cos(phi) - i * sin(phi)
+        Flexfloat::negative(w.im, w.im);
+    }
+
+    return twiddles_cache.emplace(key, std::move(table)).first->second;
+}
+
+} // namespace clib
@@ -1,6 +1,8 @@
 #include "clib/image.hpp"
+#include "clib/Fastfloat.hpp"
 #include "clib/Flexfloat.hpp"
 
 namespace clib {
     template class img<Flexfloat>;
+    template class img<Fastfloat>;
 } // namespace clib
@@ -0,0 +1,134 @@
+#include "clib/mask.hpp"
+
+#include <cassert>
+
+namespace clib
+{
+
+img_mask::img_mask(idx_t rows, idx_t cols, bool value)
+    : rows_(rows), cols_(cols), stride_((cols + WORD_BITS - 1) / WORD_BITS),
+      words_(rows * stride_, value ? ~word_t(0) : word_t(0))
+{
+    if (value && stride_ != 0)
+        for (idx_t i = 0; i < rows_; ++i)
+            row(i)[stride_ - 1] &= tail_mask();
+}
+
+img_mask::img_mask(const std::vector<std::vector<bool>> &flags)
+    : img_mask(flags.size(), flags.empty() ? 0 : flags[0].size())
+{
+    for (idx_t i = 0; i < rows_; ++i)
+    {
+        assert(flags[i].size() == cols_);
+        for (idx_t j = 0; j < cols_; ++j)
+            if (flags[i][j])
+                set(i, j, true);
+    }
+}
+
+img_mask::word_t img_mask::tail_mask() const noexcept
+{
+    const idx_t used = cols_ % WORD_BITS;
+    return used == 0 ? ~word_t(0) : (word_t(1) << used) - 1;
+}
+
+img_mask::idx_t img_mask::count() const noexcept
+{
+    idx_t res = 0;
+    for (word_t word : words_)
+        res += static_cast<idx_t>(__builtin_popcountll(word));
+
+    return res;
+}
+
+bool img_mask::any() const noexcept
+{
+    for (word_t word : words_)
+        if (word != 0)
+            return true;
+
+    return false;
+}
+
+bool img_mask::all() const noexcept
+{
+    return count() == rows_ * cols_;
+}
+
+std::vector<std::vector<bool>> img_mask::to_vector() const
+{
+    std::vector<std::vector<bool>> flags(rows_, std::vector<bool>(cols_));
+    for (idx_t i = 0; i < rows_; ++i)
+        for (idx_t j = 0; j < cols_; ++j)
+            flags[i][j] = (*this)(i, j);
+
+    return flags;
+}
+
+img_mask &img_mask::operator&=(const img_mask &rhs) noexcept
+{
+    assert(rows_ == rhs.rows_ && cols_ == rhs.cols_);
+    for (idx_t k = 0; k < words_.size(); ++k)
+        words_[k] &= rhs.words_[k];
+
+    return *this;
+}
+
+img_mask &img_mask::operator|=(const img_mask &rhs) noexcept
+{
+    assert(rows_ == rhs.rows_ && cols_ == rhs.cols_);
+    for (idx_t k = 0; k < words_.size(); ++k)
+        words_[k] |= rhs.words_[k];
+
+    return *this;
+}
+
+img_mask &img_mask::operator^=(const img_mask &rhs) noexcept
+{
+    assert(rows_ == rhs.rows_ && cols_ == rhs.cols_);
+    for (idx_t k = 0; k < words_.size(); ++k)
+        words_[k] ^= rhs.words_[k];
+
+    return *this;
+}
+
+img_mask img_mask::operator~() const
+{
+    img_mask res(*this);
+    for (word_t &word : res.words_)
+        word = ~word;
+
+    // Хвост строки должен остаться нулевым, иначе count() и == учтут лишние биты
+    if (stride_ != 0)
+        for (idx_t i = 0; i < rows_; ++i)
+            res.row(i)[stride_ - 1] &= tail_mask();
+
+    return res;
+}
+
+img_mask operator&(img_mask lhs, const img_mask &rhs) noexcept
+{
+    return lhs &= rhs;
+}
+
+img_mask operator|(img_mask lhs, const img_mask &rhs) noexcept
+{
+    return lhs |= rhs;
+}
+
+img_mask operator^(img_mask lhs, const img_mask &rhs) noexcept
+{
+    return lhs ^= rhs;
+}
+
+bool operator==(const img_mask &lhs, const img_mask &rhs) noexcept
+{
+    return lhs.rows_ == rhs.rows_ && lhs.cols_ == rhs.cols_ && lhs.words_ == rhs.words_;
+}
+
+bool operator!=(const img_mask &lhs, const img_mask &rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+} // namespace clib
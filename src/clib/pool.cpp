@@ -0,0 +1,326 @@
+#include "clib/pool.hpp"
+#include "clib/arena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+
+namespace clib
+{
+
+namespace
+{
+// Рабочий поток, выполняющий текущий код
+thread_local const thread_pool *tls_pool = nullptr;
+thread_local thread_pool::idx_t tls_worker = 0;
+
+// Ожидание завершения группы задач
+struct completion
+{
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    size_t left = 0;
+    std::exception_ptr error{};
+
+    void done(std::exception_ptr err)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (err && !error)
+            error = err;
+        if (--left == 0)
+            cv.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return left == 0; });
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+} // namespace
+
+std::vector<int> numa_topology::parse_cpulist(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ','))
+    {
+        if (range.empty() || range == "\n")
+            continue;
+
+        const auto dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+std::vector<int> numa_topology::allowed_cpus()
+{
+    std::vector<int> cpus;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return cpus;
+
+    for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &set))
+            cpus.push_back(static_cast<int>(cpu));
+    return cpus;
+}
+
+void numa_topology::restrict_to(const std::vector<int> &allowed)
+{
+    auto disallowed = [&](int cpu) { return std::find(allowed.begin(), allowed.end(), cpu) == allowed.end(); };
+    for (auto &cpus : node_cpus)
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(), disallowed), cpus.end());
+
+    node_cpus.erase(std::remove_if(node_cpus.begin(), node_cpus.end(),
+                                   [](const std::vector<int> &cpus) { return cpus.empty(); }),
+                    node_cpus.end());
+}
+
+numa_topology numa_topology::detect()
+{
+    numa_topology res;
+
+    for (int node = 0;; ++node)
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!file)
+            break;
+
+        std::string list;
+        std::getline(file, list);
+        auto cpus = parse_cpulist(list);
+        if (!cpus.empty())
+            res.node_cpus.push_back(std::move(cpus));
+    }
+
+    // Процессы под taskset или в контейнере видят в sysfs все процессоры машины
+    const std::vector<int> allowed = allowed_cpus();
+    if (!allowed.empty())
+        res.restrict_to(allowed);
+
+    if (res.node_cpus.empty())
+    {
+        if (!allowed.empty())
+            res.node_cpus.push_back(allowed);
+        else
+        {
+            const int hard_conc = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+            res.node_cpus.emplace_back();
+            for (int cpu = 0; cpu < hard_conc; ++cpu)
+                res.node_cpus[0].push_back(cpu);
+        }
+    }
+
+    return res;
+}
+
+thread_pool &thread_pool::instance()
+{
+    static thread_pool pool(numa_topology::detect());
+    return pool;
+}
+
+thread_pool::thread_pool(const numa_topology &topology, bool pin) : workers_()
+{
+    assert(!topology.node_cpus.empty());
+
+    for (idx_t node = 0; node < topology.node_cpus.size(); ++node)
+        for (idx_t k = 0; k < topology.node_cpus[node].size(); ++k)
+        {
+            workers_.emplace_back(new worker_state);
+            workers_.back()->node = node;
+        }
+
+    for (idx_t w = 0; w < workers_.size(); ++w)
+    {
+        worker_state &state = *workers_[w];
+        state.thread = std::thread(&thread_pool::loop, this, w);
+        if (!pin)
+            continue;
+
+        // Поток закрепляется за процессорами узла, а не за одним процессором: планировщик может перемещать его
+        // внутри узла, память остается локальной. Задачи появляются только после конструктора, поэтому все они
+        // выполняются уже закрепленными потоками. Если закрепить не удалось (например, процессор не разрешен
+        // процессу), поток остается на разрешенных процессорах
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : topology.node_cpus[state.node])
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(static_cast<size_t>(cpu), &set);
+        state.pinned = pthread_setaffinity_np(state.thread.native_handle(), sizeof(set), &set) == 0;
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    for (auto &w : workers_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(w->mutex);
+            w->stop = true;
+        }
+        w->cv.notify_one();
+    }
+    for (auto &w : workers_)
+        w->thread.join();
+}
+
+thread_pool::idx_t thread_pool::current_worker() const noexcept
+{
+    return tls_pool == this ? tls_worker : workers();
+}
+
+void thread_pool::submit(idx_t index, std::function<void()> task)
+{
+    worker_state &w = *workers_[index];
+    {
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.queue.push_back(std::move(task));
+    }
+    w.cv.notify_one();
+}
+
+void thread_pool::loop(idx_t index)
+{
+    tls_pool = this;
+    tls_worker = index;
+
+    worker_state &w = *workers_[index];
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(w.mutex);
+            w.cv.wait(lock, [&w] { return w.stop || !w.queue.empty(); });
+            if (w.queue.empty())
+                return;
+            task = std::move(w.queue.front());
+            w.queue.pop_front();
+        }
+        task();
+    }
+}
+
+void thread_pool::bands(idx_t nthreads, idx_t rows, const band_func &func)
+{
+    assert(nthreads > 0);
+    assert(rows != 0);
+
+    const idx_t bsize = std::max(rows / nthreads, idx_t(1));
+
+    std::vector<std::pair<idx_t, idx_t>> chunks;
+    idx_t last_row = 0;
+    for (idx_t t = 0; t < nthreads && last_row + bsize <= rows; ++t, last_row += bsize)
+        chunks.emplace_back(last_row, last_row + bsize);
+    if (last_row < rows)
+        chunks.emplace_back(last_row, rows);
+
+    // Одна полоса или вложенный вызов из рабочего потока - в текущем потоке
+    if (chunks.size() == 1 || current_worker() != workers())
+    {
+        for (const auto &chunk : chunks)
+            func(chunk.first, chunk.second);
+        return;
+    }
+
+    completion sync;
+    sync.left = chunks.size();
+
+    frame_arena *arena = current_arena();
+    for (const auto &chunk : chunks)
+        submit(worker_for(chunk.first, rows), [&sync, &func, arena, chunk] {
+            std::exception_ptr err;
+            try
+            {
+                arena_scope scope(arena);
+                func(chunk.first, chunk.second);
+            }
+            catch (...)
+            {
+                err = std::current_exception();
+            }
+            sync.done(err);
+        });
+
+    sync.wait();
+}
+
+void thread_pool::tasks(idx_t tasks, idx_t nthreads, const task_func &func)
+{
+    assert(nthreads > 0);
+
+    nthreads = std::min({nthreads, tasks, workers() + 1});
+
+    // Одна задача, один поток или вложенный вызов из рабочего потока - в текущем потоке
+    if (nthreads <= 1 || current_worker() != workers())
+    {
+        for (idx_t task = 0; task < tasks; ++task)
+            func(task);
+        return;
+    }
+
+    std::atomic<idx_t> next_task{0};
+    completion sync;
+    sync.left = nthreads - 1;
+
+    auto drain = [&next_task, &func, tasks] {
+        for (idx_t task = next_task++; task < tasks; task = next_task++)
+        {
+            try
+            {
+                func(task);
+            }
+            catch (...)
+            {
+                next_task = tasks;
+                throw;
+            }
+        }
+    };
+
+    frame_arena *arena = current_arena();
+    for (idx_t t = 1; t < nthreads; ++t)
+        submit(worker_for(t - 1, nthreads - 1), [&sync, &drain, arena] {
+            std::exception_ptr err;
+            try
+            {
+                arena_scope scope(arena);
+                drain();
+            }
+            catch (...)
+            {
+                err = std::current_exception();
+            }
+            sync.done(err);
+        });
+
+    std::exception_ptr err;
+    try
+    {
+        drain();
+    }
+    catch (...)
+    {
+        err = std::current_exception();
+    }
+    sync.wait();
+    if (err)
+        std::rethrow_exception(err);
+}
+
+} // namespace clib
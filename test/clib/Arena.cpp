@@ -0,0 +1,131 @@
+#include <doctest.h>
+#include "clib/Flexfloat.hpp"
+#include "clib/arena.hpp"
+#include "clib/image.hpp"
+#include "common.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+using ff = clib::Flexfloat;
+using img = clib::img<ff>;
+
+TEST_CASE("Test Arena Frames")
+{
+    const std::vector<std::vector<ff>> kernel(3, std::vector<ff>(3, ff::from_arithmetic_t(8, 23, 127, 1)));
+    clib::frame_arena arena(64 * 1024);
+
+    size_t blocks = 0;
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        const img input = make_frame(40, 50, frame);
+        const auto expected = img::convolution(kernel, input, clib::border_t::mirror, ff(), 4).vv();
+
+        const size_t heap_before = clib::heap_allocations();
+        {
+            clib::arena_scope scope(arena);
+
+            img res = img::convolution(kernel, input, clib::border_t::mirror, ff(), 4);
+            img sum = res + res;
+            CHECK(res.row(0) != nullptr);
+            CHECK(sum.cols() == 50);
+
+            // Строки, заполненные рабочими потоками, тоже берутся из арены
+            CHECK(clib::heap_allocations() == heap_before);
+            CHECK(arena.stats().allocations > 40);
+            CHECK(res.vv() == expected);
+        }
+
+        // Вне области арены память снова берется из кучи
+        img outside(input);
+        CHECK(clib::heap_allocations() > heap_before);
+
+        arena.reset();
+        CHECK(arena.stats().allocations == 0);
+        CHECK(arena.stats().bytes == 0);
+
+        // Блоки переиспользуются между кадрами
+        if (frame == 0)
+            blocks = arena.stats().blocks;
+        CHECK(arena.stats().blocks == blocks);
+    }
+
+    // Запрос больше блока
+    CHECK(arena.allocate(100 * 1024) != nullptr);
+    CHECK(arena.stats().blocks == blocks + 1);
+    arena.reset();
+}
+
+TEST_CASE("Test Arena Threads")
+{
+    // Потоки занимают место в общих блоках одновременно; выделенные участки не пересекаются
+    clib::frame_arena arena(4096);
+    const size_t nthreads = 4, count = 2000;
+
+    std::vector<std::vector<std::pair<char *, size_t>>> chunks(nthreads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < nthreads; ++t)
+        threads.emplace_back([&, t] {
+            for (size_t k = 0; k < count; ++k)
+            {
+                const size_t bytes = 1 + (k * 7 + t) % 100;
+                char *ptr = static_cast<char *>(arena.allocate(bytes, 8));
+                std::fill(ptr, ptr + bytes, static_cast<char>(t));
+                chunks[t].emplace_back(ptr, bytes);
+            }
+        });
+    for (std::thread &th : threads)
+        th.join();
+
+    std::vector<std::pair<char *, size_t>> all;
+    bool filled = true;
+    for (size_t t = 0; t < nthreads; ++t)
+        for (const auto &chunk : chunks[t])
+        {
+            CHECK(reinterpret_cast<uintptr_t>(chunk.first) % 8 == 0);
+            filled = filled && std::all_of(chunk.first, chunk.first + chunk.second,
+                                           [t](char c) { return c == static_cast<char>(t); });
+            all.push_back(chunk);
+        }
+    CHECK(filled);
+
+    std::sort(all.begin(), all.end());
+    bool disjoint = true;
+    for (size_t k = 1; k < all.size(); ++k)
+        disjoint = disjoint && all[k - 1].first + all[k - 1].second <= all[k].first;
+    CHECK(disjoint);
+
+    CHECK(arena.stats().allocations == nthreads * count);
+    const size_t blocks = arena.stats().blocks;
+    CHECK(blocks > 1);
+
+    // После reset блоки переиспользуются
+    arena.reset();
+    for (size_t k = 0; k < 100; ++k)
+        arena.allocate(100);
+    CHECK(arena.stats().blocks == blocks);
+}
+
+TEST_CASE("Test Arena Heap Counter")
+{
+    // Счетчики потоков складываются при чтении, счет завершившихся потоков сохраняется
+    const size_t nthreads = 4, count = 500;
+    const size_t before = clib::heap_allocations();
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < nthreads; ++t)
+        threads.emplace_back([] {
+            clib::frame_allocator<int> alloc(nullptr);
+            for (size_t k = 0; k < count; ++k)
+                alloc.deallocate(alloc.allocate(4), 4);
+        });
+    for (std::thread &th : threads)
+        th.join();
+
+    CHECK(clib::heap_allocations() - before == nthreads * count);
+
+    clib::frame_allocator<int> alloc(nullptr);
+    alloc.deallocate(alloc.allocate(4), 4);
+    CHECK(clib::heap_allocations() - before == nthreads * count + 1);
+}
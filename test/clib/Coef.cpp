@@ -0,0 +1,126 @@
+#include <doctest.h>
+#include "clib/Flexfixed.hpp"
+#include "clib/Flexfloat.hpp"
+#include "clib/coef.hpp"
+
+using ff = clib::Flexfloat;
+using fx = clib::Flexfixed;
+
+namespace
+{
+bool same_bits(const ff &lhs, const ff &rhs)
+{
+    return lhs.get_E() == rhs.get_E() && lhs.get_M() == rhs.get_M() && lhs.get_B() == rhs.get_B() &&
+           lhs.get_s() == rhs.get_s() && lhs.get_e() == rhs.get_e() && lhs.get_m() == rhs.get_m();
+}
+
+bool same_bits(const fx &lhs, const fx &rhs)
+{
+    return lhs.get_params() == rhs.get_params() && lhs.get_s() == rhs.get_s() && lhs.get_n() == rhs.get_n();
+}
+} // namespace
+
+TEST_CASE("Test Coef Flexfloat")
+{
+    const ff half = ff::from_arithmetic_t(5, 10, 15, 0), single = ff::from_arithmetic_t(8, 23, 127, 0);
+
+    std::vector<ff> coefs;
+    for (float value : {0.0f, -0.0f, 1.0f, -1.0f, 2.0f, -2.0f, 4.0f, 8.0f, 0.5f, -0.125f, 16384.0f, 6.103515625e-05f})
+        coefs.push_back(ff::from_arithmetic_t(half, value));
+    coefs.push_back(ff::from_arithmetic_t(single, 0.25f));
+    coefs.push_back(ff::from_arithmetic_t(single, -1024.0f));
+    for (const ff &coef : coefs)
+        CHECK(ff::is_pow2(coef));
+    CHECK(!ff::is_pow2(ff::from_arithmetic_t(half, 3.0f)));
+    CHECK(!ff::is_pow2(ff::from_arithmetic_t(half, -0.75f)));
+
+    // Все значения (5, 10, 15), включая денормализованные и насыщение, в формате x и в другом формате
+    for (const ff &coef : coefs)
+        for (uint64_t bits = 0; bits < (uint64_t(1) << 16); ++bits)
+        {
+            const ff x(5, 10, 15, bits);
+            for (const ff &proto : {half, single})
+            {
+                ff expected = proto, res = proto;
+                ff::mult(coef, x, expected);
+                ff::mult_pow2(coef, x, res);
+                CHECK_MESSAGE(same_bits(res, expected), coef, " * ", x);
+
+                // Результат на месте x
+                if (proto.get_E() == x.get_E())
+                {
+                    ff inplace = x;
+                    ff::mult_pow2(coef, inplace, inplace);
+                    CHECK(same_bits(inplace, expected));
+                }
+            }
+        }
+}
+
+TEST_CASE("Test Coef Flexfixed")
+{
+    const fx proto(8, 8), wide(4, 12);
+
+    std::vector<fx> coefs;
+    for (float value : {0.0f, 1.0f, -1.0f, 2.0f, -4.0f, 0.5f, 0.25f, 64.0f})
+        coefs.push_back(fx::from_arithmetic_t(proto, value));
+    for (const fx &coef : coefs)
+        CHECK(fx::is_pow2(coef));
+    CHECK(!fx::is_pow2(fx::from_arithmetic_t(proto, 3.0f)));
+
+    for (const fx &coef : coefs)
+        for (uint64_t n = 0; n < (uint64_t(1) << 16); n += 7)
+            for (uint8_t s : {0, 1})
+            {
+                const fx x(8, 8, s, n);
+                for (const fx &out : {proto, wide})
+                {
+                    fx expected = out, res = out;
+                    fx::mult(coef, x, expected);
+                    fx::mult_pow2(coef, x, res);
+                    CHECK(same_bits(res, expected));
+                }
+            }
+}
+
+TEST_CASE("Test Coef Mult Add")
+{
+    const ff proto = ff::from_arithmetic_t(5, 10, 15, 0);
+
+    for (float value : {0.0f, -0.0f, 2.0f, -0.5f, 3.0f})
+    {
+        const clib::const_coef<ff> coef(ff::from_arithmetic_t(proto, value));
+        CHECK(coef.is_zero() == (value == 0.0f));
+        CHECK(coef.is_pow2() == (value != 3.0f));
+
+        for (float acc_value : {0.0f, -0.0f, 1.5f, -7.25f, 1e-6f, -3e-7f, 65000.0f})
+            for (float x_value : {0.0f, -0.0f, 1.0f, -3.5f, 2e-7f, 40000.0f})
+            {
+                const ff x = ff::from_arithmetic_t(proto, x_value);
+                const ff acc = ff::from_arithmetic_t(proto, acc_value);
+
+                ff expected = acc, tap = x;
+                ff::mult(coef.value(), tap, tap);
+                ff::sum(expected, tap, expected);
+
+                ff res = acc;
+                coef.mult_add(x, res);
+                CHECK(same_bits(res, expected));
+            }
+    }
+
+    const fx fproto(8, 8);
+    const clib::const_coef<fx> zero(fx::from_arithmetic_t(fproto, 0.0f));
+    for (float acc_value : {0.0f, 1.5f, -7.25f, 200.0f})
+    {
+        const fx x = fx::from_arithmetic_t(fproto, -2.5f), acc = fx::from_arithmetic_t(fproto, acc_value);
+
+        fx expected = acc, tap = x;
+        fx::mult(zero.value(), tap, tap);
+        fx::sum(expected, tap, expected);
+
+        fx res = acc;
+        zero.mult_add(x, res);
+        CHECK(same_bits(res, expected));
+    }
+}
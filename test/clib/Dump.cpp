@@ -0,0 +1,166 @@
+#include <doctest.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <unistd.h>
+#include "clib/dump.hpp"
+#include "clib/video.hpp"
+
+using clib::Flexfixed;
+using clib::Flexfloat;
+using clib::idx_t;
+using clib::img;
+using clib::img_rgb;
+
+TEST_CASE("Test Dump")
+{
+    const std::string path = "/tmp/clib_dump_" + std::to_string(getpid()) + ".dump";
+
+    // Flexfloat E = 5, M = 10 (слово 2 байта) и Flexfixed I = 12, F = 8 (слово 4 байта)
+    const Flexfloat ff_proto(5, 10, 15, 0, 0, 0);
+    img<Flexfloat> ff(ff_proto, 3, 5);
+    for (idx_t i = 0; i < 3; ++i)
+        for (idx_t j = 0; j < 5; ++j)
+            ff(i, j) = Flexfloat(5, 10, 15, static_cast<Flexfloat::stype>((i + j) % 2),
+                                 static_cast<Flexfloat::etype>(i * 5 + j), static_cast<Flexfloat::mtype>(j * 97 + i));
+
+    const Flexfixed fx_proto(12, 8);
+    img_rgb<Flexfixed> rgb(fx_proto, 2, 4);
+    for (idx_t clr = 0; clr < 3; ++clr)
+        for (idx_t i = 0; i < 2; ++i)
+            for (idx_t j = 0; j < 4; ++j)
+                rgb(i, j, clr) = Flexfixed(12, 8, static_cast<Flexfixed::stype>(j % 2), (clr * 1000 + i * 10 + j) << 5);
+
+    // Два кадра: второй - первый с другим знаком
+    std::vector<img_rgb<Flexfixed>> frames(2, rgb);
+    for (idx_t clr = 0; clr < 3; ++clr)
+        for (idx_t i = 0; i < 2; ++i)
+            for (idx_t j = 0; j < 4; ++j)
+                frames[1](i, j, clr) =
+                    Flexfixed(12, 8, static_cast<Flexfixed::stype>((j + 1) % 2), rgb(i, j, clr).get_n());
+    const clib::video<Flexfixed> vid(frames);
+
+    {
+        clib::dump_writer dump(path);
+        dump.write("ff", ff);
+        dump.write("rgb", rgb);
+        dump.write("bcast", img<Flexfloat>::broadcast(Flexfloat(3, 4, 3, 1, 3, 7), 2, 2));
+        dump.write("wide", img<Flexfloat>(Flexfloat(8, 31, 127, 1, 200, 0x7654321u), 1, 3));
+
+        // Числа с разными гиперпараметрами в одной записи не пишутся
+        img<Flexfloat> mixed(ff);
+        mixed(1, 1) = Flexfloat(6, 10, 31, 0, 0, 0);
+        CHECK_THROWS_AS(dump.write("mixed", mixed), std::invalid_argument);
+
+        // Отклоненная запись не оставляет в файле ничего, следующие записи пишутся
+        dump.write("after", ff);
+        dump.write("video", vid);
+    }
+
+    clib::dump_reader dump(path);
+    REQUIRE(dump.size() == 6);
+    CHECK(dump[4].name == "after");
+    CHECK(dump[0].name == "ff");
+    CHECK(dump[0].format.word == 2);
+    CHECK(dump[1].format.word == 4);
+    CHECK(dump[2].format.word == 1);
+    CHECK(dump[3].format.word == 8);
+    CHECK(dump[1].clrs == 3);
+    CHECK(reinterpret_cast<uintptr_t>(dump[1].words) % 64 == 0);
+
+    const img<Flexfloat> ff2 = dump.read_img<Flexfloat>("ff");
+    REQUIRE(ff2.rows() == 3);
+    REQUIRE(ff2.cols() == 5);
+    bool same = true;
+    for (idx_t i = 0; i < 3; ++i)
+        for (idx_t j = 0; j < 5; ++j)
+            same = same && ff2(i, j).bits() == ff(i, j).bits() && ff2(i, j).get_B() == 15;
+    CHECK(same);
+
+    const img_rgb<Flexfixed> rgb2 = dump.read_rgb<Flexfixed>("rgb");
+    same = true;
+    for (idx_t clr = 0; clr < 3; ++clr)
+        for (idx_t i = 0; i < 2; ++i)
+            for (idx_t j = 0; j < 4; ++j)
+                same = same && rgb2[clr](i, j).bits() == rgb[clr](i, j).bits() && rgb2[clr](i, j).get_F() == 8;
+    CHECK(same);
+    CHECK(dump.read_img<Flexfixed>("rgb", 0, 2)(1, 3).bits() == rgb[2](1, 3).bits());
+
+    CHECK(dump.read_img<Flexfloat>("bcast")(1, 0).bits() == Flexfloat(3, 4, 3, 1, 3, 7).bits());
+    CHECK(dump.read_img<Flexfloat>("wide")(0, 2).bits() == Flexfloat(8, 31, 127, 1, 200, 0x7654321u).bits());
+
+    const img<Flexfloat> after = dump.read_img<Flexfloat>("after");
+    same = true;
+    for (idx_t i = 0; i < 3; ++i)
+        for (idx_t j = 0; j < 5; ++j)
+            same = same && after(i, j).bits() == ff(i, j).bits();
+    CHECK(same);
+
+    CHECK(dump[5].frames == 2);
+    const clib::video<Flexfixed> vid2 = dump.read_video<Flexfixed>("video");
+    REQUIRE(vid2.frames() == 2);
+    REQUIRE(vid2.rows() == 2);
+    REQUIRE(vid2.cols() == 4);
+    same = true;
+    for (idx_t f = 0; f < 2; ++f)
+        for (idx_t clr = 0; clr < 3; ++clr)
+            for (idx_t i = 0; i < 2; ++i)
+                for (idx_t j = 0; j < 4; ++j)
+                    same = same && vid2(f)[clr](i, j).bits() == vid(f)[clr](i, j).bits() &&
+                           vid2(f)[clr](i, j).get_I() == 12;
+    CHECK(same);
+    CHECK(vid2(1)[0](0, 0).get_s() != vid2(0)[0](0, 0).get_s());
+
+    CHECK_THROWS_AS(dump.find("missing"), std::out_of_range);
+    CHECK_THROWS_AS(dump.read_img<Flexfixed>("ff"), std::invalid_argument);
+    CHECK_THROWS_AS(dump.read_rgb<Flexfloat>("ff"), std::invalid_argument);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Test Dump Corrupted Header")
+{
+    const std::string path = "/tmp/clib_dump_bad_" + std::to_string(getpid()) + ".dump";
+
+    const Flexfloat ff_proto(5, 10, 15, 0, 0, 0);
+    {
+        clib::dump_writer dump(path);
+        dump.write("ff", img<Flexfloat>(ff_proto, 3, 5));
+    }
+
+    std::vector<char> good;
+    {
+        std::ifstream in(path, std::ios::binary);
+        good.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Файл с одним полем заголовка первой записи, замененным на value
+    auto corrupt = [&](size_t offset, uint64_t value) {
+        std::vector<char> bad(good);
+        std::memcpy(bad.data() + offset, &value, sizeof(value));
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bad.data(), static_cast<std::streamsize>(bad.size()));
+    };
+
+    // Смещения полей: magic, words_offset, words_size, name_size, frames, clrs, rows, cols
+    const size_t name_size_at = 24, cols_at = 56;
+    uint64_t cols = 0;
+    std::memcpy(&cols, good.data() + cols_at, sizeof(cols));
+    REQUIRE(cols == 5);
+
+    // sizeof(record_header) + name_size переполняется и проходит проверку words_offset
+    corrupt(name_size_at, std::numeric_limits<uint64_t>::max() - 8);
+    CHECK_THROWS_AS(clib::dump_reader{path}, std::runtime_error);
+
+    // frames * clrs * rows * cols * word переполняется и совпадает с words_size
+    corrupt(cols_at, cols + (uint64_t(1) << 63));
+    CHECK_THROWS_AS(clib::dump_reader{path}, std::runtime_error);
+
+    corrupt(cols_at, cols);
+    CHECK(clib::dump_reader{path}.size() == 1);
+
+    std::remove(path.c_str());
+}
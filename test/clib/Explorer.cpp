@@ -0,0 +1,128 @@
+#include <doctest.h>
+#include <atomic>
+#include "clib/Flexfloat.hpp"
+#include "clib/explorer.hpp"
+#include "clib/image.hpp"
+#include "common.hpp"
+
+using ff = clib::Flexfloat;
+using img = clib::img<ff>;
+using format = ff::hyper_params;
+
+namespace
+{
+// Усиление: переводит вход в формат стадии и умножает на константу
+img gain(const img &in, const format &fmt)
+{
+    img res(in, fmt);
+    const ff k = ff::from_arithmetic_t(fmt.E, fmt.M, fmt.B, 3.3f);
+    for (size_t i = 0; i < res.rows(); ++i)
+        for (size_t j = 0; j < res.cols(); ++j)
+            ff::mult(res(i, j), k, res(i, j));
+    return res;
+}
+
+img blur(const img &in, const format &fmt)
+{
+    const std::vector<std::vector<ff>> kernel(3, std::vector<ff>(3, ff::from_arithmetic_t(fmt.E, fmt.M, fmt.B, 1)));
+    return img::convolution(kernel, img(in, fmt));
+}
+} // namespace
+
+TEST_CASE("Test Explorer Sweep")
+{
+    const std::vector<img> frames = {make_frame(9, 11, 0, 0.37f), make_frame(9, 11, 5, 0.37f)};
+
+    clib::explorer<ff> ex;
+    ex.stage("gain", gain, {{8, 23, 127}, {5, 10, 15}, {4, 3, 7}})
+        .stage("blur", blur, {{8, 23, 127}, {5, 10, 15}, {5, 6, 15}, {3, 4, 3}});
+
+    const clib::explore_report report = ex.run(frames, 0.0f, 1);
+    REQUIRE(report.results.size() == 12);
+
+    // Эталон + 3 префикса + 12 листьев, для каждого кадра
+    CHECK(report.stage_runs == (2 + 3 + 12) * frames.size());
+
+    // Набор форматов, совпадающий с эталоном
+    const auto &exact = report.results[0];
+    CHECK(exact.bits == 64);
+    CHECK(std::isinf(exact.psnr));
+    CHECK(exact.max_abs == 0.0f);
+    CHECK(exact.overflow == 0);
+
+    // (4, 3, 7) и (3, 4, 3) насыщаются на этом диапазоне
+    CHECK(report.results[11].stage_overflow[1] > 0);
+    CHECK(report.results[4].formats[0].M == 10);
+    CHECK(report.results[4].formats[1].M == 23);
+
+    for (auto metric : {clib::explore_metric::psnr, clib::explore_metric::max_abs})
+    {
+        const auto front = report.pareto(metric);
+        REQUIRE(!front.empty());
+        CHECK(front.back() == 0);
+
+        auto error = [&](size_t k) {
+            return metric == clib::explore_metric::psnr ? -report.results[k].psnr : report.results[k].max_abs;
+        };
+        for (size_t f = 1; f < front.size(); ++f)
+        {
+            CHECK(report.results[front[f - 1]].bits < report.results[front[f]].bits);
+            CHECK(error(front[f]) < error(front[f - 1]));
+        }
+        for (size_t f : front)
+            for (size_t k = 0; k < report.results.size(); ++k)
+                CHECK_FALSE((report.results[k].bits <= report.results[f].bits && error(k) < error(f)));
+    }
+
+    // Результат не зависит от количества потоков
+    const clib::explore_report parallel = ex.run(frames, 0.0f, 4);
+    for (size_t k = 0; k < report.results.size(); ++k)
+    {
+        CHECK(parallel.results[k].max_abs == report.results[k].max_abs);
+        CHECK(parallel.results[k].overflow == report.results[k].overflow);
+        CHECK((parallel.results[k].psnr == report.results[k].psnr ||
+               (std::isinf(parallel.results[k].psnr) && std::isinf(report.results[k].psnr))));
+    }
+}
+
+TEST_CASE("Test Explorer Deep Split")
+{
+    // Один кандидат первой стадии и один кадр: задачи появляются только на следующих уровнях
+    const std::vector<img> frames = {make_frame(9, 11, 3, 0.37f)};
+
+    std::atomic<size_t> gain_runs{0}, blur_runs{0}, last_runs{0};
+    auto counted = [](std::atomic<size_t> &runs, img (*func)(const img &, const format &)) {
+        return [&runs, func](const img &in, const format &fmt) {
+            ++runs;
+            return func(in, fmt);
+        };
+    };
+
+    clib::explorer<ff> ex;
+    ex.stage("gain", counted(gain_runs, gain), {{5, 10, 15}})
+        .stage("blur", counted(blur_runs, blur), {{8, 23, 127}, {5, 10, 15}, {4, 3, 7}})
+        .stage("gain2", counted(last_runs, gain), {{8, 23, 127}, {5, 6, 15}});
+
+    const clib::explore_report serial = ex.run(frames, 0.0f, 1);
+    REQUIRE(serial.results.size() == 6);
+
+    for (size_t threads : {size_t(2), size_t(4)})
+    {
+        gain_runs = blur_runs = last_runs = 0;
+        const clib::explore_report report = ex.run(frames, 0.0f, threads);
+
+        // Общие префиксы по-прежнему вычисляются один раз: эталон + 1 + 3 + 6
+        CHECK(gain_runs == 1 + 1);
+        CHECK(blur_runs == 1 + 3);
+        CHECK(last_runs == 1 + 6);
+        CHECK(report.stage_runs == serial.stage_runs);
+
+        for (size_t k = 0; k < serial.results.size(); ++k)
+        {
+            CHECK(report.results[k].max_abs == serial.results[k].max_abs);
+            CHECK(report.results[k].stage_overflow == serial.results[k].stage_overflow);
+            CHECK((report.results[k].psnr == serial.results[k].psnr ||
+                   (std::isinf(report.results[k].psnr) && std::isinf(serial.results[k].psnr))));
+        }
+    }
+}
@@ -0,0 +1,153 @@
+#include <doctest.h>
+#include <cfloat>
+#include <random>
+#include "clib/Fastfloat.hpp"
+#include "clib/Flexfloat.hpp"
+#include "clib/image.hpp"
+
+using ff = clib::Flexfloat;
+using fast = clib::Fastfloat;
+
+namespace
+{
+// Одно значение в обоих представлениях
+bool same(const fast &val, const ff &ref)
+{
+    if (ff::is_zero(ref))
+        return val.to_float() == 0.0f;
+    return val.to_float() == ref.to_float();
+}
+} // namespace
+
+TEST_CASE("Test Fastfloat quantize")
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> mant(1.0f, 2.0f);
+    std::uniform_int_distribution<int> exp(-30, 20);
+
+    for (auto fmt : std::vector<ff::hyper_params>{{5, 10, 15}, {8, 23, 127}, {6, 7, 31}, {4, 3, 7}})
+    {
+        CHECK(fast::fits(fmt.E, fmt.M, fmt.B));
+        for (int k = 0; k < 2000; ++k)
+        {
+            const float x = std::ldexp(mant(gen), exp(gen)) * (k % 2 ? -1.0f : 1.0f);
+            const fast val = fast::from_arithmetic_t(fmt.E, fmt.M, fmt.B, x);
+            const ff ref = ff::from_arithmetic_t(fmt.E, fmt.M, fmt.B, x);
+            CHECK(same(val, ref));
+            CHECK(val.to_flexfloat() == ref);
+            CHECK(fast::from_flexfloat(ref).to_float() == val.to_float());
+        }
+    }
+
+    CHECK_FALSE(fast::fits(11, 52, 1023));
+    CHECK_FALSE(fast::fits(8, 24, 127));
+    CHECK(fast::from_arithmetic_t(8, 23, 127, INFINITY).to_float() == FLT_MAX);
+    CHECK_THROWS(fast(11, 52, 1023, 1.0f));
+}
+
+TEST_CASE("Test Fastfloat limits")
+{
+    const fast proto(5, 10, 15, 0.0f);
+
+    // Насыщение, в том числе inf
+    CHECK(fast::from_arithmetic_t(proto, 1e6f).to_float() == 131008.0f);
+    CHECK(fast::from_arithmetic_t(proto, -1e6f).to_float() == -131008.0f);
+    CHECK(fast::from_arithmetic_t(proto, INFINITY).to_float() == 131008.0f);
+    CHECK(proto.max_norm().to_float() == ff::max_norm(5, 10, 15, 0).to_float());
+    CHECK(proto.min_norm().to_float() == std::ldexp(1.0f, -14));
+    CHECK(proto.min_denorm().to_float() == std::ldexp(1.0f, -24));
+
+    // Денормализованная область: сетка min_denorm и сброс в ноль
+    CHECK(fast::from_arithmetic_t(proto, std::ldexp(3.7f, -24)).to_float() == std::ldexp(3.0f, -24));
+    CHECK(fast::from_arithmetic_t(proto, std::ldexp(0.9f, -24)).to_float() == 0.0f);
+
+    // Округление к ближайшему четному
+    const fast near(5, 10, 15, 0.0f, fast::rounding::nearest);
+    CHECK(fast::from_arithmetic_t(near, 1.0f + std::ldexp(1.0f, -11)).to_float() == 1.0f);
+    CHECK(fast::from_arithmetic_t(near, 1.0f + std::ldexp(3.0f, -11)).to_float() == 1.0f + std::ldexp(1.0f, -9));
+    CHECK(fast::from_arithmetic_t(near, 1.0f + std::ldexp(1.1f, -11)).to_float() == 1.0f + std::ldexp(1.0f, -10));
+    CHECK(fast::from_arithmetic_t(near, 70000.0f).to_float() == 70016.0f);
+    CHECK(fast::from_arithmetic_t(proto, 1.0f + std::ldexp(1.9f, -11)).to_float() == 1.0f);
+
+    CHECK(fast::from_arithmetic_t(proto, 2.5f).to_int() == 3);
+    CHECK(fast::from_arithmetic_t(proto, -2.5f).to_int() == -3);
+}
+
+TEST_CASE("Test Fastfloat arithmetic")
+{
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+
+    const fast proto(5, 10, 15, 0.0f);
+    const ff ref_proto = ff::from_arithmetic_t(5, 10, 15, 0.0f);
+
+    for (int k = 0; k < 2000; ++k)
+    {
+        const float a = dist(gen), b = dist(gen);
+        const fast x = fast::from_arithmetic_t(proto, a), y = fast::from_arithmetic_t(proto, b);
+        const ff rx = ff::from_arithmetic_t(ref_proto, a), ry = ff::from_arithmetic_t(ref_proto, b);
+
+        fast res = proto;
+        ff ref = ref_proto;
+
+        fast::mult(x, y, res);
+        ff::mult(rx, ry, ref);
+        CHECK(same(res, ref));
+
+        // Сложение чисел одного знака совпадает с Flexfloat
+        fast::abs(x, res);
+        fast ay = res;
+        fast::abs(y, ay);
+        ff rax = ref_proto, ray = ref_proto;
+        ff::abs(rx, rax);
+        ff::abs(ry, ray);
+        fast::sum(res, ay, res);
+        ff::sum(rax, ray, ref);
+        CHECK(same(res, ref));
+
+        CHECK((x > y) == (rx > ry));
+        CHECK((x < y) == (rx < ry));
+        CHECK((x == y) == (rx == ry));
+    }
+
+    // +0 > -0, как в Flexfloat
+    fast neg_zero = proto;
+    fast::negative(proto, neg_zero);
+    CHECK(proto > neg_zero);
+    CHECK(proto != neg_zero);
+
+    fast out = proto;
+    fast::clip(fast::from_arithmetic_t(proto, -1), fast::from_arithmetic_t(proto, 5), fast::from_arithmetic_t(proto, 2),
+               out);
+    CHECK(out.to_float() == 2.0f);
+}
+
+TEST_CASE("Test Fastfloat img")
+{
+    std::vector<std::vector<ff>> ref_vv(7, std::vector<ff>(9));
+    std::vector<std::vector<fast>> fast_vv(7, std::vector<fast>(9));
+    for (size_t i = 0; i < 7; ++i)
+        for (size_t j = 0; j < 9; ++j)
+        {
+            const int v = static_cast<int>((i * 5 + j * 3) % 17);
+            ref_vv[i][j] = ff::from_arithmetic_t(5, 10, 15, v);
+            fast_vv[i][j] = fast::from_arithmetic_t(5, 10, 15, v);
+        }
+    const clib::img<ff> ref_img(ref_vv);
+    const clib::img<fast> fast_img(fast_vv);
+
+    // Целые значения и суммы в пределах 2^11 вычисляются без округлений в обоих типах
+    CHECK(same(fast_img.sum(), ref_img.sum()));
+
+    const std::vector<std::vector<ff>> ref_kernel(3, std::vector<ff>(3, ff::from_arithmetic_t(5, 10, 15, 1)));
+    const std::vector<std::vector<fast>> fast_kernel(3, std::vector<fast>(3, fast::from_arithmetic_t(5, 10, 15, 1)));
+    const auto ref_conv = clib::img<ff>::convolution(ref_kernel, ref_img);
+    const auto fast_conv = clib::img<fast>::convolution(fast_kernel, fast_img);
+    for (size_t i = 0; i < 7; ++i)
+        for (size_t j = 0; j < 9; ++j)
+            CHECK(same(fast_conv(i, j), ref_conv(i, j)));
+
+    const clib::img<fast> packed(fast_img, ff::hyper_params{8, 23, 127});
+    CHECK(packed(3, 4).get_M() == 23);
+    CHECK(packed(3, 4).to_float() == fast_img(3, 4).to_float());
+}
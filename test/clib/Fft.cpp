@@ -0,0 +1,186 @@
+#include <doctest.h>
+#include "clib/Flexfixed.hpp"
+#include "clib/Flexfloat.hpp"
+#include "clib/fft.hpp"
+#include "clib/image.hpp"
+
+#include <cmath>
+#include <complex>
+
+using clib::Flexfixed;
+using ff = clib::Flexfloat;
+using img = clib::img<ff>;
+using cplx = clib::complex_t<ff>;
+
+#define ff_(value) ff::from_arithmetic_t(8, 23, 127, value)
+
+namespace
+{
+float value_at(size_t i, size_t j, size_t seed)
+{
+    return static_cast<float>((i * 37 + j * 11 + seed * 5) % 23) * 0.25f - 2.625f;
+}
+
+std::vector<std::vector<ff>> fill(size_t rows, size_t cols, size_t seed)
+{
+    std::vector<std::vector<ff>> res(rows, std::vector<ff>(cols));
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            res[i][j] = ff_(value_at(i, j, seed));
+    return res;
+}
+
+// Наибольшее отличие, отнесенное к наибольшему по модулю значению rhs
+double max_rel_diff(const img &lhs, const img &rhs)
+{
+    double diff = 0.0, peak = 0.0;
+    for (size_t i = 0; i < lhs.rows(); ++i)
+        for (size_t j = 0; j < lhs.cols(); ++j)
+        {
+            diff = std::max(diff, std::abs(static_cast<double>(lhs(i, j).to_float() - rhs(i, j).to_float())));
+            peak = std::max(peak, std::abs(static_cast<double>(rhs(i, j).to_float())));
+        }
+    return diff / peak;
+}
+// Прямая свертка через stencil с T::mult и T::sum на каждом коэффициенте
+template <typename T>
+clib::img<T> direct_convolution(const std::vector<std::vector<T>> &kernel, const clib::img<T> &image)
+{
+    const size_t kh = kernel.size(), kw = kernel[0].size();
+    return clib::img<T>::stencil(image, {kh, kw}, [&](const typename clib::img<T>::window &w) {
+        T acc = T::from_arithmetic_t(kernel[0][0], 0);
+        for (size_t a = 0; a < kh; ++a)
+            for (size_t b = 0; b < kw; ++b)
+            {
+                T tap = w(a, b);
+                T::mult(kernel[a][b], tap, tap);
+                T::sum(acc, tap, acc);
+            }
+        return acc;
+    });
+}
+} // namespace
+
+TEST_CASE("Test FFT Twiddles")
+{
+    const size_t n = 64;
+    for (size_t k = 0; k < n; ++k)
+    {
+        ff c = ff_(0.0f), s = ff_(0.0f);
+        ff::cos_sin_turn(k, n, c, s);
+
+        const double angle = 2.0 * 3.141592653589793 * k / n;
+        // На границах четвертей - точные 0 и ±1
+        if (k % (n / 4) == 0)
+        {
+            const long exact_cos = std::lround(std::cos(angle)), exact_sin = std::lround(std::sin(angle));
+            CHECK((exact_cos == 0 ? ff::is_zero(c) : c.to_float() == static_cast<float>(exact_cos)));
+            CHECK((exact_sin == 0 ? ff::is_zero(s) : s.to_float() == static_cast<float>(exact_sin)));
+            continue;
+        }
+        CHECK(c.to_float() == doctest::Approx(std::cos(angle)).epsilon(1e-4));
+        CHECK(s.to_float() == doctest::Approx(std::sin(angle)).epsilon(1e-4));
+    }
+
+    // Таблица одна на формат и длину
+    CHECK(clib::fft_twiddles<ff>::get(ff_(0.0f), 32) == clib::fft_twiddles<ff>::get(ff_(1.0f), 32));
+    CHECK(clib::fft_twiddles<ff>::get(ff_(0.0f), 32) != clib::fft_twiddles<ff>::get(ff_(0.0f), 16));
+}
+
+TEST_CASE("Test FFT Transform")
+{
+    const ff ZERO = ff_(0.0f);
+
+    // Длины только с этапами по основанию 4 и с последним этапом по основанию 2
+    for (size_t n : {1, 2, 4, 8, 16, 32, 64})
+    {
+        const clib::fft_plan<ff> plan(ZERO, n);
+
+        std::vector<cplx> data(n, cplx{ZERO, ZERO}), scratch(n, cplx{ZERO, ZERO});
+        std::vector<std::complex<double>> input(n);
+        for (size_t k = 0; k < n; ++k)
+        {
+            data[k] = cplx{ff_(value_at(k, 0, 1)), ff_(value_at(k, 1, 2))};
+            input[k] = {data[k].re.to_float(), data[k].im.to_float()};
+        }
+
+        plan.transform(data.data(), scratch.data());
+        for (size_t f = 0; f < n; ++f)
+        {
+            std::complex<double> expected = 0.0;
+            for (size_t k = 0; k < n; ++k)
+                expected += input[k] * std::polar(1.0, -2.0 * 3.141592653589793 * f * k / n);
+            CHECK(data[f].re.to_float() == doctest::Approx(expected.real()).epsilon(1e-4).scale(n));
+            CHECK(data[f].im.to_float() == doctest::Approx(expected.imag()).epsilon(1e-4).scale(n));
+        }
+
+        plan.transform(data.data(), scratch.data(), true);
+        for (size_t k = 0; k < n; ++k)
+        {
+            CHECK(data[k].re.to_float() == doctest::Approx(input[k].real()).epsilon(1e-3).scale(1.0));
+            CHECK(data[k].im.to_float() == doctest::Approx(input[k].imag()).epsilon(1e-3).scale(1.0));
+        }
+    }
+}
+
+TEST_CASE("Test FFT Convolution")
+{
+    // Поворотные множители берутся из 16-битных таблиц cos и sin, поэтому ошибка растет с размером FFT
+    const img image(fill(23, 29, 0));
+    const auto kernel = fill(7, 5, 3);
+
+    for (clib::border_t border : {clib::border_t::mirror, clib::border_t::clamp, clib::border_t::constant})
+    {
+        const img direct = img::convolution(kernel, image, border, ff_(1.5f));
+        for (size_t threads : {1, 3})
+        {
+            const img fast = img::fft_convolution(kernel, image, border, ff_(1.5f), threads);
+            CHECK(fast.rows() == image.rows());
+            CHECK(fast.cols() == image.cols());
+            CHECK(max_rel_diff(fast, direct) < 1e-3);
+        }
+    }
+
+    // Большие ядра convolution считает напрямую, FFT - только по явному вызову
+    const auto large = fill(15, 17, 4);
+    const img fast = img::fft_convolution(large, image);
+    CHECK(img::convolution(large, image).vv() == direct_convolution(large, image).vv());
+    CHECK(max_rel_diff(fast, direct_convolution(large, image)) < 5e-3);
+}
+
+TEST_CASE("Test FFT Convolution Narrow Formats")
+{
+    // Размытие 15 x 15 в половинной точности и в Flexfixed: convolution побитово совпадает с прямой сверткой
+    const ff half = ff::from_arithmetic_t(5, 10, 15, 0.0f);
+    const Flexfixed fixed(12, 8);
+
+    for (bool uniform : {false, true})
+    {
+        const auto pixel = [&](size_t i, size_t j) {
+            return uniform ? 250.0f : static_cast<float>((i * 67 + j * 29) % 256);
+        };
+
+        std::vector<std::vector<ff>> ff_image(20, std::vector<ff>(24));
+        std::vector<std::vector<Flexfixed>> fx_image(20, std::vector<Flexfixed>(24));
+        for (size_t i = 0; i < 20; ++i)
+            for (size_t j = 0; j < 24; ++j)
+            {
+                ff_image[i][j] = ff::from_arithmetic_t(half, pixel(i, j));
+                fx_image[i][j] = Flexfixed::from_arithmetic_t(fixed, pixel(i, j));
+            }
+
+        const std::vector<std::vector<ff>> ff_kernel(
+            15, std::vector<ff>(15, ff::from_arithmetic_t(half, 1.0f / 225.0f)));
+        const std::vector<std::vector<Flexfixed>> fx_kernel(
+            15, std::vector<Flexfixed>(15, Flexfixed::from_arithmetic_t(fixed, 1.0f / 225.0f)));
+
+        const img ff_img(ff_image);
+        CHECK(img::convolution(ff_kernel, ff_img).vv() == direct_convolution(ff_kernel, ff_img).vv());
+
+        const clib::img<Flexfixed> fx_img(fx_image);
+        CHECK(clib::img<Flexfixed>::convolution(fx_kernel, fx_img).vv() ==
+              direct_convolution(fx_kernel, fx_img).vv());
+    }
+}
+
+#undef ff_
@@ -0,0 +1,112 @@
+#include <doctest.h>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include "clib/FrameCache.hpp"
+
+using clib::ImgView;
+using idx_t = ImgView::idx_t;
+
+namespace
+{
+// Изображение rows x cols x 3 со значениями (i * 31 + j * 7 + c * 50 + shift) % 256
+void write_png(const std::string &path, idx_t rows, idx_t cols, int shift)
+{
+    clib::CImgView8 view;
+    view.init(rows, cols, 3);
+    for (idx_t c = 0; c < 3; ++c)
+        for (idx_t i = 0; i < rows; ++i)
+            for (idx_t j = 0; j < cols; ++j)
+                view.set(static_cast<int>((i * 31 + j * 7 + c * 50) % 256) + shift, i, j, c);
+    view.write_img(path);
+}
+} // namespace
+
+TEST_CASE("Test Frame Cache")
+{
+    char tmpl[] = "/tmp/clib_frames_XXXXXX";
+    REQUIRE(mkdtemp(tmpl) != nullptr);
+    const std::string dir = tmpl;
+    const std::string png = dir + "/input.png";
+    const clib::FrameCache cache(dir + "/cache");
+
+    write_png(png, 5, 7, 0);
+    CHECK(!cache.valid(png));
+
+    {
+        const clib::RawVideoView raw = cache.open(png);
+        CHECK(cache.valid(png));
+        CHECK(raw.frames() == 1);
+        CHECK(raw.rows() == 5);
+        CHECK(raw.cols() == 7);
+        CHECK(raw.clrs() == 3);
+        CHECK(raw.sample_type() == clib::sample_t::u8);
+        CHECK(raw.get(4, 6, 2, 0) == (4 * 31 + 6 * 7 + 100) % 256);
+
+        // Кадр как ImgView без копирования: отсчеты указывают в отображение файла
+        const clib::RawImgView frame = raw.frame(0);
+        CHECK(frame.samples(1) == raw.samples(1, 0));
+        std::vector<int> plane(5 * 8, -1);
+        frame.read_plane(1, plane.data(), 8);
+        bool same = true;
+        for (idx_t i = 0; i < 5; ++i)
+            for (idx_t j = 0; j < 7; ++j)
+                same = same && plane[i * 8 + j] == static_cast<int>((i * 31 + j * 7 + 50) % 256);
+        CHECK(same);
+        CHECK(plane[7] == -1);
+        CHECK(frame.data(0) == nullptr);
+    }
+
+    // Повторное открытие берет готовый файл; изменение исходного файла делает кэш недействительным
+    CHECK(cache.open(png).source_mtime() != 0);
+    write_png(png, 6, 4, 1);
+    CHECK(!cache.valid(png));
+    {
+        const clib::RawVideoView raw = cache.open(png);
+        CHECK(cache.valid(png));
+        CHECK(raw.rows() == 6);
+        CHECK(raw.cols() == 4);
+        CHECK(raw.get(0, 0, 0, 0) == 1);
+    }
+
+    // Видео из Представления: 16-битные отсчеты, произвольный доступ к кадрам
+    const std::string raw_path = dir + "/video.raw";
+    {
+        clib::CVideoViewT<uint16_t> video;
+        video.init(3, 2, 2, 4, 30);
+        for (idx_t f = 0; f < 4; ++f)
+            for (idx_t k = 0; k < 12; ++k)
+                video.set(static_cast<int>(f * 1000 + k), k / 4, k / 2 % 2, k % 2, f);
+        clib::save_raw(raw_path, video);
+    }
+    {
+        clib::RawVideoView raw(raw_path);
+        CHECK(raw.frames() == 4);
+        CHECK(raw.fps() == 30);
+        CHECK(raw.sample_type() == clib::sample_t::u16);
+        CHECK(raw.data(0, 0) == nullptr);
+        CHECK(raw.get(2, 1, 1, 3) == 3011);
+        CHECK(raw.frame(2).get(0, 0, 0) == 2000);
+        CHECK_THROWS_AS(raw.set(0, 0, 0, 0, 0), std::logic_error);
+
+        clib::RawVideoView moved = std::move(raw);
+        CHECK(moved.get(1, 0, 1, 1) == 1005);
+    }
+
+    // Заголовок, размер данных которого переполняет 64 бита: 2^62 кадров * 4 цвета дают 0 без проверки умножений
+    {
+        std::fstream file(raw_path, std::ios::binary | std::ios::in | std::ios::out);
+        const uint64_t clrs = 4, frames = uint64_t(1) << 62;
+        file.seekp(40);
+        file.write(reinterpret_cast<const char *>(&clrs), sizeof(clrs));
+        file.write(reinterpret_cast<const char *>(&frames), sizeof(frames));
+    }
+    CHECK_THROWS_AS(clib::RawVideoView{raw_path}, std::runtime_error);
+
+    CHECK_THROWS(clib::RawVideoView(png));
+    CHECK_THROWS_AS(cache.open(dir + "/input.txt"), std::exception);
+
+    std::system(("rm -rf " + dir).c_str());
+}
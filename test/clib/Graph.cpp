@@ -0,0 +1,106 @@
+#include <doctest.h>
+#include <vector>
+#include "clib/Flexfloat.hpp"
+#include "clib/arena.hpp"
+#include "clib/graph.hpp"
+#include "clib/image.hpp"
+#include "clib/synth.hpp"
+#include "common.hpp"
+
+using ff = clib::Flexfloat;
+using img = clib::img<ff>;
+
+TEST_CASE("Test Graph Synth")
+{
+    const ff proto = ff::from_arithmetic_t(8, 23, 127, 0);
+    const ff half = ff::from_arithmetic_t(5, 10, 15, 0);
+
+    // (x - mean(x)) * (x - mean(x)) + 1 / (x + y), две независимые ветви
+    clib::synth_graph<ff> g;
+    auto x = g.input(proto);
+    auto y = g.input(proto);
+    auto d = g.Sub(x, g.mean(x), proto);
+    auto sq = g.Mult(d, d, proto);
+    auto inv = g.Inv(g.Add(x, y, proto), proto);
+    auto out = g.Add(sq, inv, half);
+    auto total = g.sum(g.Mult(g.Const(2.0f, x), y, proto));
+    g.output(out).output(total);
+
+    CHECK(g.levels() == 4);
+    // Короткоживущие промежуточные результаты переиспользуют буферы
+    CHECK(g.buffers() < 8);
+
+    for (int seed : {0, 4, 9})
+    {
+        const img fx = make_frame(6, 7, seed), fy = make_frame(6, 7, seed + 2);
+        for (size_t nthreads : {1, 4})
+            g.run({fx, fy}, nthreads);
+
+        // Те же операторы, вызванные по одному
+        img m, e(proto, 6, 7), s(proto, 6, 7), a(proto, 6, 7), i(proto, 6, 7), r(half, 6, 7);
+        clib::Synth::Flexfloat_mean(fx, m);
+        clib::Synth::Flexfloat_Sub(fx, m, e);
+        clib::Synth::Flexfloat_Mult(e, e, s);
+        clib::Synth::Flexfloat_Add(fx, fy, a);
+        clib::Synth::Flexfloat_Inv(a, i);
+        clib::Synth::Flexfloat_Add(s, i, r);
+        CHECK(g.result(out).vv() == r.vv());
+
+        img c, p(proto, 6, 7), t;
+        clib::Synth::Flexfloat_Const(2.0f, fx, c);
+        clib::Synth::Flexfloat_Mult(c, fy, p);
+        clib::Synth::Flexfloat_sum(p, t);
+        CHECK(g.result(total).vv() == t.vv());
+
+        // Const, sum и mean хранят одно значение
+        CHECK(c.is_broadcast());
+        CHECK(m.is_broadcast());
+        CHECK(g.result(total).is_broadcast());
+    }
+}
+
+TEST_CASE("Test Graph Broadcast Slots")
+{
+    const ff proto = ff::from_arithmetic_t(8, 23, 127, 0);
+
+    // Inv(mean(x)) - обычный оператор с широковещательным аргументом, его результат тоже широковещательный. Граф
+    // без Inv отличается только этим узлом
+    clib::synth_graph<ff> g, plain;
+    auto x = g.input(proto);
+    auto out = g.Add(g.Mult(x, g.Inv(g.mean(x), proto), proto), x, proto);
+    g.output(out);
+    auto px = plain.input(proto);
+    plain.output(plain.Add(plain.Mult(px, plain.mean(px), proto), px, proto));
+
+    // Выделения на кадр начиная со второго кадра
+    auto per_frame = [](clib::synth_graph<ff> &graph, size_t rows, size_t cols) {
+        std::vector<size_t> counts;
+        for (int seed : {0, 1, 2, 3})
+        {
+            const img fx = make_frame(rows, cols, seed);
+            const size_t before = clib::heap_allocations();
+            graph.run({fx}, 1);
+            counts.push_back(clib::heap_allocations() - before);
+        }
+        CHECK(counts[2] == counts[1]);
+        CHECK(counts[3] == counts[1]);
+        return counts[1];
+    };
+
+    // Узел Inv выделяет только свое значение: обычные узлы не разворачивают его слот, и разница не зависит от
+    // размера кадра
+    const size_t small = per_frame(g, 8, 8) - per_frame(plain, 8, 8);
+    const size_t large = per_frame(g, 48, 40) - per_frame(plain, 48, 40);
+    CHECK(small == large);
+    CHECK(small <= 2);
+
+    const img fx = make_frame(48, 40, 5);
+    g.run({fx});
+    img m, i(proto, 48, 40), r(proto, 48, 40), e(proto, 48, 40);
+    clib::Synth::Flexfloat_mean(fx, m);
+    clib::Synth::Flexfloat_Inv(m, i);
+    clib::Synth::Flexfloat_Mult(fx, i, r);
+    clib::Synth::Flexfloat_Add(r, fx, e);
+    CHECK(i.is_broadcast());
+    CHECK(g.result(out).vv() == e.vv());
+}
@@ -7,6 +7,7 @@
 
 using ff = clib::Flexfloat;
 using img = clib::img<ff>;
+using clib::idx_t;
 
 const ff::Etype E = 8;
 const ff::Mtype M = 23;
@@ -78,9 +79,18 @@ TEST_CASE("Test Window")
 
     img vv(arr);
 
+    // Окно с центром в (i, j) - это значения stencil(w(a, b)) в пикселе (i, j)
+    auto get_window = [&vv](idx_t i, idx_t j) {
+        std::vector<std::vector<ff>> res(3, std::vector<ff>(3));
+        for (idx_t a = 0; a < 3; ++a)
+            for (idx_t b = 0; b < 3; ++b)
+                res[a][b] = img::stencil(vv, {3, 3}, [a, b](const img::window &w) { return w(a, b); })(i, j);
+        return res;
+    };
+
     // test case 1
-    auto test_1 = img::get_window(vv, {1, 1}, {3, 3});
-    for (auto it : test_1.vv())
+    auto test_1 = get_window(1, 1);
+    for (auto it : test_1)
     {
         for (auto val : it)
         {
@@ -91,14 +101,14 @@ TEST_CASE("Test Window")
 
     auto right_1 =
         std::vector<std::vector<ff>>{{ff_(1), ff_(2), ff_(3)}, {ff_(5), ff_(6), ff_(7)}, {ff_(9), ff_(10), ff_(11)}};
-    CHECK(test_1.vv() == right_1);
+    CHECK(test_1 == right_1);
 
     std::cout << std::endl;
 
     // test case 2
-    auto test_2 = img::get_window(vv, {0, 0}, {3, 3});
+    auto test_2 = get_window(0, 0);
 
-    for (auto it : test_2.vv())
+    for (auto it : test_2)
     {
         for (auto val : it)
         {
@@ -109,14 +119,14 @@ TEST_CASE("Test Window")
 
     auto right_2 =
         std::vector<std::vector<ff>>{{ff_(6), ff_(5), ff_(6)}, {ff_(2), ff_(1), ff_(2)}, {ff_(6), ff_(5), ff_(6)}};
-    CHECK(test_2.vv() == right_2);
+    CHECK(test_2 == right_2);
 
     // test case 3
-    auto test_3 = img::get_window(vv, {3, 0}, {3, 3});
+    auto test_3 = get_window(3, 0);
 
     auto right_3 = std::vector<std::vector<ff>>{
         {ff_(10), ff_(9), ff_(10)}, {ff_(14), ff_(13), ff_(14)}, {ff_(10), ff_(9), ff_(10)}};
-    CHECK(test_3.vv() == right_3);
+    CHECK(test_3 == right_3);
 }
 
 TEST_CASE("Test Window Overloaded"){
@@ -188,31 +198,37 @@ TEST_CASE("Test Convolution Overloaded"){
 
     auto val = img::get_window(vv, {3, 3});
  
-    img mx({
-    {ff_(1.0f), ff_(0.0f), ff_(-1.0f)}, 
-    {ff_(2.0f), ff_(0.0f), ff_(-2.0f)}, 
-    {ff_(1.0f), ff_(0.0f), ff_(-1.0f)}});
-    
+    // ff_(0.0f) дает не ноль, а 2^-127, поэтому нули задаются битами
+    const ff zero(E, M, B, 0);
 
-    img right({
-        {ff_(0.0f), ff_(-8.0f), ff_(-8.0f), ff_(0.0f)}, 
-        {ff_(0.0f), ff_(-8.0f), ff_(-8.0f), ff_(0.0f)}, 
-        {ff_(0.0f), ff_(-8.0f), ff_(-8.0f), ff_(0.0f)},
-        {ff_(0.0f), ff_(-8.0f), ff_(-8.0f), ff_(0.0f)}
-        });
+    img mx({
+    {ff_(1.0f), zero, ff_(-1.0f)}, 
+    {ff_(2.0f), zero, ff_(-2.0f)}, 
+    {ff_(1.0f), zero, ff_(-1.0f)}});
 
-    auto result_of_conv = img::convolution(mx,val);
+    std::vector<std::vector<float>> right = {
+        {0.0f, -8.0f, -8.0f, 0.0f},
+        {0.0f, -8.0f, -8.0f, 0.0f},
+        {0.0f, -8.0f, -8.0f, 0.0f},
+        {0.0f, -8.0f, -8.0f, 0.0f}
+        };
 
-    //std::cout << ff_(0.0f) << std::endl;
+    std::vector<std::vector<img>> mx_imgs(3);
+    for (idx_t a = 0; a < 3; ++a)
+        for (idx_t b = 0; b < 3; ++b)
+            mx_imgs[a].push_back(img({{mx(a, b)}}));
 
-    //std::cout << ff_(0.0f).to_float();
+    auto result_of_conv = img::convolution(mx_imgs, val);
 
     print_img(result_of_conv);
 
-
-    //print_img(val[0][0] * mx(0,0) +  val[0][2] * mx(0,2) + mx(1,0) * val[1][0] + mx(1,2) * val[1][2] + val[2][0] * mx(2,0) + mx(2,2) * val[2][2]);    
-
-    //CHECK(res == right);
+    auto stencil_conv = img::convolution(mx, vv);
+    for (idx_t i = 0; i < 4; ++i)
+        for (idx_t j = 0; j < 4; ++j)
+        {
+            CHECK(result_of_conv(i, j).to_float() == doctest::Approx(right[i][j]).epsilon(1e-5));
+            CHECK(stencil_conv(i, j).to_float() == doctest::Approx(right[i][j]).epsilon(1e-5));
+        }
 }
 
 
@@ -272,19 +288,19 @@ TEST_CASE("Test Convolution")
 
     img vv(arr);
 
-    std::function<ff(img)> func = [](img image) {
+    auto func = [](const img::window &w) {
         auto sum = ff_(0);
-        for (auto i = 0; i < image.rows(); ++i)
+        for (idx_t i = 0; i < 3; ++i)
         {
-            for (auto j = 0; j < image.cols(); ++j)
+            for (idx_t j = 0; j < 3; ++j)
             {
-                ff::sum(image(i, j), sum, sum);
+                ff::sum(w(i, j), sum, sum);
             }
         }
         return sum;
     };
 
-    auto res = img::convolution(vv, {3, 3}, func);
+    auto res = img::stencil(vv, {3, 3}, func);
 
     for (auto i = 0; i < res.rows(); ++i)
     {
@@ -294,6 +310,13 @@ TEST_CASE("Test Convolution")
         }
         std::cout << std::endl;
     }
+
+    // Окрестность (0, 0) с отражением: 6 5 6 / 2 1 2 / 6 5 6
+    CHECK(res(0, 0).to_float() == 6 + 5 + 6 + 2 + 1 + 2 + 6 + 5 + 6);
+    CHECK(res(1, 1).to_float() == 1 + 2 + 3 + 5 + 6 + 7 + 9 + 10 + 11);
+
+    std::vector<std::vector<ff>> box(3, std::vector<ff>(3, ff_(1)));
+    CHECK(img::convolution(box, vv).vv() == res.vv());
 }
 
 TEST_CASE("Test FF"){
@@ -307,4 +330,297 @@ TEST_CASE("Test FF"){
 
 
 
+TEST_CASE("Test Stencil Convolution")
+{
+    std::vector<std::vector<ff>> arr(5, std::vector<ff>(6));
+
+    int counter = 0;
+    for (int i = 0; i < arr.size(); ++i)
+        for (int j = 0; j < arr[0].size(); ++j)
+            arr[i][j] = ff_(counter++ * (j % 2 == 0 ? 3 : -1));
+
+    img vv(arr);
+
+    std::vector<std::vector<ff>> sobel = {
+        {ff_(1.0f), ff_(0.0f), ff_(-1.0f)}, {ff_(2.0f), ff_(0.0f), ff_(-2.0f)}, {ff_(1.0f), ff_(0.0f), ff_(-1.0f)}};
+
+    std::vector<std::vector<img>> sobel_imgs;
+    for (auto &row : sobel)
+    {
+        sobel_imgs.emplace_back();
+        for (auto &val : row)
+            sobel_imgs.back().push_back(img({{val}}));
+    }
+
+    // Одинаковый порядок операций -> побитовое совпадение со старой реализацией на get_window
+    auto right = img::convolution(sobel_imgs, img::get_window(vv, {3, 3}));
+
+    CHECK(img::convolution(sobel, vv).vv() == right.vv());
+    CHECK(img::convolution(sobel, vv, clib::border_t::mirror, ff(), 3).vv() == right.vv());
+}
+
+TEST_CASE("Test Stencil Borders")
+{
+    img vv({{ff_(1), ff_(2), ff_(3)}, {ff_(4), ff_(5), ff_(6)}});
+
+    std::vector<std::vector<ff>> box(3, std::vector<ff>(3, ff_(1)));
+
+    auto clamp = img::convolution(box, vv, clib::border_t::clamp);
+    auto constant = img::convolution(box, vv, clib::border_t::constant, ff_(0));
+
+    CHECK(clamp(0, 0).to_float() == 1 + 1 + 2 + 1 + 1 + 2 + 4 + 4 + 5);
+    CHECK(clamp(1, 2).to_float() == 2 + 3 + 3 + 5 + 6 + 6 + 5 + 6 + 6);
+    CHECK(constant(0, 0).to_float() == 1 + 2 + 4 + 5);
+    CHECK(constant(1, 1).to_float() == 1 + 2 + 3 + 4 + 5 + 6);
+
+    // Максимум по окрестности 1x3
+    auto hmax = img::stencil(vv, {1, 3}, [](const img::window &w) { return std::max({w(0, 0), w(0, 1), w(0, 2)}); });
+    CHECK(hmax(0, 0).to_float() == 2);
+    CHECK(hmax(1, 2).to_float() == 6);
+}
+
+TEST_CASE("Test Demosaic Fused")
+{
+    // Поэтапная формулировка через get_window/convolution/condition
+    auto staged = [](const img &r, const img &g, const img &b) {
+        auto one = [&r](int v) { return img({{ff::from_arithmetic_t(r(0, 0), v)}}); };
+        const std::vector<std::vector<img>> mx = {{one(1), one(0), one(-1)}, {one(2), one(0), one(-2)},
+                                                  {one(1), one(0), one(-1)}};
+        const std::vector<std::vector<img>> my = {{one(1), one(2), one(1)}, {one(0), one(0), one(0)},
+                                                  {one(-1), one(-2), one(1)}};
+        const std::vector<std::vector<img>> m = {{one(1), one(2), one(1)}, {one(2), one(4), one(2)},
+                                                 {one(1), one(2), one(1)}};
+        auto wg = img::get_window(g, {3, 3});
+        img dgx = img::abs(img::convolution(mx, wg));
+        img dgy = img::abs(img::convolution(my, wg));
+        const ff two = ff::from_arithmetic_t(r(0, 0), 2);
+        img g_new = wg[1][1] + img::condition(dgx < dgy, (wg[1][0] + wg[1][2]) / two, (wg[0][1] + wg[2][1]) / two);
+        img g_lpf = img::convolution(m, wg) / ff::from_arithmetic_t(r(0, 0), 8);
+        img r_lpf = img::convolution(m, img::get_window(r, {3, 3})) / ff::from_arithmetic_t(r(0, 0), 4);
+        img b_lpf = img::convolution(m, img::get_window(b, {3, 3})) / ff::from_arithmetic_t(r(0, 0), 4);
+        img zero(ff::from_arithmetic_t(g_lpf(0, 0), 0), g_lpf.rows(), g_lpf.cols());
+        return std::vector<img>{img::condition(g_lpf == zero, r_lpf, g_new * r_lpf / g_lpf), g_new,
+                                img::condition(g_lpf == zero, b_lpf, g_new * b_lpf / g_lpf)};
+    };
+
+    const size_t rows = 9, cols = 7;
+    std::vector<std::vector<ff>> r(rows, std::vector<ff>(cols)), g = r, b = r;
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+        {
+            r[i][j] = ff_(static_cast<float>((i * 31 + j * 17) % 256));
+            g[i][j] = ff_(static_cast<float>((i * 7 + j * 13) % 5 == 0 ? 0 : (i * 11 + j * 29) % 256));
+            b[i][j] = ff_(static_cast<float>((i * 19 + j * 3) % 256));
+        }
+
+    auto expected = staged(img(r), img(g), img(b));
+    for (size_t nthreads : {1, 4})
+    {
+        auto res = img::demosaic(img(r), img(g), img(b), nthreads);
+        for (size_t c = 0; c < 3; ++c)
+            CHECK(res[c].vv() == expected[c].vv());
+    }
+}
+
+TEST_CASE("Test Reduce Orders")
+{
+    const size_t rows = 7, cols = 11;
+    std::vector<std::vector<ff>> arr(rows, std::vector<ff>(cols)), other = arr;
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+        {
+            arr[i][j] = ff_(1.0f / static_cast<float>(i * cols + j + 1) * ((i + j) % 3 == 0 ? -1.0f : 3.0f));
+            other[i][j] = ff_(static_cast<float>((i * 5 + j) % 7) - 3.0f);
+        }
+    const img image(arr), image2(other);
+
+    // Порядок modulus = 3 из описания img::sum
+    auto modulus_sum = [](const std::vector<ff> &line) {
+        std::vector<ff> part(line.begin(), line.begin() + 3);
+        for (size_t j = 3; j < line.size(); ++j)
+            ff::sum(line[j], part[j % 3], part[j % 3]);
+        size_t st = (line.size() - 3) % 3;
+        ff ans = part[st];
+        for (size_t j = 1; j < 3; ++j)
+            ff::sum(part[(st + j) % 3], ans, ans);
+        return ans;
+    };
+    std::vector<ff> lines;
+    for (auto &line : arr)
+        lines.push_back(modulus_sum(line));
+    CHECK(image.sum() == modulus_sum(lines));
+
+    // Результат не зависит от количества потоков
+    for (auto order : {clib::order_t::modulus, clib::order_t::pairwise, clib::order_t::sequential})
+    {
+        const clib::order_spec spec(order, 3, 2);
+        const ff expected = image.sum(1, spec);
+        for (size_t nthreads : {2, 3, 7, 16})
+        {
+            CHECK(image.sum(nthreads, spec) == expected);
+            CHECK(img::dot(image, image2, spec, nthreads) == img::dot(image, image2, spec, 1));
+        }
+    }
+
+    // Дерево для 5 элементов и листа 1: (x0 + x1) + (x2 + (x3 + x4))
+    const img small({{ff_(1e8f), ff_(1.0f), ff_(-1e8f), ff_(1.0f), ff_(1.0f)}});
+    ff left = ff_(0), right = ff_(0);
+    ff::sum(small(0, 3), small(0, 4), right);
+    ff::sum(small(0, 2), right, right);
+    ff::sum(small(0, 0), small(0, 1), left);
+    ff::sum(left, right, left);
+    CHECK(small.sum(4, clib::order_spec(clib::order_t::pairwise, 3, 1)) == left);
+
+    ff seq = small(0, 0);
+    for (size_t j = 1; j < 5; ++j)
+        ff::sum(seq, small(0, j), seq);
+    CHECK(small.sum(0, clib::order_spec(clib::order_t::sequential)) == seq);
+
+    float minn = arr[0][0].to_float(), maxx = minn;
+    for (auto &line : arr)
+        for (auto &val : line)
+        {
+            minn = std::min(minn, val.to_float());
+            maxx = std::max(maxx, val.to_float());
+        }
+    CHECK(image.minimum().to_float() == minn);
+    CHECK(image.maximum(clib::order_spec(clib::order_t::pairwise)).to_float() == maxx);
+
+    std::vector<std::vector<ff>> prod = arr;
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            ff::mult(arr[i][j], other[i][j], prod[i][j]);
+    CHECK(img::dot(image, image2) == img(prod).sum());
+}
+
+
+TEST_CASE("Test Broadcast")
+{
+    const size_t rows = 5, cols = 9;
+    std::vector<std::vector<ff>> arr(rows, std::vector<ff>(cols));
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            arr[i][j] = ff_(static_cast<float>((i * 3 + j * 5) % 11) - 4.5f);
+    const img image(arr);
+
+    const ff c = ff_(2.25f);
+    const img bc = img::broadcast(c, rows, cols), dense(c, rows, cols);
+    CHECK(bc.is_broadcast());
+    CHECK(bc.rows() == rows);
+    CHECK(bc.cols() == cols);
+    CHECK(bc(3, 7) == c);
+    CHECK(bc.vv() == dense.vv());
+    CHECK(!bc.dense().is_broadcast());
+
+    // Операции с широковещательным операндом совпадают с операциями с развернутым
+    CHECK((image + bc).vv() == (image + dense).vv());
+    CHECK((bc - image).vv() == (dense - image).vv());
+    CHECK((image * bc).vv() == (image * dense).vv());
+    CHECK((image / bc).vv() == (image / dense).vv());
+    CHECK((bc + c).vv() == (dense + c).vv());
+    CHECK((c * bc).vv() == (c * dense).vv());
+    CHECK(bc.sum() == dense.sum());
+    const clib::order_spec pairwise(clib::order_t::pairwise);
+    CHECK(bc.sum(0, pairwise) == dense.sum(0, pairwise));
+    CHECK(img::dot(image, bc) == img::dot(image, dense));
+    CHECK((image < bc) == (image < dense));
+    CHECK(img::select(image, bc, std::less<ff>(), image, bc).vv() ==
+          img::select(image, dense, std::less<ff>(), image, dense).vv());
+
+    // Результат операции двух широковещательных изображений тоже широковещательный
+    CHECK((bc * bc).is_broadcast());
+    CHECK((bc * bc).vv() == (dense * dense).vv());
+    CHECK(bc.clip(0, 1).is_broadcast());
+
+    // Результат в формате res, а широковещательный res разворачивается перед записью
+    const ff half = ff::from_arithmetic_t(5, 10, 15, 0);
+    img res = img::broadcast(half, rows, cols), expected(half, rows, cols);
+    img::add(image, bc, res);
+    img::add(image, dense, expected);
+    CHECK(!res.is_broadcast());
+    CHECK(res.vv() == expected.vv());
+
+    img scalar(half, rows, cols);
+    img::mult(bc, bc, scalar);
+    CHECK(scalar.is_broadcast());
+    CHECK(scalar.value().get_E() == half.get_E());
+
+    auto conv = [](const img::window &w) { return w(0, 1); };
+    CHECK(img::stencil(bc, {3, 3}, conv).vv() == img::stencil(dense, {3, 3}, conv).vv());
+
+    // Запись элемента разворачивает изображение
+    img written = bc;
+    written(1, 2) = ff_(-1.0f);
+    CHECK(!written.is_broadcast());
+    CHECK(written(1, 2) == ff_(-1.0f));
+    CHECK(written(0, 0) == c);
+}
+
+// Представление без прямого доступа: массовые операции идут через get/set
+struct map_view : clib::ImgView
+{
+    idx_t rows_ = 0, cols_ = 0, clrs_ = 0;
+    std::vector<pixel_t> vals_;
+
+    void init(idx_t rows, idx_t cols, idx_t colors) override
+    {
+        rows_ = rows, cols_ = cols, clrs_ = colors;
+        vals_.assign(rows * cols * colors, 0);
+    }
+    idx_t rows() const override { return rows_; }
+    idx_t cols() const override { return cols_; }
+    idx_t clrs() const override { return clrs_; }
+    pixel_t get(idx_t i, idx_t j, idx_t clr) const override { return vals_[(i * cols_ + j) * clrs_ + clr]; }
+    void set(pixel_t val, idx_t i, idx_t j, idx_t clr) override { vals_[(i * cols_ + j) * clrs_ + clr] = val; }
+    void read_img(const std::string &) override {}
+    void write_img(const std::string &) override {}
+};
+
+TEST_CASE("Test View Planes")
+{
+    using pixel_t = clib::ImgView::pixel_t;
+    const size_t rows = 6, cols = 7, stride = 9;
+
+    std::vector<pixel_t> src(rows * stride, -1);
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            src[i * stride + j] = static_cast<pixel_t>(i * 31 + j * 7) % 256;
+
+    clib::CImgView cimg_view;
+    clib::CImgView8 cimg8_view;
+    map_view plain_view;
+    for (clib::ImgView *view : std::vector<clib::ImgView *>{&cimg_view, &cimg8_view, &plain_view})
+    {
+        view->init(rows, cols, 3);
+        CHECK((view->data(clib::ImgView::G) != nullptr) == (view == &cimg_view));
+        CHECK((view->samples(clib::ImgView::G) != nullptr) == (view != &plain_view));
+        CHECK((view->sample_type() == clib::sample_t::u8) == (view == &cimg8_view));
+
+        view->write_plane(clib::ImgView::G, src.data(), stride);
+        for (size_t i = 0; i < rows; ++i)
+            for (size_t j = 0; j < cols; ++j)
+                CHECK(view->get(i, j, clib::ImgView::G) == src[i * stride + j]);
+
+        std::vector<pixel_t> row(cols), plane(rows * stride, -1);
+        view->read_row(2, clib::ImgView::G, row.data());
+        CHECK(std::equal(row.begin(), row.end(), src.begin() + 2 * stride));
+        view->read_plane(clib::ImgView::G, plane.data(), stride);
+        CHECK(plane == src);
+
+        // Преобразование в img и обратно
+        const img image(ff_(1.0f), *view, clib::ImgView::G);
+        CHECK(image(4, 5) == ff_(static_cast<float>(src[4 * stride + 5])));
+        image.write(*view, clib::ImgView::B);
+        for (size_t i = 0; i < rows; ++i)
+            for (size_t j = 0; j < cols; ++j)
+                CHECK(view->get(i, j, clib::ImgView::B) == src[i * stride + j]);
+    }
+
+    // 8-битное Представление насыщает значения вне диапазона
+    cimg8_view.set(300, 1, 1, clib::ImgView::R);
+    cimg8_view.set(-5, 1, 2, clib::ImgView::R);
+    CHECK(cimg8_view.get(1, 1, clib::ImgView::R) == 255);
+    CHECK(cimg8_view.get(1, 2, clib::ImgView::R) == 0);
+}
+
 #undef ff_
@@ -0,0 +1,127 @@
+#include <doctest.h>
+#include "clib/Flexfixed.hpp"
+#include "clib/Flexfloat.hpp"
+#include "clib/linalg.hpp"
+
+using ff = clib::Flexfloat;
+using fx = clib::Flexfixed;
+
+namespace
+{
+template <typename T> T naive_product(const T &a, const T &b)
+{
+    T res = a;
+    T::mult(a, b, res);
+    return res;
+}
+
+// Наивные циклы для последовательного порядка и порядка по модулю
+template <typename T> T naive_sequential(const std::vector<T> &a, const std::vector<T> &b)
+{
+    T acc = naive_product(a[0], b[0]);
+    for (size_t k = 1; k < a.size(); ++k)
+        T::sum(acc, naive_product(a[k], b[k]), acc);
+    return acc;
+}
+
+template <typename T> T naive_modulus(const std::vector<T> &a, const std::vector<T> &b, size_t modulus)
+{
+    std::vector<T> part;
+    for (size_t k = 0; k < modulus; ++k)
+        part.push_back(naive_product(a[k], b[k]));
+    for (size_t k = modulus; k < a.size(); ++k)
+        T::sum(naive_product(a[k], b[k]), part[k % modulus], part[k % modulus]);
+
+    const size_t st = (a.size() - modulus) % modulus;
+    T acc = part[st];
+    for (size_t j = 1; j < modulus; ++j)
+        T::sum(part[(st + j) % modulus], acc, acc);
+    return acc;
+}
+
+template <typename T> std::vector<std::vector<T>> fill(const T &proto, size_t rows, size_t cols, size_t seed)
+{
+    std::vector<std::vector<T>> res(rows, std::vector<T>(cols, proto));
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            res[i][j] = T::from_arithmetic_t(proto, static_cast<float>((i * 37 + j * 11 + seed) % 29) * 0.37f - 5.1f);
+    return res;
+}
+
+template <typename T> std::vector<T> column(const std::vector<std::vector<T>> &arr, size_t j)
+{
+    std::vector<T> res;
+    for (const auto &line : arr)
+        res.push_back(line[j]);
+    return res;
+}
+} // namespace
+
+TEST_CASE("Test Linalg Dot")
+{
+    const ff proto = ff::from_arithmetic_t(5, 10, 15, 0);
+    const auto arr = fill(proto, 2, 203, 0);
+
+    CHECK(clib::dot(arr[0], arr[1], clib::order_spec(clib::order_t::sequential)) == naive_sequential(arr[0], arr[1]));
+    CHECK(clib::dot(arr[0], arr[1]) == naive_modulus(arr[0], arr[1], 3));
+    CHECK(clib::dot(arr[0], arr[1], clib::order_spec(clib::order_t::modulus, 5)) == naive_modulus(arr[0], arr[1], 5));
+
+    // Дерево из одного листа - последовательный порядок
+    CHECK(clib::dot(arr[0], arr[1], clib::order_spec(clib::order_t::pairwise, 3, 1000)) ==
+          naive_sequential(arr[0], arr[1]));
+
+    // Короче модуля - последовательно
+    const std::vector<ff> a(arr[0].begin(), arr[0].begin() + 2), b(arr[1].begin(), arr[1].begin() + 2);
+    CHECK(clib::dot(a, b) == naive_sequential(a, b));
+}
+
+TEST_CASE("Test Linalg Gemm")
+{
+    const ff proto = ff::from_arithmetic_t(5, 10, 15, 0);
+    const size_t m = 13, n = 37, p = 11;
+    const auto a = fill(proto, m, n, 1), b = fill(proto, n, p, 2);
+    const clib::matrix<ff> ma(a), mb(b);
+
+    for (const clib::order_spec &order :
+         {clib::order_spec(clib::order_t::sequential), clib::order_spec(clib::order_t::modulus, 3),
+          clib::order_spec(clib::order_t::pairwise, 3, 4)})
+    {
+        std::vector<std::vector<ff>> expected(m, std::vector<ff>(p, proto));
+        for (size_t i = 0; i < m; ++i)
+            for (size_t j = 0; j < p; ++j)
+            {
+                const auto col = column(b, j);
+                if (order.order == clib::order_t::sequential)
+                    expected[i][j] = naive_sequential(a[i], col);
+                else if (order.order == clib::order_t::modulus)
+                    expected[i][j] = naive_modulus(a[i], col, order.modulus);
+                else
+                    expected[i][j] = clib::dot(a[i], col, order);
+            }
+
+        for (size_t threads : {1, 3})
+            for (size_t block : {2, 5, 32})
+            {
+                const auto c = clib::gemm(ma, mb, clib::gemm_spec(order, block, block), threads);
+                CHECK(c.rows() == m);
+                CHECK(c.cols() == p);
+                CHECK(c.vv() == expected);
+            }
+    }
+}
+
+TEST_CASE("Test Linalg Gemm Flexfixed")
+{
+    const fx proto(8, 8);
+    const auto a = fill(proto, 6, 9, 3), b = fill(proto, 9, 7, 4);
+
+    std::vector<std::vector<fx>> expected(6, std::vector<fx>(7, proto));
+    for (size_t i = 0; i < 6; ++i)
+        for (size_t j = 0; j < 7; ++j)
+            expected[i][j] = naive_sequential(a[i], column(b, j));
+
+    const auto c = clib::gemm(clib::matrix<fx>(a), clib::matrix<fx>(b),
+                              clib::gemm_spec(clib::order_spec(clib::order_t::sequential), 4, 4), 2);
+    CHECK(c.vv() == expected);
+    CHECK(clib::matrix<fx>(a).transposed().transposed().vv() == a);
+}
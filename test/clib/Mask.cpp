@@ -0,0 +1,68 @@
+#include <doctest.h>
+#include "clib/Flexfloat.hpp"
+#include "clib/image.hpp"
+#include "clib/mask.hpp"
+
+using ff = clib::Flexfloat;
+using img = clib::img<ff>;
+using clib::img_mask;
+
+#define ff_(value) ff::from_arithmetic_t(8, 23, 127, value)
+
+TEST_CASE("Test Mask Logic")
+{
+    // 70 столбцов: вторая половина строки занимает неполное слово
+    const size_t rows = 3, cols = 70;
+    img_mask a(rows, cols), b(rows, cols, true);
+
+    CHECK(a.stride() == 2);
+    CHECK(a.count() == 0);
+    CHECK(!a.any());
+    CHECK(b.all());
+    CHECK(b.count() == rows * cols);
+
+    for (size_t j = 0; j < cols; j += 3)
+        a.set(1, j, true);
+
+    CHECK(a(1, 0));
+    CHECK(!a(1, 1));
+    CHECK(a(1, 69));
+    CHECK(a.count() == 24);
+
+    CHECK((a & b) == a);
+    CHECK((a | b) == b);
+    CHECK((a ^ b) == ~a);
+    CHECK((~a).count() == rows * cols - 24);
+    CHECK((~b).count() == 0);
+    CHECK(img_mask(a.to_vector()) == a);
+}
+
+TEST_CASE("Test Mask Select")
+{
+    const size_t rows = 5, cols = 67;
+    std::vector<std::vector<ff>> l(rows, std::vector<ff>(cols)), r = l;
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+        {
+            l[i][j] = ff_(static_cast<int>((i * 13 + j * 7) % 11));
+            r[i][j] = ff_(static_cast<int>((i * 5 + j * 3) % 11));
+        }
+    const img lhs(l), rhs(r);
+
+    auto mask = lhs < rhs;
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+        {
+            CHECK(mask(i, j) == (l[i][j] < r[i][j]));
+            CHECK((lhs == rhs)(i, j) == (l[i][j] == r[i][j]));
+        }
+
+    CHECK(((lhs < rhs) | (lhs >= rhs)).all());
+    CHECK(((lhs == rhs) ^ (lhs != rhs)).all());
+
+    auto expected = img::condition(mask.to_vector(), lhs, rhs);
+    CHECK(img::select(mask, lhs, rhs).vv() == expected.vv());
+    CHECK(img::select(lhs, rhs, std::less<ff>(), lhs, rhs).vv() == expected.vv());
+}
+
+#undef ff_
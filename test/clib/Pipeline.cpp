@@ -0,0 +1,112 @@
+#include <doctest.h>
+#include "clib/Flexfloat.hpp"
+#include "clib/image.hpp"
+#include "clib/pipeline.hpp"
+#include "clib/pool.hpp"
+#include "clib/video.hpp"
+#include "common.hpp"
+
+using ff = clib::Flexfloat;
+using img = clib::img<ff>;
+using clib::border_t;
+
+#define ff_(value) ff::from_arithmetic_t(8, 23, 127, value)
+
+TEST_CASE("Test Pipeline Tiles")
+{
+    const std::vector<std::vector<ff>> blur = {
+        {ff_(1), ff_(2), ff_(1)}, {ff_(2), ff_(4), ff_(2)}, {ff_(1), ff_(2), ff_(1)}};
+    const std::vector<std::vector<ff>> row5 = {{ff_(1), ff_(-1), ff_(3), ff_(-1), ff_(1)}};
+
+    auto square = [](const ff &x) {
+        ff res = x;
+        ff::mult(x, x, res);
+        return res;
+    };
+    auto hmax = [](const img::window &w) { return std::max({w(0, 0), w(0, 1), w(0, 2)}); };
+
+    const img image = make_frame(13, 17, 3);
+
+    for (border_t border : {border_t::mirror, border_t::clamp, border_t::constant})
+    {
+        const ff fill = ff_(5);
+
+        // Последовательное выполнение стадий над целым кадром
+        img expected = img::convolution(blur, image, border, fill);
+        expected = img::stencil(expected, {1, 5}, [&](const img::window &w) {
+            ff acc = ff::from_arithmetic_t(row5[0][0], 0);
+            for (size_t b = 0; b < 5; ++b)
+            {
+                ff tap = w(0, b);
+                ff::mult(row5[0][b], tap, tap);
+                ff::sum(acc, tap, acc);
+            }
+            return acc;
+        }, border, fill);
+        expected = img::stencil(expected, {1, 1}, [&](const img::window &w) { return square(w(0, 0)); });
+        expected = img::stencil(expected, {1, 3}, hmax, border, fill);
+
+        clib::pipeline<ff> pipe(border, fill);
+        pipe.convolution(blur).convolution(row5).map(square).stencil({1, 3}, hmax);
+        CHECK(pipe.halo() == std::make_pair(size_t(1), size_t(4)));
+
+        for (auto shape : std::vector<std::pair<size_t, size_t>>{{0, 0}, {1, 1}, {2, 3}, {5, 7}, {13, 17}})
+            for (size_t nthreads : {1, 3})
+            {
+                pipe.tile(shape.first, shape.second);
+                CHECK(pipe.run(image, nthreads).vv() == expected.vv());
+            }
+    }
+}
+
+TEST_CASE("Test Pipeline RGB")
+{
+    const img r = make_frame(6, 9, 0), g = make_frame(6, 9, 5), b = make_frame(6, 9, 9);
+    clib::img_rgb<ff> image;
+    image.r() = r;
+    image.g() = g;
+    image.b() = b;
+
+    const std::vector<std::vector<ff>> box(3, std::vector<ff>(3, ff_(1)));
+    clib::pipeline<ff> pipe;
+    pipe.convolution(box).tile(4, 4);
+
+    auto res = pipe.run(image);
+    CHECK(res.r().vv() == img::convolution(box, r).vv());
+    CHECK(res.g().vv() == img::convolution(box, g).vv());
+    CHECK(res.b().vv() == img::convolution(box, b).vv());
+}
+
+TEST_CASE("Test Pipeline Video")
+{
+    const std::vector<std::vector<ff>> box(3, std::vector<ff>(3, ff_(1)));
+    clib::pipeline<ff> pipe;
+    pipe.convolution(box).tile(4, 4);
+
+    // Меньше кадров, чем потоков пула (кадры по очереди), и больше (кадры по потокам)
+    const size_t workers = clib::thread_pool::instance().workers();
+    for (size_t nframes : {size_t(1), workers + 1})
+    {
+        std::vector<clib::img_rgb<ff>> frames(nframes);
+        for (size_t f = 0; f < nframes; ++f)
+        {
+            frames[f].r() = make_frame(7, 9, static_cast<int>(f));
+            frames[f].g() = make_frame(7, 9, static_cast<int>(f) + 3);
+            frames[f].b() = make_frame(7, 9, static_cast<int>(f) + 6);
+        }
+
+        const clib::video<ff> vid(frames);
+        const clib::video<ff> res = vid.apply(pipe);
+        REQUIRE(res.frames() == nframes);
+        bool same = true;
+        for (size_t f = 0; f < nframes; ++f)
+        {
+            const auto expected = pipe.run(frames[f], 1);
+            same = same && res(f).r().vv() == expected.r().vv() && res(f).g().vv() == expected.g().vv() &&
+                   res(f).b().vv() == expected.b().vv();
+        }
+        CHECK(same);
+    }
+}
+
+#undef ff_
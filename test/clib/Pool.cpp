@@ -0,0 +1,120 @@
+#include <doctest.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include "clib/Flexfloat.hpp"
+#include "clib/image.hpp"
+#include "clib/pool.hpp"
+
+using clib::thread_pool;
+using idx_t = thread_pool::idx_t;
+
+TEST_CASE("Test Pool Topology")
+{
+    CHECK(clib::numa_topology::parse_cpulist("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    CHECK(clib::numa_topology::parse_cpulist("5") == std::vector<int>{5});
+
+    const auto topology = clib::numa_topology::detect();
+    REQUIRE(!topology.node_cpus.empty());
+    CHECK(!topology.node_cpus[0].empty());
+
+    // Узлы содержат только процессоры, разрешенные процессу
+    const auto allowed = clib::numa_topology::allowed_cpus();
+    if (!allowed.empty())
+        for (const auto &cpus : topology.node_cpus)
+            for (int cpu : cpus)
+                CHECK(std::find(allowed.begin(), allowed.end(), cpu) != allowed.end());
+
+    clib::numa_topology host;
+    host.node_cpus = {{0, 1, 2, 3}, {4, 5, 6, 7}, {8, 9}};
+    host.restrict_to({1, 2, 9, 12});
+    CHECK(host.node_cpus == std::vector<std::vector<int>>{{1, 2}, {9}});
+}
+
+TEST_CASE("Test Pool Pinning")
+{
+    // Рабочие потоки закрепляются за разрешенными процессорами
+    thread_pool pool(clib::numa_topology::detect());
+    for (idx_t w = 0; w < pool.workers(); ++w)
+        CHECK(pool.pinned(w));
+
+    // Процессор вне маски закрепить нельзя: поток работает без закрепления
+    clib::numa_topology missing;
+    missing.node_cpus = {{100000}};
+    thread_pool unpinned(missing);
+    REQUIRE(unpinned.workers() == 1);
+    CHECK(!unpinned.pinned(0));
+    std::atomic<int> rows{0};
+    unpinned.bands(1, 5, [&](idx_t st, idx_t en) { rows += int(en - st); });
+    CHECK(rows == 5);
+}
+
+TEST_CASE("Test Pool Bands")
+{
+    // Два узла по два процессора, без закрепления
+    clib::numa_topology topology;
+    topology.node_cpus = {{0, 1}, {2, 3}};
+    thread_pool pool(topology, false);
+    REQUIRE(pool.workers() == 4);
+    CHECK(pool.worker_node(1) == 0);
+    CHECK(pool.worker_node(2) == 1);
+    CHECK(pool.current_worker() == pool.workers());
+
+    const idx_t rows = 103;
+    for (idx_t nthreads : {2, 3, 4, 7})
+    {
+        std::vector<idx_t> worker(rows, pool.workers());
+        std::vector<int> visits(rows, 0);
+        pool.bands(nthreads, rows, [&](idx_t st, idx_t en) {
+            for (idx_t i = st; i < en; ++i)
+            {
+                ++visits[i];
+                worker[i] = pool.current_worker();
+            }
+        });
+
+        for (idx_t i = 0; i < rows; ++i)
+        {
+            CHECK(visits[i] == 1);
+            CHECK(worker[i] < pool.workers());
+        }
+        // Полоса выполняется потоком, определяемым положением ее начала
+        CHECK(worker[0] == 0);
+        CHECK(pool.worker_node(worker[rows - 1]) == 1);
+    }
+
+    // Одинаковое разбиение - одинаковое отображение строк на потоки
+    std::vector<idx_t> first(rows), second(rows);
+    pool.bands(4, rows, [&](idx_t st, idx_t en) {
+        for (idx_t i = st; i < en; ++i)
+            first[i] = pool.current_worker();
+    });
+    pool.bands(4, rows, [&](idx_t st, idx_t en) {
+        for (idx_t i = st; i < en; ++i)
+            second[i] = pool.current_worker();
+    });
+    CHECK(first == second);
+
+    // Вложенный вызов выполняется в рабочем потоке
+    std::atomic<int> inner{0};
+    pool.bands(4, 8, [&](idx_t, idx_t) { pool.bands(4, 8, [&](idx_t st, idx_t en) { inner += int(en - st); }); });
+    CHECK(inner == 4 * 8);
+
+    CHECK_THROWS_AS(pool.bands(4, 8, [](idx_t st, idx_t) {
+        if (st == 4)
+            throw std::runtime_error("band");
+    }),
+                    std::runtime_error);
+}
+
+TEST_CASE("Test Pool Image")
+{
+    using ff = clib::Flexfloat;
+    const ff one = ff::from_arithmetic_t(8, 23, 127, 1);
+
+    // Конструктор и поэлементные операции выполняются пулом
+    clib::img<ff> a(one, 300, 50, 4), b(one, 300, 50, 4);
+    clib::img<ff> c = a + b;
+    CHECK(c(0, 0).to_float() == 2.0f);
+    CHECK(c(299, 49).to_float() == 2.0f);
+}
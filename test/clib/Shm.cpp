@@ -0,0 +1,196 @@
+#include <doctest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "clib/ShmTransport.hpp"
+
+using vsim::idx_t;
+using vsim::pixel_t;
+
+namespace
+{
+pixel_t pattern(idx_t n)
+{
+    return static_cast<pixel_t>(n * 7919 % 1021);
+}
+
+// Процесс-потребитель: читает видео из in, проверяет курсоры и отсчеты, возвращает отсчеты + 1 через out
+int consumer(const std::string &in_name, const std::string &out_name)
+{
+    vsim::ShmRing in = vsim::ShmRing::open(in_name);
+    vsim::ShmRing out = vsim::ShmRing::open(out_name);
+    vsim::ShmSerializer source(in, 5);
+    vsim::ShmDeserializer target(out, 7);
+
+    const idx_t line = source.cols() * source.clrs();
+    std::vector<pixel_t> buf(source.rows() * line);
+    idx_t n = 0;
+    for (idx_t f = 0; f < source.frames(); ++f)
+    {
+        // Первая строка поотсчетно, затем остаток кадра одним вызовом
+        for (idx_t k = 0; k < line; ++k, ++n)
+        {
+            if (source.frame() != f || source.row() != 0 || source.col() != k / source.clrs() ||
+                source.clr() != k % source.clrs())
+                return 2;
+            if (source.pop() != pattern(n))
+                return 3;
+        }
+        if (source.pop_n(buf.data(), buf.size() - line) != buf.size() - line)
+            return 4;
+        for (idx_t k = 0; k < buf.size() - line; ++k, ++n)
+            if (buf[k] != pattern(n))
+                return 5;
+    }
+    if (source.pop_n(buf.data(), buf.size()) != 0 || source.pop() != 0)
+        return 6;
+
+    for (idx_t k = 0; k < n; ++k)
+        target.push(pattern(k) + 1);
+    target.close();
+    return 0;
+}
+} // namespace
+
+TEST_CASE("Test Shm Transport")
+{
+    vsim::shm_media media;
+    media.frames = 3;
+    media.rows = 4;
+    media.cols = 6;
+    media.clrs = 3;
+    media.fps = 25;
+
+    const std::string prefix = "/clib_test_" + std::to_string(getpid());
+
+    // Кольца меньше кадра: обе стороны упираются в обратное давление
+    vsim::ShmRing to_child = vsim::ShmRing::create(prefix + "_in", 16, media);
+    vsim::ShmRing from_child = vsim::ShmRing::create(prefix + "_out", 16, media);
+    CHECK(to_child.capacity() == 16);
+    CHECK(from_child.media().size() == 3 * 4 * 6 * 3);
+
+    const pid_t pid = fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0)
+    {
+        int code = 1;
+        try
+        {
+            code = consumer(prefix + "_in", prefix + "_out");
+        }
+        catch (...)
+        {
+        }
+        _exit(code);
+    }
+
+    {
+        vsim::ShmDeserializer target(to_child, 11);
+        std::vector<pixel_t> frame(media.frame_size());
+        for (idx_t f = 0; f < media.frames; ++f)
+        {
+            CHECK(target.frame() == f);
+            for (idx_t k = 0; k < frame.size(); ++k)
+                frame[k] = pattern(f * frame.size() + k);
+            CHECK(target.push_frame(frame.data()) == frame.size());
+        }
+        CHECK(target.push_n(frame.data(), 1) == 0);
+        target.close();
+    }
+
+    vsim::ShmSerializer source(from_child);
+    std::vector<pixel_t> echo(media.size() + 1);
+    CHECK(source.pop_n(echo.data(), echo.size()) == media.size());
+    bool same = true;
+    for (idx_t k = 0; k < media.size(); ++k)
+        same = same && echo[k] == pattern(k) + 1;
+    CHECK(same);
+    CHECK(source.frame() == media.frames);
+
+    int status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status));
+    CHECK(WEXITSTATUS(status) == 0);
+
+    CHECK_THROWS(vsim::ShmRing::open(prefix + "_missing"));
+}
+
+TEST_CASE("Test Shm Closed By Reader")
+{
+    vsim::shm_media media;
+    media.frames = 2;
+    media.rows = 2;
+    media.cols = 2;
+    media.clrs = 3;
+
+    vsim::ShmRing ring = vsim::ShmRing::create("/clib_test_closed_" + std::to_string(getpid()), 16, media);
+    vsim::ShmDeserializer target(ring, 5);
+
+    // 4 отсчета переданы, 3 ждут в буфере, когда читатель закрывает кольцо
+    std::vector<pixel_t> src(media.size());
+    for (idx_t k = 0; k < src.size(); ++k)
+        src[k] = pattern(k);
+    CHECK(target.push_n(src.data(), 4) == 4);
+    for (idx_t k = 4; k < 7; ++k)
+        target.push(src[k]);
+    CHECK(target.row() == 1);
+    CHECK(target.col() == 0);
+    CHECK(target.clr() == 1);
+    ring.close();
+
+    // Буфер не передан: курсор возвращается к переданным отсчетам, новые отсчеты не принимаются
+    CHECK(target.flush() == 0);
+    CHECK(target.stopped());
+    CHECK(target.frame() == 0);
+    CHECK(target.row() == 0);
+    CHECK(target.col() == 1);
+    CHECK(target.clr() == 1);
+
+    target.push(src[4]);
+    CHECK(target.flush() == 0);
+    CHECK(target.push_n(src.data() + 4, 2) == 0);
+    CHECK(target.push_frame(src.data()) == 0);
+    CHECK(target.col() == 1);
+    CHECK(target.clr() == 1);
+
+    // Читатель получает ровно переданные отсчеты
+    vsim::ShmSerializer source(ring);
+    std::vector<pixel_t> dst(media.size());
+    CHECK(source.pop_n(dst.data(), dst.size()) == 4);
+    dst.resize(4);
+    src.resize(4);
+    CHECK(dst == src);
+}
+
+TEST_CASE("Test Shm Closed During Push")
+{
+    vsim::shm_media media;
+    media.frames = 1;
+    media.rows = 4;
+    media.cols = 4;
+    media.clrs = 3;
+
+    vsim::ShmRing ring = vsim::ShmRing::create("/clib_test_push_" + std::to_string(getpid()), 8, media);
+    vsim::ShmDeserializer target(ring, 4);
+
+    // Читатель забирает 8 отсчетов и закрывает кольцо посреди записи: push_n возвращает переданное количество
+    std::vector<pixel_t> src(media.size(), 5);
+    std::thread reader([&ring] {
+        std::vector<pixel_t> dst(8);
+        ring.read(dst.data(), dst.size());
+        ring.close();
+    });
+    const idx_t done = target.push_n(src.data(), src.size());
+    reader.join();
+
+    CHECK(done >= 8);
+    CHECK(done < media.size());
+    CHECK(target.stopped());
+    CHECK(target.row() * 4 * 3 + target.col() * 3 + target.clr() == done);
+    target.push(1);
+    CHECK(target.flush() == 0);
+    CHECK(target.push_n(src.data(), 1) == 0);
+    CHECK(target.row() * 4 * 3 + target.col() * 3 + target.clr() == done);
+}
@@ -0,0 +1,95 @@
+#include <doctest.h>
+#include "clib/Flexfloat.hpp"
+#include "clib/image.hpp"
+#include "clib/stats.hpp"
+
+using ff = clib::Flexfloat;
+using img = clib::img<ff>;
+
+#define ff_(value) ff::from_arithmetic_t(8, 23, 127, value)
+
+TEST_CASE("Test Stats Profile")
+{
+    const size_t rows = 10, cols = 13;
+    std::vector<std::vector<ff>> arr(rows, std::vector<ff>(cols));
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            arr[i][j] = ff_(static_cast<float>((i * 31 + j * 7) % 40) * 0.75f - 5.0f);
+    const img image(arr);
+
+    clib::stats_spec spec;
+    spec.bins = 4;
+    spec.lo = 0.0f;
+    spec.hi = 20.0f;
+    spec.block_rows = 4;
+    spec.block_cols = 5;
+
+    auto stats = clib::profile(image, spec, 1);
+
+    CHECK(stats.sum == image.sum());
+    CHECK(stats.mean() == image.mean());
+    CHECK(stats.count == rows * cols);
+
+    float minn = arr[0][0].to_float(), maxx = minn, sum_sq = 0;
+    size_t under = 0, over = 0, total_exp = 0;
+    std::vector<size_t> hist(4);
+    for (auto &line : arr)
+        for (auto &val : line)
+        {
+            const float f = val.to_float();
+            minn = std::min(minn, f);
+            maxx = std::max(maxx, f);
+            sum_sq += f * f;
+            if (f < 0)
+                ++under;
+            else if (f >= 20)
+                ++over;
+            else
+                ++hist[static_cast<size_t>(f / 5)];
+        }
+    CHECK(stats.min.to_float() == minn);
+    CHECK(stats.max.to_float() == maxx);
+    CHECK(stats.sum_sq.to_float() == doctest::Approx(sum_sq));
+    CHECK(stats.underflow == under);
+    CHECK(stats.overflow == over);
+    CHECK(stats.hist == hist);
+
+    std::vector<size_t> exp_hist;
+    for (auto &line : arr)
+        for (auto &val : line)
+        {
+            const auto exp = static_cast<size_t>(val.get_e());
+            exp_hist.resize(std::max(exp_hist.size(), exp + 1));
+            ++exp_hist[exp];
+        }
+    for (auto n : stats.exp_hist)
+        total_exp += n;
+    CHECK(total_exp == rows * cols);
+    CHECK(stats.exp_min == 0);
+    CHECK(stats.exp_hist == exp_hist);
+
+    // Сетка 3 x 3, последний ряд и столбец блоков неполные
+    CHECK(stats.grid_rows == 3);
+    CHECK(stats.grid_cols == 3);
+    CHECK(stats.block(2, 2).count == 2 * 3);
+    float block_sum = 0;
+    for (size_t i = 4; i < 8; ++i)
+        for (size_t j = 5; j < 10; ++j)
+            block_sum += arr[i][j].to_float();
+    CHECK(stats.block(1, 1).sum.to_float() == doctest::Approx(block_sum));
+
+    // Результат не зависит от количества потоков
+    for (size_t nthreads : {2, 3, 8})
+    {
+        auto other = clib::profile(image, spec, nthreads);
+        CHECK(other.sum == stats.sum);
+        CHECK(other.sum_sq == stats.sum_sq);
+        CHECK(other.min == stats.min);
+        CHECK(other.max == stats.max);
+        CHECK(other.hist == stats.hist);
+        CHECK(other.exp_hist == stats.exp_hist);
+        CHECK(other.block(1, 1).sum == stats.block(1, 1).sum);
+    }
+}
+
+#undef ff_
@@ -0,0 +1,115 @@
+#include <doctest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "clib/tasks.hpp"
+
+using clib::idx_t;
+
+TEST_CASE("Test Run Tasks")
+{
+    // Каждая задача выполняется один раз; повторные вызовы работают на одних и тех же потоках пула
+    std::mutex mutex;
+    std::set<std::thread::id> ids;
+    for (int call = 0; call < 50; ++call)
+    {
+        std::vector<int> visits(37, 0);
+        clib::run_tasks(visits.size(), 0, [&](idx_t task) {
+            ++visits[task];
+            std::lock_guard<std::mutex> lock(mutex);
+            ids.insert(std::this_thread::get_id());
+        });
+        CHECK(std::count(visits.begin(), visits.end(), 1) == 37);
+    }
+    CHECK(ids.size() <= clib::thread_pool::instance().workers() + 1);
+
+    // Вложенный вызов выполняется в том же потоке
+    std::atomic<idx_t> inner{0};
+    clib::run_tasks(8, 4, [&](idx_t) { clib::run_tasks(5, 4, [&](idx_t) { ++inner; }); });
+    CHECK(inner == 8 * 5);
+
+    CHECK_THROWS_WITH(clib::run_tasks(100, 4,
+                                      [](idx_t task) {
+                                          if (task == 17)
+                                              throw std::runtime_error("task");
+                                      }),
+                      "task");
+}
+
+TEST_CASE("Test Run Ordered")
+{
+    const idx_t items = 200;
+
+    for (idx_t workers : {1, 3, 8})
+        for (idx_t depth : {1, 2, 5, 0})
+        {
+            idx_t next = 0;
+            std::atomic<idx_t> in_flight{0}, max_in_flight{0};
+            std::vector<idx_t> out;
+
+            const idx_t res = clib::run_ordered<idx_t>(
+                [&](idx_t &item) {
+                    if (next == items)
+                        return false;
+                    item = next++;
+                    idx_t now = ++in_flight, prev = max_in_flight;
+                    while (now > prev && !max_in_flight.compare_exchange_weak(prev, now))
+                        ;
+                    return true;
+                },
+                [&](idx_t &item) {
+                    // Разная длительность обработки перемешивает порядок завершения
+                    std::this_thread::sleep_for(std::chrono::microseconds((item * 7919) % 13 * 10));
+                    item = item * item;
+                },
+                [&](idx_t index, idx_t &item) {
+                    CHECK(item == index * index);
+                    out.push_back(item);
+                    --in_flight;
+                },
+                workers, depth);
+
+            CHECK(res == items);
+            REQUIRE(out.size() == items);
+            for (idx_t i = 0; i < items; ++i)
+                CHECK(out[i] == i * i);
+            CHECK(max_in_flight <= (depth != 0 ? depth : workers * 2));
+        }
+
+    // Пустой поток
+    CHECK(clib::run_ordered<int>([](int &) { return false; }, [](int &) {}, [](idx_t, int &) {}, 2) == 0);
+}
+
+TEST_CASE("Test Run Ordered Errors")
+{
+    auto run = [](idx_t fail_produce, idx_t fail_process, idx_t fail_consume) {
+        idx_t next = 0;
+        return clib::run_ordered<idx_t>(
+            [&](idx_t &item) {
+                if (next == fail_produce)
+                    throw std::runtime_error("produce");
+                item = next++;
+                return next <= 100;
+            },
+            [&](idx_t &item) {
+                if (item == fail_process)
+                    throw std::runtime_error("process");
+            },
+            [&](idx_t, idx_t &item) {
+                if (item == fail_consume)
+                    throw std::runtime_error("consume");
+            },
+            4, 4);
+    };
+
+    const idx_t never = 1000;
+    CHECK(run(never, never, never) == 100);
+    CHECK_THROWS_WITH(run(10, never, never), "produce");
+    CHECK_THROWS_WITH(run(never, 10, never), "process");
+    CHECK_THROWS_WITH(run(never, never, 10), "consume");
+}
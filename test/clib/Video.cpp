@@ -0,0 +1,162 @@
+#include <doctest.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include "clib/Flexfixed.hpp"
+#include "clib/FrameCache.hpp"
+#include "clib/VideoReader.hpp"
+#include "clib/VideoWriter.hpp"
+#include "clib/video.hpp"
+
+using clib::Flexfixed;
+using clib::idx_t;
+using clib::img_rgb;
+
+namespace
+{
+const idx_t frames = 6, rows = 32, cols = 48;
+
+// Кадры одного цвета, чтобы прореживание цветности YUV 4:2:0 не искажало отсчеты
+int color(idx_t frame, idx_t clr)
+{
+    const int base[] = {40, 200, 100};
+    const int step[] = {25, -20, 10};
+    return base[clr] + step[clr] * static_cast<int>(frame);
+}
+
+// Кодер mpeg4 входит в libavcodec, но может быть выключен при сборке FFmpeg: тогда тест пропускается
+std::unique_ptr<clib::VideoWriter> open_writer(const std::string &path)
+{
+    try
+    {
+        return std::unique_ptr<clib::VideoWriter>(new clib::VideoWriter(path, rows, cols, 25));
+    }
+    catch (const std::runtime_error &e)
+    {
+        MESSAGE("FFmpeg cannot encode " << path << ", skipped: " << std::string(e.what()));
+        return nullptr;
+    }
+}
+
+void write_clip(clib::VideoWriter &writer)
+{
+    for (idx_t f = 0; f < frames; ++f)
+    {
+        for (idx_t i = 0; i < rows; ++i)
+            for (idx_t j = 0; j < cols; ++j)
+                for (idx_t clr = 0; clr < 3; ++clr)
+                    writer.set(color(f, clr), i, j, clr);
+        writer.write_frame();
+    }
+    writer.finish();
+}
+
+// Наибольшее отклонение отсчетов текущего кадра reader от color(frame, clr)
+int max_error(const clib::VideoReader &reader, idx_t frame)
+{
+    int err = 0;
+    for (idx_t i = 0; i < reader.rows(); ++i)
+        for (idx_t j = 0; j < reader.cols(); ++j)
+            for (idx_t clr = 0; clr < 3; ++clr)
+                err = std::max(err, std::abs(reader.get(i, j, clr) - color(frame, clr)));
+    return err;
+}
+} // namespace
+
+TEST_CASE("Test Video Round Trip")
+{
+    const std::string path = "/tmp/clib_video_" + std::to_string(getpid()) + ".avi";
+
+    auto writer = open_writer(path);
+    if (!writer)
+        return;
+    write_clip(*writer);
+    CHECK(writer->frames() == frames);
+    writer.reset();
+
+    clib::VideoReader reader(path);
+    CHECK(reader.rows() == rows);
+    CHECK(reader.cols() == cols);
+    CHECK(reader.clrs() == 3);
+
+    idx_t decoded = 0;
+    while (reader.next())
+    {
+        CHECK(reader.frame() == decoded);
+        CHECK(max_error(reader, decoded) <= 8);
+        ++decoded;
+    }
+    CHECK(decoded == frames);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Test Video Transcode")
+{
+    const std::string src = "/tmp/clib_video_src_" + std::to_string(getpid()) + ".avi";
+    const std::string dst = "/tmp/clib_video_dst_" + std::to_string(getpid()) + ".avi";
+
+    auto writer = open_writer(src);
+    if (!writer)
+        return;
+    write_clip(*writer);
+    writer.reset();
+
+    // Кадры проходят через img_rgb<Flexfixed> без изменений, в том же порядке
+    const Flexfixed prototype(12, 8);
+    {
+        clib::VideoReader reader(src);
+        clib::VideoWriter out(dst, rows, cols, 25);
+        const idx_t written = clib::video<Flexfixed>::transcode(
+            prototype, reader, out, [](const img_rgb<Flexfixed> &frame) { return frame; }, 2, 3);
+        out.finish();
+        CHECK(written == frames);
+        CHECK(out.frames() == frames);
+    }
+
+    clib::VideoReader reader(dst);
+    CHECK(reader.rows() == rows);
+    CHECK(reader.cols() == cols);
+
+    idx_t decoded = 0;
+    while (reader.next())
+    {
+        // Два поколения сжатия
+        CHECK(max_error(reader, decoded) <= 12);
+        ++decoded;
+    }
+    CHECK(decoded == frames);
+
+    std::remove(src.c_str());
+    std::remove(dst.c_str());
+}
+
+TEST_CASE("Test Video Empty Cache")
+{
+    char tmpl[] = "/tmp/clib_video_cache_XXXXXX";
+    REQUIRE(mkdtemp(tmpl) != nullptr);
+    const std::string dir = tmpl;
+    const std::string path = dir + "/empty.mkv";
+
+    // Ролик без кадров
+    auto writer = open_writer(path);
+    if (!writer)
+    {
+        std::system(("rm -rf " + dir).c_str());
+        return;
+    }
+    writer->finish();
+    writer.reset();
+
+    // Кэш без кадров не создается
+    const clib::FrameCache cache(dir + "/cache");
+    CHECK_THROWS_AS(cache.open(path), std::runtime_error);
+    CHECK(!cache.valid(path));
+    CHECK(!std::ifstream(cache.raw_path(path)));
+
+    std::system(("rm -rf " + dir).c_str());
+}
@@ -0,0 +1,385 @@
+#include <doctest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "clib/VideoInterface.hpp"
+
+using vsim::idx_t;
+using vsim::pixel_t;
+
+namespace
+{
+// Значение отсчета (frame, i, j, clr), различное для всех отсчетов небольшого ролика
+pixel_t sample_at(idx_t frame, idx_t i, idx_t j, idx_t clr)
+{
+    return static_cast<pixel_t>(frame * 1000 + i * 100 + j * 10 + clr);
+}
+
+// Изображение rows x cols x 3 со значениями (i * 31 + j * 7 + c * 50) % 256
+void write_png(const std::string &path, idx_t rows, idx_t cols)
+{
+    clib::CImgView8 view;
+    view.init(rows, cols, 3);
+    for (idx_t c = 0; c < 3; ++c)
+        for (idx_t i = 0; i < rows; ++i)
+            for (idx_t j = 0; j < cols; ++j)
+                view.set(static_cast<int>((i * 31 + j * 7 + c * 50) % 256), i, j, c);
+    view.write_img(path);
+}
+
+// Кадры f = 0..count-1 со значениями (f * 50 + k) % 256, k - номер отсчета в кадре; заголовок сообщает header кадров
+class FakeSource final : public vsim::FrameSource
+{
+    idx_t rows_, cols_, count_, header_;
+    std::vector<uint8_t> frame_;
+    idx_t &reads_; ///< вызовы next(), вернувшие кадр
+
+  public:
+    FakeSource(idx_t rows, idx_t cols, idx_t count, idx_t header, idx_t &reads)
+        : rows_(rows), cols_(cols), count_(count), header_(header), frame_(rows * cols * 3), reads_(reads)
+    {
+    }
+
+    idx_t rows() const override
+    {
+        return rows_;
+    }
+    idx_t cols() const override
+    {
+        return cols_;
+    }
+    idx_t clrs() const override
+    {
+        return 3;
+    }
+    size_t fps() const override
+    {
+        return 25;
+    }
+    idx_t frames() const override
+    {
+        return header_;
+    }
+    bool next() override
+    {
+        if (reads_ == count_)
+            return false;
+        for (idx_t k = 0; k < frame_.size(); ++k)
+            frame_[k] = static_cast<uint8_t>((reads_ * 50 + k) % 256);
+        ++reads_;
+        return true;
+    }
+    const uint8_t *row(idx_t i) const override
+    {
+        return frame_.data() + i * cols_ * 3;
+    }
+};
+
+// Запоминает записанные кадры
+class FakeSink final : public vsim::FrameSink
+{
+    std::vector<uint8_t> frame_;
+    idx_t line_;
+    std::vector<std::vector<uint8_t>> &written_;
+    idx_t &finished_;
+
+  public:
+    FakeSink(idx_t rows, idx_t cols, std::vector<std::vector<uint8_t>> &written, idx_t &finished)
+        : frame_(rows * cols * 3, 77), line_(cols * 3), written_(written), finished_(finished)
+    {
+    }
+
+    uint8_t *row(idx_t i) override
+    {
+        return frame_.data() + i * line_;
+    }
+    void write_frame() override
+    {
+        written_.push_back(frame_);
+    }
+    void finish() override
+    {
+        ++finished_;
+    }
+};
+} // namespace
+
+TEST_CASE("Test Video Flat Buffer")
+{
+    // По умолчанию отсчеты хранятся в int без потерь
+    vsim::Video video(3, 2, 4, 3, 25);
+    CHECK(video.sample_type() == clib::sample_t::i32);
+    CHECK(video.frames() == 3);
+    CHECK(video.frame_size() == 2 * 4 * 3);
+
+    for (idx_t f = 0; f < 3; ++f)
+        for (idx_t i = 0; i < 2; ++i)
+            for (idx_t j = 0; j < 4; ++j)
+                for (idx_t c = 0; c < 3; ++c)
+                    video.set(sample_at(f, i, j, c), f, i, j, c);
+    video.set(-7, 0, 0, 0, 0);
+    video.set(70000, 2, 1, 3, 2);
+
+    CHECK(video.get(0, 0, 0, 0) == -7);
+    CHECK(video.get(2, 1, 3, 2) == 70000);
+
+    // Кадры лежат один за другим, внутри кадра цвет меняется быстрее всего (порядок Serializer::pop)
+    std::vector<pixel_t> frame(video.frame_size());
+    video.get_run(1, 0, frame.data(), frame.size());
+    bool same = true;
+    for (idx_t i = 0; i < 2; ++i)
+        for (idx_t j = 0; j < 4; ++j)
+            for (idx_t c = 0; c < 3; ++c)
+                same = same && frame[(i * 4 + j) * 3 + c] == sample_at(1, i, j, c);
+    CHECK(same);
+
+    // Отрезок внутри кадра
+    const std::vector<pixel_t> run = {-1, -2, -3, -4, -5};
+    video.set_run(2, 7, run.data(), run.size());
+    std::vector<pixel_t> back(run.size());
+    video.get_run(2, 7, back.data(), back.size());
+    CHECK(back == run);
+    CHECK(video.get(2, 0, 2, 1) == -1);
+    CHECK(video.get(2, 0, 2, 0) == sample_at(2, 0, 2, 0));
+    CHECK(video.get(1, 0, 2, 1) == sample_at(1, 0, 2, 1));
+
+    video.clear_frame(1);
+    CHECK(video.get(1, 1, 3, 2) == 0);
+    CHECK(video.get(0, 1, 3, 2) == sample_at(0, 1, 3, 2));
+    CHECK(video.get(2, 1, 3, 2) == 70000);
+}
+
+TEST_CASE("Test Video Sample Types")
+{
+    // 8- и 16-битные отсчеты выбираются явно и насыщаются
+    vsim::Video video8(2, 1, 2, 1, 0, clib::sample_t::u8);
+    video8.set(300, 0, 0, 0, 0);
+    video8.set(-5, 0, 0, 1, 0);
+    CHECK(video8.get(0, 0, 0, 0) == 255);
+    CHECK(video8.get(0, 0, 1, 0) == 0);
+
+    vsim::Video video16(2, 1, 2, 1, 0, clib::sample_t::u16);
+    const std::vector<pixel_t> run = {300, 70000};
+    video16.set_run(1, 0, run.data(), run.size());
+    CHECK(video16.get(1, 0, 0, 0) == 300);
+    CHECK(video16.get(1, 0, 1, 0) == 65535);
+
+    // Размер отсчетов передается через init
+    vsim::Deserializer target;
+    target.init(2, 1, 2, 1, 0, clib::sample_t::u8);
+    CHECK(target.frames() == 2);
+}
+
+TEST_CASE("Test Video Shared Image Frame")
+{
+    char tmpl[] = "/tmp/clib_video_XXXXXX";
+    REQUIRE(mkdtemp(tmpl) != nullptr);
+    const std::string png = std::string(tmpl) + "/input.png";
+    write_png(png, 3, 5);
+
+    // Второй кадр изображения хранится вместе с первым
+    vsim::Video image(png);
+    REQUIRE(image.frames() == 2);
+    CHECK(image.sample_type() == clib::sample_t::u8);
+    CHECK(image.get(1, 2, 4, 1) == (2 * 31 + 4 * 7 + 50) % 256);
+    CHECK(image.get(1, 2, 4, 1) == image.get(0, 2, 4, 1));
+
+    // Запись во второй кадр сначала дает ему свою копию, первый кадр не меняется
+    image.set(7, 1, 2, 4, 1);
+    CHECK(image.get(1, 2, 4, 1) == 7);
+    CHECK(image.get(0, 2, 4, 1) == (2 * 31 + 4 * 7 + 50) % 256);
+    CHECK(image.get(1, 0, 0, 0) == image.get(0, 0, 0, 0));
+
+    // После копирования кадры независимы
+    image.set(9, 0, 0, 0, 0);
+    CHECK(image.get(0, 0, 0, 0) == 9);
+    CHECK(image.get(1, 0, 0, 0) == 0);
+
+    // Запись в первый кадр тоже не затрагивает второй
+    vsim::Video other(png);
+    other.clear_frame(0);
+    CHECK(other.get(0, 2, 4, 1) == 0);
+    CHECK(other.get(1, 2, 4, 1) == (2 * 31 + 4 * 7 + 50) % 256);
+
+    std::remove(png.c_str());
+    rmdir(tmpl);
+}
+
+TEST_CASE("Test Serializer Batches")
+{
+    // 3 кадра 2x3, 2 цвета: строка - 6 отсчетов, кадр - 12
+    const idx_t frames = 3, rows = 2, cols = 3, clrs = 2, line = cols * clrs, frame = rows * line;
+    const idx_t total = frames * frame;
+
+    std::vector<pixel_t> src(total);
+    for (idx_t k = 0; k < total; ++k)
+        src[k] = static_cast<pixel_t>(k * 37) - 300;
+
+    vsim::Deserializer target;
+    target.init(frames, rows, cols, clrs);
+
+    auto target_at = [&target](idx_t fr, idx_t i, idx_t j, idx_t c) {
+        CHECK(target.frame() == fr);
+        CHECK(target.row() == i);
+        CHECK(target.col() == j);
+        CHECK(target.clr() == c);
+    };
+
+    // Пакет внутри строки, затем строка с середины строки: переход через границу строки
+    CHECK(target.push_n(src.data(), 4) == 4);
+    target_at(0, 0, 2, 0);
+    CHECK(target.push_line(src.data() + 4) == line);
+    target_at(0, 1, 2, 0);
+
+    // Переход через границу кадра
+    CHECK(target.push_n(src.data() + 10, 5) == 5);
+    target_at(1, 0, 1, 1);
+
+    // Кадр с середины кадра и поштучная запись между пакетами
+    CHECK(target.push_frame(src.data() + 15) == frame);
+    target_at(2, 0, 1, 1);
+    target.push(src[27]);
+    target_at(2, 0, 2, 0);
+
+    // Короткая запись в конце: записывается только остаток, курсор - за последним кадром
+    CHECK(target.push_n(src.data() + 28, 100) == total - 28);
+    target_at(3, 0, 0, 0);
+    CHECK(target.push_n(src.data(), 1) == 0);
+    CHECK(target.push_frame(src.data()) == 0);
+
+    std::vector<pixel_t> stored(total);
+    for (idx_t f = 0; f < frames; ++f)
+        target.video().get_run(f, 0, stored.data() + f * frame, frame);
+    CHECK(stored == src);
+
+    vsim::Serializer source;
+    source.init(target.video());
+
+    auto source_at = [&source](idx_t fr, idx_t i, idx_t j, idx_t c) {
+        CHECK(source.frame() == fr);
+        CHECK(source.row() == i);
+        CHECK(source.col() == j);
+        CHECK(source.clr() == c);
+    };
+
+    std::vector<pixel_t> dst(total + 10, 0);
+    CHECK(source.pop_n(dst.data(), 3) == 3);
+    source_at(0, 0, 1, 1);
+    CHECK(source.pop_line(dst.data() + 3) == line);
+    source_at(0, 1, 1, 1);
+    CHECK(source.pop_frame(dst.data() + 9) == frame);
+    source_at(1, 1, 1, 1);
+    dst[21] = source.pop();
+    source_at(1, 1, 2, 0);
+    CHECK(source.pop_n(dst.data() + 22, 2) == 2);
+    source_at(2, 0, 0, 0);
+
+    // Короткое чтение в конце
+    CHECK(source.pop_n(dst.data() + 24, 20) == total - 24);
+    source_at(3, 0, 0, 0);
+    CHECK(source.pop_line(dst.data()) == 0);
+
+    dst.resize(total);
+    CHECK(dst == src);
+
+    // Повторная инициализация возвращает курсор в начало
+    source.init(frames, rows, cols, clrs);
+    source_at(0, 0, 0, 0);
+    CHECK(source.pop_frame(dst.data()) == frame);
+    CHECK(dst[0] == 0);
+    source_at(1, 0, 0, 0);
+}
+
+TEST_CASE("Test Serializer Stream")
+{
+    // 5 кадров 2x2 в кольце из 2 кадров; заголовок занижает количество кадров
+    const idx_t frame = 2 * 2 * 3;
+    idx_t reads = 0;
+
+    vsim::Serializer source;
+    source.init_stream(std::unique_ptr<vsim::FrameSource>(new FakeSource(2, 2, 5, 3, reads)), 2);
+    CHECK(source.video().frames() == 2);
+    CHECK(source.video().sample_type() == clib::sample_t::u8);
+    CHECK(source.fps() == 25);
+
+    // Декодируется только кольцо: кадры 0 и 1
+    CHECK(reads == 2);
+    CHECK(source.frames() == 3);
+
+    std::vector<pixel_t> dst(frame);
+    bool same = true;
+    for (idx_t f = 0; f < 5; ++f)
+    {
+        // Перед чтением кадра f он и следующий за ним уже в кольце, кадр f - в слоте f % 2
+        CHECK(reads == std::min<idx_t>(f + 2, 5));
+        std::vector<pixel_t> slot(frame);
+        source.video().get_run(f % 2, 0, slot.data(), frame);
+
+        // Кадр читается двумя пакетами через границу строки
+        CHECK(source.pop_n(dst.data(), 5) == 5);
+        CHECK(source.pop_n(dst.data() + 5, frame - 5) == frame - 5);
+        for (idx_t k = 0; k < frame; ++k)
+            same = same && dst[k] == static_cast<pixel_t>((f * 50 + k) % 256) && slot[k] == dst[k];
+    }
+    CHECK(same);
+
+    // После конца файла frames() - количество прочитанных кадров
+    CHECK(source.frames() == 5);
+    CHECK(source.frame() == 5);
+    CHECK(source.pop_n(dst.data(), 1) == 0);
+}
+
+TEST_CASE("Test Deserializer Stream")
+{
+    // 4 кадра 2x2 в кольце из 2 кадров по 32 бита: насыщение до 8 бит только при записи кадра
+    const idx_t frame = 2 * 2 * 3;
+    std::vector<std::vector<uint8_t>> written;
+    idx_t finished = 0;
+
+    vsim::Deserializer target;
+    target.init_stream(std::unique_ptr<vsim::FrameSink>(new FakeSink(2, 2, written, finished)), 4, 2, 2, 3, 25);
+    CHECK(target.frames() == 4);
+    CHECK(target.video().frames() == 2);
+    CHECK(target.video().sample_type() == clib::sample_t::i32);
+
+    std::vector<pixel_t> src(frame);
+    for (idx_t k = 0; k < frame; ++k)
+        src[k] = static_cast<pixel_t>(k * 30) - 20;
+
+    // Кадр записывается, как только курсор его проходит
+    CHECK(target.push_n(src.data(), frame - 1) == frame - 1);
+    CHECK(written.empty());
+    CHECK(target.video().get(0, 1, 1, 1) == src[frame - 2]);
+    target.push(src[frame - 1]);
+    REQUIRE(written.size() == 1);
+    bool same = true;
+    for (idx_t k = 0; k < frame; ++k)
+        same = same && written[0][k] == clib::detail::to_sample<uint8_t>(src[k]);
+    CHECK(same);
+
+    // Слот записанного кадра очищен для кадра 2
+    CHECK(target.video().get(0, 1, 1, 1) == 0);
+
+    // Кадр 1 целиком и начало кадра 2, который попадает в слот 0
+    CHECK(target.push_frame(src.data()) == frame);
+    CHECK(written.size() == 2);
+    CHECK(target.push_n(src.data(), 4) == 4);
+    CHECK(written.size() == 2);
+    CHECK(target.video().get(0, 0, 1, 0) == src[3]);
+    CHECK(target.video().get(0, 1, 0, 0) == 0);
+
+    // write() дописывает неполный кадр 2 и незаполненный кадр 3 нулями и завершает вывод один раз
+    target.write("ignored.mp4");
+    REQUIRE(written.size() == 4);
+    CHECK(finished == 1);
+    same = true;
+    for (idx_t k = 0; k < frame; ++k)
+    {
+        same = same && written[2][k] == (k < 4 ? clib::detail::to_sample<uint8_t>(src[k]) : 0);
+        same = same && written[3][k] == 0;
+    }
+    CHECK(same);
+}
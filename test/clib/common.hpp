@@ -1,10 +1,13 @@
 #pragma once
 
+#include "clib/Flexfloat.hpp"
+#include "clib/image.hpp"
 #include "clib/logs.hpp"
 
 #include <cassert>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include <iomanip> // std::setprecision, std::setw
 #include <iostream>
@@ -22,4 +25,16 @@ extern boost::log::sources::severity_logger<clib::severity_level> slg;
 template <typename T> bool check_bitwise_eq(T a, T b)
 {
     return !strncmp(reinterpret_cast<char *>(&a), reinterpret_cast<char *>(&b), sizeof(T));
-}
\ No newline at end of file
+}
+
+/*! @brief Тестовый кадр формата (8, 23, 127): ((i * 29 + j * 13 + seed) % 97) * scale
+ */
+inline clib::img<clib::Flexfloat> make_frame(size_t rows, size_t cols, int seed, float scale = 1.0f)
+{
+    std::vector<std::vector<clib::Flexfloat>> vv(rows, std::vector<clib::Flexfloat>(cols));
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            vv[i][j] = clib::Flexfloat::from_arithmetic_t(
+                8, 23, 127, static_cast<float>((i * 29 + j * 13 + static_cast<size_t>(seed)) % 97) * scale);
+    return clib::img<clib::Flexfloat>(vv);
+}